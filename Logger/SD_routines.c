@@ -3,7 +3,27 @@
 #include "SD_routines.h"
 
 static volatile uint8_t CardType = 0;
-static uint16_t wait_ready(void);
+static uint8_t state = SD_READY;	/* See SD_poll */
+static uint8_t streaming = 0;		/* A multiple block write is in progress */
+static uint32_t busy_end;			/* Timeout of the block being programmed */
+
+/*-----------------------------------------------------------------------*
+ * Timeouts                                                              *
+ *-----------------------------------------------------------------------*
+ * Measured with timer1_timestamp, the same whatever the SPI clock or    *
+ * the number of loop iterations. The timer interrupt must be enabled,   *
+ * without it the timestamp wraps every 2.5 ms and a timeout never ends. *
+ *-----------------------------------------------------------------------*/
+static uint32_t deadline(uint16_t ms) {
+	return timer1_timestamp() + ms * (F_CPU / 1000);
+}
+
+static uint8_t expired(uint32_t end) {
+	return (int32_t) (timer1_timestamp() - end) > 0;
+}
+
+static uint16_t wait_ready(uint16_t ms);
+static void programming(void);
 
 uint8_t SD_init(void) {
 	uint8_t cmd = 0;
@@ -17,19 +37,18 @@ uint8_t SD_init(void) {
 		SPI_receive();	/* 80 dummy clocks */
 	}
 	
+	uint32_t end = deadline(SD_TIMEOUT_INIT);
 	if (SD_sendCommand(CMD0, 0) == 1) {			/* Enter Idle state */
 		if (SD_sendCommand(CMD8, 0x1AA) == 1) {	/* SDv2? */
 			for (uint8_t n = 0; n < 4; n++) {
 				ocr[n] = SPI_receive();		/* Get trailing return value of R7 resp */
 			}
 			if (ocr[2] == 0x01 && ocr[3] == 0xAA) {				/* The card can work at vdd range of 2.7-3.6V */
-				for (uint16_t i = 0; i < 1000; i++) {
-					if (SD_sendCommand(ACMD41, 1UL << 30) == 0) {
-						break;
-					}
+				while (SD_sendCommand(ACMD41, 1UL << 30) && !expired(end)) {
+					;
 				} /* Wait for leaving idle state (ACMD41 with HCS bit) */
 				
-				if (SD_sendCommand(CMD58, 0) == 0) {		/* Check CCS bit in the OCR */
+				if (!expired(end) && SD_sendCommand(CMD58, 0) == 0) {		/* Check CCS bit in the OCR */
 					for (uint8_t n = 0; n < 4; n++) {
 						ocr[n] = SPI_receive();
 					}
@@ -44,18 +63,18 @@ uint8_t SD_init(void) {
 				ty = CT_MMC;
 				cmd = CMD1;	/* MMCv3 */
 			}
-			for (uint16_t i = 0; i < 1000; i++) {
-				if (SD_sendCommand(cmd, 0) != 0) {	/* Wait for leaving idle state */
-					break;
-				}
+			while (SD_sendCommand(cmd, 0) && !expired(end)) {	/* Wait for leaving idle state */
+				;
 			}
-			if (SD_sendCommand(CMD16, 512) != 0) {	/* Set R/W block length to 512 */
+			if (expired(end) || SD_sendCommand(CMD16, 512) != 0) {	/* Set R/W block length to 512 */
 				ty = 0;
 			}
 		}
 	}
 	
 	CardType = ty;
+	state = SD_READY;
+	streaming = 0;
 	SPI_deselect();
 	
 	if (ty) {			/* Initialization succeded */
@@ -68,16 +87,15 @@ uint8_t SD_init(void) {
 /*-----------------------------------------------------------------------*
  * Wait for card ready                                                   *
  *-----------------------------------------------------------------------*/
-static uint16_t wait_ready(void) { /* 1:OK, 0:Timeout */
-	/* Wait for ready in timeout of 500ms */
+static uint16_t wait_ready(uint16_t ms) { /* 1:OK, 0:Timeout */
+	uint32_t end = deadline(ms);
 	SPI_receive();
-	for (uint8_t i = 0; i < 50; i++) {
-		if (SPI_receive() == 0xFF) {
-			return 1;
+	while (SPI_receive() != 0xFF) {
+		if (expired(end)) {
+			return 0;
 		}
-		_delay_ms(10);
 	}
-	return 0;
+	return 1;
 }
 
 /*-----------------------------------------------------------------------*
@@ -93,24 +111,21 @@ void SD_deselect(void) {
  *-----------------------------------------------------------------------*/
 uint16_t SD_select(void) {	/* 1:Successful, 0:Timeout */
 	SPI_select();
-	if (!wait_ready()) {
+	if (!wait_ready(SD_TIMEOUT_WRITE)) {	/* The last block written may still be programmed */
 		SD_deselect();
+		state = SD_TIMEOUT;
 		return 0;
 	}
+	state = SD_READY;
 	return 1;
 }
 
-uint8_t SD_sendCommand(uint8_t cmd, uint32_t arg) {
+/*-----------------------------------------------------------------------*
+ * Send a command, not an ACMD, and return its response                  *
+ *-----------------------------------------------------------------------*/
+static uint8_t send_command(uint8_t cmd, uint32_t arg) {
 	uint8_t res = 0;
 	
-	if (cmd & 0x80) {	/* ACMD<n> is the command sequense of CMD55-CMD<n> */
-		cmd &= 0x7F;
-		res = SD_sendCommand(CMD55, 0);
-		if (res > 1) {
-			return res;
-		}
-	}
-	
 	/* Select the card and wait for ready */
 	SD_deselect();
 	if (!SD_select()) {
@@ -147,17 +162,28 @@ uint8_t SD_sendCommand(uint8_t cmd, uint32_t arg) {
 	return res;				/* Return with the response value */
 }
 
+/*-----------------------------------------------------------------------*
+ * Send a command, an ACMD after CMD55, without recursion so that the    *
+ * stack is known, see make stack                                        *
+ *-----------------------------------------------------------------------*/
+uint8_t SD_sendCommand(uint8_t cmd, uint32_t arg) {
+	if (cmd & 0x80) {	/* ACMD<n> is the command sequense of CMD55-CMD<n> */
+		uint8_t res = send_command(CMD55, 0);
+		if (res > 1) {
+			return res;
+		}
+		cmd &= 0x7F;
+	}
+	return send_command(cmd, arg);
+}
+
 static uint8_t SD_receive (uint8_t *buff, uint16_t btr) {
 	uint8_t token;
 	
-	/* Wait for data packet in timeout of 200ms */
-	for (uint8_t i = 0; i < 20; i++) {
+	uint32_t end = deadline(SD_TIMEOUT_READ);	/* Wait for data packet */
+	do {
 		token = SPI_receive();
-		if (token != 0xFF) {
-			break;
-		}
-		_delay_ms(10);
-	}
+	} while (token == 0xFF && !expired(end));
 	if(token != 0xFE) {
 		return 0;		/* If not valid data token, retutn with error */
 	}
@@ -180,13 +206,12 @@ uint8_t SD_readSingleBlock(uint8_t *buff, uint32_t sector) {
 	if (!(CardType & CT_BLOCK)) {
 		sector *= 512;	/* Convert to byte address if needed */
 	}
-	if (SD_sendCommand(CMD17, sector) == 0) {
-		if (SD_receive(buff, 512)) {
-			return 1;
-		}
+	uint8_t res = 1;
+	if (SD_sendCommand(CMD17, sector) == 0 && SD_receive(buff, 512)) {
+		res = 0;
 	}
 	SD_deselect();
-	return 0;
+	return res;
 }
 
 uint16_t SD_readMultipleBlock (uint8_t *buff, uint32_t sector, uint16_t count) {
@@ -209,11 +234,14 @@ uint16_t SD_readMultipleBlock (uint8_t *buff, uint32_t sector, uint16_t count) {
 
 uint8_t SD_writeSingleBlock(uint8_t *buff, uint32_t sector) {
 	uint8_t response = 0;
-	uint16_t retry = 0;
 
+	if (!(CardType & CT_BLOCK)) {
+		sector *= 512;	/* Convert to byte address if needed */
+	}
 	response = SD_sendCommand(CMD24, sector); //write a Block command
 
 	if (response != 0x00) {
+		SD_deselect();
 		return response; //check for SD status: 0x00 - OK (No flags set)
 	}
 
@@ -232,34 +260,23 @@ uint8_t SD_writeSingleBlock(uint8_t *buff, uint32_t sector) {
 		return response;             //AAA='110'-data rejected due to write error
 	}
 
-	while (!SPI_receive()) { //wait for SD card to complete writing and get idle
-		if (retry++ > 0xfffe) {
-			SD_deselect();
-			return 1;
-		}
-	}
-
-	SD_deselect();
-	SPI_transmit(0xff);   //just spend 8 clock cycle delay before reasserting the CS line
-	SD_select();         //re-asserting the CS line to verify if card is still busy
-
-	while (!SPI_receive()) { //wait for SD card to complete writing and get idle
-		if (retry++ > 0xfffe) {
-			SD_deselect();
-			return 1;
-		}
-	}
-	SD_deselect();
+	programming(); //the card programs the block while the caller goes on, see SD_poll
 	return 0;
 }
 
 uint8_t SD_writeMultipleBlock(uint8_t *buff, uint32_t sector, uint16_t count) {
 	uint8_t response;
-	uint16_t retry = 0;
 	
+	if (CardType & CT_SDC) {
+		SD_sendCommand(ACMD23, count); //pre-erase, only a hint to the card
+	}
+	if (!(CardType & CT_BLOCK)) {
+		sector *= 512;	/* Convert to byte address if needed */
+	}
 	response = SD_sendCommand(CMD25, sector); //write a Block command
 	
 	if (response != 0x00) {
+		SD_deselect();
 		return response; //check for SD status: 0x00 - OK (No flags set)
 	}
 	
@@ -269,6 +286,7 @@ uint8_t SD_writeMultipleBlock(uint8_t *buff, uint32_t sector, uint16_t count) {
 		for(uint16_t i = 0; i < 512; i++) { //send 512 bytes data
 			SPI_transmit(buff[i]);
 		}
+		buff += 512;
 		
 		SPI_transmit(0xff); //transmit dummy CRC (16-bit), CRC is ignored here
 		SPI_transmit(0xff);
@@ -279,42 +297,151 @@ uint8_t SD_writeMultipleBlock(uint8_t *buff, uint32_t sector, uint16_t count) {
 			return response;             //AAA='110'-data rejected due to write error
 		}
 		
-		while (!SPI_receive()) { //wait for SD card to complete writing and get idle
-			if (retry++ > 0xfffe) {
-				SD_deselect();
-				return 1;
-			}
+		if (!wait_ready(SD_TIMEOUT_WRITE)) { //wait for SD card to complete writing and get idle
+			SD_deselect();
+			state = SD_TIMEOUT;
+			return 1;
 		}
-		
-		SPI_receive(); //extra 8 bits
 	}
 	
 	SPI_transmit(0xfd); //send 'stop transmission token'
+	SPI_receive();
 	
-	retry = 0;
+	programming(); //the card finishes while the caller goes on, see SD_poll
+	return 0;
+}
+
+/*-----------------------------------------------------------------------*
+ * Streaming multiple block write                                        *
+ *-----------------------------------------------------------------------*
+ * Like SD_writeMultipleBlock, but the blocks are handed over one at a   *
+ * time as they become available. The card stays selected from           *
+ * SD_stream_start to SD_stream_stop, no other command may be sent in    *
+ * between. SD_stream_write returns as soon as the block is accepted,    *
+ * the card programs it while the next block is being collected.         *
+ *-----------------------------------------------------------------------*/
+uint8_t SD_stream_start(uint32_t sector, uint32_t count) {
+	streaming = 0;
+	if (CardType & CT_SDC) {
+		SD_sendCommand(ACMD23, count > 0x7FFFFF ? 0x7FFFFF : count); //pre-erase, only a hint to the card
+	}
+	if (!(CardType & CT_BLOCK)) {
+		sector *= 512;	/* Convert to byte address if needed */
+	}
+	if (SD_sendCommand(CMD25, sector) != 0) {
+		SD_deselect();
+		return 1;
+	}
+	SPI_receive(); //one byte gap before the first data token
+	streaming = 1;
+	return 0;
+}
+
+uint8_t SD_stream_write(const uint8_t *buff) {
+	uint8_t response;
 	
-	while (!SPI_receive()) { //wait for SD card to complete writing and get idle
-		if (retry++ > 0xfffe) {
-			SD_deselect();
+	while (!SD_stream_ready()) { //wait for the previous block to be programmed
+		if (state == SD_TIMEOUT) {
 			return 1;
 		}
 	}
-	
-	SD_deselect();
-	SPI_transmit(0xff); //just spend 8 clock cycle delay before reasserting the CS signal
-	SD_select(); //re assertion of the CS signal is required to verify if card is still busy
-	
-	retry = 0;
-	
-	while(!SPI_receive()) { //wait for SD card to complete writing and get idle
-		if(retry++ > 0xfffe) {
+	SD_stream_begin(buff);
+	while ((response = SD_stream_result()) == 0xff) {
+		;
+	}
+	return response;
+}
+
+/*-----------------------------------------------------------------------*
+ * The same in steps, the block is sent from the SPI interrupt           *
+ *-----------------------------------------------------------------------*
+ * SD_stream_ready tells if the card has finished programming the        *
+ * previous block, it never waits. SD_stream_begin then starts the       *
+ * block, SD_stream_result tells when it has been accepted.              *
+ *-----------------------------------------------------------------------*/
+static volatile uint8_t stream_response = 0;
+static uint8_t stream_rejected = 0;
+
+static void stream_done(uint8_t response) {
+	stream_response = response;
+}
+
+uint8_t SD_stream_ready(void) { /* 1:Ready for the next block, 0:Busy */
+	return SD_poll() == SD_READY;
+}
+
+void SD_stream_begin(const uint8_t *buff) {
+	state = SD_SENDING;
+	SPI_block_write(buff, 0xfc, stream_done); //start block token 0xfc (0x11111100)
+}
+
+uint8_t SD_stream_result(void) { /* 0xff:Sending, 0:Accepted, 1:Rejected */
+	if (SD_poll() == SD_SENDING) {
+		return 0xff;
+	}
+	return stream_rejected;
+}
+
+uint8_t SD_stream_stop(void) {
+	while (SD_poll() == SD_SENDING) { //the interrupt finishes the block
+		;
+	}
+	if (!wait_ready(SD_TIMEOUT_WRITE)) { //the last block must be programmed first
+		SD_deselect();
+		state = SD_TIMEOUT;
+		streaming = 0;
+		return 1;
+	}
+	SPI_transmit(0xfd); //send 'stop transmission token'
+	SPI_receive();
+	streaming = 0;
+	programming(); //the card finishes while the caller goes on, see SD_poll
+	return 0;
+}
+
+/*-----------------------------------------------------------------------*
+ * Card state, never waits                                               *
+ *-----------------------------------------------------------------------*
+ * After a block is written the card programs it, up to SD_TIMEOUT_WRITE *
+ * with garbage collection. Writes return as soon as the block has been  *
+ * accepted and the card stays selected, SD_poll clocks one byte at a    *
+ * time to see when it is done, while the caller goes on with other      *
+ * work. A command sent meanwhile waits for the card, see SD_select.     *
+ * SD_TIMEOUT is kept until the next command.                            *
+ *-----------------------------------------------------------------------*/
+static void programming(void) {
+	state = SD_BUSY;
+	busy_end = deadline(SD_TIMEOUT_WRITE);
+}
+
+uint8_t SD_poll(void) { /* SD_READY, SD_SENDING, SD_BUSY or SD_TIMEOUT */
+	if (state == SD_SENDING && !SPI_block_busy()) {
+		stream_rejected = (stream_response & 0x1f) != 0x05; //data not accepted
+		if (stream_rejected) {
+			SD_deselect(); //the card has ended the multiple block write
+			streaming = 0;
+			state = SD_READY;
+		} else {
+			programming();
+		}
+	} else if (state == SD_BUSY) {
+		if (SPI_receive() == 0xff) {
+			state = SD_READY;
+			if (!streaming) {
+				SD_deselect();
+			}
+		} else if (expired(busy_end)) {
 			SD_deselect();
-			return 1;
+			streaming = 0;
+			state = SD_TIMEOUT;
 		}
 	}
-	SD_deselect();
-	
-	return 0;
+	return state;
+}
+
+uint8_t SD_busy(void) { /* 1:Sending or programming, 0:Ready or failed */
+	uint8_t s = SD_poll();
+	return s == SD_SENDING || s == SD_BUSY;
 }
 
 uint8_t SD_sync() {
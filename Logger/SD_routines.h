@@ -40,6 +40,17 @@
 #define CT_SDC		(CT_SD1|CT_SD2)	/* SD */
 #define CT_BLOCK	0x08		/* Block addressing */
 
+/* Card states (SD_poll) */
+#define SD_READY	0		/* Idle, commands may be sent */
+#define SD_SENDING	1		/* A block is sent from the SPI interrupt */
+#define SD_BUSY		2		/* The card is programming */
+#define SD_TIMEOUT	3		/* The card did not get ready in time */
+
+/* Timeouts in ms, as in the SD specification */
+#define SD_TIMEOUT_INIT		1000	/* Leaving idle state */
+#define SD_TIMEOUT_READ		100		/* Data token of a read */
+#define SD_TIMEOUT_WRITE	500		/* Programming a block */
+
 uint8_t SD_init(void);
 
 void SD_deselect(void);
@@ -53,6 +64,16 @@ uint16_t SD_readMultipleBlock (uint8_t *buff, uint32_t sector, uint16_t count);
 uint8_t SD_writeSingleBlock(uint8_t *buff, uint32_t sector);
 uint8_t SD_writeMultipleBlock(uint8_t *buff, uint32_t sector, uint16_t count);
 
+uint8_t SD_stream_start(uint32_t sector, uint32_t count);
+uint8_t SD_stream_write(const uint8_t *buff);
+uint8_t SD_stream_ready(void);
+void SD_stream_begin(const uint8_t *buff);
+uint8_t SD_stream_result(void);
+uint8_t SD_stream_stop(void);
+
+uint8_t SD_poll(void);
+uint8_t SD_busy(void);
+
 uint8_t SD_sync(void);
 uint8_t SD_get_sector_count(void * buff);
 uint8_t SD_get_block_size(void * buff);
@@ -11,4 +11,13 @@ void SPI_high_speed(void);
 void SPI_select(void);
 void SPI_deselect(void);
 
+//! Bytes sent per SPI interrupt by SPI_block_write.
+#define SPI_BLOCK_BURST	32
+
+//! Called from the SPI interrupt with the data response of a block.
+typedef void (*spi_block_done_t)(uint8_t response);
+
+void SPI_block_write(const uint8_t *buff, uint8_t token, spi_block_done_t done);
+uint8_t SPI_block_busy(void);
+
 #endif
@@ -0,0 +1,433 @@
+/*
+ * canlog.c - Buffers CAN frames in sectors for the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file canlog.c
+ * \ref canlog buffers received CAN frames in sectors for the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref canlog.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup canlog Logger - CAN Log Buffer
+ * \ref canlog.c collects received frames in two sector sized buffers. Only
+ * the first is its own, the second is lent for each log by
+ * canlog_init(uint16_t, uint16_t, uint8_t, uint8_t *), on the logger the
+ * window of FatFs, which is unused while a log is written, see
+ * \ref logfile_window, so that the two take one sector of the 2 KB of RAM of
+ * the ATmega32M1 instead of two.
+ *
+ * canlog_frame(uint32_t, uint32_t, uint8_t, uint8_t *) is called from
+ * \ref CAN_ISR_RXOK and appends the frame to the sector being filled. A full
+ * sector is handed over to the main loop and filling continues in the other
+ * buffer, so the interrupt never waits for the card. The main loop fetches
+ * full sectors with canlog_next(void), writes them and returns them with
+ * canlog_release(void).
+ *
+ * Should both buffers be waiting for the card, frames are dropped and
+ * counted. The count is stored in the header of the next sector, so the log
+ * itself shows where and how many frames were lost. Frames arriving after a
+ * log has ended are counted too, see canlog_missed(void), and can be carried
+ * into the next log as dropped when it follows on, eg. in the next file.
+ *
+ * <b>Log format</b>
+ *
+ * A log starts with a session sector, \ref canlog_session_t, followed by
+ * blocks of one sector each. Every block starts with a \ref canlog_header_t
+ * and can be decoded on its own, a damaged block, eg. the last one written
+ * before power was lost, is recognised by its CRC and costs only that block.
+ * All values are little endian. Each record is:
+ * - a tag byte, the DLC in the high nibble and a dictionary slot in the low,
+ * - if the slot is \ref CANLOG_LITERAL, the 29 bit ID in four bytes,
+ * - the time since the previous record, or since canlog_header_t::time for
+ *   the first record, in µs as an unsigned LEB128 varint,
+ * - DLC bytes of payload.
+ *
+ * The dictionary is empty at the start of each block. A literal ID is given
+ * the next free slot, up to \ref CANLOG_SLOTS, later frames with the same ID
+ * only store the slot. A typical 8 byte frame thus takes 11 bytes instead of
+ * the 40 of the old text format.
+ *
+ * A partially filled sector can be handed over with canlog_close(void), eg.
+ * once a second, so that little is lost at power off on a quiet bus.
+ *
+ * To end a log, eg. when the supply voltage is falling, canlog_finish(uint8_t)
+ * stops logging, hands over what is left and last an end sector,
+ * \ref canlog_end_t, which tells that the log is complete. Until the next
+ * canlog_init(uint16_t, uint16_t, uint8_t, uint8_t *) the buffers are
+ * unused, the second is given back and canlog_spare(void) lends the first to
+ * the main loop, eg. to open the next log.
+ *
+ * The number of frames logged, dropped and blocks written are read with
+ * canlog_frames(void), canlog_drops(void) and canlog_blocks(void) for the
+ * session index, see \ref logfile.
+ *
+ * The file does not depend on the LUR7 hardware and is stress tested on the
+ * host by the test in test_canlog.
+ *
+ * \see \ref canlog.h
+ * \see \ref main.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include "canlog.h"
+
+#ifndef F_CPU
+//! Timer clock stored in the session sector, as in \ref LUR7.h.
+#define F_CPU	16000000UL
+#endif
+
+//! The first sector buffer.
+static canlog_sector_t first;
+//! The two sector buffers, the second lent by \ref canlog_init.
+static canlog_sector_t * sectors[2] = {&first, NULL};
+//! Whether a sector is waiting to be written, set by the interrupt.
+static volatile uint8_t sector_full[2];
+//! Sector being filled by \ref canlog_frame.
+static volatile uint8_t fill = 0;
+//! Next sector to write, only used by the main loop.
+static uint8_t flush = 0;
+//! Sequence number of the next sector.
+static volatile uint32_t sequence = 0;
+//! Number of frames dropped since \ref canlog_init.
+static volatile uint32_t drops = 0;
+//! Number of frames logged since \ref canlog_init.
+static volatile uint32_t frames = 0;
+//! Log id stored in every sector.
+static uint16_t log_id = 0;
+//! Dictionary of the block being filled.
+static uint32_t dictionary[CANLOG_SLOTS];
+//! Number of used slots in \ref dictionary.
+static uint8_t slots = 0;
+//! Time of the last record in the block being filled, µs.
+static uint32_t last_time = 0;
+//! Number of frames arriving while \ref stopped.
+static volatile uint32_t missed = 0;
+//! Whether logging has been stopped by \ref canlog_finish, or not yet started.
+static volatile uint8_t stopped = 1;
+//! Whether the end sector has been handed over.
+static uint8_t ended = 0;
+
+//! Initialisation function.
+/*!
+ * Empties both buffers and restarts the sequence and drop counters. The
+ * session sector is put first in line to be written.
+ *
+ * \param new_id log id to store in every sector, see \ref canlog_session_t.
+ * \param number number of the log file.
+ * \param carry if set, the frames missed since the last log ended, see
+ * \ref canlog_missed, are counted as dropped before the first block.
+ * \param second \ref CANLOG_SECTOR_SIZE bytes for the second buffer, used
+ * until \ref canlog_finish returns 1.
+ */
+void canlog_init(uint16_t new_id, uint16_t number, uint8_t carry, uint8_t * second) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		sectors[1] = (canlog_sector_t *) second;
+		memset(sectors[0], 0, sizeof(canlog_sector_t));
+		memset(sectors[1], 0, sizeof(canlog_sector_t));
+		canlog_session_t * s = (canlog_session_t *) sectors[0];
+		s->magic = CANLOG_SESSION_MAGIC;
+		s->id = new_id;
+		s->version = CANLOG_VERSION;
+		s->time_shift = CANLOG_TIME_SHIFT;
+		s->clock = F_CPU;
+		s->session = number;
+		sector_full[0] = 1;
+		sector_full[1] = 0;
+		fill = 1;
+		flush = 0;
+		sequence = 0;
+		drops = carry ? missed : 0;
+		missed = 0;
+		frames = 0;
+		log_id = new_id;
+		stopped = 0;
+		ended = 0;
+	}
+}
+
+//! Helper function, hands over the sector being filled.
+/*!
+ * Must be called with interrupts disabled.
+ */
+static void canlog_handover(void) {
+	sector_full[fill] = 1;
+	fill ^= 1;
+}
+
+//! Logs a frame.
+/*!
+ * To be called from \ref CAN_ISR_RXOK. The block header is written when the
+ * first frame is added, the block is handed over when the next frame might
+ * not fit.
+ *
+ * \param stamp timestamp of the frame, see \ref timer1_timestamp.
+ * \param id 29 bit CAN ID.
+ * \param dlc number of data bytes, at most 8.
+ * \param data the payload.
+ */
+void canlog_frame(uint32_t stamp, uint32_t id, uint8_t dlc, uint8_t * data) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		canlog_sector_t * s = sectors[fill];
+		uint32_t now = (stamp >> CANLOG_TIME_SHIFT) & CANLOG_TIME_MASK;
+		if (stopped) {
+			missed++; // log ended, frames are not part of it
+		} else if (sector_full[fill]) {
+			drops++; // both buffers are waiting for the card
+		} else {
+			if (s->header.count == 0) {
+				s->header.magic = CANLOG_MAGIC;
+				s->header.id = log_id;
+				s->header.sequence = sequence++;
+				s->header.drops = drops;
+				s->header.time = now;
+				slots = 0;
+				last_time = now;
+			}
+			if (dlc > 8) {
+				dlc = 8;
+			}
+
+			uint8_t * p = &s->data[s->header.used];
+			uint8_t slot = 0;
+			while (slot < slots && dictionary[slot] != id) {
+				slot++;
+			}
+			if (slot == slots) { // not in dictionary
+				*p++ = (dlc << 4) | CANLOG_LITERAL;
+				*p++ = id;
+				*p++ = id >> 8;
+				*p++ = id >> 16;
+				*p++ = id >> 24;
+				if (slots < CANLOG_SLOTS) {
+					dictionary[slots++] = id;
+				}
+			} else {
+				*p++ = (dlc << 4) | slot;
+			}
+
+			uint32_t delta = (now - last_time) & CANLOG_TIME_MASK;
+			last_time = now;
+			while (delta >= 0x80) {
+				*p++ = delta | 0x80;
+				delta >>= 7;
+			}
+			*p++ = delta;
+
+			memcpy(p, data, dlc);
+			p += dlc;
+
+			s->header.used = p - s->data;
+			s->header.count++;
+			frames++;
+			if (s->header.used > CANLOG_DATA_SIZE - CANLOG_RECORD_MAX) {
+				canlog_handover();
+			}
+		}
+	}
+}
+
+//! Hands over a partially filled sector.
+/*!
+ * Does nothing if the sector being filled is empty, or if the other buffer is
+ * still waiting for the card, as frames would then be dropped until it has
+ * been written. On a busy bus the sector will soon be full anyway. Nor once
+ * the log has ended, the buffers are then no longer canlog's.
+ */
+void canlog_close(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (!stopped && sectors[fill]->header.count > 0 && !sector_full[fill] && !sector_full[fill ^ 1]) {
+			sectors[fill]->header.flags |= CANLOG_FLAG_CLOSED;
+			canlog_handover();
+		}
+	}
+}
+
+//! Gets the next sector to write.
+/*!
+ * To be called from the main loop, the sector is owned by the caller until
+ * \ref canlog_release is run. The CRC of the block is calculated here, outside
+ * of the interrupt.
+ *
+ * \return the oldest sector waiting to be written, or NULL if there is none.
+ */
+canlog_sector_t * canlog_next(void) {
+	uint8_t full;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		full = sector_full[flush];
+	}
+	if (!full) {
+		return NULL;
+	}
+	canlog_sector_t * s = sectors[flush];
+	if (s->header.magic == CANLOG_MAGIC) {
+		uint16_t crc = 0xFFFF;
+		for (uint16_t i = 0; i < s->header.used; i++) {
+			crc = _crc_ccitt_update(crc, s->data[i]);
+		}
+		s->header.crc = crc;
+	}
+	return s;
+}
+
+//! Returns a written sector.
+/*!
+ * Clears the sector returned by \ref canlog_next so that it can be filled
+ * again.
+ */
+void canlog_release(void) {
+	memset(sectors[flush], 0, sizeof(canlog_sector_t));
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		sector_full[flush] = 0;
+	}
+	flush ^= 1;
+}
+
+//! Ends the log.
+/*!
+ * To be called from the main loop when no sector is being written, until it
+ * returns 1. No more frames are logged. Sectors waiting are left to
+ * \ref canlog_next, then the partially filled sector and last the end sector
+ * are handed over.
+ *
+ * \param reason stored in the end sector, \ref CANLOG_END_POWER...
+ * \return 1 when the end sector has been written and released, the second
+ * buffer is then given back.
+ */
+uint8_t canlog_finish(uint8_t reason) {
+	uint8_t done = 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		stopped = 1;
+		canlog_sector_t * s = sectors[fill];
+		if (sector_full[flush]) {
+			// the main loop writes it first
+		} else if (s->header.count > 0) {
+			s->header.flags |= CANLOG_FLAG_CLOSED;
+			canlog_handover();
+		} else if (!ended) {
+			canlog_end_t * e = (canlog_end_t *) s;
+			e->magic = CANLOG_END_MAGIC;
+			e->id = log_id;
+			e->reason = reason;
+			e->blocks = sequence;
+			e->drops = drops;
+			ended = 1;
+			canlog_handover();
+		} else {
+			done = 1;
+		}
+	}
+	return done;
+}
+
+//! Lends a sector buffer.
+/*!
+ * Once \ref canlog_finish has returned 1, or before the first \ref canlog_init,
+ * the buffers are unused and the first may be used by the main loop, eg. by
+ * \ref logfile_open. The interrupt does not touch it and its content is lost
+ * at the next \ref canlog_init.
+ *
+ * \return a buffer of \ref CANLOG_SECTOR_SIZE bytes, NULL while logging.
+ */
+uint8_t * canlog_spare(void) {
+	uint8_t * spare = NULL;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (stopped && !sector_full[0] && !sector_full[1]) {
+			spare = (uint8_t *) sectors[0];
+		}
+	}
+	return spare;
+}
+
+//! Gets the number of dropped frames.
+/*!
+ * \return number of frames dropped since \ref canlog_init.
+ */
+uint32_t canlog_drops(void) {
+	uint32_t d;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		d = drops;
+	}
+	return d;
+}
+
+//! Gets the number of frames missed between logs.
+/*!
+ * \return number of frames since \ref canlog_finish, or since power up before
+ * the first log.
+ */
+uint32_t canlog_missed(void) {
+	uint32_t m;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		m = missed;
+	}
+	return m;
+}
+
+//! Gets the number of logged frames.
+/*!
+ * \return number of frames logged since \ref canlog_init.
+ */
+uint32_t canlog_frames(void) {
+	uint32_t f;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		f = frames;
+	}
+	return f;
+}
+
+//! Gets the number of blocks.
+/*!
+ * \return number of blocks started since \ref canlog_init.
+ */
+uint32_t canlog_blocks(void) {
+	uint32_t b;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		b = sequence;
+	}
+	return b;
+}
+
+//! Gets the amount of logged data not yet written.
+/*!
+ * Sectors waiting for the card count as full, a sector being written counts
+ * until it is released.
+ *
+ * \return bytes held in the buffers, at most two sectors.
+ */
+uint16_t canlog_buffered(void) {
+	uint16_t n = 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (uint8_t i = 0; i < 2; i++) {
+			if (sector_full[i]) {
+				n += sizeof(canlog_sector_t);
+			} else if (!stopped && sectors[i]->header.count > 0) {
+				n += sizeof(canlog_header_t) + sectors[i]->header.used;
+			}
+		}
+	}
+	return n;
+}
@@ -0,0 +1,148 @@
+/*
+ * canlog.h - Buffers CAN frames in sectors for the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file canlog.h
+ * \ref canlog buffers received CAN frames in sectors for the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref canlog.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup canlog
+ */
+
+#ifndef _CANLOG_H_
+#define _CANLOG_H_
+
+//! Size of a sector on the SD card.
+#define CANLOG_SECTOR_SIZE	512
+//! First four bytes of every block, "L7LB".
+#define CANLOG_MAGIC		0x424C374CUL
+//! First four bytes of the session sector, "L7LS".
+#define CANLOG_SESSION_MAGIC	0x534C374CUL
+//! First four bytes of the end sector, "L7LE".
+#define CANLOG_END_MAGIC	0x454C374CUL
+//! First four bytes of every entry of the session index, "L7LI".
+#define CANLOG_INDEX_MAGIC	0x494C374CUL
+//! Version of the log format.
+#define CANLOG_VERSION		2
+
+//! Timer clocks per time unit as a shift, 16 clocks = 1 µs.
+#define CANLOG_TIME_SHIFT	4
+//! Times are stored modulo 2^28 µs, about 268 s.
+#define CANLOG_TIME_MASK	0x0FFFFFFFUL
+
+//! Number of IDs in the dictionary of a block.
+#define CANLOG_SLOTS		15
+//! Tag slot meaning the full ID follows.
+#define CANLOG_LITERAL		0x0F
+//! Longest record: tag, ID, time and data.
+#define CANLOG_RECORD_MAX	(1 + 4 + 4 + 8)
+
+//! Set in canlog_header_t::flags if the block was closed before it was full.
+#define CANLOG_FLAG_CLOSED	0x01
+
+//! Block header.
+typedef struct {
+	uint32_t magic;		//!< \ref CANLOG_MAGIC.
+	uint16_t id;		//!< Log id, see canlog_session_t::id.
+	uint16_t used;		//!< Number of bytes of records.
+	uint32_t sequence;	//!< Block number, counting from 0 at \ref canlog_init.
+	uint32_t drops;		//!< Frames dropped since \ref canlog_init, before this block.
+	uint32_t time;		//!< Time of the first record, µs modulo 2^28.
+	uint16_t crc;		//!< CRC-16 (CCITT, reflected, start 0xFFFF) of the records.
+	uint8_t count;		//!< Number of records.
+	uint8_t flags;		//!< \ref CANLOG_FLAG_CLOSED.
+} canlog_header_t;
+
+//! Bytes of records in a block.
+#define CANLOG_DATA_SIZE	(CANLOG_SECTOR_SIZE - 24)
+
+//! A block, one sector on the card.
+typedef struct {
+	canlog_header_t header;
+	uint8_t data[CANLOG_DATA_SIZE];	//!< Records, unused bytes zero.
+} canlog_sector_t;
+
+//! The first sector of a log.
+typedef struct {
+	uint32_t magic;		//!< \ref CANLOG_SESSION_MAGIC.
+	uint16_t id;		//!< Log id, counted up for every log, tells stale sectors of earlier logs apart.
+	uint8_t version;	//!< \ref CANLOG_VERSION.
+	uint8_t time_shift;	//!< \ref CANLOG_TIME_SHIFT.
+	uint32_t clock;		//!< Timer clock in Hz.
+	uint16_t session;	//!< Number of the log file.
+} canlog_session_t;
+
+//! The sector after the last block of a log.
+typedef struct {
+	uint32_t magic;		//!< \ref CANLOG_END_MAGIC.
+	uint16_t id;		//!< Log id, see canlog_session_t::id.
+	uint8_t reason;		//!< Why the log ended, \ref CANLOG_END_POWER...
+	uint8_t reserved;
+	uint32_t blocks;	//!< Number of blocks in the log.
+	uint32_t drops;		//!< Frames dropped in the whole log.
+} canlog_end_t;
+
+//! canlog_end_t::reason, supply voltage falling.
+#define CANLOG_END_POWER	1
+//! canlog_end_t::reason, end written at start up after power was lost.
+#define CANLOG_END_RECOVERED	2
+//! canlog_end_t::reason, stopped or restarted by a CAN message.
+#define CANLOG_END_STOP		3
+//! canlog_end_t::reason, the file is full, the log continues in the next file.
+#define CANLOG_END_ROTATE	4
+
+//! An entry of the session index, LOGINDEX.BIN, written when a log has ended.
+/*!
+ * Start and duration are measured from power up, logs with the same
+ * canlog_index_t::boot share the same time base. For a log ended at start up,
+ * \ref CANLOG_END_RECOVERED, only the session, id, reason, blocks and drops
+ * are known, the other fields are zero.
+ */
+typedef struct {
+	uint32_t magic;		//!< \ref CANLOG_INDEX_MAGIC.
+	uint16_t session;	//!< Number of the log file.
+	uint8_t reason;		//!< Why the log ended, as in the end sector.
+	uint8_t reserved;
+	uint16_t boot;		//!< Session of the first log since power up.
+	uint16_t id;		//!< Log id, see canlog_session_t::id.
+	uint32_t start;		//!< Start of the log, ms since power up.
+	uint32_t duration;	//!< Length of the log in ms.
+	uint32_t blocks;	//!< Number of blocks in the log.
+	uint32_t frames;	//!< Number of frames logged.
+	uint32_t drops;		//!< Frames dropped in the whole log.
+} canlog_index_t;
+
+void canlog_init(uint16_t, uint16_t, uint8_t, uint8_t *);
+void canlog_frame(uint32_t, uint32_t, uint8_t, uint8_t *);
+void canlog_close(void);
+canlog_sector_t * canlog_next(void);
+void canlog_release(void);
+uint32_t canlog_drops(void);
+uint32_t canlog_missed(void);
+uint32_t canlog_frames(void);
+uint32_t canlog_blocks(void);
+uint16_t canlog_buffered(void);
+uint8_t canlog_finish(uint8_t);
+uint8_t * canlog_spare(void);
+
+#endif // _CANLOG_H_
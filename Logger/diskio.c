@@ -32,9 +32,9 @@ uint8_t disk_initialize (uint8_t pdrv) {
 
 DRESULT disk_read (
 	uint8_t pdrv,		/* Physical drive nmuber to identify the drive */
-	uint8_t *buff,		/* Data buffer to store read data */
-	uint32_t sector,	/* Sector address in LBA */
-	uint16_t count		/* Number of sectors to read */
+	BYTE *buff,		/* Data buffer to store read data */
+	DWORD sector,	/* Sector address in LBA */
+	UINT count		/* Number of sectors to read */
 ) {
 	uint8_t res = 0;
 	
@@ -57,9 +57,9 @@ DRESULT disk_read (
 #if _USE_WRITE
 DRESULT disk_write (
 	uint8_t pdrv,			/* Physical drive nmuber to identify the drive */
-	const uint8_t *buff,	/* Data to be written */
-	uint32_t sector,		/* Sector address in LBA */
-	uint16_t count			/* Number of sectors to write */
+	const BYTE *buff,	/* Data to be written */
+	DWORD sector,		/* Sector address in LBA */
+	UINT count			/* Number of sectors to write */
 ) {
 	uint8_t res = 0;
 	uint8_t * buffer = (uint8_t *) buff;
@@ -0,0 +1,598 @@
+/*
+ * logfile.c - Writes the log file of the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logfile.c
+ * \ref logfile writes the log file of the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logfile.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup logfile Logger - Log File
+ * \ref logfile.c writes sectors to the log file without going through FatFs.
+ *
+ * When growing a file FatFs allocates clusters and updates the FAT as it
+ * goes, and every sector is a command of its own that waits for the card to
+ * finish the one before. Both give long and irregular write times. Instead the whole file,
+ * \ref LOGFILE_PREALLOC bytes, is allocated when it is opened and the
+ * directory entry is written with the full size. The cluster chain is read
+ * into a link map (FatFs fast seek) and sectors are streamed straight to the
+ * card with one multiple block write (CMD25, pre-erased with ACMD23) per
+ * fragment of the file. The FAT is only touched at open and close.
+ *
+ * Sectors are written in steps so that the main loop never waits for the
+ * card: logfile_ready(void) checks if the card has finished programming the
+ * previous sector, logfile_start(const uint8_t *) hands over the next one,
+ * which is sent from the SPI interrupt, and logfile_done(FRESULT *) tells
+ * when it has been accepted. logfile_write(const uint8_t *) does all three
+ * and waits.
+ *
+ * Normally the file is a single fragment, but up to \ref LOGFILE_FRAGMENTS
+ * are handled. Should the file be more fragmented than that, only the first
+ * fragments are written and the log continues in a new file at their end.
+ * Should the allocated space run out, the card is full.
+ *
+ * FatFs is not used from the end of logfile_open() to logfile_close(), so
+ * its window, 512 bytes of the FATFS object, is lent by logfile_window(void)
+ * for the second sector buffer of \ref canlog.
+ *
+ * When all but \ref LOGFILE_RESERVE sectors of the file are written,
+ * logfile_full(void) tells the main loop to end the log and continue in a new
+ * file. Every log that has ended is added to the session index,
+ * \ref LOGFILE_INDEX, by logfile_index(const canlog_index_t *), so that a
+ * run can be found without reading the logs, see \ref canlog_index_t.
+ *
+ * As the file always has the allocated size the end of the log is found from
+ * the contents, see \ref canlog_header_t. A log that is ended properly, eg.
+ * when the supply voltage falls, has an end sector after the last block, see
+ * \ref canlog_end_t. Should power have been lost before the end sector was
+ * written, it is added by \ref logfile_open the next time the logger starts:
+ * the last block is found by a binary search for the last sector i that is
+ * block i - 1 of the log, about 20 sector reads for a full file. The log
+ * is then also added to the index.
+ *
+ * Every log is given an id, counted up in EEPROM by \ref logfile_open and
+ * stored in the session sector and every block, see \ref canlog_session_t.
+ * Unlike the file number it is not used again when old logs are deleted, so
+ * stale sectors of an earlier log in the clusters of the new file are never
+ * taken for blocks of the new one. A sector given up by \ref logfile_skip
+ * leaves a hole in the log, the search looks up to \ref LOGFILE_HOLES
+ * sectors ahead to bridge it, and a log with that many sectors left out in a
+ * row continues in a new file.
+ *
+ * \see \ref logfile.h
+ * \see \ref logger_main
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include "canlog.h"
+#include "logfile.h"
+#include "logfilter.h"
+#include "SD_routines.h"
+
+#ifndef TRUE
+//! As in \ref LUR7.h, the file does not depend on the LUR7 hardware.
+#define TRUE	1
+//! As in \ref LUR7.h.
+#define FALSE	0
+#endif
+
+//! The file system.
+static FATFS fs;
+//! The log file.
+static FIL file;
+//! Fragments of \ref file still to be written, see \ref logfile_open.
+static struct {
+	uint32_t address;	//!< Card address of the next sector.
+	uint32_t left;		//!< Sectors left in the fragment, 0 after the last.
+} fragments[LOGFILE_FRAGMENTS];
+//! Fragment being written.
+static uint8_t fragment = 0;
+//! Whether a multiple block write is in progress.
+static uint8_t streaming = FALSE;
+//! Whether a sector is being sent from the SPI interrupt.
+static uint8_t sending = FALSE;
+//! Result of the last sector written.
+static FRESULT result = FR_OK;
+//! Number of sectors written to \ref file.
+static uint32_t count = 0;
+//! Sectors that may be written before the file is full, see \ref logfile_full.
+static uint32_t limit = 0;
+//! Sectors left out in a row by \ref logfile_skip.
+static uint8_t holes = 0;
+//! Id of the last log opened, kept over power cycles.
+static uint16_t EEMEM last_id;
+//! Number of \ref file.
+static uint16_t number_open = 0;
+//! Number of the last file closed by \ref logfile_close, it needs no recovery.
+static uint16_t number_closed = 0xFFFF;
+//! Files below this number exist, where the search for a free name starts.
+static uint16_t number_next = 0;
+
+//! Helper function, sets the name of log file \p n, LOGnnnn.BIN.
+static void logfile_name(char * name, uint16_t n) {
+	for (uint8_t i = 6; i >= 3; i--) {
+		name[i] = '0' + n % 10;
+		n /= 10;
+	}
+}
+
+//! Helper function, reads the first bytes of a sector of \ref file.
+static uint8_t read_sector(uint32_t sector, void * buff, UINT size) {
+	UINT br;
+	return f_lseek(&file, sector * 512) == FR_OK && f_read(&file, buff, size, &br) == FR_OK && br == size;
+}
+
+//! Helper function, checks if sector \p i of \ref file is block i - 1 of log \p id.
+static uint8_t is_block(uint32_t i, uint16_t id, canlog_header_t * h) {
+	return read_sector(i, h, sizeof(*h)) && h->magic == CANLOG_MAGIC && h->id == id && h->sequence == i - 1;
+}
+
+//! Helper function, checks if the log goes on at sector \p i, or after a hole of at most \ref LOGFILE_HOLES sectors.
+static uint8_t has_block(uint32_t i, uint32_t sectors, uint16_t id, canlog_header_t * h) {
+	for (uint32_t j = i; j < sectors && j <= i + LOGFILE_HOLES; j++) {
+		if (is_block(j, id, h)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+//! Helper function, checks if the last entry of the session index is log \p id, read into \p entry.
+static uint8_t index_has(uint16_t id, canlog_index_t * entry) {
+	UINT br;
+	uint8_t found = FALSE;
+	if (f_open(&file, LOGFILE_INDEX, FA_READ)) {
+		return FALSE;
+	}
+	if (file.fsize >= sizeof(*entry) && f_lseek(&file, (file.fsize / sizeof(*entry) - 1) * sizeof(*entry)) == FR_OK
+			&& f_read(&file, entry, sizeof(*entry), &br) == FR_OK && br == sizeof(*entry)) {
+		found = entry->magic == CANLOG_INDEX_MAGIC && entry->id == id;
+	}
+	f_close(&file);
+	return found;
+}
+
+//! What \ref logfile_recover reads, kept in the work buffer of \ref logfile_open.
+typedef struct {
+	canlog_session_t s;	//!< The session sector.
+	canlog_header_t h;	//!< A block header.
+	canlog_end_t e;		//!< The end sector.
+	canlog_index_t entry;	//!< The last entry of the index, then the entry added.
+} recovery_t;
+
+//! Helper function, adds the end sector to a log if it is missing.
+/*!
+ * Sector 0 is the session sector and sector i block i - 1, up to the end of
+ * the log, but for holes left by \ref logfile_skip. Past the end the sectors
+ * hold nothing or stale data of logs with other ids, so the last block can be
+ * found by a binary search, looking past holes of up to \ref LOGFILE_HOLES
+ * sectors. The end sector is written over the first 16 bytes of the next
+ * sector.
+ *
+ * The log is also added to the session index if it is missing there, with
+ * what can be told from the file.
+ *
+ * \param name the file of the log.
+ * \param r where the sectors are read.
+ */
+static void logfile_recover(const char * name, recovery_t * r) {
+	if (f_open(&file, name, FA_READ | FA_WRITE)) {
+		return;
+	}
+	uint32_t sectors = file.fsize / 512;
+	if (!read_sector(0, &r->s, sizeof(r->s)) || r->s.magic != CANLOG_SESSION_MAGIC) {
+		f_close(&file);
+		return;
+	}
+	uint32_t written = 0; // last sector of the log
+	uint32_t unwritten = sectors; // first sector after the log
+	while (unwritten - written > 1) {
+		uint32_t mid = written + (unwritten - written) / 2;
+		if (has_block(mid, sectors, r->s.id, &r->h)) {
+			written = mid;
+		} else {
+			unwritten = mid;
+		}
+	}
+	uint8_t complete = FALSE;
+	canlog_end_t * e = &r->e;
+	if (unwritten < sectors && read_sector(unwritten, e, sizeof(*e))) {
+		complete = e->magic == CANLOG_END_MAGIC && e->id == r->s.id;
+	}
+	if (!complete) {
+		e->magic = CANLOG_END_MAGIC;
+		e->id = r->s.id;
+		e->reason = CANLOG_END_RECOVERED;
+		e->reserved = 0;
+		e->blocks = unwritten - 1;
+		e->drops = (written > 0 && is_block(written, r->s.id, &r->h)) ? r->h.drops : 0;
+		UINT bw;
+		if (unwritten < sectors && f_lseek(&file, unwritten * 512) == FR_OK) { // else no room for an end sector
+			f_write(&file, e, sizeof(*e), &bw);
+		}
+	}
+	f_close(&file);
+
+	if (!index_has(r->s.id, &r->entry)) {
+		r->entry = (canlog_index_t) {
+			.magic = CANLOG_INDEX_MAGIC,
+			.session = r->s.session,
+			.id = r->s.id,
+			.reason = e->reason,
+			.blocks = e->blocks,
+			.drops = e->drops,
+		};
+		logfile_index(&r->entry);
+	}
+}
+
+//! Helper function, reads the rules of \ref logfilter from the card.
+/*!
+ * Without \ref LOGFILTER_FILE every frame is logged.
+ *
+ * \param line where each line is read, \ref LOGFILTER_LINE bytes.
+ */
+static void logfile_rules(char * line) {
+	logfilter_clear();
+	if (f_open(&file, LOGFILTER_FILE, FA_READ)) {
+		return;
+	}
+	while (f_gets(line, LOGFILTER_LINE, &file)) {
+		logfilter_parse(line);
+	}
+	f_close(&file);
+}
+
+//! Opens a new log file.
+/*!
+ * Mounts the card, reads the rules of \ref logfilter and creates the first
+ * free file name LOG0000.BIN to LOG9999.BIN. The previous log is ended if
+ * power was lost while it was written. The file is allocated and mapped, see \ref logfile.
+ *
+ * When the log continues from one file to the next the search starts after
+ * the last file, and the last file, closed properly, is not searched for its
+ * end, which keeps the time the log is changed short.
+ *
+ * The lines of the rules, the sectors read to end the previous log and the
+ * cluster link map are kept in \p work and take no RAM of their own. Of the
+ * link map only the fragments are kept, in \ref fragments.
+ *
+ * \param number set to the number of the file.
+ * \param id set to the id of the new log, one more than the last.
+ * \param work 512 bytes used until the function returns, eg. a sector buffer
+ * lent by \ref canlog_spare.
+ * \return FR_OK or the first error.
+ */
+FRESULT logfile_open(uint16_t * number, uint16_t * id, uint8_t * work) {
+	char name[] = "LOG0000.BIN";
+	FRESULT fr = f_mount(&fs, "", 1);
+	if (fr) {
+		return fr;
+	}
+	logfile_rules((char *) work);
+	uint16_t n = number_next;
+	while (1) {
+		if (n == 10000) {
+			return FR_EXIST;
+		}
+		logfile_name(name, n);
+		fr = f_open(&file, name, FA_READ);
+		if (fr == FR_NO_FILE) {
+			break;
+		} else if (fr) {
+			return fr;
+		}
+		f_close(&file);
+		n++;
+	}
+	if (n > 0 && n - 1 != number_closed) {
+		logfile_name(name, n - 1);
+		logfile_recover(name, (recovery_t *) work);
+		logfile_name(name, n);
+	}
+	*number = n;
+	*id = eeprom_read_word(&last_id) + 1;
+	eeprom_update_word(&last_id, *id); // before any sector of the log is written
+	fr = f_open(&file, name, FA_WRITE | FA_CREATE_NEW);
+	if (fr) {
+		return fr;
+	}
+	number_open = n;
+	number_next = n + 1;
+
+	fr = f_lseek(&file, LOGFILE_PREALLOC); // allocates the clusters, less if the card is full
+	if (!fr) {
+		fr = f_sync(&file); // FAT and directory entry written now
+	}
+	if (fr) {
+		return fr;
+	}
+	count = 0;
+	holes = 0;
+	limit = (file.fsize == LOGFILE_PREALLOC) ? LOGFILE_PREALLOC / 512 - LOGFILE_RESERVE : 0xFFFFFFFFUL;
+
+	DWORD * map = (DWORD *) work; // pairs of fragment length and first cluster, ended by 0
+	map[0] = 512 / sizeof(DWORD);
+	file.cltbl = map;
+	fr = f_lseek(&file, CREATE_LINKMAP);
+	file.cltbl = NULL;
+	if (fr && fr != FR_NOT_ENOUGH_CORE) { // else the map holds the first fragments
+		return fr;
+	}
+	uint32_t mapped = 0;
+	for (uint8_t i = 0; i < LOGFILE_FRAGMENTS; i++) {
+		if ((i == 0 || fragments[i - 1].left) && (fr || map[1 + 2 * i])) {
+			fragments[i].address = fs.database + (map[2 + 2 * i] - 2) * fs.csize;
+			fragments[i].left = map[1 + 2 * i] * fs.csize;
+		} else {
+			fragments[i].address = 0;
+			fragments[i].left = 0;
+		}
+		mapped += fragments[i].left;
+	}
+	if (mapped < file.fsize / 512) { // too fragmented, the log continues in a new file at the end of those
+		limit = mapped > LOGFILE_RESERVE ? mapped - LOGFILE_RESERVE : 0;
+	}
+	fragment = 0;
+	streaming = FALSE;
+	sending = FALSE;
+	return FR_OK;
+}
+
+//! Lends the window of FatFs.
+/*!
+ * To be called after \ref logfile_open. FatFs is not used until
+ * \ref logfile_close, which reads the window again. The window is clean,
+ * logfile_open has synced the file and only read the FAT since.
+ *
+ * \return the 512 bytes of the window.
+ */
+uint8_t * logfile_window(void) {
+	fs.winsect = 0xFFFFFFFF; // no sector in the window
+	return fs.win;
+}
+
+//! Checks if the next sector can be started.
+/*!
+ * Polls the card to see if it is still programming the previous sector, see
+ * \ref SD_poll. Never waits. Should the card not finish in time the multiple
+ * block write has been abandoned and is started again with the next sector.
+ *
+ * \return TRUE if \ref logfile_start may be called.
+ */
+uint8_t logfile_ready(void) {
+	if (sending) {
+		return FALSE;
+	}
+	switch (SD_poll()) {
+		case SD_READY:
+			return TRUE;
+		case SD_TIMEOUT:
+			streaming = FALSE; // the card has been deselected
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+//! Checks if the card is busy.
+/*!
+ * \return TRUE while a sector is sent or programmed by the card, a command
+ * sent now would wait for it.
+ */
+uint8_t logfile_busy(void) {
+	return SD_busy();
+}
+
+//! Starts writing a sector.
+/*!
+ * Writes the next sector of the file. The sector is sent from the SPI
+ * interrupt and the buffer must be left untouched until \ref logfile_done
+ * returns TRUE. To be called when \ref logfile_ready returns TRUE. When the
+ * allocated space is used up \ref logfile_done gives FR_DENIED, the card is
+ * full.
+ *
+ * \param buff the 512 bytes to write.
+ */
+void logfile_start(const uint8_t * buff) {
+	result = FR_OK;
+	if (fragments[fragment].left == 0) { // next fragment
+		if (streaming) {
+			SD_stream_stop();
+			streaming = FALSE;
+		}
+		if (fragment + 1 < LOGFILE_FRAGMENTS && fragments[fragment + 1].left) {
+			fragment++;
+		} else {
+			result = FR_DENIED; // allocated space used up, the card is full
+			return;
+		}
+	}
+	if (!streaming) { // new fragment, or the last sector was rejected
+		if (SD_stream_start(fragments[fragment].address, fragments[fragment].left)) {
+			result = FR_DISK_ERR;
+			return;
+		}
+		streaming = TRUE;
+	}
+
+	SD_stream_begin(buff);
+	sending = TRUE;
+	fragments[fragment].address++;
+	fragments[fragment].left--;
+	count++;
+}
+
+//! Checks if the sector started by \ref logfile_start is written.
+/*!
+ * \param fr set to FR_OK, FR_DISK_ERR or FR_DENIED when the card is full, once
+ * the sector is written. After FR_DISK_ERR the next sector started
+ * is written in the place of the rejected one.
+ * \return TRUE when the sector has been accepted by the card, or failed.
+ */
+uint8_t logfile_done(FRESULT * fr) {
+	if (sending) {
+		uint8_t res = SD_stream_result();
+		if (res == 0xff) {
+			return FALSE;
+		}
+		sending = FALSE;
+		if (res) {
+			streaming = FALSE; // the card ended the multiple block write
+			fragments[fragment].address--; // the next start writes the sector again
+			fragments[fragment].left++;
+			count--;
+			result = FR_DISK_ERR;
+		} else {
+			holes = 0;
+		}
+	}
+	*fr = result;
+	return TRUE;
+}
+
+//! Gives up a rejected sector.
+/*!
+ * To be called after \ref logfile_done set FR_DISK_ERR, when the sector is
+ * not to be written again. Its place is left as it was and the next sector is
+ * written after it, so that sector i of the file stays block i - 1 of the log,
+ * see \ref logfile_recover.
+ */
+void logfile_skip(void) {
+	if (fragments[fragment].left) {
+		fragments[fragment].address++;
+		fragments[fragment].left--;
+		count++;
+		holes++;
+	}
+}
+
+//! Writes a sector.
+/*!
+ * Writes the next sector of the file and waits until the card has accepted
+ * it.
+ *
+ * \param buff the 512 bytes to write.
+ * \return FR_OK, FR_DISK_ERR or FR_DENIED when the card is full.
+ */
+FRESULT logfile_write(const uint8_t * buff) {
+	FRESULT fr;
+	while (!logfile_ready()) { // at most SD_TIMEOUT_WRITE
+		;
+	}
+	logfile_start(buff);
+	while (!logfile_done(&fr)) {
+		;
+	}
+	return fr;
+}
+
+//! Checks if the log should continue in a new file.
+/*!
+ * \return TRUE when all but \ref LOGFILE_RESERVE sectors of the allocated
+ * file are written. Never when the card was too full to allocate the whole
+ * file, a new file would be smaller still. Also when so many sectors in a row
+ * have been left out by \ref logfile_skip that ending the log could make the
+ * hole longer than \ref LOGFILE_HOLES.
+ */
+uint8_t logfile_full(void) {
+	return count >= limit || holes + LOGFILE_RESERVE >= LOGFILE_HOLES;
+}
+
+//! Makes written data persistent.
+/*!
+ * \ref logfile_done only tells that the card accepted a sector, it may
+ * still be programming it and the multiple block write is open. The write is
+ * ended with the stop token and the card waited for until it has programmed
+ * the last sector, the next sector starts a new multiple block write. The
+ * directory entry is already complete.
+ *
+ * \return FR_OK, or FR_DISK_ERR if the card failed or timed out.
+ */
+FRESULT logfile_sync(void) {
+	FRESULT fr;
+	while (!logfile_done(&fr)) {
+		;
+	}
+	if (streaming) {
+		streaming = FALSE; // the next sector starts a new multiple block write
+		if (SD_stream_stop()) {
+			return FR_DISK_ERR;
+		}
+	}
+	uint8_t state;
+	while ((state = SD_poll()) == SD_BUSY) {
+		;
+	}
+	return state == SD_READY ? fr : FR_DISK_ERR;
+}
+
+//! Closes the log file.
+/*!
+ * Ends the multiple block write and closes the file. The file keeps its
+ * allocated size. The window lent by \ref logfile_window is taken back.
+ *
+ * \return FR_OK or the error of f_close.
+ */
+FRESULT logfile_close(void) {
+	FRESULT fr;
+	while (!logfile_done(&fr)) {
+		;
+	}
+	if (streaming) {
+		SD_stream_stop();
+		streaming = FALSE;
+	}
+	number_closed = holes ? 0xFFFF : number_open; // else the end sector may have been given up
+	return f_close(&file);
+}
+
+//! Adds an entry to the session index.
+/*!
+ * Appends \p entry to \ref LOGFILE_INDEX, which is created if it does not
+ * exist. A partially written entry at the end, eg. from a power loss, is
+ * overwritten. Must not be called while a log file is open.
+ *
+ * \param entry the entry.
+ * \return FR_OK or the first error.
+ */
+FRESULT logfile_index(const canlog_index_t * entry) {
+	UINT bw;
+	FRESULT fr = f_open(&file, LOGFILE_INDEX, FA_WRITE | FA_OPEN_ALWAYS);
+	if (fr) {
+		return fr;
+	}
+	fr = f_lseek(&file, file.fsize - file.fsize % sizeof(*entry));
+	if (!fr) {
+		fr = f_write(&file, entry, sizeof(*entry), &bw);
+		if (!fr && bw != sizeof(*entry)) {
+			fr = FR_DENIED; // card full
+		}
+	}
+	FRESULT fc = f_close(&file);
+	return fr ? fr : fc;
+}
@@ -0,0 +1,64 @@
+/*
+ * logfile.h - Writes the log file of the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logfile.h
+ * \ref logfile writes the log file of the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logfile.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup logfile
+ */
+
+#ifndef _LOGFILE_H_
+#define _LOGFILE_H_
+
+#include "ff.h"
+#include "canlog.h"
+
+#ifndef LOGFILE_PREALLOC
+//! Size of the log file allocated when it is created, in bytes. The log continues in a new file when it is full.
+#define LOGFILE_PREALLOC	(128UL * 1024 * 1024)
+#endif
+//! Sectors kept free at the end of the file for ending the log, the two buffers and the end sector.
+#define LOGFILE_RESERVE		3
+//! Name of the session index, see \ref canlog_index_t.
+#define LOGFILE_INDEX		"LOGINDEX.BIN"
+//! Number of fragments of the allocated file written, see \ref logfile_open.
+#define LOGFILE_FRAGMENTS	4
+//! Most sectors in a row a log may leave out, see \ref logfile_skip.
+#define LOGFILE_HOLES		8
+
+FRESULT logfile_open(uint16_t *, uint16_t *, uint8_t *);
+uint8_t * logfile_window(void);
+uint8_t logfile_ready(void);
+uint8_t logfile_busy(void);
+void logfile_start(const uint8_t *);
+uint8_t logfile_done(FRESULT *);
+void logfile_skip(void);
+FRESULT logfile_write(const uint8_t *);
+uint8_t logfile_full(void);
+FRESULT logfile_sync(void);
+FRESULT logfile_close(void);
+FRESULT logfile_index(const canlog_index_t *);
+
+#endif // _LOGFILE_H_
@@ -0,0 +1,272 @@
+/*
+ * logfilter.c - Selects the CAN frames logged by the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logfilter.c
+ * \ref logfilter selects the CAN frames logged by the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logfilter.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup logfilter Logger - Log Filter
+ * \ref logfilter.c decides which received frames are logged, to save space
+ * and write bandwidth on IDs that are sent far more often than needed.
+ *
+ * A table of up to \ref LOGFILTER_RULES rules is read from
+ * \ref LOGFILTER_FILE on the card when it is mounted, see \ref logfile_open.
+ * logfilter_keep(uint32_t, uint8_t, const uint8_t *) is called from
+ * \ref CAN_ISR_RXOK for every frame. The first rule matching the ID decides,
+ * frames matching no rule are logged. Without the file every frame is logged.
+ *
+ * One rule per line, anything after # is a comment:
+ *
+ *     keep    <id> [<mask>] [every <n>] [change]
+ *     exclude <id> [<mask>]
+ *
+ * The ID and mask are hex, a frame matches when its ID and the mask equal the
+ * ID and the mask, the default mask compares all 29 bits. "every n" keeps
+ * every nth frame, 1-255, and "change" keeps a frame when its payload differs
+ * from the last one kept. With both, a frame is kept when it has changed or
+ * when n frames have passed since the last one, so a constant value is still
+ * seen now and then. Eg.
+ *
+ *     keep 4502                    # neutral found, every one
+ *     keep 6000 1fffff00           # neutral finder debug, all of them
+ *     keep 1501 change every 100   # clutch position, on change or once a second
+ *     keep 2000 1ffffffc every 5   # DTA frames at a fifth of the rate
+ *     exclude 4500 1ffffff0        # not needed on this run
+ *
+ * Counters and the last payload are kept per rule, so "every" and "change"
+ * should be used on rules matching a single ID. The payload is compared by
+ * its CRC-16, a change with the same CRC, 1 in 65536, is missed until the next
+ * "every". Lines that can not be read are skipped. The table is read again,
+ * and counters restarted, for every new log.
+ *
+ * The file does not depend on the LUR7 hardware.
+ *
+ * \see \ref logfilter.h
+ * \see \ref logger_main
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "logfilter.h"
+
+//! The rules.
+static logfilter_rule_t rules[LOGFILTER_RULES];
+//! Number of rules in \ref rules, written last when a rule is added.
+static volatile uint8_t used = 0;
+
+//! Helper function, checks for a space between words.
+static uint8_t is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+//! Helper function, gets the next word of a line.
+/*!
+ * \param p position in the line, moved past the word.
+ * \return the word, zero terminated, or NULL at the end of the line.
+ */
+static char * word(char ** p) {
+	char * s = *p;
+	while (is_space(*s)) {
+		s++;
+	}
+	if (*s == '\0') {
+		*p = s;
+		return NULL;
+	}
+	char * w = s;
+	while (*s != '\0' && !is_space(*s)) {
+		s++;
+	}
+	if (*s != '\0') {
+		*s++ = '\0';
+	}
+	*p = s;
+	return w;
+}
+
+//! Helper function, reads a number.
+/*!
+ * \param s the word.
+ * \param base 16, with an optional 0x, or 10.
+ * \param value set to the number.
+ * \return 1 if the whole word is a number.
+ */
+static uint8_t number(const char * s, uint8_t base, uint32_t * value) {
+	uint32_t v = 0;
+	if (base == 16 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+		s += 2;
+	}
+	if (*s == '\0') {
+		return 0;
+	}
+	for (; *s; s++) {
+		uint8_t d;
+		if (*s >= '0' && *s <= '9') {
+			d = *s - '0';
+		} else if (base == 16 && *s >= 'a' && *s <= 'f') {
+			d = *s - 'a' + 10;
+		} else if (base == 16 && *s >= 'A' && *s <= 'F') {
+			d = *s - 'A' + 10;
+		} else {
+			return 0;
+		}
+		if (v > (0xFFFFFFFFUL - d) / base) {
+			return 0;
+		}
+		v = v * base + d;
+	}
+	*value = v;
+	return 1;
+}
+
+//! Removes all rules, every frame is logged.
+void logfilter_clear(void) {
+	used = 0;
+}
+
+//! Adds a rule.
+/*!
+ * To be called from the main loop with a line of \ref LOGFILTER_FILE, see
+ * \ref logfilter for the format. The line is modified.
+ *
+ * \param line the line, zero terminated.
+ * \return 1 if a rule was added or the line is empty, 0 if the line is not a
+ * rule or the table is full.
+ */
+uint8_t logfilter_parse(char * line) {
+	logfilter_rule_t r = {.mask = 0x1FFFFFFFUL, .every = 1};
+	uint8_t every = 0; // whether "every" was given
+	uint32_t v;
+	char * p = strchr(line, '#');
+	if (p != NULL) {
+		*p = '\0'; // comment
+	}
+	p = line;
+	char * w = word(&p);
+
+	if (w == NULL) {
+		return 1;
+	}
+	if (!strcmp(w, "exclude")) {
+		r.flags = LOGFILTER_EXCLUDE;
+	} else if (strcmp(w, "keep")) {
+		return 0;
+	}
+	w = word(&p);
+	if (w == NULL || !number(w, 16, &r.id)) {
+		return 0;
+	}
+	w = word(&p);
+	if (w != NULL && number(w, 16, &v)) {
+		r.mask = v;
+		w = word(&p);
+	}
+	for (; w != NULL; w = word(&p)) {
+		if (!strcmp(w, "every")) {
+			w = word(&p);
+			if (w == NULL || !number(w, 10, &v) || v < 1 || v > 255) {
+				return 0;
+			}
+			r.every = v;
+			every = 1;
+		} else if (!strcmp(w, "change")) {
+			r.flags |= LOGFILTER_CHANGE;
+		} else {
+			return 0;
+		}
+	}
+	if (r.flags & LOGFILTER_EXCLUDE && (every || r.flags & LOGFILTER_CHANGE)) {
+		return 0;
+	}
+	if (r.flags & LOGFILTER_CHANGE && !every) {
+		r.every = 0; // only on change
+	}
+	r.id &= r.mask;
+
+	if (used == LOGFILTER_RULES) {
+		return 0;
+	}
+	rules[used] = r;
+	used++; // the interrupt sees the rule only now
+	return 1;
+}
+
+//! Gets the number of rules.
+/*!
+ * \return number of rules added since \ref logfilter_clear.
+ */
+uint8_t logfilter_rules(void) {
+	return used;
+}
+
+//! Decides if a frame is logged.
+/*!
+ * To be called from \ref CAN_ISR_RXOK for every frame, updates the counters
+ * of the matching rule.
+ *
+ * \param id 29 bit CAN ID.
+ * \param dlc number of data bytes.
+ * \param data the payload.
+ * \return 1 if the frame is to be logged.
+ */
+uint8_t logfilter_keep(uint32_t id, uint8_t dlc, const uint8_t * data) {
+	uint8_t n = used;
+	for (uint8_t i = 0; i < n; i++) {
+		logfilter_rule_t * r = &rules[i];
+		if ((id & r->mask) != r->id) {
+			continue;
+		}
+		if (r->flags & LOGFILTER_EXCLUDE) {
+			return 0;
+		}
+		if (r->count < 0xFF) {
+			r->count++;
+		}
+		uint8_t keep = r->every && r->count >= r->every;
+		uint16_t crc = 0xFFFF;
+		if (r->flags & LOGFILTER_CHANGE) {
+			if (dlc > 8) {
+				dlc = 8;
+			}
+			crc = _crc_ccitt_update(crc, dlc);
+			for (uint8_t j = 0; j < dlc; j++) {
+				crc = _crc_ccitt_update(crc, data[j]);
+			}
+			if (!(r->flags & LOGFILTER_SEEN) || crc != r->crc) {
+				keep = 1;
+			}
+		}
+		if (keep) {
+			r->count = 0;
+			r->crc = crc;
+			r->flags |= LOGFILTER_SEEN;
+		}
+		return keep;
+	}
+	return 1;
+}
@@ -0,0 +1,64 @@
+/*
+ * logfilter.h - Selects the CAN frames logged by the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logfilter.h
+ * \ref logfilter selects the CAN frames logged by the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logfilter.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup logfilter
+ */
+
+#ifndef _LOGFILTER_H_
+#define _LOGFILTER_H_
+
+//! Most rules in the table.
+#define LOGFILTER_RULES		8
+//! Name of the file on the card the rules are read from.
+#define LOGFILTER_FILE		"LOGFILT.TXT"
+//! Longest line of \ref LOGFILTER_FILE, including the terminating zero.
+#define LOGFILTER_LINE		48
+
+//! logfilter_rule_t::flags, frames are dropped.
+#define LOGFILTER_EXCLUDE	0x01
+//! logfilter_rule_t::flags, frames are kept when the payload has changed.
+#define LOGFILTER_CHANGE	0x02
+//! logfilter_rule_t::flags, a frame has been kept, logfilter_rule_t::crc is valid.
+#define LOGFILTER_SEEN		0x80
+
+//! A rule, matching frames with (ID & mask) == id.
+typedef struct {
+	uint32_t id;		//!< ID, masked.
+	uint32_t mask;		//!< Bits of the ID compared.
+	uint8_t flags;		//!< \ref LOGFILTER_EXCLUDE, \ref LOGFILTER_CHANGE.
+	uint8_t every;		//!< Keep every Nth frame, 0 only on change.
+	uint8_t count;		//!< Frames since the last one kept.
+	uint16_t crc;		//!< CRC of the DLC and payload of the last frame kept.
+} logfilter_rule_t;
+
+void logfilter_clear(void);
+uint8_t logfilter_parse(char *);
+uint8_t logfilter_rules(void);
+uint8_t logfilter_keep(uint32_t, uint8_t, const uint8_t *);
+
+#endif // _LOGFILTER_H_
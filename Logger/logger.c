@@ -0,0 +1,332 @@
+/*
+ * logger.c - Controls the logs of the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logger.c
+ * \ref logger controls the logs of the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logger.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup logger Logger - Log Control
+ * \ref logger.c moves frames from the CAN interrupt to the card and decides
+ * when logs start and end. It is the main loop of the logger without the
+ * hardware, \ref logger_main calls logger_poll(void) in its loop and passes
+ * on the interrupts, so the same code runs on the host with an emulated card,
+ * see test_logger.
+ *
+ * Frames are selected by \ref logfilter and collected in sectors by
+ * \ref canlog from the CAN interrupt, logger_poll(void) writes full sectors to
+ * a new file LOGnnnn.BIN for each log, see \ref logfile. It never waits for
+ * the card, sectors are sent from the SPI interrupt and the card is polled
+ * while it is programming. Logs are only ended and opened once the card is
+ * idle, see \ref logfile_busy. A sector the card rejects is written again, up to
+ * \ref LOG_RETRIES times, then it is lost and the log goes on.
+ *
+ * Logging is started and stopped by \ref CAN_MSG_LOG_START and
+ * \ref CAN_MSG_LOG_STOP on \ref CAN_LOG_ID, sent by the mid MCU, and starts at
+ * power up if \ref LOG_AUTOSTART is set. START while logging ends the log and
+ * begins a new one, marking a new run. Each log is a new file, and when the
+ * file is full the log continues in the next one, see \ref logfile_full.
+ * Frames arriving while the file is changed are not logged, they are counted
+ * as dropped in the next log, which thus accounts for every frame since the
+ * last. So are those while the voltage is low, but not those between STOP and
+ * START. Every log that has ended is added to the session index with its
+ * start, duration and frame counts, see \ref canlog_index_t.
+ *
+ * When the analog comparator warns that the supply voltage is falling, see
+ * \ref LUR7_ancomp, logging stops and what is left is written followed by an
+ * end sector, at most two full sectors, the partially filled one and the end,
+ * about 5 ms with a responsive card. The file is then closed and the log
+ * added to the index. Should the voltage recover, a new log file is started.
+ * Logs torn by a sudden power loss are ended by \ref logfile_open at the next
+ * start.
+ *
+ * The file does not depend on the LUR7 hardware.
+ *
+ * \see \ref logger.h
+ * \see \ref logger_main
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <util/atomic.h>
+#include "canlog.h"
+#include "logfile.h"
+#include "logfilter.h"
+#include "logger.h"
+
+//! Whether the supply voltage is falling, see \ref logger_power.
+static volatile uint8_t power_fail = 0;
+//! Last start/stop message received, \ref LOG_CMD_NONE once handled.
+static volatile uint8_t command = LOG_CMD_NONE;
+//! Time since power up in units of 10 ms, counted by \ref logger_tick.
+static volatile uint32_t uptime = 0;
+
+//! Whether a log is open.
+static uint8_t logging = 0;
+//! Sector being written, NULL if none.
+static canlog_sector_t * writing = NULL;
+//! Whether \ref writing has been handed to \ref logfile_start.
+static uint8_t sending = 0;
+//! Whether \ref writing was closed before it was full.
+static uint8_t closed = 0;
+//! Times \ref writing has been rejected by the card.
+static uint8_t retries = 0;
+//! Why the log is being ended, 0 if it is not.
+static uint8_t ending = 0;
+//! Whether a new log is started once the current one has ended.
+static uint8_t restart = 0;
+//! Whether the next log follows on the last, see \ref canlog_init.
+static uint8_t carry = 0;
+
+//! Number of the log file being written.
+static uint16_t session;
+//! Id of the log being written, see \ref canlog_session_t.
+static uint16_t log_id;
+//! Number of the first log file since power up.
+static uint16_t boot;
+//! Whether \ref boot has been set.
+static uint8_t booted = 0;
+//! Start of the log being written, ms since power up.
+static uint32_t session_start;
+
+//! Helper function, gets the time since power up in ms.
+static uint32_t uptime_ms(void) {
+	uint32_t t;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		t = uptime;
+	}
+	return t * 10;
+}
+
+//! Helper function, takes the last start/stop message.
+/*!
+ * \return \ref LOG_CMD_NONE, \ref LOG_CMD_START or \ref LOG_CMD_STOP.
+ */
+static uint8_t take_command(void) {
+	uint8_t cmd;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		cmd = command;
+		command = LOG_CMD_NONE;
+	}
+	return cmd;
+}
+
+//! Helper function, starts a new log.
+/*!
+ * \return FR_OK or the error of \ref logfile_open, nothing is logged then.
+ */
+static FRESULT log_start(void) {
+	FRESULT fr = logfile_open(&session, &log_id, canlog_spare());
+	if (fr) {
+		return fr;
+	}
+	if (!booted) {
+		boot = session;
+		booted = 1;
+	}
+	session_start = uptime_ms();
+	canlog_init(log_id, session, carry, logfile_window());
+	carry = 0;
+	logging = 1;
+	return FR_OK;
+}
+
+//! Helper function, closes a log that has been ended and adds it to the index.
+/*!
+ * \param reason why the log ended, as in the end sector.
+ */
+static void log_end(uint8_t reason) {
+	canlog_index_t entry = {
+		.magic = CANLOG_INDEX_MAGIC,
+		.session = session,
+		.reason = reason,
+		.boot = boot,
+		.id = log_id,
+		.start = session_start,
+		.duration = uptime_ms() - session_start,
+		.blocks = canlog_blocks(),
+		.frames = canlog_frames(),
+		.drops = canlog_drops(),
+	};
+	logfile_close();
+	logfile_index(&entry);
+	logging = 0;
+}
+
+//! Initialisation function.
+/*!
+ * Starts the first log if \ref LOG_AUTOSTART is set. To be called before CAN
+ * is enabled, with the timer interrupt running for the card timeouts.
+ *
+ * \return FR_OK or the error of \ref logfile_open.
+ */
+FRESULT logger_init(void) {
+	if (LOG_AUTOSTART) {
+		return log_start();
+	}
+	return FR_OK;
+}
+
+//! Does the work of the main loop.
+/*!
+ * To be called over and over from the main loop, never waits for the card.
+ * Logs are ended, closed and opened here, which takes some time.
+ *
+ * <ul> <li> If logging and no sector is being written: <ol>
+ * <li> end the log if power is failing, restart when it is back,
+ * <li> on STOP, or START which begins a new log,
+ * <li> continue in a new file when this one is full.
+ * <li> once everything and the end sector are written and the card is idle,
+ * close the file. </ol>
+ * <li> If not logging, start a log on START or when power is back. </ul>
+ * <ul> <li> If the card is ready and a sector is waiting, start writing it,
+ * it is sent from the SPI interrupt.
+ * <li> If a sector is being written and has been accepted by the card, return
+ * the buffer, the card programs it meanwhile. </ul>
+ *
+ * \return FR_OK, or the error when a log could not be opened or a sector not
+ * written.
+ */
+FRESULT logger_poll(void) {
+	FRESULT fr = FR_OK;
+	if (logging && !writing) {
+		if (!ending) {
+			uint8_t cmd;
+			if (power_fail) {
+				ending = CANLOG_END_POWER;
+				restart = 1;
+			} else if ((cmd = take_command()) != LOG_CMD_NONE) {
+				ending = CANLOG_END_STOP;
+				restart = (cmd == LOG_CMD_START);
+			} else if (logfile_full()) {
+				ending = CANLOG_END_ROTATE;
+				restart = 1;
+			}
+		}
+		if (ending && canlog_finish(ending) && !logfile_busy()) {
+			log_end(ending);
+			ending = 0;
+			carry = restart;
+		}
+	} else if (!logging) {
+		uint8_t cmd = take_command();
+		if (cmd != LOG_CMD_NONE) { // START begins a new log, STOP cancels a restart
+			restart = (cmd == LOG_CMD_START);
+			carry = carry && restart;
+		}
+		if (restart && !power_fail && !logfile_busy()) { // wait for power to come back, or go
+			restart = 0;
+			fr = log_start();
+		}
+	}
+
+	if (!writing) {
+		if (logging && logfile_ready() && (writing = canlog_next()) != NULL) {
+			closed = writing->header.flags & CANLOG_FLAG_CLOSED;
+			retries = 0;
+			logfile_start((uint8_t *) writing);
+			sending = 1;
+		}
+	} else if (!sending) { // rejected, written again at the same place when the card is ready
+		if (logfile_ready()) {
+			logfile_start((uint8_t *) writing);
+			sending = 1;
+		}
+	} else if (logfile_done(&fr)) {
+		sending = 0;
+		if (fr == FR_DISK_ERR && retries < LOG_RETRIES) {
+			retries++;
+			return FR_OK; // not an error yet
+		}
+		if (fr == FR_DISK_ERR) {
+			logfile_skip(); // lost, the log goes on after it
+		}
+		canlog_release();
+		writing = NULL;
+		if (closed) {
+			logfile_sync(); // quiet bus, make sure the data is on the card
+		}
+	}
+	return fr;
+}
+
+//! Logs a frame.
+/*!
+ * To be called from \ref CAN_ISR_RXOK, frames are selected by \ref logfilter.
+ *
+ * \param stamp timestamp of the frame, see \ref timer1_timestamp.
+ * \param id 29 bit CAN ID.
+ * \param dlc number of data bytes.
+ * \param data the payload.
+ */
+void logger_frame(uint32_t stamp, uint32_t id, uint8_t dlc, uint8_t * data) {
+	if (logfilter_keep(id, dlc, data)) {
+		canlog_frame(stamp, id, dlc, data);
+	}
+}
+
+//! Passes on a start or stop message.
+/*!
+ * To be called from \ref CAN_ISR_RXOK, handled by \ref logger_poll.
+ *
+ * \param cmd \ref LOG_CMD_START or \ref LOG_CMD_STOP.
+ */
+void logger_command(uint8_t cmd) {
+	command = cmd;
+}
+
+//! Timer tick.
+/*!
+ * To be called from \ref timer1_isr_100Hz. Counts the time since power up,
+ * once a second a partially filled sector is handed over for writing.
+ *
+ * \param interrupt_nbr The id of the interrupt, counting from 0-99.
+ */
+void logger_tick(uint8_t interrupt_nbr) {
+	uptime++;
+	if (interrupt_nbr == 0) {
+		canlog_close();
+	}
+}
+
+//! Supply voltage warning.
+/*!
+ * To be called from the brown-out interrupts, the log is ended by
+ * \ref logger_poll while the voltage is low.
+ *
+ * \param failing 1 when the voltage is falling, 0 when it is stable again.
+ */
+void logger_power(uint8_t failing) {
+	power_fail = failing;
+}
+
+//! Checks if a log is open.
+/*!
+ * \return 1 while a log is open.
+ */
+uint8_t logger_logging(void) {
+	return logging;
+}
@@ -0,0 +1,58 @@
+/*
+ * logger.h - Controls the logs of the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logger.h
+ * \ref logger controls the logs of the LUR7 logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logger.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup logger
+ */
+
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#include <stdint.h>
+#include "ff.h"
+
+//! Whether logging starts at power up, otherwise at the first START message.
+#define LOG_AUTOSTART	1
+//! Times a sector is written again after the card rejected it.
+#define LOG_RETRIES		3
+
+//! \ref logger_command, no message received.
+#define LOG_CMD_NONE	0
+//! \ref logger_command, \ref CAN_MSG_LOG_START received.
+#define LOG_CMD_START	1
+//! \ref logger_command, \ref CAN_MSG_LOG_STOP received.
+#define LOG_CMD_STOP	2
+
+FRESULT logger_init(void);
+FRESULT logger_poll(void);
+void logger_frame(uint32_t, uint32_t, uint8_t, uint8_t *);
+void logger_command(uint8_t);
+void logger_tick(uint8_t);
+void logger_power(uint8_t);
+uint8_t logger_logging(void);
+
+#endif // _LOGGER_H_
@@ -16,81 +16,122 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "../header_and_config/LUR7.h"
+/*! \file Logger/main.c
+ * \ref logger_main is the Entry Point for execution of code on the logger.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logger.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup logger_main Logger - Main source file
+ * The logger records the frames on the CAN bus to the SD card. This file sets
+ * up the hardware and passes the interrupts on to \ref logger, which decides
+ * what is logged and when, and writes it to the card from the main loop.
+ *
+ * Frames received are handed to \ref logger_frame, start and stop messages on
+ * \ref CAN_LOG_ID to \ref logger_command, the 100 Hz timer to
+ * \ref logger_tick and the early warning of power loss to \ref logger_power.
+ * LED0 is lit when a log can not be opened or a sector not written, logging
+ * starts again at the next START message.
+ *
+ * \see \ref Logger/main.c
+ * \see \ref logger
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
 
-#include "ff.h"
+#include "../header_and_config/LUR7.h"
 
-#include "SPI_routines.h"
+#include <string.h>
+#include "logger.h"
 
-FATFS fs;
+//! Number of MObs receiving frames, more allows longer interrupt latency.
+#define LOG_MOBS	4
 
+//! Main function.
+/*!
+ * The structure of main is:
+ */
 int main(void) {
-	//io_init();
-	//adc_init();
-	//ancomp_init();
-	//can_init();
-	//timer1_init(OFF);
-	//power_off_default();
-	//power_off_timer0();
-	
+	//! <ul> <li> SETUP
+	//! <ul> <li> Initialisation <ol>
+	can_init(); //! <li> initialise LUR7_CAN.
+	timer1_init(OFF); //! <li> initialise LUR7_timer1, timestamps and 100 Hz interrupt.
+	ancomp_init(); //! <li> initialise LUR7_ancomp, early warning of power loss.
+	//! </ol>
+
 	DDRC |= 1 << DDC1;
 	DDRB |= 1 << DDB0;
-	interrupts_on();
-	//can_enable();
-	
-	set_output(LED0, ON);
-	
-	FIL file;
-	FRESULT fr;
-	UINT bw;
-	
-	_delay_ms(1000);
-	
-	fr = f_mount(&fs, "", 0);
-	_delay_ms(1000);
-	if (fr) {
-		//set_output(LED0, OFF);
-	} else {
-		fr = f_open(&file, "logloglo.txt", FA_WRITE);
-		if (fr) {/*
-			do {
-				set_output(LED0, ON);
-				_delay_ms(300);
-				set_output(LED0, OFF);
-				_delay_ms(300);
-				set_output(LED0, ON);
-			} while  (--fr);*/
-		} else {
-			fr = f_printf(&file, "Hello World!");
-			f_close(&file);
-		}
+
+	//! <li> Setup CAN RX, all extended frames <ol>
+	for (uint8_t i = 0; i < LOG_MOBS; i++) {
+		can_setup_rx(0, 0, 8);
+	}
+	//! </ol>
+
+	//! <li> Open log file <ol>
+	interrupts_on(); //! <li> enable interrupts, the card timeouts use \ref timer1_timestamp.
+	_delay_ms(1000); //! <li> let the card power up.
+	if (logger_init()) { //! <li> mount card and start the first log, see \ref LOG_AUTOSTART.
+		set_output(LED0, ON);
 	}
-	
+	//! </ol>
+
+	//! <li> Enable system <ol>
+	can_enable(); //! <li> enable CAN.
+	//! </ol>
+	//! </ul>
+
+	//! <li> LOOP
 	while (1) {
-		_delay_ms(1000);
-		SPI_transmit(0x00);
-		SPI_transmit(0xAA);
-		SPI_transmit(0x00);
+		if (logger_poll()) { //! <ul> <li> write sectors, start and end logs, see \ref logger_poll.
+			set_output(LED0, ON); // card full or failed
+		} //! </ul>
 	}
+	return 0; //! </ul>
 }
 
+//! Timer Interrupt, 100 Hz
+/*!
+ * Counts the time since power up and hands over partially filled sectors, see
+ * \ref logger_tick.
+ *
+ * \param interrupt_nbr The id of the interrupt, counting from 0-99.
+ */
+void timer1_isr_100Hz(uint8_t interrupt_nbr) {
+	logger_tick(interrupt_nbr);
+}
 
-void pcISR_in1(void) {}
-void pcISR_in2(void) {}
-void pcISR_in3(void) {}
-void pcISR_in4(void) {}
-void pcISR_in5(void) {}
-void pcISR_in6(void) {}
-void pcISR_in7(void) {}
-void pcISR_in8(void) {}
-void pcISR_in9(void) {}
-
-void timer1_isr_100Hz(uint8_t interrupt_nbr) {}
 void timer0_isr_stop(void) {}
 
-void CAN_ISR_RXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {}
+//! CAN Interrupt, received frames are logged as selected by \ref logfilter.
+/*!
+ * Start and stop messages, \ref CAN_LOG_ID, are logged too and passed to
+ * \ref logger_command.
+ */
+void CAN_ISR_RXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {
+	logger_frame(timer1_timestamp(), id, dlc, data);
+	if (id == CAN_LOG_ID && dlc == CAN_LOG_DLC) {
+		if (!memcmp(data, CAN_MSG_LOG_START, CAN_LOG_DLC)) {
+			logger_command(LOG_CMD_START);
+		} else if (!memcmp(data, CAN_MSG_LOG_STOP, CAN_LOG_DLC)) {
+			logger_command(LOG_CMD_STOP);
+		}
+	}
+}
 void CAN_ISR_TXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {}
 void CAN_ISR_OTHER(void) {}
 
-void early_bod_warning_ISR(void) {}
-void early_bod_safe_ISR(void) {}
+//! Supply voltage falling, \ref logger_poll ends the log.
+void early_bod_warning_ISR(void) {
+	logger_power(TRUE);
+}
+
+//! Supply voltage stable again.
+void early_bod_safe_ISR(void) {
+	logger_power(FALSE);
+}
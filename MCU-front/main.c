@@ -41,10 +41,6 @@
 #include "../header_and_config/LUR7.h"
 #include "config.h"
 
-//! Counter for pulses from left wheel speed sensor.
-volatile uint16_t wheel_count_l = 0;
-//! Counter for pulses from right wheel speed sensor.
-volatile uint16_t wheel_count_r = 0;
 //! Suspension sensor position for left wheel.
 volatile uint16_t susp_l = 0;
 //! Suspension sensor position for right wheel.
@@ -83,6 +79,7 @@ int main(void) {
 	ancomp_init(); //! <li> initialise LUR7_ancomp.
 	can_init(); //! <li> initialise LUR7_CAN.
 	timer1_init(OFF); //! <li> initialise LUR7_timer1.
+	wheel_init(); //! <li> initialise LUR7_wheel.
 	//! </ol>
 	//! <li> LUR7_power. <ol>
 	power_off_default(); //! <li> power off unused periferals.
@@ -133,32 +130,31 @@ int main(void) {
 	return 0;
 }
 
+//! Pin Change handler for \ref WHEEL_R.
 /*!
- * \ref WHEEL_R causes an interrupt incrementing the value of \ref wheel_count_r.
+ * A rising edge on \ref WHEEL_R is timestamped, see \ref LUR7_wheel.
  */
-void pcISR_in1(void) {
-	wheel_count_r++;
+static void wheel_r_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_RISING) {
+		wheel_edge(WHEEL_RIGHT, timestamp);
+	}
 }
+
+//! Pin Change handler for \ref WHEEL_L.
 /*!
- * \ref WHEEL_R causes an interrupt incrementing the value of \ref wheel_count_r.
+ * A rising edge on \ref WHEEL_L is timestamped, see \ref LUR7_wheel.
  */
-void pcISR_in2(void) {
-	wheel_count_l++;
+static void wheel_l_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_RISING) {
+		wheel_edge(WHEEL_LEFT, timestamp);
+	}
 }
-/*! \note unused input */
-void pcISR_in3(void) {}
-/*! \warning used as analog input */
-void pcISR_in4(void) {}
-/*! \note unused input */
-void pcISR_in5(void) {}
-/*! \warning used as analog input */
-void pcISR_in6(void) {}
-/*! \note unused input */
-void pcISR_in7(void) {}
-/*! \warning used as analog input */
-void pcISR_in8(void) {}
-/*! \warning used as analog input */
-void pcISR_in9(void) {}
+
+//! Pin Change Interrupt handlers, only the wheel speed sensors are used.
+PC_HANDLERS = {
+	[WHEEL_R] = wheel_r_change,
+	[WHEEL_L] = wheel_l_change,
+};
 
 /*!
  * In order to schedule tasks or perform them with a well defined time delta,
@@ -176,15 +172,15 @@ void pcISR_in9(void) {}
  * | \p interrupt_nbr | Wheel speed log | suspension log | brake and steering log |
  * | :--------------: | :-------------: | :------------: | :--------------------: |
  * | 0, 10, 20, .. 90 | x               |                |                        |
- * | 1, 11, 21, .. 91 |                 |                | x                      |
- * | 2, 12, 22, .. 92 |                 |                |                        |
- * | 3, 13, 23, .. 93 |                 | x              |                        |
- * | 4, 14, 24, .. 94 |                 |                |                        |
- * | 5, 15, 25, .. 95 |                 |                |                        |
- * | 6, 16, 26, .. 96 |                 |                | x                      |
- * | 7, 17, 27, .. 97 |                 |                |                        |
- * | 8, 18, 28, .. 98 |                 | x              |                        |
- * | 9, 19, 29, .. 99 |                 |                |                        |
+ * | 1, 11, 21, .. 91 | x               |                | x                      |
+ * | 2, 12, 22, .. 92 | x               |                |                        |
+ * | 3, 13, 23, .. 93 | x               | x              |                        |
+ * | 4, 14, 24, .. 94 | x               |                |                        |
+ * | 5, 15, 25, .. 95 | x               |                |                        |
+ * | 6, 16, 26, .. 96 | x               |                | x                      |
+ * | 7, 17, 27, .. 97 | x               |                |                        |
+ * | 8, 18, 28, .. 98 | x               | x              |                        |
+ * | 9, 19, 29, .. 99 | x               |                |                        |
  *
  * Commands to turn the brake light on or off are sent should the brake pressure
  * exceed the level defined in BRAKES_ON. Handling the light state in the
@@ -197,18 +193,15 @@ void pcISR_in9(void) {}
  * \param interrupt_nbr The id of the interrupt, counting from 0-99.
  */
 void timer1_isr_100Hz(uint8_t interrupt_nbr) {
-	// 10Hz interrupt (avoid other data being sent)
-	if ((interrupt_nbr % 10) == 0) { //10 Hz
-		uint32_t holder = wheel_count_l | ((uint32_t) wheel_count_r<< 16) ; // build data to send
-		can_setup_tx(CAN_FRONT_LOG_SPEED_ID, (uint8_t *) &holder, CAN_FRONT_LOG_DLC); // send
-		wheel_count_l = 0; // reset
-		wheel_count_r = 0; // reset
-	}
+	// 100 Hz
+	wheel_update();
+	uint32_t speed[2] = {wheel_get_frequency(WHEEL_LEFT), wheel_get_frequency(WHEEL_RIGHT)}; // build data to send
+	can_setup_tx(CAN_FRONT_LOG_SPEED_ID, (uint8_t *) speed, CAN_FRONT_LOG_SPEED_DLC); // send
 
 	// 20 Hz (avoid other data being sent)
 	if (((interrupt_nbr + 2) % 5) == 0) {
 		uint32_t holder = susp_l_atomic | ((uint32_t) susp_r_atomic << 16) ; // build data
-		can_setup_tx(CAN_FRONT_LOG_SPEED_ID, (uint8_t *) &holder, CAN_FRONT_LOG_DLC); // send
+		can_setup_tx(CAN_FRONT_LOG_SUSPENSION_ID, (uint8_t *) &holder, CAN_FRONT_LOG_DLC); // send
 	}
 
 	// 20 Hz (avoid other data being sent)
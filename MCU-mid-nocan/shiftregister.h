@@ -1,27 +0,0 @@
-/*
- * / shiftregister.h - A collection of functions to setup and ease the use of the LUR7 PCB
- * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
- * /
- * / This program is free software: you can redistribute it and/or modify
- * / it under the terms of the GNU General Public License as published by
- * / the Free Software Foundation, either version 3 of the License, or
- * / (at your option) any later version.
- * /
- * / This program is distributed in the hope that it will be useful,
- * / but WITHOUT ANY WARRANTY; without even the implied warranty of
- * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * / GNU General Public License for more details.
- * /
- * / You should have received a copy of the GNU General Public License
- * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
- */
-
-#ifndef _SHIFTREG_H_
-#define _SHIFTREG_H_
-
-void shift_byte(uint8_t);
-void shift_bar(uint8_t, uint8_t);
-void shift_bit(uint8_t);
-void shift_strobe(void);
-
-#endif // _SHIFTREG_H_
@@ -41,6 +41,18 @@
 #ifndef _CONFIG_H_
 #define _CONFIG_H_
 
+//Variants
+//! 1 for the car without gear changes and clutch on CAN.
+/*!
+ * The paddles and the clutch paddle are then wired to the rear MCU, see NOCAN
+ * in its config.h. The panel shows the gear sent by the rear MCU, and IN2,
+ * IN3 and IN7 are the buttons of \ref IO_POT_DISS_BTN, \ref IO_NEUTRAL_BTN and
+ * \ref IO_POT_GOOD_BTN. Built as main_nocan.hex by the makefile.
+ */
+#ifndef NOCAN
+#define NOCAN 0
+#endif
+
 //Inputs
 //! gear/clutch over CAN disengaged
 #define IO_GEAR_STOP		IN1
@@ -59,6 +71,12 @@
 #define IO_GEAR_DOWN		IN8
 //! Input for Gear Up paddle
 #define IO_GEAR_UP			IN9
+//! Without CAN, gear potentiometer disconnected button, see \ref NOCAN
+#define IO_POT_DISS_BTN		IN2
+//! Without CAN, Neutral Gear button, repeated attempts, see \ref NOCAN
+#define IO_NEUTRAL_BTN		IN3
+//! Without CAN, gear potentiometer connected button, see \ref NOCAN
+#define IO_POT_GOOD_BTN		IN7
 
 //Outputs
 //unused					OUT1
@@ -76,11 +94,15 @@
 //unused					OUT8
 
 
+//Debounce
+//! Lockout time for the gear paddles, in 10 ms ticks of \ref timer1_isr_100Hz.
+#define PADDLE_DEBOUNCE		3
+
+//Display
+//! The panel is rendered every DISPLAY_REFRESH_DIV:th tick of \ref timer1_isr_100Hz, 5 => 20 Hz. Must divide 100.
+#define DISPLAY_REFRESH_DIV	5
+
 //External interrupts
-//! Interrupt vector for Gear Up paddle
-#define INT_GEAR_UP			INT_IN9_vect
-//! Interrupt vector for Gear Down paddle
-#define INT_GEAR_DOWN		INT_IN8_vect
 //! Interrupt vector for Neutral Gear button
 #define INT_GEAR_NEUTRAL	INT_IN5_vect
 
@@ -43,12 +43,13 @@
 #include "../header_and_config/LUR7.h"
 #include "config.h"
 #include "display.h"
+#include "shiftregister.h"
 
 //! The MOb configured for RX of logging start/stop instructions.
 volatile uint8_t CAN_DTA_MOb;
-//! Variable containing information on whether logging is active or not.
-volatile uint8_t logging = FALSE;
-//! Flag set when new information has been received and the panel is ready to be updated
+//! Variable containing information on whether logging is active or not, the logger starts at power up.
+volatile uint8_t logging = TRUE;
+//! Flag set by \ref timer1_isr_100Hz when the panel is due to be rendered, see \ref DISPLAY_REFRESH_DIV.
 volatile uint8_t new_info = TRUE;
 //! Left clutch position sensor value.
 volatile uint16_t clutch_pos_left = 0;
@@ -60,10 +61,12 @@ volatile uint16_t clutch_pos_left_atomic = 0;
 volatile uint16_t clutch_pos_right_atomic = 0;
 //! Used for stopping clutch CAN messages.
 volatile uint8_t clutch_CAN_disable = FALSE;
-//! Debounce for gear shifting
-volatile uint8_t gear_debounce = FALSE;
 //! CAN unhang
 volatile uint8_t dta_can_counter = 0;
+//! The MOb configured for RX of the gear from the rear MCU, see \ref NOCAN.
+volatile uint8_t gear_MOb;
+//! CAN unhang of \ref gear_MOb.
+volatile uint8_t rear_can_counter = 0;
 
 //void ugly_reset(void);
 
@@ -88,7 +91,7 @@ int main(void) {
 	ancomp_init(); //! <li> initialise LUR7_ancomp.
 	can_init(); //! <li> initialise LUR7_CAN.
 	timer1_init(OFF); //! <li> initialise LUR7_timer1.
-	timer0_init(); //! <li> initialise LUR7_timer0.
+	timer0_init(); //! <li> initialise LUR7_timer0, drives the display.
 	//! </ol>
 
 	//! <li> LUR7_power. <ol>
@@ -97,15 +100,24 @@ int main(void) {
 
 	//! <li> Setup CAN RX <ol>
 	CAN_DTA_MOb = can_setup_rx(CAN_DTA_ID, CAN_DTA_MASK, CAN_DTA_DLC); //! <li> Reception of DTA packages, ID 0x2000-3.
+	if (NOCAN) {
+		gear_MOb = can_setup_rx(CAN_REAR_GEAR_ID, CAN_REAR_GEAR_MASK, CAN_REAR_GEAR_DLC); //! <li> Without CAN, reception of the gear from the rear MCU.
+	}
 	//! </ol>
 
 	//! <li> Input interrupts <ol>
-	ext_int_on(IO_GEAR_UP, 0, 1); //! <li> Gear up, any (!) flank trigger external interrupt
-	ext_int_on(IO_GEAR_DOWN, 0, 1); //! <li> Gear down, any (!) flank trigger external interrupt
-	ext_int_on(IO_GEAR_NEUTRAL, 1, 0); //! <li> Neutral gear, falling flank trigger external interrupt
+	if (NOCAN) {
+		pc_int_on(IO_POT_DISS_BTN); //! <li> Without CAN, the buttons, see \ref NOCAN
+		pc_int_on(IO_NEUTRAL_BTN);
+		pc_int_on(IO_POT_GOOD_BTN);
+	} else {
+		debounce_on(IO_GEAR_UP, PADDLE_DEBOUNCE); //! <li> Gear up, debounced pin change interrupt
+		debounce_on(IO_GEAR_DOWN, PADDLE_DEBOUNCE); //! <li> Gear down, debounced pin change interrupt
+		ext_int_on(IO_GEAR_NEUTRAL, 1, 0); //! <li> Neutral gear, falling flank trigger external interrupt
 
-	//pc_int_on(IO_GP_BTN);
-	pc_int_on(IO_LOG_BTN);
+		//pc_int_on(IO_GP_BTN);
+		pc_int_on(IO_LOG_BTN);
+	}
 	//! </ol>
 
 	//! <li> Enable system <ol>
@@ -117,7 +129,7 @@ int main(void) {
 	//! <li> LOOP <ul>
 	while (1) {
 		//! <li> Always do: <ol>
-		if (!clutch_CAN_disable) {
+		if (!NOCAN && !clutch_CAN_disable) {
 			clutch_pos_left = adc_get(IO_CLUTCH_LEFT); //! <li> get left clutch paddle position
 			ATOMIC_BLOCK(ATOMIC_FORCEON) {
 				clutch_pos_left_atomic = clutch_pos_left; //! <li> copy value to atomic variable
@@ -130,10 +142,14 @@ int main(void) {
 		}
 		
 		//! </ol>
-		//! <li> If new information for panel <ol>
-		if (new_info) {
-			new_info = FALSE; //! <li> clear flag
-			update_display(get_input(IO_ALT_BTN)); //! <li> update panel
+		//! <li> If the panel is due to be rendered <ol>
+		uint8_t render;
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			render = new_info; //! <li> take and clear flag
+			new_info = FALSE;
+		} // end ATOMIC_BLOCK
+		if (render) {
+			update_display(!NOCAN && get_input(IO_ALT_BTN)); //! <li> render panel, only sent if changed
 		} //! </ol>
 	} //! </ul>
 	return 0; //! </ul>
@@ -169,6 +185,13 @@ int main(void) {
  * \param interrupt_nbr The id of the interrupt, counting from 0-99.
  */
 void timer1_isr_100Hz(uint8_t interrupt_nbr) {
+	if (!NOCAN) {
+		debounce_tick(); // time base for paddle debouncing
+	}
+
+	if (interrupt_nbr % DISPLAY_REFRESH_DIV == 0) {
+		new_info = TRUE; // render the panel at the capped refresh rate
+	}
 
 	if (dta_can_counter++ > 20) {
 		can_free_rx(CAN_DTA_MOb);
@@ -182,47 +205,86 @@ void timer1_isr_100Hz(uint8_t interrupt_nbr) {
 		update_watertemp(0);
 		update_speed(0);
 		update_oiltemp(0);
-		update_gear(7);
+		if (!NOCAN) {
+			update_gear(7);
+		}
 	} 
 
-	if (dta_can_counter > 20) {
-		update_gear(7);
+	if (NOCAN) { // the gear is sent by the rear MCU
+		if (rear_can_counter++ > 20) {
+			can_free_rx(gear_MOb);
+			gear_MOb = can_setup_rx(CAN_REAR_GEAR_ID, CAN_REAR_GEAR_MASK, CAN_REAR_GEAR_DLC);
+
+			if (gear_MOb != 0xff) {
+				rear_can_counter = 0;
+			}
+
+			update_gear(10); //blank display
+		}
+	} else {
+		if (dta_can_counter > 20) {
+			update_gear(7);
+		}
+		uint32_t c_data = ((uint32_t) clutch_pos_left_atomic << 16) | clutch_pos_right_atomic;
+		can_setup_tx(CAN_CLUTCH_ID, (uint8_t *) &c_data, CAN_GEAR_CLUTCH_LAUNCH_DLC);
 	}
-	uint32_t c_data = ((uint32_t) clutch_pos_left_atomic << 16) | clutch_pos_right_atomic;
-	can_setup_tx(CAN_CLUTCH_ID, (uint8_t *) &c_data, CAN_GEAR_CLUTCH_LAUNCH_DLC);
 }
 
 /*!
- * lzlrsgkoslr
+ * Clocks the display shift registers, see \ref shift_tick.
  */
 void timer0_isr_stop(void) {
-	gear_debounce = FALSE;
+	shift_tick();
 }
 
-//! Gear Up interrupt handler
+#if NOCAN
+//! Pin Change handler for \ref IO_POT_DISS_BTN, gear potentiometer disconnected.
+static void pot_diss_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
+		can_setup_tx(CAN_GEAR_ID, CAN_MSG_POT_DISS, CAN_GEAR_CLUTCH_LAUNCH_DLC);
+	}
+}
+
+//! Pin Change handler for \ref IO_NEUTRAL_BTN, neutral gear.
+static void neutral_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
+		can_setup_tx(CAN_GEAR_ID, CAN_MSG_GEAR_NEUTRAL_REPEAT, CAN_GEAR_CLUTCH_LAUNCH_DLC);
+	}
+}
+
+//! Pin Change handler for \ref IO_POT_GOOD_BTN, gear potentiometer connected.
+static void pot_good_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
+		can_setup_tx(CAN_GEAR_ID, CAN_MSG_POT_GOOD, CAN_GEAR_CLUTCH_LAUNCH_DLC);
+	}
+}
+
+//! Pin Change Interrupt handlers, without CAN.
+PC_HANDLERS = {
+	[IO_POT_DISS_BTN] = pot_diss_change,
+	[IO_NEUTRAL_BTN] = neutral_change,
+	[IO_POT_GOOD_BTN] = pot_good_change,
+};
+#else
+//! Gear Up paddle handler
 /*!
- * When the paddle for changing gears up is depressed, this ISR is executed
- * sending a message to the rear MCU to do the shifting.
+ * When the paddle for changing gears up is depressed, a message is sent to
+ * the rear MCU to do the shifting. The paddle is debounced, see \ref debounce_on.
  */
-ISR (INT_GEAR_UP) { //IN9
-	if (!get_input(IO_GEAR_UP) && !gear_debounce) {
+static void gear_up_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
 		can_setup_tx(CAN_GEAR_ID, CAN_MSG_GEAR_UP, CAN_GEAR_CLUTCH_LAUNCH_DLC);
-	} else {
-		gear_debounce = TRUE;
-		timer0_start(1500);
 	}
 }
-//! Gear Down interrupt handler
+
+//! Gear Down paddle handler
 /*!
- * When the paddle for changing gears down is depressed, this ISR is executed
- * sending a message to the rear MCU to do the shifting.
+ * When the paddle for changing gears down is depressed, a message is sent to
+ * the rear MCU to do the shifting. The paddle is debounced, see \ref debounce_on.
  */
-ISR (INT_GEAR_DOWN) { //IN8
-	if (!get_input(IO_GEAR_DOWN) && !gear_debounce) {
+static void gear_down_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
 		can_setup_tx(CAN_GEAR_ID, CAN_MSG_GEAR_DOWN, CAN_GEAR_CLUTCH_LAUNCH_DLC);
-	} else {
-		gear_debounce = TRUE;
-		timer0_start(1500);
 	}
 }
 //! Neutral Gear interrupt handler
@@ -240,9 +302,9 @@ ISR (INT_GEAR_NEUTRAL) { //IN5
 	}
 }
 
-//! Pin Change Interrupt handler for IN1.
+//! Pin Change handler for \ref IO_GEAR_STOP.
 /*! \todo manual gear changes on/off, FAILSAFE */
-void pcISR_in1(void) {
+static void gear_stop_change(uint8_t level, uint32_t timestamp) {
 	//ext_int_off(IO_GEAR_UP);
 	//ext_int_off(IO_GEAR_DOWN);
 	//ext_int_off(IO_GEAR_NEUTRAL);
@@ -250,45 +312,36 @@ void pcISR_in1(void) {
 	//set_output(IO_GEAR_STOP_LED, ON);
 }
 
-//! Pin Change Interrupt handler for IN2.
-/*! Logging start/stop button.broadcasts a messabe to start or stop logging. */
-void pcISR_in2(void) { /*
-	if (get_input(IO_LOG_BTN)) {
+//! Pin Change handler for \ref IO_LOG_BTN.
+/*!
+ * Logging start/stop button, with \ref IO_ALT_BTN held broadcasts a message
+ * to stop logging, or to start a new log if it is stopped, see
+ * \ref logger_main.
+ */
+static void log_btn_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_RISING) {
 		if (get_input(IO_ALT_BTN)) {
 			if (logging) {
-				can_setup_tx(CAN_LOG_ID, (uint8_t *) &CAN_MSG_LOG_STOP, CAN_LOG_DLC);
-				logging = TRUE;
-			} else {
-				can_setup_tx(CAN_LOG_ID, (uint8_t *) &CAN_MSG_LOG_START, CAN_LOG_DLC);
+				can_setup_tx(CAN_LOG_ID, CAN_MSG_LOG_STOP, CAN_LOG_DLC);
 				logging = FALSE;
+			} else {
+				can_setup_tx(CAN_LOG_ID, CAN_MSG_LOG_START, CAN_LOG_DLC);
+				logging = TRUE;
 			}
-		} else {
+		} /* else {
 			can_setup_tx(CAN_LAUNCH_ID, (uint8_t *) &CAN_MSG_LAUNCH, CAN_GEAR_CLUTCH_LAUNCH_DLC);
-		}
-	} */
+		} */
+	}
 }
 
-//! Pin Change Interrupt handler for IN3.
-/*! Alternate purpose button, not used as interrupt */
-void pcISR_in3(void) {}
-//! Pin Change Interrupt handler for IN4.
-/*! \warning in6 used as analog input */
-void pcISR_in4(void) {}
-//! Pin Change Interrupt handler for IN5.
-/*! \warning in5 used as external interrupt */
-void pcISR_in5(void) {}
-//! Pin Change Interrupt handler for IN6.
-/*! \warning in6 used as analog input */
-void pcISR_in6(void) {}
-//! Pin Change Interrupt handler for IN7.
-/*! unused */
-void pcISR_in7(void) {}
-//! Pin Change Interrupt handler for IN8.
-/*! \warning in8 used as external interrupt */
-void pcISR_in8(void) {}
-//! Pin Change Interrupt handler for IN9.
-/*! \warning in9 used as external interrupt */
-void pcISR_in9(void) {}
+//! Pin Change Interrupt handlers.
+PC_HANDLERS = {
+	[IO_GEAR_STOP] = gear_stop_change,
+	[IO_LOG_BTN] = log_btn_change,
+	[IO_GEAR_UP] = gear_up_change,
+	[IO_GEAR_DOWN] = gear_down_change,
+};
+#endif
 
 //! CAN message receiver function.
 /*!
@@ -304,12 +357,11 @@ void CAN_ISR_RXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {
 		if (id == 0x2000) { //! <li> ID = 0x2000. <ul>
 			update_RPM((data[6] << 8) | data[7]); //! <li> extract RPM.
 			update_watertemp((data[2] << 8) | data[3]); //! <li> extract water temperature [C].
-			new_info = TRUE; //! <li> set flag to update panel
 		} else if (id == 0x2001) { //! <li> ID = 0x2001. <ul>
 			update_speed((data[2] << 8) | data[3]);  //! <li> extract speed [km/h * 10]
 		} else if (id == 0x2002) { //! <li> ID = 0x2002. <ul>
 			update_oiltemp((data[5] << 8) | data[6]);  //! <li> extract oil temperature [C].
-		} else if (id == 0x2004) { //! <li> ID = 0x2004. <ul>
+		} else if (!NOCAN && id == 0x2004) { //! <li> ID = 0x2004, unless the gear is sent by the rear MCU. <ul>
 			uint16_t ana3 = ((uint16_t) data[2] << 8) | data[3];//! <li> extract current gear.
 			/*if (ana3 > 700 && ana3 < 900){
 				update_gear(1); // 791
@@ -343,6 +395,10 @@ void CAN_ISR_RXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {
 			}
 		}
 	} //! </ul>
+	else if (NOCAN && mob == gear_MOb) { //! <li> without CAN, if received from the rear MCU, the gear.
+		rear_can_counter = 0;
+		update_gear(data[0]);
+	}
 	//! </ul>
 }
 //! CAN message sent function.
@@ -354,7 +410,7 @@ void CAN_ISR_TXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {}
  */
 void CAN_ISR_OTHER(void) {
 	uint8_t mob = (CANPAGE & 0xF0) >> 4; // get mob number
-	if (mob == CAN_DTA_MOb) {
+	if (mob == CAN_DTA_MOb || (NOCAN && mob == gear_MOb)) {
 		CANCDMOB &= ~((1 << CONMOB1) | (1 << CONMOB0)); //disable MOb
 		_NOP();
 		CANCDMOB |= (1 << CONMOB1); // re-enable reception
@@ -0,0 +1,174 @@
+/*
+ * render.c - Converts values to LED patterns for the display of the LUR7
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file render.c
+ * \ref render converts values to LED patterns for the display of the LUR7.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref render.h
+ * \see \ref display.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup render Display Rendering
+ * \ref render.c converts engine revs, temperatures and numbers to the bit
+ * patterns shown on the display.
+ *
+ * Rendering runs for every refresh of the display and should take the same,
+ * short, time whatever the values. There are no loops, no floats and no
+ * divisions, the ATmega32M1 has no divide instruction. Divisions by constants
+ * are done as a multiplication by the reciprocal followed by a shift, and
+ * patterns are read from small tables in flash.
+ *
+ * The file only depends on avr-libc for PROGMEM, it can thus be compiled for
+ * the host and is checked against the previous implementation by the test in
+ * test_render.
+ *
+ * \see \ref render.h
+ * \see \ref display
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "display.h"
+#include "render.h"
+
+//! Bit patterns for numbers on seven segment display.
+static const uint8_t sev_seg[SEV_SEG_BLANK + 1] PROGMEM = {
+	// a b c d e f g dp
+	0b11111100, //0
+	0b01100000, //1
+	0b11011010, //2
+	0b11110010, //3
+	0b01100110, //4
+	0b10110110, //5
+	0b10111110, //6
+	0b11100000, //7
+	0b11111110, //8
+	0b11110110, //9
+	0b00000000  //blank
+};
+
+//! Temperature resolution of \ref temp_bar, all levels must be multiples of this.
+#define TEMP_STEP	5
+//! Temperatures from this and up always light the full bar.
+#define TEMP_RANGE	100
+
+#if (TEMP_LVL_1 % TEMP_STEP) || (TEMP_LVL_2 % TEMP_STEP) || (TEMP_LVL_3 % TEMP_STEP) \
+	|| (TEMP_LVL_4 % TEMP_STEP) || (TEMP_LVL_5 % TEMP_STEP) || (TEMP_LVL_6 % TEMP_STEP) \
+	|| (TEMP_LVL_7 % TEMP_STEP) || (TEMP_LVL_8 % TEMP_STEP) || (TEMP_LVL_9 % TEMP_STEP) \
+	|| (TEMP_LVL_10 % TEMP_STEP) || (TEMP_LVL_10 > TEMP_RANGE)
+#error "TEMP_LVL_1 to TEMP_LVL_10 must be multiples of TEMP_STEP and at most TEMP_RANGE"
+#endif
+
+//! Number of lit LEDs at temperature \p t, evaluated by the compiler.
+#define TEMP_BAR(t)	(((t) >= TEMP_LVL_1) + ((t) >= TEMP_LVL_2) + ((t) >= TEMP_LVL_3) \
+	+ ((t) >= TEMP_LVL_4) + ((t) >= TEMP_LVL_5) + ((t) >= TEMP_LVL_6) + ((t) >= TEMP_LVL_7) \
+	+ ((t) >= TEMP_LVL_8) + ((t) >= TEMP_LVL_9) + ((t) >= TEMP_LVL_10))
+
+//! Temperature bar length for every \ref TEMP_STEP degrees below \ref TEMP_RANGE.
+static const uint8_t temp_bar[TEMP_RANGE / TEMP_STEP] PROGMEM = {
+	TEMP_BAR(0),  TEMP_BAR(5),  TEMP_BAR(10), TEMP_BAR(15), TEMP_BAR(20),
+	TEMP_BAR(25), TEMP_BAR(30), TEMP_BAR(35), TEMP_BAR(40), TEMP_BAR(45),
+	TEMP_BAR(50), TEMP_BAR(55), TEMP_BAR(60), TEMP_BAR(65), TEMP_BAR(70),
+	TEMP_BAR(75), TEMP_BAR(80), TEMP_BAR(85), TEMP_BAR(90), TEMP_BAR(95)
+};
+
+//! Shift of the rev bar reciprocal.
+#define REV_BAR_SHIFT	24
+//! REV_BAR_MAX / (REV_MAX - REV_MIN) scaled by 2^\ref REV_BAR_SHIFT, rounded up.
+#define REV_BAR_MUL		((((uint32_t) REV_BAR_MAX << REV_BAR_SHIFT) + (REV_MAX - REV_MIN) - 1) / (REV_MAX - REV_MIN))
+
+//! Convert binary to BCD
+/*!
+ * Calculates the Binary Coded Decimal representation of \p value. Leading
+ * zeros are replaced by \ref SEV_SEG_BLANK, the last digit is always shown.
+ * Values above 999 give a hundreds digit above 9, truncated to 8 bits, which
+ * is shown blank.
+ *
+ * x / 100 is calculated as (x / 4) * 5243 / 2^17, exact for all 16 bit x, and
+ * x / 10 as x * 103 / 2^10, exact for x < 100.
+ *
+ * \param value number to convert.
+ * \param bcd array of three digits to write, hundreds first.
+ */
+void render_bcd(uint16_t value, uint8_t * bcd) {
+	uint16_t hundreds = ((uint32_t) (value >> 2) * 5243) >> 17;
+	uint8_t rest = value - 100 * hundreds;
+	uint8_t tens = ((uint16_t) rest * 103) >> 10;
+
+	bcd[0] = (value >= 100) ? hundreds : SEV_SEG_BLANK;
+	bcd[1] = (tens == 0 && bcd[0] == SEV_SEG_BLANK) ? SEV_SEG_BLANK : tens; // no leading zero
+	bcd[2] = rest - 10 * tens;
+}
+
+//! Get seven segment representation of number
+/*!
+ * For binary numbers [0, 9] this function returns the seven segment
+ * representation of the number with an optional decimal point. Other numbers
+ * give a blank digit.
+ *
+ * \param binary number to convert.
+ * \param dp decimal point.
+ */
+uint8_t render_7seg(uint8_t binary, uint8_t dp) {
+	if (binary > SEV_SEG_BLANK) {
+		return pgm_read_byte(&sev_seg[SEV_SEG_BLANK]);
+	}
+	return pgm_read_byte(&sev_seg[binary]) | (dp ? 1 : 0); // dp is the lowest bit
+}
+
+//! Calculate the number of LEDs to light for the rev-bar.
+/*!
+ * The Rev-Bar is lit up in a linear manner proportional to the engine revs,
+ * \ref REV_BAR_MIN LEDs at \ref REV_MIN and \ref REV_BAR_MAX LEDs before
+ * \ref REV_MAX.
+ *
+ * \param revs engine revs.
+ */
+uint8_t render_rev_bar(uint16_t revs) {
+	if (revs < REV_MIN) {
+		return 0;
+	} else if (revs >= REV_MAX) {
+		return REV_BAR_MAX;
+	}
+	uint8_t bar = (((uint32_t) (revs - REV_MIN) * REV_BAR_MUL) >> REV_BAR_SHIFT) + REV_BAR_MIN;
+	return bar > REV_BAR_MAX ? REV_BAR_MAX : bar;
+}
+
+//! Determine the number of LEDs to light for the temperature bar.
+/*!
+ * The Temperature Bar is lit up in a alinear manner. The intervalls are chosen
+ * to give good resolution in the interesting regions, while maintaining a wide
+ * span. \ref TEMP_LVL_1 to \ref TEMP_LVL_10 determine the steps.
+ *
+ * t / \ref TEMP_STEP is calculated as t * 103 / 2^9, exact for t < 100.
+ *
+ * \param temperature temperature in degrees C.
+ */
+uint8_t render_temp_bar(uint16_t temperature) {
+	if (temperature >= TEMP_RANGE) {
+		return TEMP_BAR(TEMP_RANGE);
+	}
+	return pgm_read_byte(&temp_bar[((uint16_t) temperature * 103) >> 9]);
+}
@@ -1,5 +1,5 @@
 /*
- * gear_clutch_launch.h - A collection of functions to setup and ease the use of the LUR7 PCB
+ * render.h - Converts values to LED patterns for the display of the LUR7
  * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
  *
  * This program is free software: you can redistribute it and/or modify
@@ -16,39 +16,38 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-/*! \file gear_clutch_launch.h
- * The \ref gear_launch defines inputs and constants used on the rear MCU.
+/*! \file render.h
+ * \ref render converts values to LED patterns for the display of the LUR7.
  *
  * All code is released under the GPLv3 license.
  *
- * \see \ref gear_launch
- * \see \ref gear_launch.c
- * \see \ref main.c
- * \see \ref config.h
+ * \see \ref render.c
+ * \see \ref display.c
  * \see <http://www.gnu.org/copyleft/gpl.html>
  * \author Simon Wrafter
  * \copyright GNU Public License v3.0
  *
- * \addtogroup gear_clutch_launch
+ * \addtogroup render
  */
 
-#ifndef _GEAR_CLUTCH_LAUNCH_H_
-#define _GEAR_CLUTCH_LAUNCH_H_
+#ifndef _RENDER_H_
+#define _RENDER_H_
 
-#define POT_FAIL 10
+//! Minimum engine revs
+#define REV_MIN		2000
+//! Maximum engine revs
+#define REV_MAX		11000
+//! Minimum number of LEDs for rev bar
+#define REV_BAR_MIN	1
+//! Maximum number of LEDs for rev bar
+#define REV_BAR_MAX	22
 
-void set_current_gear(uint8_t gear);
-uint8_t get_current_gear(void);
-void set_current_revs(uint16_t);
+//! Seven segment code for a blank digit, see \ref render_bcd.
+#define SEV_SEG_BLANK	10
 
-void gear_up(void);
-void gear_down(void);
+void render_bcd(uint16_t, uint8_t *);
+uint8_t render_7seg(uint8_t, uint8_t);
+uint8_t render_rev_bar(uint16_t);
+uint8_t render_temp_bar(uint16_t);
 
-void gear_neutral_single(void);
-void gear_neutral_repeat_linear(void);
-void gear_neutral_repeat_bisect(void);
-
-//void launch_control(void);
-//void launch_stop_clutch(void);
-
-#endif // _GEAR_CLUTCH_LAUNCH_H_
+#endif // _RENDER_H_
@@ -31,6 +31,20 @@
  * \defgroup shiftregister Shift Register
  * \ref shiftregister.c Populates shift registers.
  *
+ * The shift register outputs are ordinary I/O pins, not the SPI pins, and the
+ * output stages need a long pulse time, so the bits are clocked out by
+ * \ref shift_tick from the periodic interrupt of LUR7_timer0, one step per
+ * \ref PULSE_TIME. shift_byte(uint8_t), shift_bar(uint8_t, uint8_t) and
+ * shift_bit(uint8_t) only fill a frame buffer. shift_strobe(void) hands the
+ * frame to the interrupt and returns at once, the frame is latched through to
+ * the display when the last bit has been clocked out. Should a frame be
+ * handed over while another is being sent it is queued, only the newest
+ * queued frame is kept.
+ *
+ * The last frame handed over is remembered, a frame identical to it is
+ * dropped by shift_strobe(void) as the display already shows it. The display
+ * can thus be rendered at a fixed rate and only changes are shifted out.
+ *
  * \see \ref shiftregister.c
  * \see \ref shiftregister.h
  * \see \ref display
@@ -44,7 +58,35 @@
 #include "config.h"
 #include "shiftregister.h"
 
-static const float PULSE_TIME = 300; //2000
+//! Time per step in units of 100µs, see \ref timer0_repeat.
+static const uint8_t PULSE_TIME = 3; // 300 µs
+//! Size of a frame in bytes, enough for the whole display.
+#define SHIFT_FRAME_BYTES	8
+
+//! Frame being filled by \ref shift_bit.
+static uint8_t frame_fill[SHIFT_FRAME_BYTES];
+//! Number of bits in \ref frame_fill.
+static uint8_t frame_fill_len = 0;
+//! Frame waiting to be sent.
+static uint8_t frame_queued[SHIFT_FRAME_BYTES];
+//! Number of bits in \ref frame_queued.
+static volatile uint8_t frame_queued_len = 0;
+//! Whether \ref frame_queued holds a frame.
+static volatile uint8_t frame_queued_flag = FALSE;
+//! Frame being clocked out.
+static uint8_t frame_out[SHIFT_FRAME_BYTES];
+//! Number of bits in \ref frame_out.
+static volatile uint8_t frame_out_len = 0;
+//! Next bit of \ref frame_out to clock out.
+static volatile uint8_t frame_out_pos = 0;
+//! Step within the current bit.
+static volatile uint8_t frame_out_step = 0;
+//! Whether a frame is being clocked out.
+static volatile uint8_t busy = FALSE;
+//! Last frame handed over by \ref shift_strobe.
+static uint8_t frame_last[SHIFT_FRAME_BYTES];
+//! Number of bits in \ref frame_last, 0xFF until the first frame.
+static uint8_t frame_last_len = 0xFF;
 
 //! Shifts out a byte.
 /*!
@@ -54,14 +96,10 @@ static const float PULSE_TIME = 300; //2000
  * \param value the byte to shift out.
  */
 void shift_byte(uint8_t value) {
-	shift_bit(value & 1);
-	shift_bit(value & 2);
-	shift_bit(value & 4);
-	shift_bit(value & 8);
-	shift_bit(value & 16);
-	shift_bit(value & 32);
-	shift_bit(value & 64);
-	shift_bit(value & 128);
+	for (uint8_t i = 0; i < 8; i++) {
+		shift_bit(value & 1);
+		value >>= 1;
+	}
 }
 
 //! Shift out a bar.
@@ -77,9 +115,6 @@ void shift_bar(uint8_t nbr_high, uint8_t length) {
 	if (nbr_high > length) {
 		nbr_high = length;
 	}
-	if (nbr_high < 0) {
-		nbr_high = 0;
-	}
 	uint8_t nbr_low = length - nbr_high;
 	for (uint8_t i=0; i< nbr_low; i++) {
 		shift_bit(OFF);
@@ -91,29 +126,133 @@ void shift_bar(uint8_t nbr_high, uint8_t length) {
 
 //! Shift out a single bit.
 /*!
- * Shifts out a bit by setting the data output to \p value, waiting and then 
- * triggering generating a clock pulse.
+ * Adds a bit to the frame being built. Bits beyond the size of the frame are
+ * dropped.
  * 
  * \param value the bit value to shift out.
  */
 void shift_bit(uint8_t value) {
-	set_output(IO_SHIFT_DATA, value);
-	_delay_us(PULSE_TIME);
-	set_output(IO_SHIFT_CLK, HIGH);
-	_delay_us(PULSE_TIME);
-	set_output(IO_SHIFT_CLK, LOW);
-	_delay_us(PULSE_TIME);
-	set_output(IO_SHIFT_DATA, LOW);
-	_delay_us(PULSE_TIME);
+	if (frame_fill_len < 8 * SHIFT_FRAME_BYTES) {
+		uint8_t mask = 1 << (frame_fill_len & 7);
+		if (value) {
+			frame_fill[frame_fill_len >> 3] |= mask;
+		} else {
+			frame_fill[frame_fill_len >> 3] &= ~mask;
+		}
+		frame_fill_len++;
+	}
+}
+
+//! Helper function, starts sending the queued frame.
+/*!
+ * Must be called with interrupts disabled.
+ */
+static void shift_start(void) {
+	for (uint8_t i = 0; i < SHIFT_FRAME_BYTES; i++) {
+		frame_out[i] = frame_queued[i];
+	}
+	frame_out_len = frame_queued_len;
+	frame_queued_flag = FALSE;
+	frame_out_pos = 0;
+	frame_out_step = 0;
+	busy = TRUE;
+	timer0_repeat(PULSE_TIME);
+}
+
+//! Helper function, compares the new frame to the last one.
+/*!
+ * Only the bits in the frame are compared, the rest of the last byte is
+ * masked off. Saves the new frame as the last frame if it differs.
+ *
+ * \return TRUE if \ref frame_fill differs from \ref frame_last.
+ */
+static uint8_t shift_changed(void) {
+	uint8_t changed = (frame_fill_len != frame_last_len);
+	for (uint8_t i = 0; 8 * i < frame_fill_len; i++) {
+		uint8_t mask = 0xFF;
+		if (frame_fill_len - 8 * i < 8) {
+			mask = (1 << (frame_fill_len & 7)) - 1;
+		}
+		if ((frame_fill[i] ^ frame_last[i]) & mask) {
+			changed = TRUE;
+		}
+		frame_last[i] = frame_fill[i];
+	}
+	frame_last_len = frame_fill_len;
+	return changed;
 }
 
 //! Strobe the data through.
 /*!
- * Data stored in the shift registers is latched through to the outputs of the 
- * shift registers when strobe is set high and locked when it returnes to low.
+ * Hands the frame built since the last strobe to the interrupt and starts a
+ * new frame. Data stored in the shift registers is latched through to the
+ * outputs of the shift registers when strobe is set high and locked when it
+ * returnes to low, this happens once the whole frame is shifted out.
+ *
+ * A frame equal to the previous one is not sent.
  */
 void shift_strobe(void) {
-	set_output(IO_SHIFT_STROBE, HIGH);
-	_delay_us(PULSE_TIME);
-	set_output(IO_SHIFT_STROBE, LOW);
+	if (!shift_changed()) {
+		frame_fill_len = 0;
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (uint8_t i = 0; i < SHIFT_FRAME_BYTES; i++) {
+			frame_queued[i] = frame_fill[i];
+		}
+		frame_queued_len = frame_fill_len;
+		frame_queued_flag = TRUE;
+		if (!busy) {
+			shift_start();
+		}
+	}
+	frame_fill_len = 0;
+}
+
+//! Whether a frame is being sent.
+/*!
+ * \return TRUE while a frame is being shifted out or waiting to be.
+ */
+uint8_t shift_busy(void) {
+	return busy;
+}
+
+//! Clock out the next step of the frame.
+/*!
+ * To be called from \ref timer0_isr_stop. Each bit takes three steps: set
+ * data, clock high, clock low. After the last bit the strobe is pulsed.
+ */
+void shift_tick(void) {
+	if (!busy) {
+		return;
+	}
+	if (frame_out_pos < frame_out_len) {
+		switch (frame_out_step) {
+			case 0:
+				set_output(IO_SHIFT_DATA, frame_out[frame_out_pos >> 3] & (1 << (frame_out_pos & 7)));
+				frame_out_step = 1;
+				break;
+			case 1:
+				set_output(IO_SHIFT_CLK, HIGH);
+				frame_out_step = 2;
+				break;
+			default:
+				set_output(IO_SHIFT_CLK, LOW);
+				frame_out_step = 0;
+				frame_out_pos++;
+				break;
+		}
+	} else if (frame_out_step == 0) {
+		set_output(IO_SHIFT_DATA, LOW);
+		set_output(IO_SHIFT_STROBE, HIGH);
+		frame_out_step = 1;
+	} else {
+		set_output(IO_SHIFT_STROBE, LOW);
+		if (frame_queued_flag) {
+			shift_start();
+		} else {
+			busy = FALSE;
+			timer0_stop();
+		}
+	}
 }
@@ -23,5 +23,7 @@ void shift_byte(uint8_t);
 void shift_bar(uint8_t, uint8_t);
 void shift_bit(uint8_t);
 void shift_strobe(void);
+uint8_t shift_busy(void);
+void shift_tick(void);
 
 #endif // _SHIFTREG_H_
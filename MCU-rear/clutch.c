@@ -25,20 +25,38 @@
 static const float CLUTCH_POS_LEFT_LOOSE  = 553; // slapp vajer
 //! Threshold value for open clutch
 static const float CLUTCH_POS_LEFT_TIGHT  = 639; // dragen vajer
+#if NOCAN
+//! Threshold value for closed clutch
+static const float CLUTCH_POS_RIGHT_LOOSE = 420;
+#else
 //! Threshold value for closed clutch
 static const float CLUTCH_POS_RIGHT_LOOSE = 427;
+#endif
 //! Threshold value for open clutch
 static const float CLUTCH_POS_RIGHT_TIGHT = 378;
+#if NOCAN
+//! PWM value for closed clutch
+static const float CLUTCH_DC_LOOSE        = 2650; // slapp vajer. min: 2200
+//! PWM value for open clutch
+static const float CLUTCH_DC_TIGHT        = 10150; // dragen vajer. max: 13500 (?)
+#else
 //! PWM value for closed clutch
 static const float CLUTCH_DC_LOOSE        = 6000; // slapp vajer. min: 2200
 //! PWM value for open clutch
 static const float CLUTCH_DC_TIGHT        = 13500; // dragen vajer. max: 13500 (?)
+#endif
 
 //static const float clutch_pos_break_factor   = 0.8; // ADJUST IF NEEDED!
 volatile static float clutch_pos_left_break  = 625;
+#if NOCAN
+volatile static float clutch_pos_right_break = 384;
+
+static const float clutch_dc_break = 6150; // AJUST IF NEEDED!
+#else
 volatile static float clutch_pos_right_break = 387;
 
 static const float clutch_dc_break = 9500; // AJUST IF NEEDED!
+#endif
 
 //! Initial value for the filter.
 volatile static float clutch_left_filtered  = 0;
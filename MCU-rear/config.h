@@ -41,12 +41,33 @@
 #ifndef _CONFIG_H_
 #define _CONFIG_H_
 
+//Variants
+//! 1 for the car without gear changes, clutch and brake pressure on CAN.
+/*!
+ * The paddles, the neutral button, the clutch paddle and the brake pressure
+ * sensor are then wired to the backup inputs, as when the mid and front MCUs
+ * are in failsafe mode, and the gear potentiometer to \ref GEAR_POT. The gear
+ * is read from it instead of from the DTA and sent to the mid MCU. Wheel
+ * speed and suspension are not measured. Built as main_nocan.hex by the
+ * makefile.
+ */
+#ifndef NOCAN
+#define NOCAN 0
+#endif
+
 //Constants
 
+#if NOCAN
+//! The value above which the brakes are considered to have been applied.
+#define BRAKES_ON	218 // MUST above BRAKES_OFF
+//! The value below which the brakes are considered to have been released.
+#define BRAKES_OFF	215 // MUST below BRAKES_ON
+#else
 //! The value above which the brakes are considered to have been applied.
 #define BRAKES_ON	217 // MUST above BRAKES_OFF
 //! The value below which the brakes are considered to have been released.
 #define BRAKES_OFF	213 // MUST below BRAKES_ON
+#endif
 
 //Inputs
 //! Input for speed measurment of rear right wheel.
@@ -67,6 +88,8 @@
 #define SUSPENSION_R	ADC_IN8
 //! Input (analog) for measurment of rear left suspension.
 #define SUSPENSION_L	ADC_IN9
+//! Input (analog) of the gear potentiometer, in place of \ref SUSPENSION_R, see \ref NOCAN.
+#define GEAR_POT		ADC_IN8
 
 
 //Outputs
@@ -81,6 +104,10 @@
 #define GEAR_DOWN			OUT5
 //! Output for Shift cut (DTA pin 14)
 #define SHIFT_CUT			OUT6
+//! Output group of the gear solenoids, see \ref set_output_group.
+#define GEAR_SOLENOIDS		(IO_GROUP(GEAR_UP) | IO_GROUP(GEAR_DOWN))
+//! Output group of the gear solenoids and shift cut, see \ref set_output_group.
+#define GEAR_ACTUATORS		(GEAR_SOLENOIDS | IO_GROUP(SHIFT_CUT))
 //! Output for controling Launch Control. (DTA pin 4)
 #define LAUNCH				OUT7
 //! Output to control availability of ground for sensors.
@@ -62,16 +62,32 @@ static void (*volatile end_fun_ptr)(void);
 //********* GEAR ***************************************************************
 
 //! Delay between engaging shift cut and running the solenoid. 1 to 2
+#if NOCAN
+static const uint16_t SHIFT_CUT_DELAY_1_TO_2 = 250;//300; //35 ms
+#else
 static const uint16_t SHIFT_CUT_DELAY_1_TO_2 = 300;//300; //35 ms
+#endif
 //! Delay between engaging shift cut and running the solenoid. 2 to 3
 static const uint16_t SHIFT_CUT_DELAY_2_TO_3 = 150;//150; //20 ms
 //! Delay between engaging shift cut and running the solenoid. 3 to 4
 static const uint16_t SHIFT_CUT_DELAY_3_TO_4 = 150;//150; //20 ms
 //! Delay between engaging shift cut and running the solenoid. 4 to 5
 static const uint16_t SHIFT_CUT_DELAY_4_TO_5 = 150;//150; //20 ms
-//! Delay between engaging shift cut and running the solenoid. if unknown gear
-static const uint16_t SHIFT_CUT_DELAY_FAIL = 150;//150; //20 ms
 
+#if NOCAN
+//! Time to run the solenoid for gear up.
+static const uint16_t GEAR_UP_DELAY_2_TO_5 = 300; //30 ms
+//! Time to run the solenoid for gear down.
+static const uint16_t GEAR_DOWN_DELAY_5_TO_2 = 500; //50 ms
+//! Time to run the solenoid for gear up from first.
+static const uint16_t GEAR_UP_DELAY_1_TO_2 = 950; //95 ms
+//! Time to run the solenoid for gear down from second.
+static const uint16_t GEAR_DOWN_DELAY_2_TO_1 = 900; //90 ms
+//! Time to run the solenoid for gear up from neutral.
+static const uint16_t GEAR_UP_DELAY_N_TO_2 = 750; //75 ms
+//! Time to run the solenoid for gear down from neutral.
+static const uint16_t GEAR_DOWN_DELAY_N_TO_1 = 800; //80 ms
+#else
 //! Time to run the solenoid for gear up.
 static const uint16_t GEAR_UP_DELAY_2_TO_5 = 300; //30 ms
 //! Time to run the solenoid for gear down.
@@ -84,6 +100,7 @@ static const uint16_t GEAR_DOWN_DELAY_2_TO_1 = 900; //90 ms
 static const uint16_t GEAR_UP_DELAY_N_TO_2 = 700; //70 ms
 //! Time to run the solenoid for gear down from neutral.
 static const uint16_t GEAR_DOWN_DELAY_N_TO_1 = 770; //77 ms
+#endif
 
 //! Lowest revs needed to change up a gear
 //static const uint16_t GEAR_DOWN_REV_LIMIT = 9000; // TODO: what should the limit be?
@@ -103,7 +120,11 @@ static const uint8_t NEUTRAL_REPEAT_LIMIT = 10;
 //! Last gear selected before neutral attempt.
 static volatile uint8_t last_gear = 0;
 //! Last delay time used for finding neutral from first.
+#if NOCAN
+static volatile uint16_t neutral_1_to_N = 240; // 24 ms
+#else
 static volatile uint16_t neutral_1_to_N = 300; // 25 ms
+#endif
 //! Last delay time used for finding neutral from second.
 static volatile uint16_t neutral_2_to_N = 250; // 30 ms
 //! Number of tries for neutral
@@ -174,7 +195,9 @@ void set_current_revs(uint16_t revs) {
  *   <li> set \ref busy flag.
  *   <li> start shift cut by setting \ref SHIFT_CUT to GND.
  *   <li> set \ref end_fun_ptr to \ref mid_gear_up for second part of routine.
- *   <li> start timer0, \ref SHIFT_CUT_DELAY.
+ *   <li> start timer0, \ref SHIFT_CUT_DELAY_1_TO_2. The cases of the gears
+ *   fall through, so every gear change waits the delay from first, as tuned on
+ *   the car.
  *   </ol>
  * <li> In \ref timer0_isr_stop, call \ref mid_gear_up.
  *   <ol>
@@ -276,9 +299,7 @@ static void mid_gear_up(void) {
  * Turns off the solenoid in both directions. Frees the busy flag.
  */
 static void end_gear_change(void) {
-	set_output(SHIFT_CUT, TRI); // reset shift cut output
-	set_output(GEAR_UP, TRI); // reset output
-	set_output(GEAR_DOWN, TRI); // reset output
+	set_output_group(GEAR_ACTUATORS, GEAR_ACTUATORS); // reset shift cut and solenoid outputs, TRI
 	busy = FALSE; // free unit
 }
 
@@ -423,8 +444,7 @@ static void neutral_repeat_worker_linear(void) {
 }
 
 static void neutral_repeat_stabiliser_linear(void) {
-	set_output(GEAR_UP, TRI); // reset output
-	set_output(GEAR_DOWN, TRI); // reset output
+	set_output_group(GEAR_SOLENOIDS, GEAR_SOLENOIDS); // reset outputs, TRI
 	end_fun_ptr = neutral_repeat_worker_linear;
 	timer0_start(NEUTRAL_STABILISATION_DELAY);
 	can_setup_tx(0x6099, (uint8_t *) "LBTS", 4);
@@ -498,8 +518,7 @@ static void neutral_repeat_worker_bisect(void) {
 }
 
 static void neutral_repeat_stabiliser_bisect(void) {
-	set_output(GEAR_UP, TRI); // reset output
-	set_output(GEAR_DOWN, TRI); // reset output
+	set_output_group(GEAR_SOLENOIDS, GEAR_SOLENOIDS); // reset outputs, TRI
 	end_fun_ptr = neutral_repeat_worker_bisect;
 	timer0_start(NEUTRAL_STABILISATION_DELAY);
 }
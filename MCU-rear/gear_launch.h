@@ -35,7 +35,12 @@
 #ifndef _GEAR_CLUTCH_LAUNCH_H_
 #define _GEAR_CLUTCH_LAUNCH_H_
 
+//! Gear set when the gear is not known, the value the mid MCU shows.
+#if NOCAN
+#define POT_FAIL 10
+#else
 #define POT_FAIL 11
+#endif
 
 void set_current_gear(uint8_t gear);
 uint8_t get_current_gear(void);
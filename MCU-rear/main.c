@@ -60,19 +60,15 @@ volatile uint8_t failsafe_dta = FALSE;
 //! Counter to put DTA is in failsafe mode.
 volatile uint8_t failsafe_dta_counter = 0;
 
-//! Whether the front MCU is in failsafe mode.
-volatile uint8_t failsafe_front = FALSE;
+//! Whether the front MCU is in failsafe mode, from the start without CAN, see \ref NOCAN.
+volatile uint8_t failsafe_front = NOCAN;
 //! Counter to put front MCU is in failsafe mode.
 volatile uint8_t failsafe_front_counter = 0;
-//! Whether the front MCU is in failsafe mode.
-volatile uint8_t failsafe_mid = FALSE;
+//! Whether the mid MCU is in failsafe mode, from the start without CAN, see \ref NOCAN.
+volatile uint8_t failsafe_mid = NOCAN;
 //! Counter to put front MCU is in failsafe mode.
 volatile uint8_t failsafe_mid_counter = 0;
 
-//! Counter for pulses from left wheel speed sensor.
-volatile uint16_t wheel_count_l = 0;
-//! Counter for pulses from right wheel speed sensor.
-volatile uint16_t wheel_count_r = 0;
 //! Suspension sensor position for left wheel.
 volatile uint16_t susp_l = 0;
 //! Suspension sensor position for right wheel.
@@ -90,6 +86,10 @@ volatile uint16_t clutch_left_atomic = 0;
 volatile uint16_t clutch_right_atomic = 0;
 //! voltage reading of gear pot, received from DTA
 volatile uint16_t ana3 = 0;
+//! reading of the gear pot, without CAN, see \ref NOCAN
+volatile uint16_t gear_pot_atomic = 0;
+//! Set when the mid MCU reports the gear pot disconnected, see \ref NOCAN.
+volatile uint8_t diss_pot = FALSE;
 
 //! The MOb configured for RX of gear, clutch and launch control instructions.
 volatile uint8_t gcl_MOb;
@@ -125,6 +125,20 @@ int main(void) {
 	can_init(); //! <li> initialise LUR7_CAN.
 	timer0_init(); //! <li> initialise LUR7_timer0.
 	timer1_init(ON); //! <li> initialise LUR7_timer1.
+	if (!NOCAN) {
+		wheel_init(); //! <li> initialise LUR7_wheel.
+	}
+	//! </ol>
+
+	//! <li> Setup interrupts <ol>
+	if (NOCAN) { //! <li> without CAN, the backup inputs. <ol>
+		pc_int_on(BAK_IN_GEAR_UP); //! <li> gear up.
+		pc_int_on(BAK_IN_GEAR_DOWN); //! <li> gear down.
+		pc_int_on(BAK_IN_NEUTRAL); //! <li> gear neutral.
+	} else { //! </ol> <li> otherwise the wheel speeds. <ol>
+		pc_int_on(WHEEL_L); //! <li> enable interrupts on \ref WHEEL_L.
+		pc_int_on(WHEEL_R); //! <li> enable interrupts on \ref WHEEL_R.
+	} //! </ol>
 	//! </ol>
 
 	//! <li> LUR7_power. <ol>
@@ -133,8 +147,10 @@ int main(void) {
 
 	//! <li> Setup CAN RX <ol>
 	gcl_MOb = can_setup_rx(CAN_GEAR_ID, CAN_GEAR_CLUTCH_LAUNCH_MASK, CAN_GEAR_CLUTCH_LAUNCH_DLC); //! <li> Reception of gear and clutch instructions.
-	brk_MOb = can_setup_rx(CAN_FRONT_LOG_STEER_BRAKE_ID, CAN_FRONT_LOG_STEER_BRAKE_MASK, CAN_FRONT_LOG_DLC); //! <li> Reception of brake light instructions.
-	dta_MOb = can_setup_rx(CAN_DTA_ID, CAN_DTA_MASK, CAN_DTA_DLC); //! <li> Reception of current gear from DTA.
+	if (!NOCAN) {
+		brk_MOb = can_setup_rx(CAN_FRONT_LOG_STEER_BRAKE_ID, CAN_FRONT_LOG_STEER_BRAKE_MASK, CAN_FRONT_LOG_DLC); //! <li> Reception of brake light instructions.
+		dta_MOb = can_setup_rx(CAN_DTA_ID, CAN_DTA_MASK, CAN_DTA_DLC); //! <li> Reception of current gear from DTA.
+	}
 	//! </ol>
 
 	//! <li> Enable system <ol>
@@ -177,16 +193,23 @@ int main(void) {
 			clutch_flag = FALSE;
 		} //! </ol>
 
-		susp_l = adc_get(SUSPENSION_L); //! <li> update left suspension value.
-		ATOMIC_BLOCK(ATOMIC_FORCEON) {
-			susp_l_atomic = susp_l; //! <li> atomic copy of left suspension value.
-		} // end ATOMIC_BLOCK
+		if (NOCAN) {
+			uint16_t gear_pot = adc_get(GEAR_POT); //! <li> without CAN, update the gear pot value.
+			ATOMIC_BLOCK(ATOMIC_FORCEON) {
+				gear_pot_atomic = gear_pot;
+			} // end ATOMIC_BLOCK
+		} else {
+			susp_l = adc_get(SUSPENSION_L); //! <li> update left suspension value.
+			ATOMIC_BLOCK(ATOMIC_FORCEON) {
+				susp_l_atomic = susp_l; //! <li> atomic copy of left suspension value.
+			} // end ATOMIC_BLOCK
+
+			susp_r = adc_get(SUSPENSION_R); //! <li>  update right suspension value.
+			ATOMIC_BLOCK(ATOMIC_FORCEON) {
+				susp_r_atomic = susp_r; //! <li> atomic copy of right suspension value.
+			} // end ATOMIC_BLOCK
+		}
 
-		susp_r = adc_get(SUSPENSION_R); //! <li>  update right suspension value.
-		ATOMIC_BLOCK(ATOMIC_FORCEON) {
-			susp_r_atomic = susp_r; //! <li> atomic copy of right suspension value.
-		} // end ATOMIC_BLOCK
-		
 		//! <li> If front in failsafe, do: <ul>
 		if (failsafe_front) {
 			//! <li> Brake control <ol>
@@ -211,61 +234,62 @@ int main(void) {
 	return 0;
 }
 
-//! Pin Change Interrupt handler for IN1.
+#if !NOCAN
+//! Pin Change handler for \ref WHEEL_R.
 /*!
- * \ref WHEEL_R causes an interrupt incrementing the value of \ref wheel_count_r.
+ * A rising edge on \ref WHEEL_R is timestamped, see \ref LUR7_wheel.
  */
-void pcISR_in1(void) {
-	wheel_count_r++;
+static void wheel_r_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_RISING) {
+		wheel_edge(WHEEL_RIGHT, timestamp);
+	}
 }
 
-//! Pin Change Interrupt handler for IN2.
+//! Pin Change handler for \ref WHEEL_L.
 /*!
- * \ref WHEEL_R causes an interrupt incrementing the value of \ref wheel_count_r.
+ * A rising edge on \ref WHEEL_L is timestamped, see \ref LUR7_wheel.
  */
-void pcISR_in2(void) {
-	wheel_count_l++;
+static void wheel_l_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_RISING) {
+		wheel_edge(WHEEL_LEFT, timestamp);
+	}
 }
+#endif
 
-//! Pin Change Interrupt handler for IN3.
+//! Pin Change handler for \ref BAK_IN_GEAR_UP.
 /*! Gear Up backup, enabled if mid-MCU is in failsafe mode. */
-void pcISR_in3(void) {
-	if (!get_input(BAK_IN_GEAR_UP)) {
+static void bak_gear_up_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
 		gear_up_flag = TRUE;
 	}
 }
 
-//! Pin Change Interrupt handler for IN4.
-/*! \warning used as analog input */
-void pcISR_in4(void) {}
-
-//! Pin Change Interrupt handler for IN5.
+//! Pin Change handler for \ref BAK_IN_GEAR_DOWN.
 /*! Gear Down backup, enabled if mid-MCU is in failsafe mode. */
-void pcISR_in5(void) {
-	if (!get_input(BAK_IN_GEAR_DOWN)) {
+static void bak_gear_down_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
 		gear_down_flag = TRUE;
 	}
 }
 
-//! Pin Change Interrupt handler for IN6.
-/*! \warning used as analog input */
-void pcISR_in6(void) {}
-
-//! Pin Change Interrupt handler for IN7.
+//! Pin Change handler for \ref BAK_IN_NEUTRAL.
 /*! Neutral Gear backup, enabled if mid-MCU is in failsafe mode. */
-void pcISR_in7(void) {
-	if (!get_input(BAK_IN_NEUTRAL)) {
+static void bak_neutral_change(uint8_t level, uint32_t timestamp) {
+	if (level == PC_FALLING) {
 		gear_neutral_single_flag = TRUE;
 	}
 }
 
-//! Pin Change Interrupt handler for IN8.
-/*! \warning used as analog input */
-void pcISR_in8(void) {}
-
-//! Pin Change Interrupt handler for IN9.
-/*! \warning used as analog input */
-void pcISR_in9(void) {}
+//! Pin Change Interrupt handlers.
+PC_HANDLERS = {
+#if !NOCAN
+	[WHEEL_R] = wheel_r_change,
+	[WHEEL_L] = wheel_l_change,
+#endif
+	[BAK_IN_GEAR_UP] = bak_gear_up_change,
+	[BAK_IN_GEAR_DOWN] = bak_gear_down_change,
+	[BAK_IN_NEUTRAL] = bak_neutral_change,
+};
 
 //! Timer Interrupt, 100 Hz
 /*!
@@ -283,32 +307,32 @@ void pcISR_in9(void) {}
  * | \p interrupt_nbr | Wheel speed log | suspension log |
  * | :--------------: | :-------------: | :------------: |
  * | 0, 10, 20, .. 90 | x               |                |
- * | 1, 11, 21, .. 91 |                 |                |
- * | 2, 12, 22, .. 92 |                 |                |
- * | 3, 13, 23, .. 93 |                 | x              |
- * | 4, 14, 24, .. 94 |                 |                |
- * | 5, 15, 25, .. 95 |                 |                |
- * | 6, 16, 26, .. 96 |                 |                |
- * | 7, 17, 27, .. 97 |                 |                |
- * | 8, 18, 28, .. 98 |                 | x              |
- * | 9, 19, 29, .. 99 |                 |                |
+ * | 1, 11, 21, .. 91 | x               |                |
+ * | 2, 12, 22, .. 92 | x               |                |
+ * | 3, 13, 23, .. 93 | x               | x              |
+ * | 4, 14, 24, .. 94 | x               |                |
+ * | 5, 15, 25, .. 95 | x               |                |
+ * | 6, 16, 26, .. 96 | x               |                |
+ * | 7, 17, 27, .. 97 | x               |                |
+ * | 8, 18, 28, .. 98 | x               | x              |
+ * | 9, 19, 29, .. 99 | x               |                |
  *
  * \param interrupt_nbr The id of the interrupt, counting from 0-99.
  */
 void timer1_isr_100Hz(uint8_t interrupt_nbr) {
-	if (!failsafe_front && ++failsafe_front_counter == 100) {
+	if (!NOCAN && !failsafe_front && ++failsafe_front_counter == 100) {
 		failsafe_front = TRUE;
 		can_free_rx(brk_MOb);
 		//can_setup_tx(failsafe_front_ID, (uint8_t *) &failsafe_front_counter, 1);
 	}
 
-	if (!failsafe_front && failsafe_front_counter > 20){
+	if (!NOCAN && !failsafe_front && failsafe_front_counter > 20){
 		can_free_rx(brk_MOb);
 		brk_MOb = can_setup_rx(CAN_FRONT_LOG_STEER_BRAKE_ID, CAN_FRONT_LOG_STEER_BRAKE_MASK, CAN_FRONT_LOG_DLC); //! <li> Reception of brake light instructions.
 	    //can_setup_tx(failsafe_front_restart_ID, (uint8_t *) &failsafe_front_counter, 1);
 	}
 
-	if (!failsafe_mid && ++failsafe_mid_counter == 100) {
+	if (!NOCAN && !failsafe_mid && ++failsafe_mid_counter == 100) {
 		failsafe_mid = TRUE;
 		can_free_rx(gcl_MOb);
 		pc_int_on(BAK_IN_GEAR_UP); // gear up backup
@@ -316,7 +340,7 @@ void timer1_isr_100Hz(uint8_t interrupt_nbr) {
 		pc_int_on(BAK_IN_NEUTRAL); // gear neutral backup
 	}
 
-	if (!failsafe_mid && failsafe_mid_counter > 20) {
+	if (!NOCAN && !failsafe_mid && failsafe_mid_counter > 20) {
 		can_free_rx(gcl_MOb);
 		gcl_MOb = can_setup_rx(CAN_GEAR_ID, CAN_GEAR_CLUTCH_LAUNCH_MASK, CAN_GEAR_CLUTCH_LAUNCH_DLC);
 	}
@@ -325,30 +349,50 @@ void timer1_isr_100Hz(uint8_t interrupt_nbr) {
 		clutch_flag = TRUE;
 	}
 
-	if (dta_first_received && !failsafe_dta && ++failsafe_dta_counter == 100) {
+	if (!NOCAN && dta_first_received && !failsafe_dta && ++failsafe_dta_counter == 100) {
 		failsafe_dta = TRUE;
 		can_free_rx(dta_MOb);
 		set_current_gear(POT_FAIL);
 		set_current_revs(13000);
 	}
 
-	if (dta_first_received && !failsafe_dta && failsafe_dta_counter > 20) {
+	if (!NOCAN && dta_first_received && !failsafe_dta && failsafe_dta_counter > 20) {
 		can_free_rx(dta_MOb);
 		dta_MOb = can_setup_rx(CAN_DTA_ID, CAN_DTA_MASK, CAN_DTA_DLC);
 	}
 
-	// 10 Hz (avoid other data being sent)
-	if ((interrupt_nbr % 10) == 0) {
-		uint32_t holder = ((uint32_t) wheel_count_l << 16) | wheel_count_r; // build data to send
-		can_setup_tx(CAN_REAR_LOG_SPEED_ID, (uint8_t *) &holder, CAN_REAR_LOG_DLC); // send
-		wheel_count_l = 0; // reset
-		wheel_count_r = 0; // reset
+	// without CAN, the gear from the gear pot at 10 Hz
+	if (NOCAN && interrupt_nbr % 10 == 0) {
+		if (diss_pot) {
+			set_current_gear(POT_FAIL);
+		} else if (gear_pot_atomic > 71 && gear_pot_atomic <= 131) {
+			set_current_gear(1); // 449
+		} else if (gear_pot_atomic > 131 && gear_pot_atomic <= 223) {
+			set_current_gear(0); // 930
+		} else if (gear_pot_atomic > 223 && gear_pot_atomic <= 355) {
+			set_current_gear(2); // 1254
+		} else if (gear_pot_atomic > 355 && gear_pot_atomic <= 553) {
+			set_current_gear(3); // 2216
+		} else if (gear_pot_atomic > 553 && gear_pot_atomic <= 752) {
+			set_current_gear(4); // 3193
+		} else if (gear_pot_atomic > 752 && gear_pot_atomic < 870) {
+			set_current_gear(5); // 4150
+		} else {
+			set_current_gear(POT_FAIL);
+		}
 	}
 
-	//20 Hz (avoid other data being sent)
-	if (((interrupt_nbr + 2) % 5) == 0) {
-		uint32_t holder = ((uint32_t) susp_l_atomic << 16) | susp_r_atomic; // build data
-		can_setup_tx(CAN_REAR_LOG_SUSPENSION_ID, (uint8_t *) &holder, CAN_REAR_LOG_DLC); // send
+	if (!NOCAN) {
+		// 100 Hz
+		wheel_update();
+		uint32_t speed[2] = {wheel_get_frequency(WHEEL_RIGHT), wheel_get_frequency(WHEEL_LEFT)}; // build data to send
+		can_setup_tx(CAN_REAR_LOG_SPEED_ID, (uint8_t *) speed, CAN_REAR_LOG_SPEED_DLC); // send
+
+		//20 Hz (avoid other data being sent)
+		if (((interrupt_nbr + 2) % 5) == 0) {
+			uint32_t holder = ((uint32_t) susp_l_atomic << 16) | susp_r_atomic; // build data
+			can_setup_tx(CAN_REAR_LOG_SUSPENSION_ID, (uint8_t *) &holder, CAN_REAR_LOG_DLC); // send
+		}
 	}
 	/*
 	uint32_t filter = ((uint32_t) clutch_get_filtered_right() << 16) | clutch_get_filtered_left();
@@ -356,8 +400,8 @@ void timer1_isr_100Hz(uint8_t interrupt_nbr) {
 	uint32_t dutycycle = ((uint32_t) clutch_get_dutycycle_right() << 16) | clutch_get_dutycycle_left();
 	can_setup_tx(CAN_REAR_LOG_DUTYCYCLE_ID, (uint8_t *) &dutycycle, CAN_REAR_LOG_DLC);
 	*/
-	uint8_t hold = get_current_gear();
-	can_setup_tx(0x9876, (uint8_t *) &hold, 1);
+	uint8_t hold = get_current_gear(); // shown by the mid MCU without CAN
+	can_setup_tx(CAN_REAR_GEAR_ID, (uint8_t *) &hold, CAN_REAR_GEAR_DLC);
 }
 
 //see gear_clutch.c
@@ -384,6 +428,10 @@ void CAN_ISR_RXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {
 				gear_neutral_single_flag = TRUE;
 			} else if (can_data_equals(CAN_MSG_GEAR_NEUTRAL_REPEAT, data, dlc)) { //! <li> if msg is CAN_MSG_GEAR_NEUTRAL_REAPEAT, set neutral_r to TRUE.
 				gear_neutral_repeat_flag = TRUE;
+			} else if (NOCAN && can_data_equals(CAN_MSG_POT_DISS, data, dlc)) { //! <li> without CAN, if msg is CAN_MSG_POT_DISS, set \ref diss_pot.
+				diss_pot = TRUE;
+			} else if (NOCAN && can_data_equals(CAN_MSG_POT_GOOD, data, dlc)) { //! <li> without CAN, if msg is CAN_MSG_POT_GOOD, clear \ref diss_pot.
+				diss_pot = FALSE;
 			}
 		} else if (id == CAN_CLUTCH_ID) { //! <li> if message ID is CAN_CLUTCH_ID <ul>
 			clutch_left_atomic = ((uint16_t) data[3] << 8) | data[2];
@@ -393,13 +441,13 @@ void CAN_ISR_RXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {
 			//launch_control(); //! engage launch control.
 		} //! </ul>
 	} //! </ul>
-	else if (mob == brk_MOb) { //! <li> \ref brk_MOb receives a message <ul>
+	else if (!NOCAN && mob == brk_MOb) { //! <li> \ref brk_MOb receives a message <ul>
 		failsafe_front_counter = 0; //! <li> reset \ref failsafe_front_counter
 		uint16_t brake_p = ((uint16_t) data[1] << 8) | data[0]; //! <li> reconstruct brake pressure
 		brake_light(brake_p); //! <li> control brake light
 		//can_setup_tx(brake_signal_ID, (uint16_t *) &brake_p, 1);
 	} //! </ul>
-	else if (mob == dta_MOb) { //! <li> \ref dta_MOb receives a message <ul>
+	else if (!NOCAN && mob == dta_MOb) { //! <li> \ref dta_MOb receives a message <ul>
 		dta_first_received = TRUE;
 		failsafe_dta_counter = 0; //! <li> reset \ref failsafe_front_counter
 		if (id == 0x2000) {
@@ -442,7 +490,7 @@ void CAN_ISR_TXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {}
  */
 void CAN_ISR_OTHER(void) {
 	uint8_t mob = (CANPAGE & 0xF0) >> 4; // get mob number
-	if (mob == gcl_MOb || mob == brk_MOb || mob == dta_MOb) {
+	if (mob == gcl_MOb || (!NOCAN && (mob == brk_MOb || mob == dta_MOb))) {
 		CANCDMOB &= ~((1 << CONMOB1) | (1 << CONMOB0)); //disable MOb
 		_NOP();
 		CANCDMOB |= (1 << CONMOB1); // re-enable reception
@@ -0,0 +1,572 @@
+/*
+ * main.c - Cycles of the interrupts and the main loop of a firmware of the LUR7 under simavr.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file main.c
+ * avrbench runs the .elf of a firmware, as built by avr-gcc, on the AVR core
+ * of simavr and counts the cycles of every interrupt and of every pass of the
+ * main loop, instruction by instruction:
+ *
+ *     avrbench -t MCU-rear/main -m atmega64m1 -d 2000 -s bench.txt -o main.bench main.elf
+ *
+ * An interrupt is counted from being taken to its reti, interrupts nested in
+ * it included. A pass of the main loop is counted from one time the loop head
+ * is reached to the next, the interrupts taken meanwhile excluded. The head
+ * is the target of the jump that ends main, as GCC ends a main that never
+ * returns with the jump back of its loop, or the address given with -l. Its
+ * address and size are read with avr-nm, -n.
+ *
+ * simavr has no ATmega32M1, its ATmega64M1 is the same part with more flash
+ * and RAM and is the default, -m. Neither has the CAN controller: a frame is
+ * received by taking CAN_INT with the registers of a received frame in MOb 0,
+ * CANMSG reading the payload in turn as on the MCU. A frame is taken as soon
+ * as CAN_INT is enabled and no other is pending, so the bus is never faster
+ * than the firmware. The SPI has nothing on it, so the logger runs without a
+ * card.
+ *
+ * The inputs are driven by a script, -s, lines of the time in ms, a command
+ * and its arguments, numbers in hex for IDs and data, # starts a comment:
+ *
+ * <ul> <li> <tt>can rate id [byte...]</tt> receive a frame \p rate times a
+ * second, 0 stops it, up to \ref STREAMS at once, the DLC is the number of
+ * bytes.
+ * <li> <tt>adc channel value</tt> the conversions of ADMUX channel \p channel
+ * read \p value, 0 - 1023 of AVCC.
+ * <li> <tt>pin port bit level</tt> drive a pin, eg. <tt>pin D 3 0</tt>.
+ * <li> <tt>pulse port bit hz</tt> a square wave of \p hz on a pin, 0 stops
+ * it. </ul>
+ *
+ * Prints the count, average and worst cycles of every interrupt taken and of
+ * the main loop, and writes them with -o, a tab separated line of each:
+ * title, kind (isr or loop), name, count, average and worst cycles. Exits with
+ * 1 if the worst of an interrupt is longer than the tick, -T, 100 us by
+ * default, or with -B if a worst case grew by more than a tenth from the same
+ * line of an earlier report.
+ *
+ * \see header_and_config/LUR7.mk, make bench
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_interrupts.h"
+#include "sim_io.h"
+#include "avr_adc.h"
+#include "avr_ioport.h"
+
+#define VECTORS		31	//!< Interrupt vectors of the ATmega32M1, reset included.
+#define CAN_VECTOR	18	//!< CAN_INT_vect.
+#define STREAMS		8	//!< Frames received at once, see the can command.
+#define PULSES		8	//!< Square waves at once, see the pulse command.
+#define MAX_LINE	256	//!< Longest line of a script.
+
+// CAN registers of the ATmega32M1, data addresses
+#define CANGIT		0xDA
+#define CANGIE		0xDB
+#define CANSIT2		0xE0
+#define CANSIT1		0xE1
+#define CANHPMOB	0xEC
+#define CANPAGE		0xED
+#define CANSTMOB	0xEE
+#define CANCDMOB	0xEF
+#define CANIDT4		0xF0
+#define CANMSG		0xFA
+#define ENIT		7
+#define CANIT		7
+#define RXOK		5
+#define IDE		4
+#define AINC		3
+
+//! Names of the vectors, as in avr/io.h.
+static const char * const vector_names[VECTORS] = {
+	"RESET", "ANACOMP0_vect", "ANACOMP1_vect", "ANACOMP2_vect", "ANACOMP3_vect", "PSC_FAULT_vect",
+	"PSC_EC_vect", "INT0_vect", "INT1_vect", "INT2_vect", "INT3_vect", "TIMER1_CAPT_vect",
+	"TIMER1_COMPA_vect", "TIMER1_COMPB_vect", "TIMER1_OVF_vect", "TIMER0_COMPA_vect",
+	"TIMER0_COMPB_vect", "TIMER0_OVF_vect", "CAN_INT_vect", "CAN_TOVF_vect", "LIN_TC_vect",
+	"LIN_ERR_vect", "PCINT0_vect", "PCINT1_vect", "PCINT2_vect", "PCINT3_vect", "SPI_STC_vect",
+	"ADC_vect", "WDT_vect", "EE_READY_vect", "SPM_READY_vect",
+};
+
+//! Cycles of an interrupt or of the main loop.
+typedef struct {
+	uint64_t count;		//!< Times taken.
+	uint64_t cycles;	//!< In total.
+	uint64_t max;		//!< The most at once.
+} bench_t;
+
+//! A frame received over and over, see the can command.
+typedef struct {
+	uint32_t id;
+	uint8_t dlc;
+	uint8_t data[8];
+	uint64_t period;	//!< Cycles between frames, 0 if stopped.
+	uint64_t next;		//!< Cycle of the next frame.
+} stream_t;
+
+//! A square wave on a pin, see the pulse command.
+typedef struct {
+	char port;
+	uint8_t bit;
+	uint8_t level;
+	uint64_t half;		//!< Cycles between edges, 0 if stopped.
+	uint64_t next;		//!< Cycle of the next edge.
+} pulse_t;
+
+static avr_t * avr;
+static uint32_t hz = 16000000;
+static bench_t isr[VECTORS];
+static bench_t loop;
+static uint64_t entered[VECTORS];	//!< Cycle an interrupt running was taken.
+static uint8_t depth;		//!< Interrupts running, nested.
+static uint64_t isr_cycles;	//!< Cycles in interrupts, outermost only.
+static uint8_t left;		//!< Whether an interrupt returned in the last instruction.
+static stream_t streams[STREAMS];
+static stream_t * receiving;	//!< Frame of the CAN_INT pending or running.
+static pulse_t pulses[PULSES];
+static avr_int_vector_t can_vector = {
+	.vector = CAN_VECTOR,
+	.enable = AVR_IO_REGBIT(CANGIE, ENIT),
+	.raised = AVR_IO_REGBIT(CANGIT, CANIT),
+};
+
+static void usage(const char * name) {
+	fprintf(stderr, "usage: %s [-t title] [-m mcu] [-f hz] [-d ms] [-T tick_us] [-s script] [-o report] "
+		"[-B baseline] [-n nm] [-l loop] file.elf\n", name);
+	exit(2);
+}
+
+//! Helper function, counts \p cycles.
+static void bench_add(bench_t * b, uint64_t cycles) {
+	b->count++;
+	b->cycles += cycles;
+	if (cycles > b->max) {
+		b->max = cycles;
+	}
+}
+
+//! Helper function, fills in MOb 0 with the frame received.
+static void can_receive(const stream_t * s) {
+	uint32_t id = s->id;
+	avr->data[CANHPMOB] = 0x00; // MOb 0
+	avr->data[CANSIT2] = 1 << 0;
+	avr->data[CANSIT1] = 0;
+	avr->data[CANSTMOB] = 1 << RXOK;
+	avr->data[CANCDMOB] = (1 << IDE) | s->dlc;
+	avr->data[CANIDT4] = id << 3;
+	avr->data[CANIDT4 + 1] = id >> 5;
+	avr->data[CANIDT4 + 2] = id >> 13;
+	avr->data[CANIDT4 + 3] = id >> 21;
+}
+
+//! Called as an interrupt is taken, \p value 1, and returns, 0.
+static void isr_hook(struct avr_irq_t * irq, uint32_t value, void * param) {
+	(void) irq;
+	uint8_t v = (uintptr_t) param;
+	if (value) {
+		if (v == CAN_VECTOR && receiving) {
+			can_receive(receiving); // the registers are read in the interrupt
+		}
+		entered[v] = avr->cycle;
+		depth++;
+	} else if (depth) {
+		uint64_t c = avr->cycle - entered[v];
+		bench_add(&isr[v], c);
+		if (--depth == 0) {
+			isr_cycles += c;
+			left = 1;
+		}
+		if (v == CAN_VECTOR) {
+			receiving = NULL;
+		}
+	}
+}
+
+//! Reads CANMSG, the byte of the frame at the index of CANPAGE.
+static uint8_t canmsg_read(struct avr_t * a, avr_io_addr_t addr, void * param) {
+	(void) addr;
+	(void) param;
+	uint8_t page = a->data[CANPAGE];
+	uint8_t v = receiving ? receiving->data[page & 7] : 0;
+	if (!(page & (1 << AINC))) { // auto increment
+		a->data[CANPAGE] = (page & 0xF8) | ((page + 1) & 7);
+	}
+	return v;
+}
+
+//! Helper function, a frame is received when it is due and CAN_INT can be taken.
+static void can_streams(void) {
+	if (receiving || !(avr->data[CANGIE] & (1 << ENIT))) {
+		return;
+	}
+	for (uint8_t i = 0; i < STREAMS; i++) {
+		stream_t * s = &streams[i];
+		if (s->period && s->next <= avr->cycle) {
+			s->next += s->period;
+			receiving = s;
+			avr_raise_interrupt(avr, &can_vector);
+			return;
+		}
+	}
+}
+
+//! Helper function, drives a pin.
+static void pin_set(char port, uint8_t bit, uint8_t level) {
+	avr_irq_t * irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(port), bit);
+	if (irq) {
+		avr_raise_irq(irq, level);
+	}
+}
+
+//! Helper function, the edges of the square waves that are due.
+static void pulse_edges(void) {
+	for (uint8_t i = 0; i < PULSES; i++) {
+		pulse_t * p = &pulses[i];
+		if (p->half && p->next <= avr->cycle) {
+			p->next += p->half;
+			p->level = !p->level;
+			pin_set(p->port, p->bit, p->level);
+		}
+	}
+}
+
+//! Helper function, runs a command of the script.
+/*!
+ * \return 0 if it is not understood.
+ */
+static int command(char * cmd) {
+	char * name = strtok(cmd, " \t");
+	char * args[10];
+	int n = 0;
+	while (n < 10 && (args[n] = strtok(NULL, " \t")) != NULL) {
+		n++;
+	}
+	if (!name) {
+		return 1;
+	}
+	if (!strcmp(name, "can") && n >= 2 && n <= 10) {
+		uint32_t rate = strtoul(args[0], NULL, 10);
+		uint32_t id = strtoul(args[1], NULL, 16);
+		stream_t * s = NULL;
+		for (uint8_t i = 0; i < STREAMS && !s; i++) {
+			if (streams[i].period && streams[i].id == id) {
+				s = &streams[i];
+			}
+		}
+		for (uint8_t i = 0; i < STREAMS && !s; i++) {
+			if (!streams[i].period) {
+				s = &streams[i];
+			}
+		}
+		if (!s) {
+			return 0;
+		}
+		s->id = id;
+		s->dlc = n - 2;
+		for (int i = 2; i < n; i++) {
+			s->data[i - 2] = strtoul(args[i], NULL, 16);
+		}
+		s->period = rate ? hz / rate : 0;
+		s->next = avr->cycle;
+		return 1;
+	}
+	if (!strcmp(name, "adc") && n == 2) {
+		avr_irq_t * irq = avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0 + atoi(args[0]));
+		if (irq) {
+			avr_raise_irq(irq, atoi(args[1]) * avr->avcc / 1024); // mV
+		}
+		return irq != NULL;
+	}
+	if (!strcmp(name, "pin") && n == 3) {
+		pin_set(args[0][0], atoi(args[1]), atoi(args[2]));
+		return 1;
+	}
+	if (!strcmp(name, "pulse") && n == 3) {
+		char port = args[0][0];
+		uint8_t bit = atoi(args[1]);
+		uint32_t f = atoi(args[2]);
+		pulse_t * p = NULL;
+		for (uint8_t i = 0; i < PULSES && !p; i++) {
+			if (pulses[i].half && pulses[i].port == port && pulses[i].bit == bit) {
+				p = &pulses[i];
+			}
+		}
+		for (uint8_t i = 0; i < PULSES && !p; i++) {
+			if (!pulses[i].half) {
+				p = &pulses[i];
+			}
+		}
+		if (!p) {
+			return 0;
+		}
+		p->port = port;
+		p->bit = bit;
+		p->half = f ? hz / f / 2 : 0;
+		p->next = avr->cycle;
+		return 1;
+	}
+	return 0;
+}
+
+//! Helper function, address and size of main, read with nm.
+static int find_main(const char * nm, const char * elf, uint32_t * address, uint32_t * size) {
+	char cmd[512];
+	char line[256];
+	int found = 0;
+	snprintf(cmd, sizeof(cmd), "%s -S --defined-only '%s'", nm, elf);
+	FILE * in = popen(cmd, "r");
+	while (in && fgets(line, sizeof(line), in)) {
+		unsigned long a, s;
+		char type, name[64];
+		if (sscanf(line, "%lx %lx %c %63s", &a, &s, &type, name) == 4 && (type == 'T' || type == 't')
+				&& !strcmp(name, "main")) {
+			*address = a;
+			*size = s;
+			found = 1;
+		}
+	}
+	if (in) {
+		pclose(in);
+	}
+	return found;
+}
+
+//! Helper function, the target of the jump ending main, the head of its loop.
+/*!
+ * \return the address, 0 if main does not end in a jump.
+ */
+static uint32_t loop_head(uint32_t main, uint32_t size) {
+	const uint8_t * f = avr->flash;
+	uint32_t a = main + size - 2;
+	uint16_t op = f[a] | (f[a + 1] << 8);
+	if ((op & 0xF000) == 0xC000) { // rjmp
+		int16_t k = (int16_t) (op << 4) >> 4;
+		return a + 2 + 2 * k;
+	}
+	a -= 2;
+	op = f[a] | (f[a + 1] << 8);
+	if ((op & 0xFE0E) == 0x940C) { // jmp, a 22 bit word address
+		uint32_t k = ((uint32_t) ((op >> 3) & 0x3E) | (op & 1)) << 16 | f[a + 2] | (f[a + 3] << 8);
+		return 2 * k;
+	}
+	return 0;
+}
+
+//! Helper function, prints and writes a line of the report.
+static void report(FILE * out, const char * title, const char * kind, const char * name, const bench_t * b,
+		uint64_t tick) {
+	printf("  %-18s %10" PRIu64 " %10.1f %10" PRIu64 " %9.1f us%s\n", name, b->count, (double) b->cycles / b->count,
+		b->max, 1e6 * b->max / hz, strcmp(kind, "isr") || b->max <= tick ? "" : "  over the tick");
+	if (out) {
+		fprintf(out, "%s\t%s\t%s\t%" PRIu64 "\t%.1f\t%" PRIu64 "\n", title, kind, name, b->count,
+			(double) b->cycles / b->count, b->max);
+	}
+}
+
+//! Helper function, compares the worst cases with those of an earlier report.
+/*!
+ * \return the number of worst cases grown by more than a tenth.
+ */
+static int compare(const char * title, const char * baseline) {
+	FILE * in = fopen(baseline, "r");
+	if (!in) {
+		perror(baseline);
+		return 1;
+	}
+	char line[MAX_LINE];
+	int grown = 0;
+	while (fgets(line, sizeof(line), in)) {
+		char t[64], kind[16], name[64];
+		uint64_t count, max;
+		double avg;
+		if (line[0] == '#' || sscanf(line, "%63s %15s %63s %" SCNu64 " %lf %" SCNu64, t, kind, name, &count, &avg,
+				&max) != 6 || strcmp(t, title)) {
+			continue;
+		}
+		const bench_t * b = &loop;
+		if (!strcmp(kind, "isr")) {
+			b = NULL;
+			for (uint8_t v = 1; v < VECTORS; v++) {
+				if (!strcmp(vector_names[v], name)) {
+					b = &isr[v];
+				}
+			}
+		}
+		if (b && b->max > max + max / 10) {
+			fprintf(stderr, "%s: %s %s took %" PRIu64 " cycles, %" PRIu64 " in %s\n", title, kind, name, b->max,
+				max, baseline);
+			grown++;
+		}
+	}
+	fclose(in);
+	return grown;
+}
+
+int main(int argc, char ** argv) {
+	const char * title = "firmware";
+	const char * mcu = "atmega64m1";
+	const char * script = NULL;
+	const char * output = NULL;
+	const char * baseline = NULL;
+	const char * nm = "avr-nm";
+	uint32_t loop_address = 0;
+	double ms = 1000, tick_us = 100;
+	int opt;
+	while ((opt = getopt(argc, argv, "t:m:f:d:T:s:o:B:n:l:")) != -1) {
+		switch (opt) {
+			case 't': title = optarg; break;
+			case 'm': mcu = optarg; break;
+			case 'f': hz = strtoul(optarg, NULL, 0); break;
+			case 'd': ms = atof(optarg); break;
+			case 'T': tick_us = atof(optarg); break;
+			case 's': script = optarg; break;
+			case 'o': output = optarg; break;
+			case 'B': baseline = optarg; break;
+			case 'n': nm = optarg; break;
+			case 'l': loop_address = strtoul(optarg, NULL, 0); break;
+			default: usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+	}
+	const char * elf = argv[optind];
+
+	elf_firmware_t fw;
+	memset(&fw, 0, sizeof(fw));
+	if (elf_read_firmware(elf, &fw)) {
+		fprintf(stderr, "avrbench: %s could not be read\n", elf);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(mcu);
+	if (!avr) {
+		fprintf(stderr, "avrbench: simavr has no %s, see -m\n", mcu);
+		return 2;
+	}
+	avr_init(avr);
+	avr->log = LOG_ERROR;
+	avr->frequency = hz;
+	avr->vcc = avr->avcc = avr->aref = 5000; // mV
+	avr_load_firmware(avr, &fw);
+	avr_register_vector(avr, &can_vector);
+	avr_register_io_read(avr, CANMSG, canmsg_read, NULL);
+	for (uint8_t v = 1; v < VECTORS; v++) {
+		avr_irq_t * irq = avr_get_interrupt_irq(avr, v);
+		if (irq) {
+			avr_irq_register_notify(irq + AVR_INT_IRQ_RUNNING, isr_hook, (void *) (uintptr_t) v);
+		}
+	}
+	if (!loop_address) {
+		uint32_t address, size;
+		if (!find_main(nm, elf, &address, &size) || !(loop_address = loop_head(address, size))) {
+			fprintf(stderr, "avrbench: the loop of main not found in %s, see -l\n", elf);
+			return 2;
+		}
+	}
+
+	FILE * in = NULL;
+	char line[MAX_LINE];
+	double line_ms = -1;
+	char * cmd = NULL;
+	if (script && !(in = fopen(script, "r"))) {
+		perror(script);
+		return 2;
+	}
+	uint64_t end = ms * hz / 1000;
+	uint64_t pass_start = 0, pass_isr = 0;
+	uint32_t prev_pc = avr->pc;
+	int state = cpu_Running;
+	while (avr->cycle < end) {
+		while (in && (line_ms < 0 || line_ms * hz / 1000 <= avr->cycle)) {
+			if (cmd) {
+				if (!command(cmd)) {
+					fprintf(stderr, "avrbench: %s: not understood: %s\n", script, cmd);
+					return 2;
+				}
+				cmd = NULL;
+			}
+			if (!fgets(line, sizeof(line), in)) {
+				fclose(in);
+				in = NULL;
+				break;
+			}
+			line[strcspn(line, "#\r\n")] = 0;
+			char * time_text = strtok(line, " \t");
+			if (time_text) {
+				line_ms = atof(time_text);
+				cmd = time_text + strlen(time_text) + 1;
+			}
+		}
+		can_streams();
+		pulse_edges();
+		left = 0;
+		state = avr_run(avr);
+		if (state == cpu_Done || state == cpu_Crashed) {
+			fprintf(stderr, "avrbench: %s stopped after %" PRIu64 " cycles\n", title, avr->cycle);
+			break;
+		}
+		if (avr->pc == loop_address && prev_pc != loop_address && !left && !depth) {
+			if (pass_start) {
+				bench_add(&loop, avr->cycle - pass_start - (isr_cycles - pass_isr));
+			}
+			pass_start = avr->cycle;
+			pass_isr = isr_cycles;
+		}
+		prev_pc = avr->pc;
+	}
+
+	uint64_t tick = tick_us * hz / 1e6;
+	FILE * out = NULL;
+	if (output && !(out = fopen(output, "w"))) {
+		perror(output);
+		return 2;
+	}
+	if (out) {
+		fprintf(out, "# title\tkind\tname\tcount\taverage\tmax, cycles at %" PRIu32 " Hz\n", hz);
+	}
+	printf("%s: %.0f ms on the simavr %s at %.1f MHz, tick %.0f us = %" PRIu64 " cycles\n", title, ms, mcu, hz / 1e6,
+		tick_us, tick);
+	printf("  %-18s %10s %10s %10s %12s\n", "cycles", "count", "average", "worst", "worst");
+	int over = 0;
+	for (uint8_t v = 1; v < VECTORS; v++) {
+		if (isr[v].count) {
+			report(out, title, "isr", vector_names[v], &isr[v], tick);
+			over += isr[v].max > tick;
+		}
+	}
+	if (loop.count) {
+		report(out, title, "loop", "main", &loop, tick);
+	} else {
+		printf("  no pass of the main loop at 0x%" PRIx32 " completed\n", loop_address);
+	}
+	if (out) {
+		fclose(out);
+	}
+	if (over) {
+		fprintf(stderr, "%s: %d interrupts longer than the tick of %.0f us\n", title, over, tick_us);
+	}
+	if (baseline) {
+		over += compare(title, baseline);
+	}
+	return over || state == cpu_Crashed ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * bench.cpp - Benchmark of the LUR7 log decoder.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file bench.cpp
+ * lur7bench writes a synthetic log of the given size in MB, binary and as
+ * text, and times \ref logdecode on both with 1, 2, 4... threads up to the
+ * number of CPUs, or the given number:
+ *
+ *     lur7bench [MB] [threads] [directory]
+ *
+ * The binary log is written by the encoder of the logger, \ref canlog.c, from
+ * a bus at full load with the messages of the car, so that a multi-GB log
+ * spans hours and the 268 s wrap of the stored times many times. Every run is
+ * checked: all frames decoded, times increasing in every column, the last
+ * time as sent, and the same columns whatever the number of threads.
+ *
+ * The logs are written to the directory, /tmp by default, and removed when
+ * done.
+ *
+ * \see \ref logdecode
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "canlog_decode.h"
+#include "logdecode.h"
+
+//! Time between frames, µs, about full load at 1 Mbit/s.
+#define FRAME_US	130
+
+//! A message of the synthetic bus.
+static const struct {
+	uint32_t id;
+	uint8_t dlc;
+} bus[] = {
+	{0x4000, 8}, {0x4500, 8}, {0x1501, 4}, {0x2000, 8},
+	{0x4000, 8}, {0x4500, 8}, {0x1501, 4}, {0x2001, 8},
+	{0x4000, 8}, {0x4500, 8}, {0x4001, 4}, {0x4501, 4},
+	{0x4002, 4}, {0x2002, 8}, {0x2003, 8}, {0x9876, 1},
+};
+
+//! Number of messages in \ref bus.
+#define BUS_LEN		(sizeof(bus) / sizeof(bus[0]))
+
+//! What was written to a log.
+struct written {
+	uint64_t frames;
+	uint64_t last_us;	//!< Time of the last frame.
+};
+
+//! Helper function, payload of frame \p k.
+static void payload(uint64_t k, uint8_t * data) {
+	uint64_t x = k * 6364136223846793005ULL + 1442695040888963407ULL;
+	memcpy(data, &x, 8);
+}
+
+//! Writes a binary log of \p mb MB.
+static written write_binary(const char * path, uint64_t mb) {
+	written w = {0, 0};
+	FILE * f = fopen(path, "wb");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	uint64_t sectors = mb * 1000000 / CANLOG_SECTOR_SIZE;
+	uint64_t n = 0;
+	canlog_init(1, 0, 0);
+	while (n < sectors) {
+		uint8_t data[8];
+		payload(w.frames, data);
+		w.last_us = w.frames * FRAME_US;
+		canlog_frame((uint32_t) (w.last_us << CANLOG_TIME_SHIFT), bus[w.frames % BUS_LEN].id, bus[w.frames % BUS_LEN].dlc, data);
+		w.frames++;
+		canlog_sector_t * s;
+		while ((s = canlog_next()) != NULL) {
+			fwrite(s, CANLOG_SECTOR_SIZE, 1, f);
+			canlog_release();
+			n++;
+		}
+	}
+	canlog_close();
+	canlog_sector_t * s;
+	while ((s = canlog_next()) != NULL) {
+		fwrite(s, CANLOG_SECTOR_SIZE, 1, f);
+		canlog_release();
+	}
+	fclose(f);
+	return w;
+}
+
+//! Writes a text log of \p mb MB, in the format of canlog2csv.
+static written write_text(const char * path, uint64_t mb) {
+	written w = {0, 0};
+	FILE * f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	uint64_t bytes = 0;
+	while (bytes < mb * 1000000) {
+		uint8_t data[8] = {0};
+		payload(w.frames, data);
+		uint8_t dlc = bus[w.frames % BUS_LEN].dlc;
+		memset(data + dlc, 0, 8 - dlc);
+		w.last_us = w.frames * FRAME_US;
+		int n = fprintf(f, "%08X, %llu.%03u", bus[w.frames % BUS_LEN].id, (unsigned long long) (w.last_us / 1000), (unsigned) (w.last_us % 1000));
+		for (uint8_t i = 0; i < 8; i++) {
+			n += fprintf(f, ",  %02u", data[i]);
+		}
+		n += fprintf(f, "\n");
+		bytes += n;
+		w.frames++;
+	}
+	fclose(f);
+	return w;
+}
+
+//! Checks a decoded log, returns a checksum of all columns.
+static uint64_t check(const log_result & res, const written & w, int & errors) {
+	uint64_t sum = 0;
+	uint64_t last = 0;
+	if (res.frames != w.frames || res.truncated || res.bad || res.lost) {
+		printf("    %llu of %llu frames, %llu too short, %llu rejected, %llu lost\n", (unsigned long long) res.frames,
+				(unsigned long long) w.frames, (unsigned long long) res.truncated, (unsigned long long) res.bad,
+				(unsigned long long) res.lost);
+		errors++;
+	}
+	for (unsigned s = 0; s < SIGNAL_COUNT; s++) {
+		uint64_t prev = 0;
+		for (const log_part & part : res.parts) {
+			for (uint64_t t : part.columns[s].time) {
+				t += part.offset;
+				if (t < prev) {
+					printf("    %s: time going backwards\n", signals[s].time);
+					errors++;
+				}
+				prev = t;
+				sum = sum * 31 + t;
+			}
+		}
+		for (uint8_t f = 0; f < SIGNAL_FIELDS; f++) {
+			for (const log_part & part : res.parts) {
+				for (uint8_t b : part.columns[s].values[f]) {
+					sum = sum * 31 + b;
+				}
+			}
+		}
+		if (prev > last) {
+			last = prev;
+		}
+	}
+	if (last > w.last_us || w.last_us - last > BUS_LEN * FRAME_US) {
+		printf("    last time %llu us, sent %llu us\n", (unsigned long long) last, (unsigned long long) w.last_us);
+		errors++;
+	}
+	return sum;
+}
+
+//! Decodes a log with 1, 2, 4... threads.
+static int run(const char * name, const char * path, const written & w, unsigned max_threads) {
+	uint64_t reference = 0;
+	int errors = 0;
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+		log_result res;
+		std::string err;
+		auto start = std::chrono::steady_clock::now();
+		if (!log_decode(path, threads, res, err)) {
+			printf("%s\n", err.c_str());
+			return 1;
+		}
+		double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		uint64_t sum = check(res, w, errors);
+		if (threads == 1) {
+			reference = sum;
+		} else if (sum != reference) {
+			printf("    columns differ from 1 thread\n");
+			errors++;
+		}
+		printf("%-6s %8.1f MB %10llu frames %2u threads %7.3f s %7.0f MB/s %6.1f Mframes/s\n", name, res.bytes / 1e6,
+				(unsigned long long) res.frames, threads, s, res.bytes / 1e6 / s, res.frames / 1e6 / s);
+		fflush(stdout);
+	}
+	return errors;
+}
+
+int main(int argc, char ** argv) {
+	uint64_t mb = argc > 1 ? strtoull(argv[1], NULL, 10) : 2048;
+	unsigned threads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+	std::string dir = argc > 3 ? argv[3] : "/tmp";
+	std::string bin = dir + "/lur7bench.bin";
+	std::string txt = dir + "/lur7bench.txt";
+	int errors = 0;
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	printf("writing %llu MB logs to %s\n", (unsigned long long) mb, dir.c_str());
+	fflush(stdout);
+	written w = write_binary(bin.c_str(), mb);
+	errors += run("binary", bin.c_str(), w, threads);
+	remove(bin.c_str());
+
+	w = write_text(txt.c_str(), mb);
+	errors += run("text", txt.c_str(), w, threads);
+	remove(txt.c_str());
+
+	printf(errors ? "FAIL\n" : "OK\n");
+	return errors != 0;
+}
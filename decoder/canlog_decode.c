@@ -0,0 +1,283 @@
+/*
+ * canlog_decode.c - Decodes log files of the LUR7 logger on a PC.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file canlog_decode.c
+ * \ref canlog_decode decodes log files of the LUR7 logger on a PC.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref canlog_decode.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup canlog_decode PC - Log Decoder
+ * Reference decoder of the format written by \ref canlog. Sectors are fed one
+ * at a time to canlog_decode_sector(), which checks the block and calls back
+ * once per frame. Nothing is assumed about the host byte order or structure
+ * layout, all fields are read byte by byte.
+ *
+ * Every block is checked before any frame is passed on: magic, log id,
+ * sequence, CRC and that the records exactly fill the used bytes. A rejected
+ * block is counted and skipped, decoding continues with the next. Since the
+ * allocated log file is larger than the log, the sectors after the end are
+ * rejected too, as unwritten or stale. A complete log ends with an end
+ * sector, decoding should stop there.
+ *
+ * \see \ref canlog_decode.h
+ * \see \ref canlog
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <string.h>
+#include "canlog_decode.h"
+
+//! Reads a little endian 16 bit value.
+static uint16_t rd16(const uint8_t * p) {
+	return p[0] | (uint16_t) p[1] << 8;
+}
+
+//! Reads a little endian 32 bit value.
+static uint32_t rd32(const uint8_t * p) {
+	return p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+//! CRC of each nibble, polynomial 0x8408.
+static const uint16_t crc_nibble[16] = {
+	0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+	0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F
+};
+
+//! CRC of a block.
+/*!
+ * CRC-16 CCITT, reflected, start value 0xFFFF, as _crc_ccitt_update of
+ * avr-libc. Calculated four bits at a time, most of the decoding time was
+ * spent here bit by bit.
+ *
+ * \param data bytes to check.
+ * \param length number of bytes.
+ * \return the CRC.
+ */
+uint16_t canlog_crc(const uint8_t * data, uint16_t length) {
+	uint16_t crc = 0xFFFF;
+	for (uint16_t i = 0; i < length; i++) {
+		crc ^= data[i];
+		crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+		crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+	}
+	return crc;
+}
+
+//! Prepares a decoder for a new log.
+void canlog_decoder_init(canlog_decoder_t * dec) {
+	memset(dec, 0, sizeof(*dec));
+}
+
+//! Helper function, parses the header of a block.
+static void parse_header(canlog_header_t * h, const uint8_t * p) {
+	h->magic = rd32(p);
+	h->id = rd16(p + 4);
+	h->used = rd16(p + 6);
+	h->sequence = rd32(p + 8);
+	h->drops = rd32(p + 12);
+	h->time = rd32(p + 16);
+	h->crc = rd16(p + 20);
+	h->count = p[22];
+	h->flags = p[23];
+}
+
+//! Decodes one sector.
+/*!
+ * \param dec the decoder of the log.
+ * \param sector 512 bytes read from the log.
+ * \param cb called for every frame of the block, may be NULL.
+ * \param ctx passed on to \p cb.
+ * \return \ref CANLOG_OK, \ref CANLOG_SESSION, \ref CANLOG_END or the reason
+ * the sector was rejected.
+ */
+int canlog_decode_sector(canlog_decoder_t * dec, const uint8_t * sector, canlog_frame_cb cb, void * ctx) {
+	canlog_frame_t frames[CANLOG_MAX_RECORDS]; // on the stack, decoders may run in parallel
+	canlog_header_t h;
+	uint32_t dictionary[CANLOG_SLOTS];
+	uint8_t slots = 0;
+
+	if (rd32(sector) == CANLOG_SESSION_MAGIC) {
+		if (dec->have_session && rd16(sector + 4) != dec->id) {
+			dec->bad_blocks++;
+			return CANLOG_BAD_SESSION;
+		}
+		dec->have_session = 1;
+		dec->id = rd16(sector + 4);
+		dec->clock = rd32(sector + 8);
+		return CANLOG_SESSION;
+	}
+
+	if (rd32(sector) == CANLOG_END_MAGIC) {
+		if (dec->have_session && rd16(sector + 4) != dec->id) {
+			dec->bad_blocks++;
+			return CANLOG_BAD_SESSION;
+		}
+		dec->ended = 1;
+		dec->end.magic = CANLOG_END_MAGIC;
+		dec->end.id = rd16(sector + 4);
+		dec->end.reason = sector[6];
+		dec->end.reserved = sector[7];
+		dec->end.blocks = rd32(sector + 8);
+		dec->end.drops = rd32(sector + 12);
+		return CANLOG_END;
+	}
+
+	parse_header(&h, sector);
+	int res = CANLOG_OK;
+	if (h.magic != CANLOG_MAGIC || h.used > CANLOG_DATA_SIZE) {
+		res = CANLOG_BAD_MAGIC;
+	} else if (dec->have_session && h.id != dec->id) {
+		res = CANLOG_BAD_SESSION;
+	} else if (dec->started && h.sequence <= dec->sequence) {
+		res = CANLOG_BAD_SEQUENCE;
+	} else if (canlog_crc(sector + sizeof(canlog_header_t), h.used) != h.crc) {
+		res = CANLOG_BAD_CRC;
+	}
+	if (res != CANLOG_OK) {
+		dec->bad_blocks++;
+		return res;
+	}
+
+	// parse all records before passing any on
+	const uint8_t * p = sector + sizeof(canlog_header_t);
+	const uint8_t * end = p + h.used;
+	uint64_t time = dec->started ? dec->time + ((h.time - dec->raw_time) & CANLOG_TIME_MASK) : h.time;
+	uint32_t raw_time = h.time;
+	uint16_t n = 0;
+	while (p < end && n < h.count) {
+		canlog_frame_t * f = &frames[n];
+		uint8_t tag = *p++;
+		uint8_t slot = tag & 0x0F;
+		f->dlc = tag >> 4;
+		if (f->dlc > 8) {
+			break;
+		}
+		if (slot == CANLOG_LITERAL) {
+			if (end - p < 4) {
+				break;
+			}
+			f->id = rd32(p);
+			p += 4;
+			if (slots < CANLOG_SLOTS) {
+				dictionary[slots++] = f->id;
+			}
+		} else if (slot < slots) {
+			f->id = dictionary[slot];
+		} else {
+			break;
+		}
+
+		uint32_t delta = 0;
+		uint8_t shift = 0;
+		uint8_t b = 0x80;
+		do {
+			if (p == end || shift > 28) {
+				break;
+			}
+			b = *p++;
+			delta |= (uint32_t) (b & 0x7F) << shift;
+			shift += 7;
+		} while (b & 0x80);
+		if (b & 0x80) {
+			break;
+		}
+		time += delta;
+		raw_time = (raw_time + delta) & CANLOG_TIME_MASK;
+		f->time = time;
+
+		if (end - p < f->dlc) {
+			break;
+		}
+		memset(f->data, 0, sizeof(f->data));
+		memcpy(f->data, p, f->dlc);
+		p += f->dlc;
+		n++;
+	}
+	if (p != end || n != h.count) {
+		dec->bad_blocks++;
+		return CANLOG_BAD_RECORD;
+	}
+
+	if (dec->started) {
+		dec->lost_blocks += h.sequence - dec->sequence - 1;
+	} else if (!dec->have_session) {
+		dec->have_session = 1;
+		dec->id = h.id;
+	}
+	dec->started = 1;
+	dec->sequence = h.sequence;
+	dec->time = time;
+	dec->raw_time = raw_time;
+	dec->header = h;
+	dec->blocks++;
+	dec->frames += n;
+	if (cb) {
+		for (uint16_t i = 0; i < n; i++) {
+			cb(&frames[i], ctx);
+		}
+	}
+	return CANLOG_OK;
+}
+
+//! Reads an entry of the session index.
+/*!
+ * \param entry filled with the entry.
+ * \param bytes 32 bytes read from LOGINDEX.BIN.
+ * \return 1 if the bytes are an index entry.
+ */
+int canlog_parse_index(canlog_index_t * entry, const uint8_t * bytes) {
+	entry->magic = rd32(bytes);
+	entry->session = rd16(bytes + 4);
+	entry->reason = bytes[6];
+	entry->reserved = bytes[7];
+	entry->boot = rd16(bytes + 8);
+	entry->id = rd16(bytes + 10);
+	entry->start = rd32(bytes + 12);
+	entry->duration = rd32(bytes + 16);
+	entry->blocks = rd32(bytes + 20);
+	entry->frames = rd32(bytes + 24);
+	entry->drops = rd32(bytes + 28);
+	return entry->magic == CANLOG_INDEX_MAGIC;
+}
+
+//! Describes why a log ended.
+/*!
+ * \param reason canlog_end_t::reason.
+ * \return a short text.
+ */
+const char * canlog_end_reason(uint8_t reason) {
+	switch (reason) {
+		case CANLOG_END_POWER:
+			return "power off";
+		case CANLOG_END_RECOVERED:
+			return "ended at start up after power loss";
+		case CANLOG_END_STOP:
+			return "stopped";
+		case CANLOG_END_ROTATE:
+			return "file full, continues in the next";
+		default:
+			return "unknown";
+	}
+}
@@ -0,0 +1,100 @@
+/*
+ * canlog_decode.h - Decodes log files of the LUR7 logger on a PC.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file canlog_decode.h
+ * \ref canlog_decode decodes log files of the LUR7 logger on a PC.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref canlog_decode.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup canlog_decode
+ */
+
+#ifndef _CANLOG_DECODE_H_
+#define _CANLOG_DECODE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../Logger/canlog.h"
+
+//! Most records that fit in a block, all of two bytes.
+#define CANLOG_MAX_RECORDS	(CANLOG_DATA_SIZE / 2)
+
+//! Results of \ref canlog_decode_sector.
+enum {
+	CANLOG_OK = 0,		//!< Block decoded.
+	CANLOG_SESSION,		//!< Session sector read.
+	CANLOG_END,		//!< End sector read, the log is complete.
+	CANLOG_BAD_MAGIC,	//!< Not a block, eg. unwritten space after the end of the log.
+	CANLOG_BAD_SESSION,	//!< Block of another log, or session sector of another log.
+	CANLOG_BAD_SEQUENCE,	//!< Block older than one already decoded.
+	CANLOG_BAD_CRC,		//!< Damaged block, eg. torn by power loss.
+	CANLOG_BAD_RECORD	//!< Records do not match the header.
+};
+
+//! A decoded frame.
+typedef struct {
+	uint64_t time;		//!< µs, from the same origin as canlog_header_t::time, unwrapped.
+	uint32_t id;		//!< 29 bit CAN ID.
+	uint8_t dlc;		//!< Number of data bytes.
+	uint8_t data[8];	//!< Payload, unused bytes zero.
+} canlog_frame_t;
+
+//! Decoder state, one per log.
+typedef struct {
+	uint8_t have_session;	//!< Whether the session sector or a first block has been read.
+	uint16_t id;		//!< Log id, see canlog_session_t::id.
+	uint32_t clock;		//!< Timer clock from the session sector, 0 if not read.
+	uint8_t started;	//!< Whether a block has been decoded.
+	uint32_t sequence;	//!< Sequence number of the last decoded block.
+	uint32_t raw_time;	//!< Last time as stored, modulo 2^28 µs.
+	uint64_t time;		//!< Last time, unwrapped.
+	canlog_header_t header;	//!< Header of the last decoded block.
+	uint8_t ended;		//!< Whether the end sector has been read.
+	canlog_end_t end;	//!< The end sector.
+	uint32_t blocks;	//!< Number of decoded blocks.
+	uint32_t bad_blocks;	//!< Number of rejected sectors.
+	uint32_t lost_blocks;	//!< Number of blocks missing in the sequence.
+	uint64_t frames;	//!< Number of decoded frames.
+} canlog_decoder_t;
+
+//! Called for every decoded frame.
+typedef void (*canlog_frame_cb)(const canlog_frame_t * frame, void * ctx);
+
+void canlog_decoder_init(canlog_decoder_t * dec);
+int canlog_decode_sector(canlog_decoder_t * dec, const uint8_t * sector, canlog_frame_cb cb, void * ctx);
+uint16_t canlog_crc(const uint8_t * data, uint16_t length);
+int canlog_parse_index(canlog_index_t * entry, const uint8_t * bytes);
+const char * canlog_end_reason(uint8_t reason);
+
+//! Size of an entry of the session index in the file.
+#define CANLOG_INDEX_SIZE	32
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CANLOG_DECODE_H_
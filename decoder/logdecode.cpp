@@ -0,0 +1,442 @@
+/*
+ * logdecode.cpp - Parallel decoder of LUR7 logs into signal columns.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logdecode.cpp
+ * \ref logdecode decodes a log into one column per signal.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref logdecode.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup logdecode PC - Parallel Log Decoder
+ * Replaces the readcvs_main.m pipeline, which read every cell with a separate
+ * csvread and grew its vectors one value at a time. The log is memory mapped
+ * and split in as many parts as there are threads, every thread decodes its
+ * part into its own columns and the columns are joined in file order when
+ * written, nothing is copied in between.
+ *
+ * Two formats are read:
+ * - the binary format of \ref canlog, recognised by its magic. A part is a
+ *   range of sectors, each block is decoded on its own by \ref canlog_decode.
+ *   Times are unwrapped within a part, the parts are then joined using the
+ *   stored time of the last frame of one part and the first block of the next.
+ *   Parts after the end sector are discarded, they hold stale data.
+ * - text, as written by canlog2csv or the old logger. A part starts at the
+ *   first line break after its share of the file.
+ *
+ * The signals decoded are listed in \ref signals.h, other IDs are counted and
+ * skipped.
+ *
+ * \see \ref logdecode.h
+ * \see \ref canlog_decode
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+#include "canlog_decode.h"
+#include "logdecode.h"
+#include "matfile.h"
+
+//! Number of times converted per write.
+#define TIME_BUFFER	65536
+
+//! Size of a value.
+uint8_t field_size(enum field_type type) {
+	return type == FIELD_U32_LE ? 4 : 2;
+}
+
+//! Helper function, finds the entry of an ID in \ref signals.
+/*!
+ * \return the index, or -1 if the ID is not decoded.
+ */
+static int find_signal(uint32_t id) {
+	for (unsigned i = 0; i < SIGNAL_COUNT; i++) {
+		if (signals[i].id == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//! Helper function, number of payload bytes the values of a message take.
+static uint8_t signal_length(const struct signal & sig) {
+	uint8_t len = 0;
+	for (uint8_t i = 0; i < SIGNAL_FIELDS; i++) {
+		const struct field & f = sig.fields[i];
+		if (f.type != FIELD_NONE && f.offset + field_size(f.type) > len) {
+			len = f.offset + field_size(f.type);
+		}
+	}
+	return len;
+}
+
+//! Helper function, decodes the values of a frame into the columns of a part.
+/*!
+ * A frame whose \p dlc does not cover its values is counted as
+ * short and skipped, the bytes would be stale.
+ */
+static void add_frame(log_part & part, uint64_t time, uint32_t id, uint8_t dlc, const uint8_t * data) {
+	part.frames++;
+	int s = find_signal(id);
+	if (s < 0) {
+		part.unknown++;
+		return;
+	}
+	if (dlc < signal_length(signals[s])) {
+		part.truncated++;
+		return;
+	}
+	log_column & col = part.columns[s];
+	col.time.push_back(time);
+	for (uint8_t i = 0; i < SIGNAL_FIELDS; i++) {
+		const struct field & f = signals[s].fields[i];
+		const uint8_t * p = data + f.offset;
+		std::vector<uint8_t> & v = col.values[i];
+		if (f.type == FIELD_U16_BE) {
+			uint16_t x = (p[0] << 8) | p[1];
+			v.resize(v.size() + 2);
+			memcpy(&v[v.size() - 2], &x, 2);
+		} else if (f.type == FIELD_U16_LE) {
+			uint16_t x = p[0] | (p[1] << 8);
+			v.resize(v.size() + 2);
+			memcpy(&v[v.size() - 2], &x, 2);
+		} else if (f.type == FIELD_U32_LE) {
+			uint32_t x = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+			v.resize(v.size() + 4);
+			memcpy(&v[v.size() - 4], &x, 4);
+		}
+	}
+}
+
+//! Callback of \ref canlog_decode_sector.
+static void binary_frame(const canlog_frame_t * f, void * ctx) {
+	add_frame(*(log_part *) ctx, f->time, f->id, f->dlc, f->data);
+}
+
+//! Helper function, decodes sectors \p first to \p last - 1 of a binary log.
+static void decode_binary(const uint8_t * log, uint64_t first, uint64_t last, uint16_t id, log_part * part) {
+	canlog_decoder_t dec;
+	canlog_decoder_init(&dec);
+	dec.have_session = 1;
+	dec.id = id;
+	for (uint64_t i = first; i < last; i++) {
+		const uint8_t * sector = log + i * CANLOG_SECTOR_SIZE;
+		int res = canlog_decode_sector(&dec, sector, binary_frame, part);
+		if (res == CANLOG_END) {
+			part->ended = true;
+			part->drops = dec.end.drops;
+			break;
+		} else if (res == CANLOG_OK) {
+			if (!part->started) {
+				part->started = true;
+				part->first_sequence = dec.sequence;
+				part->first_raw = dec.header.time;
+			}
+			part->last_sequence = dec.sequence;
+			part->last_raw = dec.raw_time;
+			part->last_time = dec.time;
+			part->drops = dec.header.drops;
+		} else if (res != CANLOG_SESSION && res != CANLOG_BAD_MAGIC) {
+			part->bad++; // unwritten sectors at the end are not counted
+		}
+	}
+	part->lost = dec.lost_blocks;
+}
+
+//! Helper function, parses an unsigned number.
+/*!
+ * \return the number of digits.
+ */
+static int parse_number(const char *& p, const char * end, unsigned base, uint64_t & value) {
+	int digits = 0;
+	value = 0;
+	while (p < end) {
+		unsigned d;
+		if (*p >= '0' && *p <= '9') {
+			d = *p - '0';
+		} else if (base == 16 && (*p | 0x20) >= 'a' && (*p | 0x20) <= 'f') {
+			d = (*p | 0x20) - 'a' + 10;
+		} else {
+			break;
+		}
+		value = value * base + d;
+		p++;
+		digits++;
+	}
+	return digits;
+}
+
+//! Helper function, skips spaces and at most one comma.
+static void skip_separator(const char *& p, const char * end) {
+	bool comma = false;
+	while (p < end && (*p == ' ' || *p == '\t' || (*p == ',' && !comma))) {
+		comma |= *p == ',';
+		p++;
+	}
+}
+
+//! Helper function, decodes the lines of a text log in \p begin to \p end.
+/*!
+ * A line is: ID in hex, time in ms with up to three decimals, and up to
+ * eight data bytes in decimal, separated by commas.
+ */
+static void decode_text(const char * begin, const char * end, log_part * part) {
+	const char * p = begin;
+	while (p < end) {
+		const char * eol = (const char *) memchr(p, '\n', end - p);
+		if (!eol) {
+			eol = end;
+		}
+		const char * line = p;
+		p = eol + 1;
+		while (line < eol && (*line == ' ' || *line == '\r')) {
+			line++;
+		}
+		if (line == eol) {
+			continue; // empty line
+		}
+
+		uint64_t id, ms, frac = 0, byte;
+		uint8_t data[8] = {0};
+		int frac_digits = 0;
+		uint8_t dlc = 0;
+		bool ok = parse_number(line, eol, 16, id) > 0;
+		skip_separator(line, eol);
+		ok &= parse_number(line, eol, 10, ms) > 0;
+		if (line < eol && *line == '.') {
+			line++;
+			frac_digits = parse_number(line, eol, 10, frac);
+		}
+		for (uint8_t i = 0; ok && i < 8; i++) {
+			skip_separator(line, eol);
+			if (line == eol || *line == '\r') {
+				break;
+			}
+			ok &= parse_number(line, eol, 10, byte) > 0 && byte <= 0xFF;
+			data[i] = byte;
+			dlc++;
+		}
+		if (!ok || frac_digits > 3) {
+			part->bad++;
+			continue;
+		}
+		while (frac_digits++ < 3) {
+			frac *= 10;
+		}
+		add_frame(*part, ms * 1000 + frac, id, dlc, data);
+	}
+}
+
+//! Helper function, start of the first line at or after \p pos.
+static uint64_t line_start(const char * log, uint64_t size, uint64_t pos) {
+	if (pos == 0) {
+		return 0;
+	}
+	const char * eol = (const char *) memchr(log + pos - 1, '\n', size - pos + 1);
+	return eol ? eol - log + 1 : size;
+}
+
+//! Helper function, joins the times of the parts of a binary log.
+static void join_parts(log_result & res) {
+	const log_part * prev = NULL;
+	for (log_part & part : res.parts) {
+		if (res.ended) { // after the end of the log
+			part = log_part();
+			part.columns.resize(SIGNAL_COUNT);
+			continue;
+		}
+		if (part.ended) {
+			res.ended = true;
+			res.drops = part.drops;
+		}
+		if (!part.started) {
+			continue;
+		}
+		if (!prev) {
+			part.offset = 0;
+		} else {
+			uint64_t prev_last = prev->last_time + prev->offset;
+			uint32_t gap = (part.first_raw - prev->last_raw) & CANLOG_TIME_MASK;
+			part.offset = (int64_t) (prev_last + gap) - part.first_raw;
+			if (part.first_sequence > prev->last_sequence) {
+				res.lost += part.first_sequence - prev->last_sequence - 1;
+			} else {
+				res.bad++; // out of order across the parts
+			}
+		}
+		if (!res.ended) {
+			res.drops = part.drops;
+		}
+		prev = &part;
+	}
+}
+
+//! Decodes a log.
+/*!
+ * \param path the log file, binary or text.
+ * \param threads number of threads, and parts of the log.
+ * \param res the decoded log.
+ * \param err reason of a failure.
+ * \return true on success.
+ */
+bool log_decode(const char * path, unsigned threads, log_result & res, std::string & err) {
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st)) {
+		err = std::string(path) + ": " + strerror(errno);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+	res = log_result();
+	res.bytes = st.st_size;
+	if (res.bytes == 0) {
+		close(fd);
+		return true;
+	}
+	void * map = mmap(NULL, res.bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		err = std::string(path) + ": " + strerror(errno);
+		return false;
+	}
+	madvise(map, res.bytes, MADV_SEQUENTIAL);
+	const uint8_t * log = (const uint8_t *) map;
+
+	uint32_t magic = 0;
+	if (res.bytes >= CANLOG_SECTOR_SIZE) {
+		magic = log[0] | (log[1] << 8) | (log[2] << 16) | ((uint32_t) log[3] << 24);
+	}
+	res.binary = magic == CANLOG_SESSION_MAGIC || magic == CANLOG_MAGIC;
+	if (res.binary) {
+		res.id = log[4] | (log[5] << 8);
+	}
+
+	uint64_t units = res.binary ? res.bytes / CANLOG_SECTOR_SIZE : res.bytes;
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (threads > units) {
+		threads = units;
+	}
+	res.parts.resize(threads);
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < threads; i++) {
+		log_part * part = &res.parts[i];
+		part->columns.resize(SIGNAL_COUNT);
+		uint64_t first = units * i / threads;
+		uint64_t last = units * (i + 1) / threads;
+		if (res.binary) {
+			workers.emplace_back(decode_binary, log, first, last, res.id, part);
+		} else {
+			const char * text = (const char *) log;
+			first = line_start(text, res.bytes, first);
+			last = line_start(text, res.bytes, last);
+			workers.emplace_back(decode_text, text + first, text + last, part);
+		}
+	}
+	for (std::thread & t : workers) {
+		t.join();
+	}
+	munmap(map, res.bytes);
+
+	if (res.binary) {
+		join_parts(res);
+	}
+	for (const log_part & part : res.parts) {
+		res.frames += part.frames;
+		res.unknown += part.unknown;
+		res.truncated += part.truncated;
+		res.bad += part.bad;
+		res.lost += part.lost;
+	}
+	return true;
+}
+
+//! Writes the columns of a decoded log to a MAT-file.
+/*!
+ * Every message gives a time vector in seconds, named as in \ref signals, and
+ * one vector per value, of its own type.
+ *
+ * \param res the decoded log.
+ * \param path name of the MAT-file.
+ * \param err reason of a failure.
+ * \return true on success.
+ */
+bool log_write_mat(const log_result & res, const char * path, std::string & err) {
+	matfile mat;
+	if (!mat.open(path)) {
+		err = std::string(path) + ": " + strerror(errno);
+		return false;
+	}
+	std::vector<double> seconds(TIME_BUFFER);
+	for (unsigned s = 0; s < SIGNAL_COUNT; s++) {
+		uint64_t count = 0;
+		for (const log_part & part : res.parts) {
+			count += part.columns[s].time.size();
+		}
+
+		if (!mat.begin(signals[s].time, MAT_DOUBLE, count)) {
+			err = std::string(signals[s].time) + ": too large for a MAT-file";
+			return false;
+		}
+		for (const log_part & part : res.parts) {
+			const std::vector<uint64_t> & time = part.columns[s].time;
+			for (size_t i = 0; i < time.size(); i += TIME_BUFFER) {
+				size_t n = std::min(time.size() - i, (size_t) TIME_BUFFER);
+				for (size_t j = 0; j < n; j++) {
+					seconds[j] = (double) (int64_t) (time[i + j] + part.offset) * 1e-6;
+				}
+				mat.data(seconds.data(), n * sizeof(double));
+			}
+		}
+		mat.end();
+
+		for (uint8_t f = 0; f < SIGNAL_FIELDS; f++) {
+			const struct field & field = signals[s].fields[f];
+			if (field.type == FIELD_NONE) {
+				continue;
+			}
+			if (!mat.begin(field.name, field.type == FIELD_U32_LE ? MAT_UINT32 : MAT_UINT16, count)) {
+				err = std::string(field.name) + ": too large for a MAT-file";
+				return false;
+			}
+			for (const log_part & part : res.parts) {
+				mat.data(part.columns[s].values[f].data(), part.columns[s].values[f].size());
+			}
+			mat.end();
+		}
+	}
+	if (!mat.close()) {
+		err = std::string(path) + ": write failed";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,82 @@
+/*
+ * logdecode.h - Parallel decoder of LUR7 logs into signal columns.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logdecode.h
+ * \ref logdecode decodes a log into one column per signal.
+ *
+ * \see \ref logdecode.cpp
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup logdecode
+ */
+
+#ifndef _LOGDECODE_H_
+#define _LOGDECODE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "signals.h"
+
+//! Decoded values of one message, from one part of the log.
+struct log_column {
+	std::vector<uint64_t> time;			//!< µs, unwrapped.
+	std::vector<uint8_t> values[SIGNAL_FIELDS];	//!< Values in the byte order of the host.
+};
+
+//! Result of decoding one part of the log, by one thread.
+struct log_part {
+	std::vector<log_column> columns;	//!< One per entry in \ref signals.
+	int64_t offset;		//!< Added to the times of the part to get the time of the log.
+	bool started;		//!< Whether the part has a valid block.
+	bool ended;		//!< Whether the part has the end sector, decoding stopped there.
+	uint32_t first_sequence;	//!< Sequence number of the first valid block.
+	uint32_t last_sequence;	//!< Sequence number of the last valid block.
+	uint32_t first_raw;	//!< Time of the first valid block, as stored.
+	uint32_t last_raw;	//!< Time of the last frame, as stored.
+	uint64_t last_time;	//!< Time of the last frame, unwrapped within the part.
+	uint32_t drops;		//!< Drop counter of the last valid block.
+	uint64_t frames;	//!< Number of frames.
+	uint64_t unknown;	//!< Number of frames not in \ref signals.
+	uint64_t truncated;	//!< Number of frames too short for their values, not decoded.
+	uint64_t bad;		//!< Number of rejected blocks or lines.
+	uint64_t lost;		//!< Number of blocks missing in the sequence.
+};
+
+//! A decoded log.
+struct log_result {
+	bool binary;		//!< Whether the log was in the binary format of \ref canlog.
+	uint16_t id;		//!< Log id of a binary log, see canlog_session_t::id.
+	uint64_t bytes;		//!< Size of the log file.
+	std::vector<log_part> parts;	//!< In the order of the file.
+	uint64_t frames;	//!< Totals of all parts, see \ref log_part.
+	uint64_t unknown;
+	uint64_t truncated;
+	uint64_t bad;
+	uint64_t lost;
+	uint32_t drops;
+	bool ended;		//!< Whether the log has an end sector.
+};
+
+bool log_decode(const char * path, unsigned threads, log_result & res, std::string & err);
+bool log_write_mat(const log_result & res, const char * path, std::string & err);
+uint8_t field_size(enum field_type type);
+
+#endif // _LOGDECODE_H_
@@ -0,0 +1,137 @@
+/*
+ * logindex.c - Lists the runs in the session index of the LUR7 logger.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file logindex.c
+ * logindex lists the runs recorded in LOGINDEX.BIN on the card of the
+ * logger, so that a run can be found without reading every log:
+ *
+ *     logindex LOGINDEX.BIN
+ *     logindex -r 3 LOGINDEX.BIN
+ *
+ * A run is one log, or several when the file became full and the log
+ * continued in the next, see \ref CANLOG_END_ROTATE. The first form prints
+ * one line per run with its files, start and length since power up, frame
+ * counts and how it ended. The second prints only the files of run 3, one
+ * per line, eg. to pass on to lur7decode.
+ *
+ * \see \ref canlog_index_t
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "canlog_decode.h"
+
+static void usage(const char * name) {
+	fprintf(stderr, "usage: %s [-r run] LOGINDEX.BIN\n", name);
+	exit(2);
+}
+
+//! Prints a run, entries \p first to \p last of the index.
+static void print_run(unsigned run, const canlog_index_t * first, const canlog_index_t * last) {
+	uint64_t blocks = 0, frames = 0, drops = 0;
+	uint64_t length = 0;
+	for (const canlog_index_t * e = first; e <= last; e++) {
+		blocks += e->blocks;
+		frames += e->frames;
+		drops += e->drops;
+		length += e->duration;
+	}
+	printf("%4u  LOG%04u.BIN", run, first->session);
+	if (last != first) {
+		printf("-%04u", last->session);
+	} else {
+		printf("     ");
+	}
+	if (first->reason == CANLOG_END_RECOVERED) {
+		printf("  %5s  %10s  %10s", "-", "-", "-");
+	} else {
+		printf("  %5u  %10.2f  %10.2f", first->boot, first->start / 1000.0, length / 1000.0);
+	}
+	printf("  %8" PRIu64 "  %10" PRIu64 "  %6" PRIu64 "  %s\n", blocks, frames, drops, canlog_end_reason(last->reason));
+}
+
+int main(int argc, char ** argv) {
+	long wanted = -1;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:")) != -1) {
+		if (opt == 'r') {
+			wanted = atol(optarg);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+	}
+	FILE * in = fopen(argv[optind], "rb");
+	if (!in) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	canlog_index_t * entries = NULL;
+	size_t count = 0, bad = 0;
+	uint8_t bytes[CANLOG_INDEX_SIZE];
+	while (fread(bytes, sizeof(bytes), 1, in) == 1) {
+		canlog_index_t e;
+		if (!canlog_parse_index(&e, bytes)) {
+			bad++;
+			continue;
+		}
+		canlog_index_t * grown = realloc(entries, (count + 1) * sizeof(*entries));
+		if (!grown) {
+			perror("realloc");
+			return 1;
+		}
+		entries = grown;
+		entries[count++] = e;
+	}
+	fclose(in);
+
+	if (wanted < 0) {
+		printf("%4s  %-16s  %5s  %10s  %10s  %8s  %10s  %6s  %s\n",
+				"run", "files", "boot", "start s", "length s", "blocks", "frames", "drops", "end");
+	}
+	unsigned run = 0;
+	int found = 0;
+	for (size_t i = 0; i < count; run++) {
+		size_t j = i; // rotated files continue the run
+		while (j + 1 < count && entries[j].reason == CANLOG_END_ROTATE && entries[j + 1].session == entries[j].session + 1) {
+			j++;
+		}
+		if (wanted < 0) {
+			print_run(run, &entries[i], &entries[j]);
+		} else if ((long) run == wanted) {
+			for (size_t k = i; k <= j; k++) {
+				printf("LOG%04u.BIN\n", entries[k].session);
+			}
+			found = 1;
+		}
+		i = j + 1;
+	}
+	if (bad) {
+		fprintf(stderr, "%zu damaged entries skipped\n", bad);
+	}
+	free(entries);
+	return (wanted < 0 || found) ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*
+ * lur7decode.cpp - Converts LUR7 logs to MAT-files.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file lur7decode.cpp
+ * lur7decode decodes a log, binary from the logger or text, into one column
+ * per signal and writes them to a MAT-file:
+ *
+ *     lur7decode [-j threads] [-o out.mat] LOG0001.BIN
+ *
+ * In MATLAB all columns are then read with load('out.mat'), in Python with
+ * scipy.io.loadmat('out.mat'). The default output name is the log name with
+ * the extension replaced by .mat, the default number of threads is the number
+ * of CPUs.
+ *
+ * \see \ref logdecode
+ * \see \ref signals.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include "logdecode.h"
+
+static void usage(const char * name) {
+	fprintf(stderr, "usage: %s [-j threads] [-o out.mat] LOGnnnn.BIN|log.txt\n", name);
+	exit(2);
+}
+
+int main(int argc, char ** argv) {
+	unsigned threads = std::thread::hardware_concurrency();
+	std::string out;
+	int opt;
+	while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+		if (opt == 'j') {
+			threads = atoi(optarg);
+		} else if (opt == 'o') {
+			out = optarg;
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+	}
+	const char * in = argv[optind];
+	if (out.empty()) {
+		out = in;
+		size_t dot = out.find_last_of('.');
+		size_t slash = out.find_last_of('/');
+		if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+			out.erase(dot);
+		}
+		out += ".mat";
+	}
+
+	log_result res;
+	std::string err;
+	auto start = std::chrono::steady_clock::now();
+	if (!log_decode(in, threads, res, err)) {
+		fprintf(stderr, "%s\n", err.c_str());
+		return 1;
+	}
+	double decode_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (!log_write_mat(res, out.c_str(), err)) {
+		fprintf(stderr, "%s\n", err.c_str());
+		return 1;
+	}
+
+	fprintf(stderr, "%s log, %llu frames, %llu of unknown IDs, %llu too short, %llu %s rejected\n",
+			res.binary ? "binary" : "text", (unsigned long long) res.frames, (unsigned long long) res.unknown,
+			(unsigned long long) res.truncated, (unsigned long long) res.bad, res.binary ? "blocks" : "lines");
+	if (res.binary) {
+		fprintf(stderr, "log id %u, %u frames dropped by the logger, %llu blocks missing, %s\n",
+				res.id, res.drops, (unsigned long long) res.lost, res.ended ? "complete" : "no end sector");
+	}
+	fprintf(stderr, "decoded %.1f MB in %.3f s with %zu threads, %.0f MB/s\n",
+			res.bytes / 1e6, decode_s, res.parts.size(), res.bytes / 1e6 / decode_s);
+	return 0;
+}
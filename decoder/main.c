@@ -0,0 +1,82 @@
+/*
+ * main.c - Converts log files of the LUR7 logger to text.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file decoder/main.c
+ * canlog2csv converts a LOGnnnn.BIN file from the logger to the text format
+ * read by the matlab scripts, one frame per line:
+ *
+ *     ID, time in ms, data bytes 0-7
+ *
+ * Usage: canlog2csv LOG0001.BIN > log.txt
+ *
+ * Decoding stops at the end sector. A summary of the log, including lost and
+ * rejected blocks, is printed to stderr.
+ *
+ * \see \ref canlog_decode
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "canlog_decode.h"
+
+//! Prints a frame.
+static void print_frame(const canlog_frame_t * f, void * ctx) {
+	FILE * out = ctx;
+	fprintf(out, "%08" PRIX32 ", %" PRIu64 ".%03u", f->id, f->time / 1000, (unsigned) (f->time % 1000));
+	for (uint8_t i = 0; i < 8; i++) {
+		fprintf(out, ",  %02u", f->data[i]);
+	}
+	fputc('\n', out);
+}
+
+int main(int argc, char ** argv) {
+	uint8_t sector[CANLOG_SECTOR_SIZE];
+	canlog_decoder_t dec;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s LOGnnnn.BIN\n", argv[0]);
+		return 2;
+	}
+	FILE * in = fopen(argv[1], "rb");
+	if (!in) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	canlog_decoder_init(&dec);
+	uint32_t unwritten = 0;
+	while (!dec.ended && fread(sector, sizeof(sector), 1, in) == 1) {
+		if (canlog_decode_sector(&dec, sector, print_frame, stdout) == CANLOG_BAD_MAGIC) {
+			unwritten++; // the file is pre-allocated, most of the end is empty
+		}
+	}
+	fclose(in);
+
+	fprintf(stderr, "log id %u, %" PRIu64 " frames in %" PRIu32 " blocks\n", dec.id, dec.frames, dec.blocks);
+	fprintf(stderr, "%" PRIu32 " frames dropped by the logger, %" PRIu32 " blocks missing, %" PRIu32 " damaged\n",
+			dec.ended ? dec.end.drops : dec.header.drops, dec.lost_blocks, dec.bad_blocks - unwritten);
+	if (dec.ended) {
+		fprintf(stderr, "log complete, %s, %" PRIu32 " blocks\n", canlog_end_reason(dec.end.reason), dec.end.blocks);
+	} else {
+		fprintf(stderr, "log has no end sector\n");
+	}
+	return dec.have_session ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/*
+ * matfile.cpp - Writes MATLAB level 5 MAT-files.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file matfile.cpp
+ * \ref matfile writes column vectors to a MAT-file.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref matfile.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup matfile PC - MAT-file Writer
+ * The level 5 format is read by load() in MATLAB and by scipy.io.loadmat in
+ * Python, all vectors of a file in one call. Only uncompressed real column
+ * vectors are written, each vector streamed in parts with begin(), data() and
+ * end(), so that the caller need not collect a column in one buffer. A vector
+ * is limited to 4 GB by the format.
+ *
+ * The file is written in the byte order of the host, marked in the header as
+ * the format requires.
+ *
+ * \see \ref matfile.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "matfile.h"
+
+// data types
+#define MI_INT8		1
+#define MI_UINT16	4
+#define MI_INT32	5
+#define MI_UINT32	6
+#define MI_DOUBLE	9
+#define MI_MATRIX	14
+
+// classes
+#define MX_DOUBLE	6
+#define MX_UINT16	11
+#define MX_UINT32	13
+
+//! Data type, class and size of the \ref mat_type.
+static const struct {
+	uint32_t mi;
+	uint32_t mx;
+	uint32_t size;
+} types[] = {
+	{MI_DOUBLE, MX_DOUBLE, 8},
+	{MI_UINT16, MX_UINT16, 2},
+	{MI_UINT32, MX_UINT32, 4},
+};
+
+//! Rounds up to a multiple of 8 bytes.
+static uint64_t align8(uint64_t bytes) {
+	return (bytes + 7) & ~(uint64_t) 7;
+}
+
+matfile::matfile() : file(NULL), pad(0), failed(false) {}
+
+matfile::~matfile() {
+	if (file) {
+		fclose(file);
+	}
+}
+
+//! Helper function, writes and remembers failure.
+void matfile::write(const void * buf, size_t bytes) {
+	if (fwrite(buf, 1, bytes, file) != bytes) {
+		failed = true;
+	}
+}
+
+//! Creates the file and writes the header.
+/*!
+ * \param path name of the file.
+ * \return true on success.
+ */
+bool matfile::open(const char * path) {
+	file = fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+	char header[128];
+	memset(header, ' ', 116);
+	memcpy(header, "MATLAB 5.0 MAT-file, written by lur7decode", 42);
+	memset(header + 116, 0, 8);
+	uint16_t version = 0x0100;
+	uint16_t endian = ('M' << 8) | 'I';
+	memcpy(header + 124, &version, 2);
+	memcpy(header + 126, &endian, 2);
+	write(header, sizeof(header));
+	return !failed;
+}
+
+//! Closes the file.
+/*!
+ * \return true if everything was written.
+ */
+bool matfile::close() {
+	if (file && fclose(file)) {
+		failed = true;
+	}
+	file = NULL;
+	return !failed;
+}
+
+//! Starts a column vector.
+/*!
+ * Exactly \p count values must follow, in calls to data().
+ *
+ * \param name name of the variable, a valid MATLAB identifier.
+ * \param type class of the values.
+ * \param count number of values.
+ * \return false if the vector is too large for the format.
+ */
+bool matfile::begin(const char * name, mat_type type, uint64_t count) {
+	uint32_t name_len = strlen(name);
+	uint64_t bytes = count * types[type].size;
+	if (16 + 16 + 8 + align8(name_len) + 8 + align8(bytes) > UINT32_MAX) {
+		return false;
+	}
+	pad = align8(bytes) - bytes;
+	uint32_t tags[] = {
+		MI_MATRIX, (uint32_t) (16 + 16 + 8 + align8(name_len) + 8 + align8(bytes)),
+		MI_UINT32, 8, types[type].mx, 0,	// array flags
+		MI_INT32, 8, (uint32_t) count, 1,	// dimensions
+		MI_INT8, name_len
+	};
+	write(tags, sizeof(tags));
+	uint8_t zero[8] = {0};
+	write(name, name_len);
+	write(zero, align8(name_len) - name_len);
+	uint32_t data_tag[] = {types[type].mi, (uint32_t) bytes};
+	write(data_tag, sizeof(data_tag));
+	return true;
+}
+
+//! Writes values of the vector started by begin().
+void matfile::data(const void * values, size_t bytes) {
+	write(values, bytes);
+}
+
+//! Ends the vector started by begin().
+void matfile::end() {
+	uint8_t zero[8] = {0};
+	write(zero, pad);
+	pad = 0;
+}
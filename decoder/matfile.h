@@ -0,0 +1,61 @@
+/*
+ * matfile.h - Writes MATLAB level 5 MAT-files.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file matfile.h
+ * \ref matfile writes column vectors to a MAT-file.
+ *
+ * \see \ref matfile.cpp
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup matfile
+ */
+
+#ifndef _MATFILE_H_
+#define _MATFILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+//! Types of vectors, MATLAB class and MAT-file data type.
+enum mat_type {
+	MAT_DOUBLE,
+	MAT_UINT16,
+	MAT_UINT32
+};
+
+//! A MAT-file being written.
+class matfile {
+public:
+	matfile();
+	~matfile();
+	bool open(const char * path);
+	bool close();
+	bool begin(const char * name, mat_type type, uint64_t count);
+	void data(const void * values, size_t bytes);
+	void end();
+
+private:
+	FILE * file;		//!< The open file.
+	uint32_t pad;		//!< Bytes of padding after the vector being written.
+	bool failed;		//!< Whether a write has failed.
+	void write(const void * buf, size_t bytes);
+};
+
+#endif // _MATFILE_H_
@@ -0,0 +1,81 @@
+/*
+ * signals.h - The signals on the CAN bus of the LUR7, for the log decoder.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file signals.h
+ * Table of the messages decoded by lur7decode, with the position and type of
+ * every value. Byte orders follow the senders: the DTA sends big endian, the
+ * LUR7 MCUs send their native little endian, see the can_setup_tx calls in
+ * the main.c of each MCU.
+ *
+ * \see \ref lur7decode.cpp
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#ifndef _SIGNALS_H_
+#define _SIGNALS_H_
+
+#include <stdint.h>
+
+//! Most values in a message.
+#define SIGNAL_FIELDS	2
+
+//! Type and byte order of a value.
+enum field_type {
+	FIELD_NONE = 0,
+	FIELD_U16_BE,	//!< uint16, big endian, DTA.
+	FIELD_U16_LE,	//!< uint16, little endian, LUR7 MCUs.
+	FIELD_U32_LE	//!< uint32, little endian, LUR7 MCUs.
+};
+
+//! A value in a message.
+struct field {
+	const char * name;	//!< Name of the column.
+	enum field_type type;
+	uint8_t offset;		//!< First byte in the payload.
+};
+
+//! A message.
+struct signal {
+	uint32_t id;		//!< CAN ID.
+	const char * time;	//!< Name of the time column.
+	struct field fields[SIGNAL_FIELDS];
+};
+
+//! All decoded messages, column names as in readcvs_main.m where it has them.
+static const struct signal signals[] = {
+	{0x2000, "dta0time",   {{"rpm", FIELD_U16_BE, 6}, {"water_temp", FIELD_U16_BE, 2}}},
+	{0x2001, "dta1time",   {{"kph_x10", FIELD_U16_BE, 2}, {0, FIELD_NONE, 0}}},
+	{0x2002, "dta2time",   {{"oil_temp", FIELD_U16_BE, 5}, {0, FIELD_NONE, 0}}},
+	{0x2003, "dta3time",   {{"gear", FIELD_U16_BE, 0}, {0, FIELD_NONE, 0}}},
+	{0x1501, "mid1time",   {{"clutch_right", FIELD_U16_LE, 0}, {"clutch_left", FIELD_U16_LE, 2}}},
+	{0x4000, "front0time", {{"wheel_front_left", FIELD_U32_LE, 0}, {"wheel_front_right", FIELD_U32_LE, 4}}},
+	{0x4001, "front1time", {{"susp_front_left", FIELD_U16_LE, 0}, {"susp_front_right", FIELD_U16_LE, 2}}},
+	{0x4002, "front2time", {{"brake_pressure", FIELD_U16_LE, 0}, {"steering", FIELD_U16_LE, 2}}},
+	{0x4500, "rear0time",  {{"wheel_rear_right", FIELD_U32_LE, 0}, {"wheel_rear_left", FIELD_U32_LE, 4}}},
+	{0x4501, "rear1time",  {{"susp_rear_right", FIELD_U16_LE, 0}, {"susp_rear_left", FIELD_U16_LE, 2}}},
+	{0x4502, "rear2time",  {{"neutral_down_time", FIELD_U16_LE, 0}, {"neutral_up_time", FIELD_U16_LE, 2}}},
+	{0x4503, "rear3time",  {{"clutch_left_filtered", FIELD_U16_LE, 0}, {"clutch_right_filtered", FIELD_U16_LE, 2}}},
+	{0x4504, "rear4time",  {{"servo_left_dutycycle", FIELD_U16_LE, 0}, {"servo_right_dutycycle", FIELD_U16_LE, 2}}},
+};
+
+//! Number of entries in \ref signals.
+#define SIGNAL_COUNT	(sizeof(signals) / sizeof(signals[0]))
+
+#endif // _SIGNALS_H_
@@ -49,6 +49,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/cpufunc.h> //included for _NOP()
+#include <avr/pgmspace.h>
 #include <util/atomic.h>
 #include <stdint.h>
 
@@ -161,5 +162,6 @@
 #include "LUR7_power.h"
 #include "LUR7_timer0.h"
 #include "LUR7_timer1.h"
+#include "LUR7_wheel.h"
 
 #endif  // _LUR7_H_
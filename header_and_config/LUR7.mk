@@ -0,0 +1,166 @@
+# Build of the firmware of an ATmega32M1 of the LUR7, included by the makefile of each target.
+#
+# make         build $(TARGET).hex and .eep and print the flash and RAM used
+# make size    print the flash and RAM used
+# make lss     disassembly with the source, make sym the symbols
+# make program write $(TARGET).hex to the MCU with avrdude
+# make stack   worst case stack from the call graphs of GCC 10 or later, fails when it
+#              leaves less than STACK_MARGIN bytes of RAM beside .data and .bss, see
+#              stackcheck/main.c
+# make bench   run $(TARGET).elf on the AVR core of simavr for BENCH_MS and print the
+#              cycles of each interrupt and of the passes of the main loop, fails when
+#              an interrupt takes longer than the tick of 100 us, see avrbench/main.c
+# make clean   remove the build output
+#
+# The makefile of a target sets, before including this file:
+#
+# TARGET       name of the output, default main
+# SRC          its own sources, main.c included
+# LUR7_MODULES modules of header_and_config it uses, io adc ancomp can interrupt power
+#              timer0 timer1 wheel, default all but wheel
+# SPEED_SRC    sources built with -O$(SPEED_OPT) instead of -O$(OPT), the modules in
+#              LUR7_SPEED are added, by default those with the interrupts taken most often
+# CDEFS        -D options
+# VARIANTS     other builds of the same sources, for each v $(TARGET)_v.hex is built with
+#              CDEFS_v added to CDEFS
+# STACK_MARGIN RAM make stack leaves free, default 128 bytes
+# STACK_CALLS  the functions called through pointers, default stack.txt if there is one
+# STACK_NESTED interrupts run with interrupts enabled, ISR_NOBLOCK
+# STACK_USED   .data and .bss for make stack, taken from $(TARGET).elf when not given
+# BENCH_SCRIPT the CAN frames and inputs of make bench, default bench.txt if there is one
+# BENCH_MS     time run by make bench, default 2000 ms
+# BASELINE     directory of the .bench of an earlier make bench, it fails when a worst
+#              case has grown by more than a tenth
+#
+# Everything is built with -ffunction-sections -fdata-sections and linked with
+# --gc-sections, and with link time optimisation unless LTO is set empty, so
+# functions not called are left out. GCC keeps the -O of each source through
+# LTO as options of its functions. The objects are built in obj/ of the
+# target, in a directory for each variant, not next to the sources shared
+# with other targets. make stack builds them again without LTO in stack/ for
+# the call graphs, as LTO moves the code of a function after the stack of
+# each is known.
+
+TARGET ?= main
+MCU = atmega32m1
+FLASH_SIZE = 32768
+RAM_SIZE = 2048
+FORMAT = ihex
+LUR7_DIR = ../header_and_config
+LUR7_MODULES ?= io adc ancomp can interrupt power timer0 timer1
+LUR7_SPEED ?= can interrupt timer0 timer1
+OPT ?= s
+SPEED_OPT ?= 2
+LTO ?= -flto
+OBJDIR = obj/$(TARGET)
+STACK_MARGIN ?= 128
+STACK_CALLS ?= $(wildcard stack.txt)
+STACK_DIR = $(OBJDIR)/stack
+STACKCHECK = ../stackcheck/stackcheck
+BENCH_MCU ?= atmega64m1
+BENCH_HZ = 16000000
+BENCH_MS ?= 2000
+BENCH_SCRIPT ?= $(wildcard bench.txt)
+AVRBENCH = ../avrbench/avrbench
+
+SRC += $(patsubst %,$(LUR7_DIR)/LUR7_%.c,$(LUR7_MODULES))
+SPEED_SRC += $(patsubst %,$(LUR7_DIR)/LUR7_%.c,$(filter $(LUR7_SPEED),$(LUR7_MODULES)))
+
+CC = avr-gcc
+OBJCOPY = avr-objcopy
+OBJDUMP = avr-objdump
+SIZE = avr-size
+NM = avr-nm
+AVRDUDE = avrdude
+
+MCU_FLAGS = -mmcu=$(MCU) -mrelax
+CFLAGS = $(MCU_FLAGS) -I. -gdwarf-2 -std=gnu99 -Wall -Wstrict-prototypes $(CDEFS) $(LTO) \
+	-ffunction-sections -fdata-sections
+LDFLAGS = $(MCU_FLAGS) -O$(OPT) $(LTO) -Wl,--gc-sections -Wl,-Map=$(TARGET).map -lm
+
+AVRDUDE_FLAGS = -p m32m1 -P usb -c avrisp2
+
+OBJ = $(addprefix $(OBJDIR)/,$(notdir $(SRC:.c=.o)))
+SPEED_OBJ = $(addprefix $(OBJDIR)/,$(notdir $(SPEED_SRC:.c=.o)))
+STACK_CI = $(addprefix $(STACK_DIR)/,$(notdir $(SRC:.c=.ci)))
+STACK_SPEED_CI = $(addprefix $(STACK_DIR)/,$(notdir $(SPEED_SRC:.c=.ci)))
+
+vpath %.c $(sort $(dir $(SRC)))
+
+all: $(TARGET).hex $(TARGET).eep size
+
+# each variant is built by a make of its own
+ifndef VARIANT
+all size stack bench clean: $(addprefix variant-,$(VARIANTS))
+variant-%:
+	$(MAKE) VARIANT=$* TARGET=$(TARGET)_$* CDEFS="$(CDEFS) $(CDEFS_$*)" $(or $(filter all size stack bench clean,$(MAKECMDGOALS)),all)
+endif
+
+$(SPEED_OBJ) $(STACK_SPEED_CI): OPT = $(SPEED_OPT)
+
+$(OBJDIR)/%.o: %.c
+	@mkdir -p $(OBJDIR)
+	$(CC) -c $(CFLAGS) -O$(OPT) -MMD -MP $< -o $@
+
+$(STACK_DIR)/%.ci: %.c
+	@mkdir -p $(STACK_DIR)
+	$(CC) -c $(CFLAGS) -fno-lto -O$(OPT) -fcallgraph-info=su -MMD -MP -MT $@ $< -o $(@:.ci=.o)
+
+$(TARGET).elf: $(OBJ)
+	$(CC) $(OBJ) -o $@ $(LDFLAGS)
+
+$(TARGET).hex: $(TARGET).elf
+	$(OBJCOPY) -O $(FORMAT) -R .eeprom $< $@
+
+$(TARGET).eep: $(TARGET).elf
+	-$(OBJCOPY) -j .eeprom --set-section-flags=.eeprom="alloc,load" \
+	--change-section-lma .eeprom=0 -O $(FORMAT) $< $@
+
+$(TARGET).lss: $(TARGET).elf
+	$(OBJDUMP) -h -S $< > $@
+
+$(TARGET).sym: $(TARGET).elf
+	$(NM) -n $< > $@
+
+lss: $(TARGET).lss
+sym: $(TARGET).sym
+
+# flash holds .text and the initial values of .data, RAM .data, .bss and .noinit
+size: $(TARGET).elf
+	@$(SIZE) -A $< | awk -v t="$(notdir $(CURDIR))/$(TARGET)" -v flash=$(FLASH_SIZE) -v ram=$(RAM_SIZE) \
+		'$$1 == ".text" || $$1 == ".data" { f += $$2 } \
+		$$1 == ".data" || $$1 == ".bss" || $$1 == ".noinit" { r += $$2 } \
+		END { printf "%s: flash %d of %d bytes, %.1f%%, RAM %d of %d bytes, %.1f%%\n", \
+			t, f, flash, 100 * f / flash, r, ram, 100 * r / ram }'
+
+stack: $(STACK_CI) $(STACKCHECK) $(if $(STACK_USED),,$(TARGET).elf)
+	@$(STACKCHECK) -t $(notdir $(CURDIR))/$(TARGET) -r $(RAM_SIZE) -m $(STACK_MARGIN) \
+		-u $(or $(STACK_USED),$$($(SIZE) -A $(TARGET).elf | \
+			awk '$$1 == ".data" || $$1 == ".bss" || $$1 == ".noinit" { r += $$2 } END { print r + 0 }')) \
+		$(addprefix -c ,$(STACK_CALLS)) $(addprefix -i ,$(STACK_NESTED)) $(STACK_CI)
+
+$(STACKCHECK): ../stackcheck/main.c
+	$(MAKE) -C ../stackcheck stackcheck
+
+# simavr has no ATmega32M1, the ATmega64M1 differs only in flash and RAM, BENCH_HZ is
+# F_CPU of LUR7.h
+bench: $(TARGET).elf $(AVRBENCH)
+	@$(AVRBENCH) -t $(notdir $(CURDIR))/$(TARGET) -m $(BENCH_MCU) -f $(BENCH_HZ) -d $(BENCH_MS) -n $(NM) \
+		$(addprefix -s ,$(BENCH_SCRIPT)) $(addprefix -B $(BASELINE)/,$(if $(BASELINE),$(TARGET).bench)) \
+		-o $(TARGET).bench $<
+
+$(AVRBENCH): ../avrbench/main.c
+	$(MAKE) -C ../avrbench avrbench
+
+program: $(TARGET).hex $(TARGET).eep
+	$(AVRDUDE) $(AVRDUDE_FLAGS) -U flash:w:$(TARGET).hex
+
+clean:
+	rm -f $(TARGET).hex $(TARGET).eep $(TARGET).elf $(TARGET).map $(TARGET).lss $(TARGET).sym \
+		$(TARGET).bench
+	rm -rf $(OBJDIR)
+	-rmdir obj 2>/dev/null
+
+-include $(OBJ:.o=.d) $(STACK_CI:.ci=.d)
+
+.PHONY: all size lss sym stack bench program clean
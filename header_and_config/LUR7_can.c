@@ -77,6 +77,7 @@ const uint32_t CAN_FRONT_LOG_SUSPENSION_ID = 0x00004001; //!< Message ID for fro
 const uint32_t CAN_FRONT_LOG_STEER_BRAKE_ID = 0x00004002; //!< Message ID for steering and braking
 const uint32_t CAN_FRONT_LOG_STEER_BRAKE_MASK = 0xFFFFFFFF; //!< Mask for steering and braking
 const uint8_t  CAN_FRONT_LOG_DLC = 4; //!< DLC of messages from front logging node
+const uint8_t  CAN_FRONT_LOG_SPEED_DLC = 8; //!< DLC of front wheel speed messages
 
 // +  Mid-MCU
 // +  +  Gear and Clutch
@@ -89,7 +90,7 @@ const uint8_t  CAN_GEAR_CLUTCH_LAUNCH_DLC = 4; //!< DLC of Gear Change and Clutc
 // +  +  Logging
 const uint32_t CAN_LOG_ID = 0x00003000; //!< The ID of CAN messages for starting/stoping logging
 const uint32_t CAN_LOG_MASK = 0xFFFFFFFF; //!< Mask for the LOG instruction
-const uint8_t  CAN_LOG_DLC = 1; //!< DLC of DTA messages
+const uint8_t  CAN_LOG_DLC = 4; //!< DLC of logging start/stop messages
 
 // +  Rear MCU
 // +  +  Logging
@@ -99,6 +100,11 @@ const uint32_t CAN_REAR_LOG_NEUTRAL_ID = 0x4502; //!< Message ID for logging of
 const uint32_t CAN_REAR_LOG_FILTER_ID = 0x4503; //!< Messsage ID for filtered clutch paddle positions
 const uint32_t CAN_REAR_LOG_DUTYCYCLE_ID = 0x4504; //!< Message for servo dutycycle
 const uint8_t  CAN_REAR_LOG_DLC = 4; //!< DLC of messages from rear logging node
+const uint8_t  CAN_REAR_LOG_SPEED_DLC = 8; //!< DLC of rear wheel speed messages
+// +  +  Gear
+const uint32_t CAN_REAR_GEAR_ID = 0x9876; //!< Message ID for the current gear, see MCU-rear
+const uint32_t CAN_REAR_GEAR_MASK = 0xFFFFFFFF; //!< Mask for the current gear
+const uint8_t  CAN_REAR_GEAR_DLC = 1; //!< DLC of the current gear
 
 // messages are backwards so they can be easily read with CANview.
 // Pre-defined messages
@@ -358,8 +364,9 @@ ISR (CAN_INT_vect) {
 	
 	// check for valid MOb!!!
 	uint8_t mob = (CANHPMOB & 0xF0) >> 4; // select MOb with highest priority interrupt
+	uint8_t sit = mob < 8 ? CANSIT2 & (1 << mob) : CANSIT1 & (1 << (mob - 8)); // MOb 8 and up in CANSIT1, 15 if none
 	
-	if (CANSIT2 && (1 << mob)) {
+	if (sit) {
 		CANPAGE = mob << 4;
 		if (CANSTMOB & (1 << RXOK)) { //test for RXOK
 			CANSTMOB &= ~(1 << RXOK); // clear interrupt flag
@@ -387,7 +394,10 @@ void _can_handle_RXOK() {
 	uint8_t mob = (CANPAGE & 0xF0) >> 4; // get mob number
 	uint32_t id = _can_get_id(); // get id
 	uint8_t dlc = CANCDMOB & 0x0F; // get dlc
-	uint8_t data[dlc]; // create vector for data
+	if (dlc > 8) {
+		dlc = 8; // a DLC above 8 carries 8 bytes
+	}
+	uint8_t data[8]; // fixed size, the stack of the interrupt is known, see make stack
 
 	//read data
 	for (uint8_t i = dlc; i > 0; i--) {
@@ -411,7 +421,10 @@ void _can_handle_TXOK() {
 	uint8_t mob = (CANPAGE & 0xF0) >> 4; // get mob number
 	uint32_t id = _can_get_id(); // get id
 	uint8_t dlc = CANCDMOB & 0x0F; // get dlc
-	uint8_t data[dlc]; // create vector for data
+	if (dlc > 8) {
+		dlc = 8; // a DLC above 8 carries 8 bytes
+	}
+	uint8_t data[8]; // fixed size, the stack of the interrupt is known, see make stack
 
 	//read data
 	for (uint8_t i = dlc; i > 0; i--) {
@@ -126,6 +126,7 @@ extern const uint32_t CAN_FRONT_LOG_SUSPENSION_ID; //!< Message ID for front sus
 extern const uint32_t CAN_FRONT_LOG_STEER_BRAKE_ID; //!< Message ID for steering and braking
 extern const uint32_t CAN_FRONT_LOG_STEER_BRAKE_MASK; //!< Mask for steering and braking
 extern const uint8_t  CAN_FRONT_LOG_DLC; //!< DLC of messages from front logging node
+extern const uint8_t  CAN_FRONT_LOG_SPEED_DLC; //!< DLC of front wheel speed messages
 
 // +  Mid-MCU
 // +  +  Gear and Clutch
@@ -137,7 +138,7 @@ extern const uint8_t  CAN_GEAR_CLUTCH_LAUNCH_DLC; //!< DLC of Gear Change and Cl
 
 // +  +  Logging
 extern const uint32_t CAN_LOG_ID; //!< The ID of CAN messages for starting/stoping logging
-extern const uint8_t  CAN_LOG_DLC; //!< DLC of DTA messages
+extern const uint8_t  CAN_LOG_DLC; //!< DLC of logging start/stop messages
 
 // +  Rear MCU
 // +  +  Logging
@@ -147,6 +148,11 @@ extern const uint32_t CAN_REAR_LOG_NEUTRAL_ID; //!< Message ID for logging of su
 extern const uint32_t CAN_REAR_LOG_FILTER_ID; //!< Messsage ID for filtered clutch paddle positions
 extern const uint32_t CAN_REAR_LOG_DUTYCYCLE_ID; //!< Message for servo dutycycle
 extern const uint8_t  CAN_REAR_LOG_DLC; //!< DLC of messages from rear logging node
+extern const uint8_t  CAN_REAR_LOG_SPEED_DLC; //!< DLC of rear wheel speed messages
+// +  +  Gear
+extern const uint32_t CAN_REAR_GEAR_ID; //!< Message ID for the current gear, see MCU-rear
+extern const uint32_t CAN_REAR_GEAR_MASK; //!< Mask for the current gear
+extern const uint8_t  CAN_REAR_GEAR_DLC; //!< DLC of the current gear
 
 // Pre-defined messages
 extern uint8_t CAN_MSG_NONE[8]; //!< No message
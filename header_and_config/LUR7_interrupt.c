@@ -41,6 +41,10 @@
  * ATmega32M1 datasheet. How too use interrupts with the LUR7 PCB is described
  * more closelly in \ref LUR7_interrupt.c.
  * 
+ * Buttons and paddles connected to Pin Change Interrupts can be debounced
+ * with debounce_on(uint8_t, uint8_t), the time base is provided by calling
+ * debounce_tick(void) from a periodic interrupt.
+ * 
  * \see LUR7_interrupt.c
  * \see LUR7_interrupt.h
  * \see <http://www.atmel.com/devices/ATMEGA32M1.aspx>
@@ -56,6 +60,23 @@
  * static function declarations
  */
 static void _update_pcint_data(void);
+static void _pc_dispatch(uint8_t, uint8_t, const uint8_t *, uint32_t);
+static void _pc_deliver(uint8_t, uint8_t, uint32_t);
+
+//! Weak reference, not all projects link LUR7_timer1.
+/*!
+ * When LUR7_timer1 is not part of the project the pin change handlers are
+ * given a timestamp of 0.
+ */
+extern uint32_t timer1_timestamp(void) __attribute__((weak));
+
+//! Helper function, timestamp of a pin change.
+/*!
+ * \return \ref timer1_timestamp, or 0 if LUR7_timer1 is not linked.
+ */
+static inline uint32_t _pc_timestamp(void) {
+	return timer1_timestamp ? timer1_timestamp() : 0;
+}
 
 
 //EXTERNAL INTERRUPTS
@@ -99,19 +120,26 @@ static uint8_t INTn[9] = {
 };
 
 //PIN CHANGE INTERRUPTS
-//! Pin Change Mask Registers
-static volatile uint8_t * PCMSKn[9] = {
-	&PCMSK2, //PD3 - IN1
-	&PCMSK2, //PD2 - IN2
-	&PCMSK2, //PD1 - IN3
-	&PCMSK0, //PB7 - IN4
-	&PCMSK1, //PC0 - IN5
-	&PCMSK0, //PB6 - IN6
-	&PCMSK2, //PD0 - IN7
-	&PCMSK0, //PB5 - IN8
-	&PCMSK0  //PB2 - IN9
+//! Pin Change Mask Registers, as offsets from PCMSK0.
+/*!
+ * PCMSK0 - PCMSK3 follow each other, offsets keep the table free of register
+ * addresses so that it can be initialised on the host as well, see host/sim.c.
+ */
+static uint8_t PCMSKn[9] = {
+	2, //PD3 - IN1
+	2, //PD2 - IN2
+	2, //PD1 - IN3
+	0, //PB7 - IN4
+	1, //PC0 - IN5
+	0, //PB6 - IN6
+	2, //PD0 - IN7
+	0, //PB5 - IN8
+	0  //PB2 - IN9
 };
 
+//! Pin Change Mask Register of an input, see \ref PCMSKn.
+#define PCMSK_REG(port)	((&PCMSK0)[PCMSKn[port]])
+
 //! Pin Change Enable Mask bit
 static uint8_t PCINTn[9] = {
 	PCINT19, //PD3 - IN1
@@ -138,6 +166,30 @@ static uint8_t PCIEn[9] = {
 	PCIE0  //IN9
 };
 
+//! Inputs connected to PB0 - PB7, 0xFF if not connected to an input.
+static const uint8_t pcint0_inputs[8] PROGMEM = {
+	0xFF, 0xFF, IN9, 0xFF, 0xFF, IN8, IN6, IN4
+};
+
+//! Inputs connected to PD0 - PD7, 0xFF if not connected to an input.
+static const uint8_t pcint2_inputs[8] PROGMEM = {
+	IN7, IN3, IN2, IN1, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+//! Default, empty, table of Pin Change Interrupt handlers.
+/*!
+ * Replaced by the table defined with \ref PC_HANDLERS in the application.
+ */
+__attribute__((weak)) const pc_handler_t pc_handlers[LAST_IN + 1] PROGMEM = {0};
+
+//DEBOUNCE
+//! Lockout time in ticks of \ref debounce_tick for each input, 0 if not debounced.
+static uint8_t debounce_ticks[LAST_IN + 1];
+//! Remaining lockout ticks for each input.
+static volatile uint8_t debounce_lock[LAST_IN + 1];
+//! Last level reported to the handler for each debounced input, one bit per input.
+static volatile uint16_t debounce_level = 0;
+
 //! Copy of the input as it was last time a Pin Change interrupt happened for PCINT0.
 static volatile uint8_t pcint0_data = 0;
 // only one interrupt on pcint1, no help variable needed.
@@ -217,14 +269,17 @@ static void _update_pcint_data() {
 //! Activates Pin Change Interrupt on \p port.
 /*!
  * Turns Pin Change Interrupt on for \p port. When a interrupt is generated
- * the corresponding extern function is executed. These functions need to be
- * defined in the main project as:
+ * the handler registered for \p port in \ref pc_handlers is executed. Only
+ * the inputs that are used need a handler:
  * \code{.c}
- * void pcISR_inX(void) {
+ * static void wheel_r_change(uint8_t level, uint32_t timestamp) {
  *     ; // do stuff
  * }
+ *
+ * PC_HANDLERS = {
+ *     [WHEEL_R] = wheel_r_change,
+ * };
  * \endcode
- * Where inX is replaced with in1-in9 for the respective inputs.
  * 
  * Interrupts are generated on logical value changes to the input. Unlike External Interrupts this behaviour can not be altered.
  * 
@@ -234,7 +289,7 @@ static void _update_pcint_data() {
  */
 uint8_t pc_int_on(uint8_t port) {
 	if (port >= FIRST_IN && port <= LAST_IN) {
-		*PCMSKn[port] |= (1<<PCINTn[port]);
+		PCMSK_REG(port) |= (1<<PCINTn[port]);
 		PCICR |= (1<<PCIEn[port]);
 		_update_pcint_data();
 		return TRUE;
@@ -252,8 +307,8 @@ uint8_t pc_int_on(uint8_t port) {
  */
 uint8_t pc_int_off(uint8_t port) {
 	if (port >= FIRST_IN && port <= LAST_IN) {
-		*PCMSKn[port] &= ~(1<<PCINTn[port]);
-		if(!(*PCMSKn[port])) {
+		PCMSK_REG(port) &= ~(1<<PCINTn[port]);
+		if(!PCMSK_REG(port)) {
 			PCICR &= ~(1<<PCIEn[port]);
 		}
 		_update_pcint_data();
@@ -262,6 +317,78 @@ uint8_t pc_int_off(uint8_t port) {
 	return FALSE;
 }
 
+//DEBOUNCE
+//! Activates debouncing of \p port.
+/*!
+ * Mechanical switches bounce for a few ms when pressed and released. With
+ * debouncing active, the first edge is delivered to the handler in
+ * \ref pc_handlers at once, with its timestamp, after which further edges are
+ * ignored for \p ticks calls to \ref debounce_tick. When the lockout ends the
+ * input is sampled and, should it differ from the last delivered level, a new
+ * edge is delivered and a new lockout started. Debouncing adds no latency to
+ * a press or release, it only limits how often they can be reported.
+ *
+ * Pin Change Interrupt is turned on for \p port, \ref debounce_tick needs to
+ * be called regularly, eg. from \ref timer1_isr_100Hz.
+ *
+ * \param port The input to debounce, \ref IN1 - \ref IN9.
+ * \param ticks lockout time in calls to \ref debounce_tick, at least 1.
+ * \return \ref TRUE if debouncing was successfully activated, \n \ref FALSE otherwise.
+ */
+uint8_t debounce_on(uint8_t port, uint8_t ticks) {
+	if (port >= FIRST_IN && port <= LAST_IN && ticks) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			debounce_ticks[port] = ticks;
+			debounce_lock[port] = 0;
+			if (get_input(port)) {
+				debounce_level |= (1 << port);
+			} else {
+				debounce_level &= ~(1 << port);
+			}
+		}
+		return pc_int_on(port);
+	}
+	return FALSE;
+}
+
+//! De-activates debouncing of \p port.
+/*!
+ * Edges on \p port are delivered directly again. Pin Change Interrupt is left
+ * on, see \ref pc_int_off.
+ *
+ * \param port The input to stop debouncing.
+ * \return \ref TRUE if debouncing was successfully de-activated, \n \ref FALSE otherwise.
+ */
+uint8_t debounce_off(uint8_t port) {
+	if (port >= FIRST_IN && port <= LAST_IN) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			debounce_ticks[port] = 0;
+			debounce_lock[port] = 0;
+		}
+		return TRUE;
+	}
+	return FALSE;
+}
+
+//! Time base of the debouncing.
+/*!
+ * Counts down the lockout of all debounced inputs. When a lockout ends the
+ * input is sampled, if it changed during the lockout the new level is
+ * delivered to the handler.
+ *
+ * Call from a periodic interrupt, eg. \ref timer1_isr_100Hz, the lockout
+ * times given to \ref debounce_on are counted in calls to this function.
+ */
+void debounce_tick(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (uint8_t i = FIRST_IN; i <= LAST_IN; i++) {
+			if (debounce_lock[i] && !--debounce_lock[i]) {
+				_pc_deliver(i, get_input(i), _pc_timestamp());
+			}
+		}
+	}
+}
+
 //General
 //! Activate interrupts globaly
 /*!
@@ -282,68 +409,101 @@ void interrupts_off(void) {
 }
 
 //INTERRUPT HANDLERS
-//! Interrupt Service Routine, Pin Change Interrupt 0
+//! Helper function, calls the handler of an input.
 /*!
- * Upon a Pin Change Interrupt the ISR checks which input changed and executes
- * the correct function.
- * 
- * \see pcISR_in4
- * \see pcISR_in6
- * \see pcISR_in8
- * \see pcISR_in9
+ * Edges on debounced inputs are dropped during the lockout or if the level
+ * equals the last delivered level, otherwise a lockout is started.
+ *
+ * \param input the input that changed.
+ * \param level the new level of the input.
+ * \param timestamp time of the change.
  */
-ISR(PCINT0_vect) {
-	uint8_t change_finder = (PINB & PCMSK0) ^ pcint0_data;
-	_update_pcint_data();
+static void _pc_deliver(uint8_t input, uint8_t level, uint32_t timestamp) {
+	if (debounce_ticks[input]) {
+		if (debounce_lock[input] || level == ((debounce_level >> input) & 1)) {
+			return; // bouncing, or no change since last delivered edge
+		}
+		debounce_level ^= (1 << input);
+		debounce_lock[input] = debounce_ticks[input];
+	}
+	pc_handler_t handler = (pc_handler_t) pgm_read_ptr(&pc_handlers[input]);
+	if (handler) {
+		handler(level, timestamp);
+	}
+}
 
-	if(change_finder & (1<<PCINTn[IN4])) {
-		pcISR_in4();
+//! Helper function, index of the lowest set bit.
+/*!
+ * Binary search, three steps independent of the value of \p x.
+ *
+ * \param x a non zero value.
+ * \return the index of the lowest set bit in \p x.
+ */
+static inline uint8_t _lowest_bit(uint8_t x) {
+	uint8_t n = 0;
+	if (!(x & 0x0F)) {
+		n += 4;
+		x >>= 4;
 	}
-	if(change_finder & (1<<PCINTn[IN6])) {
-		pcISR_in6();
+	if (!(x & 0x03)) {
+		n += 2;
+		x >>= 2;
 	}
-	if(change_finder & (1<<PCINTn[IN8])) {
-		pcISR_in8();
+	if (!(x & 0x01)) {
+		n += 1;
 	}
-	if(change_finder & (1<<PCINTn[IN9])) {
-		pcISR_in9();
+	return n;
+}
+
+//! Helper function, calls the handlers of all changed inputs on a port.
+/*!
+ * Only the bits that changed are visited, the cost scales with the number of
+ * simultaneous changes rather than the number of inputs on the port.
+ *
+ * \param change the pins that changed.
+ * \param level the current value of the pins.
+ * \param inputs table translating pin number to input, in flash.
+ * \param timestamp time of the interrupt.
+ */
+static void _pc_dispatch(uint8_t change, uint8_t level, const uint8_t * inputs, uint32_t timestamp) {
+	while (change) {
+		uint8_t bit = _lowest_bit(change);
+		_pc_deliver(pgm_read_byte(&inputs[bit]), (level >> bit) & 1, timestamp);
+		change &= change - 1; // clear lowest set bit
 	}
 }
 
+//! Interrupt Service Routine, Pin Change Interrupt 0
+/*!
+ * Upon a Pin Change Interrupt the ISR checks which inputs changed and executes
+ * the registered handlers, see \ref pc_handlers.
+ */
+ISR(PCINT0_vect) {
+	uint32_t timestamp = _pc_timestamp();
+	uint8_t level = PINB & PCMSK0;
+	uint8_t change_finder = level ^ pcint0_data;
+	pcint0_data = level;
+	_pc_dispatch(change_finder, level, pcint0_inputs, timestamp);
+}
+
 //! Interrupt Service Routine, Pin Change Interrupt 1
 /*!
  * There is only one input connected to this flag so it is assumed that IN5 
  * changed should the flag be set.
- * 
- * \see pcISR_in5
  */
 ISR(PCINT1_vect) {
-	pcISR_in5();
+	_pc_deliver(IN5, PINC & (1 << PINC0) ? PC_RISING : PC_FALLING, _pc_timestamp());
 }
 
 //! Interrupt Service Routine, Pin Change Interrupt 2
 /*!
- * Upon a Pin Change Interrupt the ISR checks which input changed and executes
- * the correct function.
- * 
- * \see pcISR_in1
- * \see pcISR_in2
- * \see pcISR_in3
- * \see pcISR_in7
+ * Upon a Pin Change Interrupt the ISR checks which inputs changed and executes
+ * the registered handlers, see \ref pc_handlers.
  */
 ISR(PCINT2_vect) {
-	uint8_t change_finder = (PIND & PCMSK2) ^ pcint2_data;
-	_update_pcint_data();
-	if(change_finder & (1<<PCINTn[IN1])) {
-		pcISR_in1();
-	}
-	if(change_finder & (1<<PCINTn[IN2])) {
-		pcISR_in2();
-	}
-	if(change_finder & (1<<PCINTn[IN3])) {
-		pcISR_in3();
-	}
-	if(change_finder & (1<<PCINTn[IN7])) {
-		pcISR_in7();
-	}
+	uint32_t timestamp = _pc_timestamp();
+	uint8_t level = PIND & PCMSK2;
+	uint8_t change_finder = level ^ pcint2_data;
+	pcint2_data = level;
+	_pc_dispatch(change_finder, level, pcint2_inputs, timestamp);
 }
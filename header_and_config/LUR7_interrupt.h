@@ -48,62 +48,40 @@
 //! H
 #define INT_IN9_vect INT1_vect //PB2 - IN9
 
-//interrupt functions
 //   pin change interrupts
-//! Pin Change Interrupt handler for IN1.
-/*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN1.
- */
-extern void pcISR_in1(void);
-//! Pin Change Interrupt handler for IN2.
-/*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN2.
- */
-extern void pcISR_in2(void);
-//! Pin Change Interrupt handler for IN3.
-/*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN3.
- */
-extern void pcISR_in3(void);
-//! Pin Change Interrupt handler for IN4.
-/*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN4.
- */
-extern void pcISR_in4(void);
-//! Pin Change Interrupt handler for IN5.
-/*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN5.
- */
-extern void pcISR_in5(void);
-//! Pin Change Interrupt handler for IN6.
-/*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN6.
- */
-extern void pcISR_in6(void);
-//! Pin Change Interrupt handler for IN7.
+//! Level passed to a \ref pc_handler_t after a falling edge.
+#define PC_FALLING	0
+//! Level passed to a \ref pc_handler_t after a rising edge.
+#define PC_RISING	1
+
+//! Pin Change Interrupt handler.
 /*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN7.
+ * Called from the Pin Change Interrupt when the input it is registered for in
+ * \ref pc_handlers changes.
+ *
+ * \param level the new level of the input, \ref PC_RISING or \ref PC_FALLING.
+ * \param timestamp \ref timer1_timestamp taken on entry to the interrupt.
  */
-extern void pcISR_in7(void);
-//! Pin Change Interrupt handler for IN8.
+typedef void (*pc_handler_t)(uint8_t level, uint32_t timestamp);
+
+//! Table of Pin Change Interrupt handlers, indexed by input.
 /*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN8.
+ * Applications using Pin Change Interrupts define the table in flash with
+ * \ref PC_HANDLERS, listing only the inputs that are used. When no table is
+ * defined an empty default is used.
  */
-extern void pcISR_in8(void);
-//! Pin Change Interrupt handler for IN9.
+extern const pc_handler_t pc_handlers[LAST_IN + 1] PROGMEM;
+
+//! Defines the \ref pc_handlers table.
 /*!
- * If including this through \ref LUR7.h this function will need to be defined
- * in the code. It will be executed when a Pin Change Interrupt occures on IN9.
+ * \code{.c}
+ * PC_HANDLERS = {
+ *     [WHEEL_R] = wheel_r_change,
+ *     [WHEEL_L] = wheel_l_change,
+ * };
+ * \endcode
  */
-extern void pcISR_in9(void);
+#define PC_HANDLERS	const pc_handler_t pc_handlers[LAST_IN + 1] PROGMEM
 
 //EXTERNAL INTERRUPTS
 uint8_t ext_int_on(uint8_t, uint8_t, uint8_t);
@@ -113,6 +91,11 @@ uint8_t ext_int_off(uint8_t);
 uint8_t pc_int_on(uint8_t);
 uint8_t pc_int_off(uint8_t);
 
+//DEBOUNCE
+uint8_t debounce_on(uint8_t, uint8_t);
+uint8_t debounce_off(uint8_t);
+void debounce_tick(void);
+
 //GENERAL
 void interrupts_on(void);
 void interrupts_off(void);
@@ -43,6 +43,13 @@
  * The remaining functions are straight forward in their use. The arguments to
  * the functions are defined in \ref LUR7.h as \ref IN1 - \ref IN9 and \ref OUT1 - \ref OUT8.
  * 
+ * set_output(uint8_t, uint8_t), get_output(uint8_t), toggle_output(uint8_t) and
+ * get_input(uint8_t) are inline functions defined in LUR7_io.h. When the port
+ * is a constant, as it almost always is, the pin is resolved at compile time
+ * through \ref IO_PIN_CODE and the call becomes a single sbi/cbi/sbis/sbic
+ * instruction. For variable ports the io_ prefixed functions in this file are
+ * called, these look the pin up in a table stored in flash.
+ * 
  * \see LUR7_io.c
  * \see LUR7_io.h
  * \see <http://www.gnu.org/copyleft/gpl.html>
@@ -55,143 +62,30 @@
 #include "LUR7.h"
 #include "LUR7_io.h"
 
-// vectors of ports as used on PCB, used localy only!
-//! Data Direction Register for the respective in- and outputs
-static volatile uint8_t * DDX[NBR_OF_IO+1] = {
-	&DDRD, //IN1
-	&DDRD, //IN2
-	&DDRD, //IN3
-	&DDRB, //IN4
-	&DDRC, //IN5
-	&DDRB, //IN6
-	&DDRD, //IN7
-	&DDRB, //IN8
-	&DDRB, //IN9
-	&DDRC, //OUT1 MCU v1.1
-//	&DDRB, //OUT1 MCU v1.0
-	&DDRB, //OUT2
-	&DDRD, //OUT3
-	&DDRC, //OUT4
-	&DDRC, //OUT5
-	&DDRC, //OUT6
-	&DDRB, //OUT7
-	&DDRB, //OUT8
-	&DDRB  //LED0 MCU v1.1
-};
-
-//! Data Direction Register bits for the respective in- and outputs
-static uint8_t DDXn[NBR_OF_IO+1] = {
-	DDD3, //IN1
-	DDD2, //IN2
-	DDD1, //IN3
-	DDB7, //IN4
-	DDC0, //IN5
-	DDB6, //IN6
-	DDD0, //IN7
-	DDB5, //IN8
-	DDB2, //IN9
-	DDC1, //OUT1 MCU v1.1
-//	DDB0, //OUT1 MCU v1.0
-	DDB1, //OUT2
-	DDD7, //OUT3
-	DDC4, //OUT4
-	DDC5, //OUT5
-	DDC6, //OUT6
-	DDB3, //OUT7
-	DDB4, //OUT8
-	DDB0  //LED0 MCU v1.1
-};
-
-//! Port Data register for the respective in- and outputs
-static volatile uint8_t * PORTX[NBR_OF_IO+1] = {
-	&PORTD, //IN1
-	&PORTD, //IN2
-	&PORTD, //IN3
-	&PORTB, //IN4
-	&PORTC, //IN5
-	&PORTB, //IN6
-	&PORTD, //IN7
-	&PORTB, //IN8
-	&PORTB, //IN9
-	&PORTC, //OUT1 MCU v1.1
-//	&PORTB, //OUT1 MCU v1.0
-	&PORTB, //OUT2
-	&PORTD, //OUT3
-	&PORTC, //OUT4
-	&PORTC, //OUT5
-	&PORTC, //OUT6
-	&PORTB, //OUT7
-	&PORTB, //OUT8
-	&PORTB  //LED0 MCU v1.1
-};
-
-//! Port Data register bits for the respective in- and outputs
-static uint8_t PORTXn[NBR_OF_IO+1] = {
-	PORTD3, //IN1
-	PORTD2, //IN2
-	PORTD1, //IN3
-	PORTB7, //IN4
-	PORTC0, //IN5
-	PORTB6, //IN6
-	PORTD0, //IN7
-	PORTB5, //IN8
-	PORTB2, //IN9
-	PORTC1, //OUT1 MCU v1.1
-//	PORTB0, //OUT1 MCU v1.0
-	PORTB1, //OUT2
-	PORTD7, //OUT3
-	PORTC4, //OUT4
-	PORTC5, //OUT5
-	PORTC6, //OUT6
-	PORTB3, //OUT7
-	PORTB4, //OUT8
-	PORTB0  //LED0 MCU v1.1
-};
-
-//! Port Input Pins register for the respective in- and outputs
-static volatile uint8_t * PINX[NBR_OF_IO+1] = {
-	&PIND, //IN1
-	&PIND, //IN2
-	&PIND, //IN3
-	&PINB, //IN4
-	&PINC, //IN5
-	&PINB, //IN6
-	&PIND, //IN7
-	&PINB, //IN8
-	&PINB, //IN9
-	&PINC, //OUT1 MCU v1.1
-//	&PINB, //OUT1 MCU v1.0
-	&PINB, //OUT2
-	&PIND, //OUT3
-	&PINC, //OUT4
-	&PINC, //OUT5
-	&PINC, //OUT6
-	&PINB, //OUT7
-	&PINB, //OUT8
-	&PINB  //LED0 MCU v1.1
-};
-
-//! Port Input Pins register bits for the respective in- and outputs
-static uint8_t PINXn[NBR_OF_IO+1] = {
-	PIND3, //IN1
-	PIND2, //IN2
-	PIND1, //IN3
-	PINB7, //IN4
-	PINC0, //IN5
-	PINB6, //IN6
-	PIND0, //IN7
-	PINB5, //IN8
-	PINB2, //IN9
-	PINC1, //OUT1 MCU v1.1
-//	PINB0, //OUT1 MCU v1.0
-	PINB1, //OUT2
-	PIND7, //OUT3
-	PINC4, //OUT4
-	PINC5, //OUT5
-	PINC6, //OUT6
-	PINB3, //OUT7
-	PINB4, //OUT8
-	PINB0  //LED0 MCU v1.1
+//! Pin codes of the in- and outputs, stored in flash. Used localy only!
+/*!
+ * Generated from \ref IO_PIN_CODE, used when the pin is not known at compile
+ * time.
+ */
+static const uint8_t io_pins[NBR_OF_IO] PROGMEM = {
+	IO_PIN_CODE(IN1),
+	IO_PIN_CODE(IN2),
+	IO_PIN_CODE(IN3),
+	IO_PIN_CODE(IN4),
+	IO_PIN_CODE(IN5),
+	IO_PIN_CODE(IN6),
+	IO_PIN_CODE(IN7),
+	IO_PIN_CODE(IN8),
+	IO_PIN_CODE(IN9),
+	IO_PIN_CODE(OUT1),
+	IO_PIN_CODE(OUT2),
+	IO_PIN_CODE(OUT3),
+	IO_PIN_CODE(OUT4),
+	IO_PIN_CODE(OUT5),
+	IO_PIN_CODE(OUT6),
+	IO_PIN_CODE(OUT7),
+	IO_PIN_CODE(OUT8),
+	IO_PIN_CODE(LED0)
 };
 
 //! Hardware initialisation function.
@@ -201,7 +95,8 @@ static uint8_t PINXn[NBR_OF_IO+1] = {
  */
 void io_init(void) {
 	for (uint8_t i = FIRST_OUT; i <= LAST_OUT; i++) { // for each output
-		*DDX[i] |= (1<<DDXn[i]); // set DDXn=1 for all outputs
+		uint8_t code = pgm_read_byte(&io_pins[i]);
+		*IO_DDR_REG(code) |= IO_MASK(code); // set DDXn=1 for all outputs
 	}
 	MCUCR |= (1 << PUD); // disable Pull-up resistors on chip.
 }
@@ -210,23 +105,24 @@ void io_init(void) {
 
 //! Set output value for port.
 /*!
- * A function to set output \p port to the value \p data.
- * 
- * \ref LUR7.h contains definitions of ports and useful parameter values for \p data.
- * 
- * \see LUR7.h
- * 
+ * Run time version of \ref set_output, used when \p port is not a constant.
+ *
  * \param port The output to set value for.
  * \param data The value to output on \p port.
  * \return The value outputed on \p port. 0xFF if \p port is not an output.
  */
-uint8_t set_output(uint8_t port, uint8_t data) {
+uint8_t io_set_output(uint8_t port, uint8_t data) {
 	if (port >= FIRST_OUT && port <= LAST_OUT) { // check that port is an output
+		uint8_t code = pgm_read_byte(&io_pins[port]);
 		if (!data) { // invert because of pull-up resistors
-			*PORTX[port] |= (1 << PORTXn[port]); // set output to one
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				*IO_PORT_REG(code) |= IO_MASK(code); // set output to one
+			}
 			return 1; // return output value
 		} else {
-			*PORTX[port] &= ~(1 << PORTXn[port]); // set output to 0
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				*IO_PORT_REG(code) &= ~IO_MASK(code); // set output to 0
+			}
 			return 0; // return output value
 		}
 	}
@@ -235,50 +131,76 @@ uint8_t set_output(uint8_t port, uint8_t data) {
 
 //! Get current output value.
 /*!
- * Retreives the current value of the output \p port.
+ * Run time version of \ref get_output, used when \p port is not a constant.
  *
- * \ref LUR7.h contains definitions of ports.
- * 
  * \param port The output to read value for.
  * \return The output value of \p port. 0xFF if \p port is not an output.
  */
-uint8_t get_output(uint8_t port) {
+uint8_t io_get_output(uint8_t port) {
 	if (port >= FIRST_OUT && port <= LAST_OUT) { // check that port is an output
-		return !get_input(port); // same method as for inputs, invert for pull-up
+		uint8_t code = pgm_read_byte(&io_pins[port]);
+		return (*IO_PIN_REG(code) & IO_MASK(code) ? 0 : 1); // invert for pull-up
 	}
 	return 0xFF; // return 0xFF if port i not an output
 }
 
 //! Invert current output value.
 /*!
- * A function to invert the output value on \p port.
+ * Run time version of \ref toggle_output, used when \p port is not a constant.
  *
- * \ref LUR7.h contains definitions of ports.
- * 
  * \param port The output to toggle the value for.
  * \return The output value of \p port after toggle. 0xFF if \p port is not an output.
  */
-uint8_t toggle_output(uint8_t port) {
+uint8_t io_toggle_output(uint8_t port) {
 	if (port >= FIRST_OUT && port <= LAST_OUT) {
-		*PINX[port] = (1 << PINXn[port]);
-		_NOP(); //FIXME: concidered bad, other options for very short delays?
-		return get_output(port);
+		uint8_t code = pgm_read_byte(&io_pins[port]);
+		*IO_PIN_REG(code) = IO_MASK(code);
+		_NOP(); // PINx is updated one cycle after the write
+		return io_get_output(port);
 	}
 	return 0xFF;
 }
 
 //! Get input value of input.
 /*!
- * Retreives the current value of the input \p port.
+ * Run time version of \ref get_input, used when \p port is not a constant.
  *
- * \ref LUR7.h contains definitions of ports.
- * 
  * \param port The input to read value for.
  * \return The input value of \p port. 0xFF if \p port is not an input.
  */
-uint8_t get_input(uint8_t port) {
+uint8_t io_get_input(uint8_t port) {
 	if (port >= FIRST_IN && port <= LAST_IN) {
-		return (*PINX[port] & (1 << PINXn[port]) ? 1 : 0);
+		uint8_t code = pgm_read_byte(&io_pins[port]);
+		return (*IO_PIN_REG(code) & IO_MASK(code) ? 1 : 0);
 	}
 	return 0xFF;
 }
+
+//! Set several outputs at once.
+/*!
+ * Run time version of \ref set_output_group, used when the group is not a
+ * constant. The port masks are collected from the pin table before the ports
+ * are written.
+ *
+ * \param group the outputs to set, built with \ref IO_GROUP.
+ * \param on the outputs in \p group to turn on.
+ */
+void io_set_output_group(uint32_t group, uint32_t on) {
+	uint8_t set[3] = {0, 0, 0};
+	uint8_t clear[3] = {0, 0, 0};
+	for (uint8_t i = FIRST_OUT; i <= LAST_OUT; i++) { // for each output
+		if (group & IO_GROUP(i)) {
+			uint8_t code = pgm_read_byte(&io_pins[i]);
+			if (on & IO_GROUP(i)) {
+				clear[code >> 3] |= IO_MASK(code); // ON, invert because of pull-up resistors
+			} else {
+				set[code >> 3] |= IO_MASK(code);
+			}
+		}
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		PORTB = (PORTB | set[0]) & ~clear[0];
+		PORTC = (PORTC | set[1]) & ~clear[1];
+		PORTD = (PORTD | set[2]) & ~clear[2];
+	}
+}
@@ -20,6 +20,9 @@
  * \ref LUR7_io provides functions for setting up and using the digital inputs
  * and outputs of the LUR7 PCB. 
  * 
+ * The pin mapping and the inline versions of the functions are kept in this
+ * file so that constant pins are resolved at compile time.
+ *
  * All code is released under the GPLv3 license.
  *
  * When writing code for the LUR7 PCB this file should not be included directly,
@@ -36,12 +39,197 @@
 #ifndef _LUR7_IO_H_
 #define _LUR7_IO_H_
 
+//! Pin code of bit \p n on port B, see \ref IO_PIN_CODE.
+#define IO_B(n)		(0x00 | (n))
+//! Pin code of bit \p n on port C, see \ref IO_PIN_CODE.
+#define IO_C(n)		(0x08 | (n))
+//! Pin code of bit \p n on port D, see \ref IO_PIN_CODE.
+#define IO_D(n)		(0x10 | (n))
+
+//! Pin mapping of the LUR7 PCB.
+/*!
+ * Translates an in- or output (\ref IN1 - \ref IN9, \ref OUT1 - \ref OUT8,
+ * \ref LED0) to a pin code, port index in bits 3-4 and bit number in bits 0-2.
+ * For a constant \p p the whole expression is evaluated by the compiler.
+ *
+ * This is the only place where the pin mapping is defined, the flash table
+ * used for variable pins in LUR7_io.c is generated from it.
+ */
+#define IO_PIN_CODE(p) \
+	((p) == IN1  ? IO_D(3) : \
+	 (p) == IN2  ? IO_D(2) : \
+	 (p) == IN3  ? IO_D(1) : \
+	 (p) == IN4  ? IO_B(7) : \
+	 (p) == IN5  ? IO_C(0) : \
+	 (p) == IN6  ? IO_B(6) : \
+	 (p) == IN7  ? IO_D(0) : \
+	 (p) == IN8  ? IO_B(5) : \
+	 (p) == IN9  ? IO_B(2) : \
+	 (p) == OUT1 ? IO_C(1) : /* IO_B(0) on MCU v1.0 */ \
+	 (p) == OUT2 ? IO_B(1) : \
+	 (p) == OUT3 ? IO_D(7) : \
+	 (p) == OUT4 ? IO_C(4) : \
+	 (p) == OUT5 ? IO_C(5) : \
+	 (p) == OUT6 ? IO_C(6) : \
+	 (p) == OUT7 ? IO_B(3) : \
+	 (p) == OUT8 ? IO_B(4) : \
+	 (p) == LED0 ? IO_B(0) : 0)
+
+//! Bit mask of a pin code.
+#define IO_MASK(code)		(1 << ((code) & 0x07))
+//! Port Input Pins register of a pin code.
+/*!
+ * PINx, DDRx and PORTx are placed in that order for port B, C and D with no
+ * gaps in between, the registers of any port are found from the address of PINB.
+ */
+#define IO_PIN_REG(code)	(&PINB + 3 * ((code) >> 3))
+//! Data Direction Register of a pin code.
+#define IO_DDR_REG(code)	(IO_PIN_REG(code) + 1)
+//! Port Data register of a pin code.
+#define IO_PORT_REG(code)	(IO_PIN_REG(code) + 2)
+
+//! Member \p p of an output group, groups are formed as IO_GROUP(OUT1) | IO_GROUP(OUT2).
+#define IO_GROUP(p)		(1UL << (p))
+
+//! Bit of output \p p in the port \p k mask of \p group, see \ref IO_GROUP_MASK.
+#define IO_GROUP_BIT(group, k, p) \
+	((((group) >> (p)) & 1) && (IO_PIN_CODE(p) >> 3) == (k) ? IO_MASK(IO_PIN_CODE(p)) : 0)
+//! Mask of all outputs in \p group on port \p k (0 = B, 1 = C, 2 = D).
+/*!
+ * Evaluated by the compiler for a constant \p group.
+ */
+#define IO_GROUP_MASK(group, k) \
+	(IO_GROUP_BIT(group, k, OUT1) | IO_GROUP_BIT(group, k, OUT2) | \
+	 IO_GROUP_BIT(group, k, OUT3) | IO_GROUP_BIT(group, k, OUT4) | \
+	 IO_GROUP_BIT(group, k, OUT5) | IO_GROUP_BIT(group, k, OUT6) | \
+	 IO_GROUP_BIT(group, k, OUT7) | IO_GROUP_BIT(group, k, OUT8) | \
+	 IO_GROUP_BIT(group, k, LED0))
+
 void io_init(void);
 
-uint8_t set_output(uint8_t, uint8_t);
-uint8_t get_output(uint8_t);
-uint8_t toggle_output(uint8_t);
+uint8_t io_set_output(uint8_t, uint8_t);
+uint8_t io_get_output(uint8_t);
+uint8_t io_toggle_output(uint8_t);
+
+uint8_t io_get_input(uint8_t);
+
+void io_set_output_group(uint32_t, uint32_t);
+
+//! Set output value for port.
+/*!
+ * A function to set output \p port to the value \p data.
+ *
+ * When \p port is a constant this compiles to a single sbi/cbi instruction,
+ * otherwise \ref io_set_output is called.
+ *
+ * \ref LUR7.h contains definitions of ports and useful parameter values for \p data.
+ *
+ * \see LUR7.h
+ *
+ * \param port The output to set value for.
+ * \param data The value to output on \p port.
+ * \return The value outputed on \p port. 0xFF if \p port is not an output.
+ */
+static inline __attribute__((always_inline)) uint8_t set_output(uint8_t port, uint8_t data) {
+	if (__builtin_constant_p(port) && port >= FIRST_OUT && port <= LAST_OUT) {
+		if (!data) { // invert because of pull-up resistors
+			*IO_PORT_REG(IO_PIN_CODE(port)) |= IO_MASK(IO_PIN_CODE(port)); // set output to one
+			return 1;
+		} else {
+			*IO_PORT_REG(IO_PIN_CODE(port)) &= ~IO_MASK(IO_PIN_CODE(port)); // set output to 0
+			return 0;
+		}
+	}
+	return io_set_output(port, data);
+}
+
+//! Get current output value.
+/*!
+ * Retreives the current value of the output \p port.
+ *
+ * When \p port is a constant this compiles to a single sbis/sbic instruction,
+ * otherwise \ref io_get_output is called.
+ *
+ * \param port The output to read value for.
+ * \return The output value of \p port. 0xFF if \p port is not an output.
+ */
+static inline __attribute__((always_inline)) uint8_t get_output(uint8_t port) {
+	if (__builtin_constant_p(port) && port >= FIRST_OUT && port <= LAST_OUT) {
+		return (*IO_PIN_REG(IO_PIN_CODE(port)) & IO_MASK(IO_PIN_CODE(port)) ? 0 : 1); // invert for pull-up
+	}
+	return io_get_output(port);
+}
+
+//! Invert current output value.
+/*!
+ * A function to invert the output value on \p port.
+ *
+ * When \p port is a constant the toggle is a single write to PINx, otherwise
+ * \ref io_toggle_output is called.
+ *
+ * \param port The output to toggle the value for.
+ * \return The output value of \p port after toggle. 0xFF if \p port is not an output.
+ */
+static inline __attribute__((always_inline)) uint8_t toggle_output(uint8_t port) {
+	if (__builtin_constant_p(port) && port >= FIRST_OUT && port <= LAST_OUT) {
+		*IO_PIN_REG(IO_PIN_CODE(port)) = IO_MASK(IO_PIN_CODE(port));
+		_NOP(); // PINx is updated one cycle after the write
+		return get_output(port);
+	}
+	return io_toggle_output(port);
+}
 
-uint8_t get_input(uint8_t);
+//! Get input value of input.
+/*!
+ * Retreives the current value of the input \p port.
+ *
+ * When \p port is a constant this compiles to a single sbis/sbic instruction,
+ * otherwise \ref io_get_input is called.
+ *
+ * \param port The input to read value for.
+ * \return The input value of \p port. 0xFF if \p port is not an input.
+ */
+static inline __attribute__((always_inline)) uint8_t get_input(uint8_t port) {
+	if (__builtin_constant_p(port) && port >= FIRST_IN && port <= LAST_IN) {
+		return (*IO_PIN_REG(IO_PIN_CODE(port)) & IO_MASK(IO_PIN_CODE(port)) ? 1 : 0);
+	}
+	return io_get_input(port);
+}
+
+//! Set several outputs at once.
+/*!
+ * All outputs in \p group are set in one write per port, outputs on the same
+ * port change at the same instant and the update can not be interrupted. The
+ * outputs in both \p group and \p on are set to ON (TRI), the rest of
+ * \p group to OFF (GND), as by \ref set_output.
+ *
+ * \code
+ * set_output_group(IO_GROUP(GEAR_UP) | IO_GROUP(SHIFT_CUT), IO_GROUP(GEAR_UP)); // GEAR_UP TRI, SHIFT_CUT GND
+ * \endcode
+ *
+ * When \p group and \p on are constants the port masks are calculated by the
+ * compiler, otherwise \ref io_set_output_group is called.
+ *
+ * \param group the outputs to set, built with \ref IO_GROUP.
+ * \param on the outputs in \p group to turn on.
+ */
+static inline __attribute__((always_inline)) void set_output_group(uint32_t group, uint32_t on) {
+	if (__builtin_constant_p(group) && __builtin_constant_p(on)) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			// set port bit for OFF, clear port bit for ON (inverted outputs)
+			if (IO_GROUP_MASK(group, 0)) {
+				PORTB = (PORTB | IO_GROUP_MASK(group, 0)) & ~IO_GROUP_MASK(group & on, 0);
+			}
+			if (IO_GROUP_MASK(group, 1)) {
+				PORTC = (PORTC | IO_GROUP_MASK(group, 1)) & ~IO_GROUP_MASK(group & on, 1);
+			}
+			if (IO_GROUP_MASK(group, 2)) {
+				PORTD = (PORTD | IO_GROUP_MASK(group, 2)) & ~IO_GROUP_MASK(group & on, 2);
+			}
+		}
+	} else {
+		io_set_output_group(group, on);
+	}
+}
 
 #endif  // _LUR7_IO_H_
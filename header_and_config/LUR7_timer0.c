@@ -35,6 +35,9 @@
  * By using timed interrupts and counters time can be measured with a resolution
  * of 100µs.
  *
+ * For periodic tasks with short periods, eg. bit-banging, \ref timer0_repeat
+ * calls \ref timer0_isr_stop every period with one interrupt per period.
+ *
  * \see LUR7_timer0.c
  * \see LUR7_timer0.h
  * \see <http://www.gnu.org/copyleft/gpl.html>
@@ -49,6 +52,8 @@
 static volatile uint16_t counter = 0;
 //! Holds the time to delay for.
 static volatile uint16_t compare = 0;
+//! Set while running periodically, see \ref timer0_repeat.
+static volatile uint8_t repeat = FALSE;
 
 //! Hardware initialisation function.
 /*!
@@ -70,6 +75,9 @@ void timer0_init(void) {
  * \param time time in ms*10 (100µs resolution)
  */
 void timer0_start(uint16_t time) {
+	TCCR0B = 0; // stop while reconfiguring
+	repeat = FALSE;
+	OCR0A = 199; // 100µs with clock prescaler = 8.
 	TIFR0 = 0x00; // clear interrupt flags
 	TCNT0 = 0x00; // reset counter.
 	TCCR0B = (1 << CS01); // clock prescaler = 8.
@@ -78,12 +86,52 @@ void timer0_start(uint16_t time) {
 	compare = time; // store time to pause.
 }
 
+//! Start periodic interrupts
+/*!
+ * Calls \ref timer0_isr_stop every \p time * 100µs until \ref timer0_stop or
+ * \ref timer0_start is called. Unlike \ref timer0_start only one interrupt is
+ * generated per period.
+ *
+ * \param time period in ms*10, [1, 10].
+ */
+void timer0_repeat(uint8_t time) {
+	if (time < 1) {
+		time = 1;
+	} else if (time > 10) {
+		time = 10;
+	}
+	TCCR0B = 0; // stop while reconfiguring
+	repeat = TRUE;
+	OCR0A = 25 * time - 1; // 100µs = 25 clocks with clock prescaler = 64.
+	TCNT0 = 0x00; // reset counter.
+	TIFR0 = (1 << OCF0A); // clear pending compare match
+	TIMSK0 = (1 << OCIE0A); // enable output compare interrupt.
+	TCCR0B = (1 << CS01) | (1 << CS00); // clock prescaler = 64.
+}
+
+//! Stop the timer
+/*!
+ * Stops a running delay or periodic interrupt, \ref timer0_isr_stop is not
+ * executed.
+ */
+void timer0_stop(void) {
+	TCCR0B = 0; // turn off counter
+	TIMSK0 = 0; // disable interrupts
+	repeat = FALSE;
+	compare = 0;
+}
+
 //! Interrupt Service Routine, Timer0
 /*!
  * Interrupt handler. Handles the timer and counts the time passed. Executes
- * \ref timer0_isr_stop when \p time has elapsed and stops the timer.
+ * \ref timer0_isr_stop when \p time has elapsed and stops the timer. When
+ * running periodically \ref timer0_isr_stop is executed every interrupt.
  */
 ISR(TIMER0_COMPA_vect) {
+	if (repeat) {
+		timer0_isr_stop();
+		return;
+	}
 	++counter;
 	if (counter == compare) {
 		TCCR0B = 0; // turn off counter
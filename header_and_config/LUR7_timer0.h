@@ -42,10 +42,13 @@
 void timer0_init(void);
 
 void timer0_start(uint16_t);
+void timer0_repeat(uint8_t);
+void timer0_stop(void);
 
 //! Delay complete
 /*!
- * Executes when the time specified by timer0_start has elapsed.
+ * Executes when the time specified by timer0_start has elapsed, or every
+ * period when started with timer0_repeat.
  */
 extern void timer0_isr_stop(void);
 
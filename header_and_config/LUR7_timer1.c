@@ -57,6 +57,18 @@ static volatile uint8_t interrupt_nbr = 0;
  * interrupts.
  */
 static volatile uint8_t interrupt_divider = 0;
+//! Timestamp of the last TOP
+/*!
+ * The number of timer clocks elapsed from \ref timer1_init to the last time
+ * the counter reached TOP. Used by \ref timer1_timestamp, wraps every 268 s.
+ */
+static volatile uint32_t timestamp_top = 0;
+//! Set from \ref timer1_init until the first TOP
+/*!
+ * During the first half cycle the counter counts up without TOV1 having been
+ * set, this flag replaces TOV1 in \ref timer1_timestamp until TOP is reached.
+ */
+static volatile uint8_t timestamp_first = 1;
 
 //! Hardware initialisation function.
 /*!
@@ -80,9 +92,12 @@ void timer1_init(uint8_t pwm_on) {
 	
 	TCCR1B = (1 << WGM13) | (1 << CS10); // phase and frequency correct PWM mode, prescaler = 1
 	TCCR1C = 0x00; // no force compare match
-	OCR1A  = 0x4E20; // 20000 => 400Hz
+	OCR1A  = TIMER1_TOP; // 20000 => 400Hz
 	OCR1B  = 0x0000; // duytcycle = 0 to start
 	TIMSK1 = (1 << OCIE1A); // timer interrupts 400Hz
+	TIFR1 = (1 << TOV1) | (1 << OCF1A); // clear flags used by timer1_timestamp
+	timestamp_top = 0;
+	timestamp_first = 1;
 }
 
 //! Sets the dutycycle of the output.
@@ -95,12 +110,48 @@ void timer1_init(uint8_t pwm_on) {
  * \param dutycycle the dutycycle [0, 20000] of the PWM output.
  */
 void timer1_dutycycle(uint16_t dutycycle) {
-	if (dutycycle > 20000) {
-		dutycycle = 20000;
+	if (dutycycle > TIMER1_TOP) {
+		dutycycle = TIMER1_TOP;
 	}
 	OCR1B = dutycycle;
 }
 
+//! Free running timestamp.
+/*!
+ * Timer1 counts up and down between BOTTOM and TOP, one full cycle is
+ * 2 * \ref TIMER1_TOP timer clocks. The position in the current cycle is
+ * reconstructed from TCNT1 and the TOV1 flag, which is set at BOTTOM and
+ * cleared at TOP by the interrupt handler. Should TOP have been passed without
+ * the interrupt having been serviced yet, OCF1A is still set and one extra
+ * cycle is added.
+ *
+ * The timestamp has a resolution of one timer clock (62.5 ns) and wraps every
+ * 268 s, time differences should be calculated with unsigned arithmetic. Safe
+ * to call from both interrupts and the main loop.
+ *
+ * \return number of timer clocks since \ref timer1_init.
+ */
+uint32_t timer1_timestamp(void) {
+	uint32_t top;
+	uint16_t count;
+	uint8_t flags;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		count = TCNT1;
+		flags = TIFR1;
+		top = timestamp_top;
+		if (timestamp_first) {
+			flags |= (1 << TOV1);
+		}
+	}
+	if (flags & (1 << OCF1A)) { // TOP passed, interrupt pending, counting down.
+		return top + 3 * (uint32_t) TIMER1_TOP - count;
+	}
+	if (flags & (1 << TOV1)) { // BOTTOM passed, counting up.
+		return top + TIMER1_TOP + count;
+	}
+	return top + TIMER1_TOP - count; // counting down from TOP
+}
+
 //! Interrupt Service Routine, Timer1
 /*!
  * Interrupts are triggered every 10ms, the counter \ref interrupt_nbr is
@@ -108,6 +159,9 @@ void timer1_dutycycle(uint16_t dutycycle) {
  * \ref timer1_isr_100Hz is called and can be used for scheduling tasks.
  */
 ISR(TIMER1_COMPA_vect) {
+	timestamp_top += 2 * (uint32_t) TIMER1_TOP; // one full up-down cycle
+	TIFR1 = (1 << TOV1); // clear BOTTOM flag, counting down from here
+	timestamp_first = 0;
 	interrupt_divider = (interrupt_divider + 1) % 4;
 	if (interrupt_divider == 0) {
 		timer1_isr_100Hz(interrupt_nbr++);
@@ -36,8 +36,14 @@
 #ifndef _LUR7_TIMER1_H_
 #define _LUR7_TIMER1_H_
 
+//! TOP value of timer1, 20000 => 400 Hz
+#define TIMER1_TOP	20000
+//! Number of timer1 clocks per microsecond, see \ref timer1_timestamp.
+#define TIMER1_CLOCKS_PER_US	(F_CPU / 1000000UL)
+
 void timer1_init(uint8_t);
 void timer1_dutycycle(uint16_t);
+uint32_t timer1_timestamp(void);
 
 //! Timer interrupt function triggered at 100 Hz.
 /*!
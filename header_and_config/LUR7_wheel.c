@@ -0,0 +1,200 @@
+/*
+ * LUR7_wheel.c - A collection of functions to setup and ease the use of the LUR7 PCB
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file LUR7_wheel.c
+ * \ref LUR7_wheel measures wheel speed from the time between sensor pulses.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * When writing code for the LUR7 PCB this file should not be included directly,
+ * instead you should include the \ref LUR7.h file to each source file.
+ *
+ * \see LUR7_wheel
+ * \see LUR7_wheel.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup LUR7_wheel Shared - Wheel Speed
+ * Counting pulses over a fixed time gives a resolution of one pulse per
+ * period, at 10 Hz and low speeds that is a large part of the measured value.
+ * Instead every pulse is timestamped using \ref timer1_timestamp and the
+ * frequency is calculated from the time between pulses.
+ *
+ * To use the module, run wheel_init(void) once. Call wheel_edge(uint8_t, uint32_t)
+ * from the pin change handler on every rising edge of the sensor, and
+ * wheel_update(void) from \ref timer1_isr_100Hz. The latest result is read
+ * with wheel_get_frequency(uint8_t).
+ *
+ * The frequency is averaged over up to \ref WHEEL_WINDOW pulses, but never
+ * over more than \ref WHEEL_WINDOW_TIME_US. When pulses stop arriving the
+ * frequency decays as if a pulse was just about to come, and after
+ * \ref WHEEL_TIMEOUT_US it is set to zero.
+ *
+ * The input capture unit of timer1 can not be used as ICP1 is not connected to
+ * the inputs used by the wheel speed sensors, timestamps are taken in the
+ * pin change interrupt instead. The jitter is the interrupt latency, a few µs.
+ *
+ * \see LUR7_wheel.c
+ * \see LUR7_wheel.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include "LUR7.h"
+#include "LUR7_wheel.h"
+
+//! Mask used for indexing the timestamp buffers.
+#define WHEEL_MASK	(WHEEL_WINDOW - 1)
+
+//! Timestamps of the latest pulses, ring buffer.
+static volatile uint32_t wheel_stamps[WHEEL_CHANNELS][WHEEL_WINDOW];
+//! Index of the next timestamp to write in \ref wheel_stamps.
+static volatile uint8_t wheel_head[WHEEL_CHANNELS];
+//! Number of valid timestamps in \ref wheel_stamps, at most \ref WHEEL_WINDOW.
+static volatile uint8_t wheel_valid[WHEEL_CHANNELS];
+//! Total number of pulses since \ref wheel_init.
+static volatile uint32_t wheel_pulses[WHEEL_CHANNELS];
+//! Frequency calculated by \ref wheel_update in units of 1/\ref WHEEL_FREQ_SCALE Hz.
+static volatile uint32_t wheel_freq[WHEEL_CHANNELS];
+
+//! Initialisation function.
+/*!
+ * Clears all stored pulses. Requires timer1 to be running, see \ref timer1_init.
+ */
+void wheel_init(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (uint8_t i = 0; i < WHEEL_CHANNELS; i++) {
+			wheel_head[i] = 0;
+			wheel_valid[i] = 0;
+			wheel_pulses[i] = 0;
+			wheel_freq[i] = 0;
+		}
+	}
+}
+
+//! Registers a pulse.
+/*!
+ * Called from the pin change handler of the sensor input on each rising
+ * edge.
+ *
+ * \param wheel \ref WHEEL_LEFT or \ref WHEEL_RIGHT.
+ * \param now timestamp of the edge, as passed to the \ref pc_handler_t.
+ */
+void wheel_edge(uint8_t wheel, uint32_t now) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		uint8_t head = wheel_head[wheel];
+		wheel_stamps[wheel][head] = now;
+		wheel_head[wheel] = (head + 1) & WHEEL_MASK;
+		if (wheel_valid[wheel] < WHEEL_WINDOW) {
+			wheel_valid[wheel]++;
+		}
+		wheel_pulses[wheel]++;
+	}
+}
+
+//! Calculates the frequency of one wheel.
+/*!
+ * The newest pulse is compared to the oldest pulse within the window, the
+ * frequency is the number of periods in between divided by the time.
+ *
+ * \param wheel the wheel to calculate.
+ * \param now timestamp of the calculation.
+ * \return frequency in units of 1/\ref WHEEL_FREQ_SCALE Hz.
+ */
+static uint32_t wheel_calculate(uint8_t wheel, uint32_t now) {
+	uint8_t head = wheel_head[wheel];
+	uint8_t valid = wheel_valid[wheel];
+	uint32_t newest;
+	uint32_t span = 0;
+	uint8_t periods = 0;
+	uint32_t freq;
+	uint32_t since;
+
+	if (valid < 2) {
+		return 0;
+	}
+	newest = wheel_stamps[wheel][(head - 1) & WHEEL_MASK];
+	since = (now - newest) / TIMER1_CLOCKS_PER_US;
+	if (since > WHEEL_TIMEOUT_US) {
+		wheel_valid[wheel] = 0; // standing still, restart measurement
+		return 0;
+	}
+
+	for (uint8_t i = 1; i < valid; i++) {
+		uint32_t s = (newest - wheel_stamps[wheel][(head - 1 - i) & WHEEL_MASK]) / TIMER1_CLOCKS_PER_US;
+		if (periods > 0 && s > WHEEL_WINDOW_TIME_US) {
+			break;
+		}
+		span = s;
+		periods = i;
+	}
+	if (span == 0) {
+		return 0;
+	}
+	freq = periods * (1000000UL * WHEEL_FREQ_SCALE) / span;
+
+	// no pulse for longer than one period, the wheel is slowing down
+	if (since * periods > span) {
+		uint32_t bound = (1000000UL * WHEEL_FREQ_SCALE) / since;
+		if (bound < freq) {
+			freq = bound;
+		}
+	}
+	return freq;
+}
+
+//! Updates the wheel frequencies.
+/*!
+ * Should be called at a regular interval, eg. from \ref timer1_isr_100Hz.
+ */
+void wheel_update(void) {
+	for (uint8_t i = 0; i < WHEEL_CHANNELS; i++) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			wheel_freq[i] = wheel_calculate(i, timer1_timestamp());
+		}
+	}
+}
+
+//! Gets the wheel frequency.
+/*!
+ * \param wheel \ref WHEEL_LEFT or \ref WHEEL_RIGHT.
+ * \return pulse frequency in units of 1/\ref WHEEL_FREQ_SCALE Hz, as calculated
+ * by the latest call to \ref wheel_update.
+ */
+uint32_t wheel_get_frequency(uint8_t wheel) {
+	uint32_t freq;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		freq = wheel_freq[wheel];
+	}
+	return freq;
+}
+
+//! Gets the total number of pulses.
+/*!
+ * \param wheel \ref WHEEL_LEFT or \ref WHEEL_RIGHT.
+ * \return number of pulses since \ref wheel_init.
+ */
+uint32_t wheel_get_pulses(uint8_t wheel) {
+	uint32_t pulses;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		pulses = wheel_pulses[wheel];
+	}
+	return pulses;
+}
@@ -0,0 +1,61 @@
+/*
+ * LUR7_wheel.h - A collection of functions to setup and ease the use of the LUR7 PCB
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file LUR7_wheel.h
+ * \ref LUR7_wheel measures wheel speed from the time between sensor pulses.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * When writing code for the LUR7 PCB this file should not be included directly,
+ * instead you should include the \ref LUR7.h file to each source file.
+ *
+ * \see LUR7_wheel
+ * \see LUR7_wheel.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup LUR7_wheel
+ */
+
+#ifndef _LUR7_WHEEL_H_
+#define _LUR7_WHEEL_H_
+
+//! Number of wheels that can be measured.
+#define WHEEL_CHANNELS	2
+//! Channel for the left wheel.
+#define WHEEL_LEFT		0
+//! Channel for the right wheel.
+#define WHEEL_RIGHT		1
+
+//! Number of pulse timestamps kept per wheel, must be a power of two.
+#define WHEEL_WINDOW			8
+//! Length of the moving window in µs.
+#define WHEEL_WINDOW_TIME_US	50000UL
+//! Time without pulses in µs after which the wheel is considered stationary.
+#define WHEEL_TIMEOUT_US		1000000UL
+//! Unit of the wheel frequency, 100 => 0.01 Hz.
+#define WHEEL_FREQ_SCALE		100UL
+
+void wheel_init(void);
+void wheel_edge(uint8_t, uint32_t);
+void wheel_update(void);
+uint32_t wheel_get_frequency(uint8_t);
+uint32_t wheel_get_pulses(uint8_t);
+
+#endif // _LUR7_WHEEL_H_
@@ -98,25 +98,6 @@ int main(void) {
 	return 0;
 }
 
-/*! \note unused input */
-void pcISR_in1(void) {}
-/*! \note unused input */
-void pcISR_in2(void) {}
-/*! \note unused input */
-void pcISR_in3(void) {}
-/*! \note unused input */
-void pcISR_in4(void) {}
-/*! \note unused input */
-void pcISR_in5(void) {}
-/*! \note unused input */
-void pcISR_in6(void) {}
-/*! \note unused input */
-void pcISR_in7(void) {}
-/*! \note unused input */
-void pcISR_in8(void) {}
-/*! \note unused input */
-void pcISR_in9(void) {}
-
 /*!
  * In order to schedule tasks or perform them with a well defined time delta,
  * the 100 Hz interrupt generator of LUR7_timer0 is used.
@@ -1,5 +1,5 @@
 /*
- * brake.h - A collection of functions to setup and ease the use of the LUR7 PCB
+ * cpufunc.h - Host replacement of avr-libc <avr/cpufunc.h>
  * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
  *
  * This program is free software: you can redistribute it and/or modify
@@ -16,23 +16,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-/*! \file brake.h
- * \ref brake controls braking of the LUR7.
- *
- * All code is released under the GPLv3 license.
- *
- * \see \ref brake
- * \see \ref brake.c
- * \see <http://www.gnu.org/copyleft/gpl.html>
- * \author Simon Wrafter
- * \copyright GNU Public License v3.0
- *
- * \addtogroup brake
- */
+// A NOP takes one cycle and completes the register access before it.
+
+#ifndef _HOST_CPUFUNC_H_
+#define _HOST_CPUFUNC_H_
 
-#ifndef _BRAKE_H_
-#define _BRAKE_H_
+void sim_nop(void);
 
-void brake_light(uint16_t);
+#define _NOP()	sim_nop()
+#define _MemoryBarrier()	__asm__ __volatile__("" ::: "memory")
 
-#endif // _BRAKE_H_
\ No newline at end of file
+#endif // _HOST_CPUFUNC_H_
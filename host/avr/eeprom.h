@@ -0,0 +1,33 @@
+/*
+ * eeprom.h - Host replacement of avr-libc <avr/eeprom.h>
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The EEPROM is ordinary memory in a section of its own, which lasts over the
+// power cuts of a run. It is written by test_logger/sdcard.c, the only part
+// of the logger using it, which can keep it in a file between runs, see
+// sdcard_eeprom.
+
+#ifndef _HOST_EEPROM_H_
+#define _HOST_EEPROM_H_
+
+#include <stdint.h>
+
+#define EEMEM	__attribute__((section("host_eeprom")))
+#define eeprom_read_word(addr)	(*(const uint16_t *) (addr))
+void eeprom_update_word(uint16_t * addr, uint16_t value);
+
+#endif // _HOST_EEPROM_H_
@@ -0,0 +1,39 @@
+/*
+ * interrupt.h - Host replacement of avr-libc <avr/interrupt.h>
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// An interrupt vector is a plain function called by host/sim.c when the
+// interrupt is taken, with the I bit cleared as on the target.
+
+#ifndef _HOST_INTERRUPT_H_
+#define _HOST_INTERRUPT_H_
+
+#include <avr/io.h>
+
+void sim_sei(void);
+void sim_cli(void);
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define ISR(vector, ...)	void vector(void); void vector(void)
+
+#define sei()	sim_sei()
+#define cli()	sim_cli()
+#define reti()	return
+
+#endif // _HOST_INTERRUPT_H_
@@ -0,0 +1,251 @@
+/*
+ * io.h - Host replacement of avr-libc <avr/io.h>, ATmega32M1 registers
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Every register is an access through sim_reg(), see host/sim.c, which runs
+// the peripherals and interrupts up to the time of the access. Addresses are
+// the data addresses of the ATmega32M1, so pointer arithmetic between
+// registers such as IO_PIN_REG works as on the target. Registers can not be
+// used in static initialisers.
+
+#ifndef _HOST_IO_H_
+#define _HOST_IO_H_
+
+#include <stdint.h>
+
+volatile uint8_t * sim_reg(uint8_t addr);
+
+#define _SFR_MEM8(addr)		(*sim_reg(addr))
+#define _SFR_MEM16(addr)	(*(volatile uint16_t *) sim_reg(addr))
+#define _SFR_IO8(addr)		_SFR_MEM8((addr) + 0x20)
+#define _BV(bit)			(1 << (bit))
+#define _VECTOR(n)			__vector_ ## n
+
+// Ports
+#define PINB	_SFR_MEM8(0x23)
+#define DDRB	_SFR_MEM8(0x24)
+#define PORTB	_SFR_MEM8(0x25)
+#define PINC	_SFR_MEM8(0x26)
+#define DDRC	_SFR_MEM8(0x27)
+#define PORTC	_SFR_MEM8(0x28)
+#define PIND	_SFR_MEM8(0x29)
+#define DDRD	_SFR_MEM8(0x2A)
+#define PORTD	_SFR_MEM8(0x2B)
+#define PINE	_SFR_MEM8(0x2C)
+#define DDRE	_SFR_MEM8(0x2D)
+#define PORTE	_SFR_MEM8(0x2E)
+
+// Interrupt flags and masks
+#define TIFR0	_SFR_MEM8(0x35)
+#define TIFR1	_SFR_MEM8(0x36)
+#define GPIOR1	_SFR_MEM8(0x39)
+#define GPIOR2	_SFR_MEM8(0x3A)
+#define PCIFR	_SFR_MEM8(0x3B)
+#define EIFR	_SFR_MEM8(0x3C)
+#define EIMSK	_SFR_MEM8(0x3D)
+#define GPIOR0	_SFR_MEM8(0x3E)
+#define PCICR	_SFR_MEM8(0x68)
+#define EICRA	_SFR_MEM8(0x69)
+#define PCMSK0	_SFR_MEM8(0x6A)
+#define PCMSK1	_SFR_MEM8(0x6B)
+#define PCMSK2	_SFR_MEM8(0x6C)
+#define PCMSK3	_SFR_MEM8(0x6D)
+#define TIMSK0	_SFR_MEM8(0x6E)
+#define TIMSK1	_SFR_MEM8(0x6F)
+
+// Timer0
+#define TCCR0A	_SFR_MEM8(0x44)
+#define TCCR0B	_SFR_MEM8(0x45)
+#define TCNT0	_SFR_MEM8(0x46)
+#define OCR0A	_SFR_MEM8(0x47)
+#define OCR0B	_SFR_MEM8(0x48)
+
+// SPI
+#define SPCR	_SFR_MEM8(0x4C)
+#define SPSR	_SFR_MEM8(0x4D)
+#define SPDR	_SFR_MEM8(0x4E)
+
+// System
+#define ACSR	_SFR_MEM8(0x50)
+#define SMCR	_SFR_MEM8(0x53)
+#define MCUSR	_SFR_MEM8(0x54)
+#define MCUCR	_SFR_MEM8(0x55)
+#define SREG	_SFR_MEM8(0x5F)
+#define WDTCSR	_SFR_MEM8(0x60)
+#define CLKPR	_SFR_MEM8(0x61)
+#define PRR		_SFR_MEM8(0x64)
+
+// ADC and amplifiers
+#define AMP0CSR	_SFR_MEM8(0x75)
+#define AMP1CSR	_SFR_MEM8(0x76)
+#define AMP2CSR	_SFR_MEM8(0x77)
+#define ADC		_SFR_MEM16(0x78)
+#define ADCW	_SFR_MEM16(0x78)
+#define ADCL	_SFR_MEM8(0x78)
+#define ADCH	_SFR_MEM8(0x79)
+#define ADCSRA	_SFR_MEM8(0x7A)
+#define ADCSRB	_SFR_MEM8(0x7B)
+#define ADMUX	_SFR_MEM8(0x7C)
+#define DIDR0	_SFR_MEM8(0x7E)
+#define DIDR1	_SFR_MEM8(0x7F)
+
+// Timer1
+#define TCCR1A	_SFR_MEM8(0x80)
+#define TCCR1B	_SFR_MEM8(0x81)
+#define TCCR1C	_SFR_MEM8(0x82)
+#define TCNT1	_SFR_MEM16(0x84)
+#define TCNT1L	_SFR_MEM8(0x84)
+#define TCNT1H	_SFR_MEM8(0x85)
+#define ICR1	_SFR_MEM16(0x86)
+#define OCR1A	_SFR_MEM16(0x88)
+#define OCR1B	_SFR_MEM16(0x8A)
+
+// Analog comparators
+#define AC0CON	_SFR_MEM8(0x94)
+#define AC1CON	_SFR_MEM8(0x95)
+#define AC2CON	_SFR_MEM8(0x96)
+#define AC3CON	_SFR_MEM8(0x97)
+
+// CAN
+#define CANGCON		_SFR_MEM8(0xD8)
+#define CANGSTA		_SFR_MEM8(0xD9)
+#define CANGIT		_SFR_MEM8(0xDA)
+#define CANGIE		_SFR_MEM8(0xDB)
+#define CANEN2		_SFR_MEM8(0xDC)
+#define CANEN1		_SFR_MEM8(0xDD)
+#define CANIE2		_SFR_MEM8(0xDE)
+#define CANIE1		_SFR_MEM8(0xDF)
+#define CANSIT2		_SFR_MEM8(0xE0)
+#define CANSIT1		_SFR_MEM8(0xE1)
+#define CANBT1		_SFR_MEM8(0xE2)
+#define CANBT2		_SFR_MEM8(0xE3)
+#define CANBT3		_SFR_MEM8(0xE4)
+#define CANTCON		_SFR_MEM8(0xE5)
+#define CANTIM		_SFR_MEM16(0xE6)
+#define CANTTC		_SFR_MEM16(0xE8)
+#define CANTEC		_SFR_MEM8(0xEA)
+#define CANREC		_SFR_MEM8(0xEB)
+#define CANHPMOB	_SFR_MEM8(0xEC)
+#define CANPAGE		_SFR_MEM8(0xED)
+#define CANSTMOB	_SFR_MEM8(0xEE)
+#define CANCDMOB	_SFR_MEM8(0xEF)
+#define CANIDT4		_SFR_MEM8(0xF0)
+#define CANIDT3		_SFR_MEM8(0xF1)
+#define CANIDT2		_SFR_MEM8(0xF2)
+#define CANIDT1		_SFR_MEM8(0xF3)
+#define CANIDM4		_SFR_MEM8(0xF4)
+#define CANIDM3		_SFR_MEM8(0xF5)
+#define CANIDM2		_SFR_MEM8(0xF6)
+#define CANIDM1		_SFR_MEM8(0xF7)
+#define CANSTM		_SFR_MEM16(0xF8)
+#define CANMSG		_SFR_MEM8(0xFA)
+
+// Bits, named as in avr-libc
+#define _HOST_BITS8(p)	enum { p ## 0, p ## 1, p ## 2, p ## 3, p ## 4, p ## 5, p ## 6, p ## 7 };
+_HOST_BITS8(PINB) _HOST_BITS8(DDB) _HOST_BITS8(PORTB)
+_HOST_BITS8(PINC) _HOST_BITS8(DDC) _HOST_BITS8(PORTC)
+_HOST_BITS8(PIND) _HOST_BITS8(DDD) _HOST_BITS8(PORTD)
+#undef _HOST_BITS8
+enum { PINE0, PINE1, PINE2, DDE0 = 0, DDE1, DDE2, PORTE0 = 0, PORTE1, PORTE2 };
+enum { PCINT0, PCINT1, PCINT2, PCINT3, PCINT4, PCINT5, PCINT6, PCINT7 };
+enum { PCINT8, PCINT9, PCINT10, PCINT11, PCINT12, PCINT13, PCINT14, PCINT15 };
+enum { PCINT16, PCINT17, PCINT18, PCINT19, PCINT20, PCINT21, PCINT22, PCINT23 };
+enum { PCINT24, PCINT25, PCINT26 };
+enum { PCIE0, PCIE1, PCIE2, PCIE3 };
+enum { PCIF0, PCIF1, PCIF2, PCIF3 };
+enum { INT0, INT1, INT2, INT3 };
+enum { INTF0, INTF1, INTF2, INTF3 };
+enum { ISC00, ISC01, ISC10, ISC11, ISC20, ISC21, ISC30, ISC31 };
+enum { TOV0 = 0, OCF0A = 1, OCF0B = 2 };
+enum { TOIE0 = 0, OCIE0A = 1, OCIE0B = 2 };
+enum { WGM00 = 0, WGM01 = 1, COM0B0 = 4, COM0B1 = 5, COM0A0 = 6, COM0A1 = 7 };
+enum { CS00 = 0, CS01 = 1, CS02 = 2, WGM02 = 3, FOC0B = 6, FOC0A = 7 };
+enum { TOV1 = 0, OCF1A = 1, OCF1B = 2, ICF1 = 5 };
+enum { TOIE1 = 0, OCIE1A = 1, OCIE1B = 2, ICIE1 = 5 };
+enum { WGM10 = 0, WGM11 = 1, COM1B0 = 4, COM1B1 = 5, COM1A0 = 6, COM1A1 = 7 };
+enum { CS10 = 0, CS11 = 1, CS12 = 2, WGM12 = 3, WGM13 = 4, ICES1 = 6, ICNC1 = 7 };
+enum { FOC1B = 6, FOC1A = 7 };
+enum { SPR0 = 0, SPR1 = 1, CPHA = 2, CPOL = 3, MSTR = 4, DORD = 5, SPE = 6, SPIE = 7 };
+enum { SPI2X = 0, WCOL = 6, SPIF = 7 };
+enum { SE = 0, SM0 = 1, SM1 = 2, SM2 = 3 };
+enum { IVCE = 0, IVSEL = 1, PUD = 4, SPIPS = 7 };
+enum { PORF = 0, EXTRF = 1, BORF = 2, WDRF = 3 };
+enum { SREG_C = 0, SREG_Z = 1, SREG_N = 2, SREG_V = 3, SREG_S = 4, SREG_H = 5, SREG_T = 6, SREG_I = 7 };
+enum { WDP0 = 0, WDP1 = 1, WDP2 = 2, WDE = 3, WDCE = 4, WDP3 = 5, WDIE = 6, WDIF = 7 };
+enum { CLKPS0 = 0, CLKPS1 = 1, CLKPS2 = 2, CLKPS3 = 3, CLKPCE = 7 };
+enum { PRADC = 0, PRLIN = 1, PRSPI = 2, PRTIM0 = 3, PRTIM1 = 4, PRPSC = 5, PRCAN = 6 };
+enum { MUX0 = 0, MUX1 = 1, MUX2 = 2, MUX3 = 3, MUX4 = 4, ADLAR = 5, REFS0 = 6, REFS1 = 7 };
+enum { ADPS0 = 0, ADPS1 = 1, ADPS2 = 2, ADIE = 3, ADIF = 4, ADATE = 5, ADSC = 6, ADEN = 7 };
+enum { ADTS0 = 0, ADTS1 = 1, ADTS2 = 2, ADTS3 = 3, AREFEN = 5, ISRCEN = 6, ADHSM = 7 };
+enum { ADC0D = 0, ADC1D = 1, ADC2D = 2, ADC3D = 3, ADC4D = 4, ADC5D = 5, ADC6D = 6, ADC7D = 7 };
+enum { ADC8D = 0, ADC9D = 1, ADC10D = 2, AMP0ND = 3, AMP0PD = 4, ACMP0D = 5, AMP2PD = 6 };
+enum { AC0M0 = 0, AC0M1 = 1, AC0M2 = 2, AC0IS0 = 4, AC0IS1 = 5, AC0IE = 6, AC0EN = 7 };
+enum { AC1M0 = 0, AC1M1 = 1, AC1M2 = 2, AC1ICE = 3, AC1IS0 = 4, AC1IS1 = 5, AC1IE = 6, AC1EN = 7 };
+enum { AC2M0 = 0, AC2M1 = 1, AC2M2 = 2, AC2IS0 = 4, AC2IS1 = 5, AC2IE = 6, AC2EN = 7 };
+enum { AC3M0 = 0, AC3M1 = 1, AC3M2 = 2, AC3IS0 = 4, AC3IS1 = 5, AC3IE = 6, AC3EN = 7 };
+enum { AC0O = 0, AC1O = 1, AC2O = 2, AC3O = 3, AC0IF = 4, AC1IF = 5, AC2IF = 6, AC3IF = 7 };
+enum { SWRES = 0, ENASTB = 1, TEST = 2, LISTEN = 3, SYNTTC = 4, TTC = 5, OVRQ = 6, ABRQ = 7 };
+enum { ERRP = 0, BOFF = 1, ENFG = 2, RXBSY = 3, TXBSY = 4, OVFG = 6 };
+enum { AERG = 0, FERG = 1, CERG = 2, SERG = 3, BXOK = 4, OVRTIM = 5, BOFFIT = 6, CANIT = 7 };
+enum { ENOVRT = 0, ENERG = 1, ENBX = 2, ENERR = 3, ENTX = 4, ENRX = 5, ENBOFF = 6, ENIT = 7 };
+enum { ENMOB0, ENMOB1, ENMOB2, ENMOB3, ENMOB4, ENMOB5 };
+enum { IEMOB0, IEMOB1, IEMOB2, IEMOB3, IEMOB4, IEMOB5 };
+enum { SIT0, SIT1, SIT2, SIT3, SIT4, SIT5 };
+enum { BRP0 = 1, BRP1 = 2, BRP2 = 3, BRP3 = 4, BRP4 = 5, BRP5 = 6 };
+enum { PRS0 = 1, PRS1 = 2, PRS2 = 3, SJW0 = 5, SJW1 = 6 };
+enum { SMP = 0, PHS10 = 1, PHS11 = 2, PHS12 = 3, PHS20 = 4, PHS21 = 5, PHS22 = 6 };
+enum { CGP0 = 0, CGP1 = 1, CGP2 = 2, CGP3 = 3, HPMOB0 = 4, HPMOB1 = 5, HPMOB2 = 6, HPMOB3 = 7 };
+enum { INDX0 = 0, INDX1 = 1, INDX2 = 2, AINC = 3, MOBNB0 = 4, MOBNB1 = 5, MOBNB2 = 6, MOBNB3 = 7 };
+enum { AERR = 0, FERR = 1, CERR = 2, SERR = 3, BERR = 4, RXOK = 5, TXOK = 6, DLCW = 7 };
+enum { DLC0 = 0, DLC1 = 1, DLC2 = 2, DLC3 = 3, IDE = 4, RPLV = 5, CONMOB0 = 6, CONMOB1 = 7 };
+enum { RB0TAG = 0, RB1TAG = 1, RTRTAG = 2 };
+enum { IDEMSK = 0, RTRMSK = 2 };
+
+// Interrupt vectors, numbered as on the ATmega32M1
+#define ANACOMP0_vect		_VECTOR(1)
+#define ANACOMP1_vect		_VECTOR(2)
+#define ANACOMP2_vect		_VECTOR(3)
+#define ANACOMP3_vect		_VECTOR(4)
+#define PSC_FAULT_vect		_VECTOR(5)
+#define PSC_EC_vect			_VECTOR(6)
+#define INT0_vect			_VECTOR(7)
+#define INT1_vect			_VECTOR(8)
+#define INT2_vect			_VECTOR(9)
+#define INT3_vect			_VECTOR(10)
+#define TIMER1_CAPT_vect	_VECTOR(11)
+#define TIMER1_COMPA_vect	_VECTOR(12)
+#define TIMER1_COMPB_vect	_VECTOR(13)
+#define TIMER1_OVF_vect		_VECTOR(14)
+#define TIMER0_COMPA_vect	_VECTOR(15)
+#define TIMER0_COMPB_vect	_VECTOR(16)
+#define TIMER0_OVF_vect		_VECTOR(17)
+#define CAN_INT_vect		_VECTOR(18)
+#define CAN_TOVF_vect		_VECTOR(19)
+#define LIN_TC_vect			_VECTOR(20)
+#define LIN_ERR_vect		_VECTOR(21)
+#define PCINT0_vect			_VECTOR(22)
+#define PCINT1_vect			_VECTOR(23)
+#define PCINT2_vect			_VECTOR(24)
+#define PCINT3_vect			_VECTOR(25)
+#define SPI_STC_vect		_VECTOR(26)
+#define ADC_vect			_VECTOR(27)
+#define WDT_vect			_VECTOR(28)
+#define EE_READY_vect		_VECTOR(29)
+#define SPM_READY_vect		_VECTOR(30)
+#define _VECTORS_SIZE		31
+
+#endif // _HOST_IO_H_
@@ -0,0 +1,2028 @@
+/*
+ * sim.c - ATmega32M1 peripherals simulated on the host, for the LUR7 HAL.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file sim.c
+ * \ref sim runs the LUR7 HAL and the firmware on the host.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref sim.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \defgroup sim Host - ATmega32M1 simulation
+ * The firmware of a node is built for the host with the headers in host/ in
+ * place of avr-libc, the LUR7 HAL is used unchanged. Every register access
+ * goes through sim_reg(uint8_t), which lets \ref SIM_ACCESS_CLOCKS of
+ * simulated time pass, runs the peripherals up to then, takes pending interrupts
+ * and returns the register. The code in between accesses takes no time, so
+ * the simulated time is that of the hardware, not of the code.
+ *
+ * Registers are kept at their data addresses. A write is seen at the next
+ * access, when the register last accessed is compared with its old value, so
+ * writing a register with the value it already has does nothing, except for
+ * the interrupt flag registers, which read with a reserved bit set. Writing
+ * PINx toggles PORTx the same way. The MOb registers are paged from CANPAGE
+ * and CANMSG steps through the data as on the target.
+ *
+ * The simulated parts are:
+ * <ul> <li> the ports, inputs driven by \ref sim_set_input or pulled up,
+ * with pin change and external interrupts,
+ * <li> timer0 and timer1 in all modes, the PWM on OC1B is reported as a duty
+ * cycle,
+ * <li> the ADC, a conversion takes 13 ADC clocks,
+ * <li> the analog comparators, their outputs set by \ref sim_set_comparator,
+ * <li> the CAN controller with six MObs, its error counters and bus off, the
+ * bus is left to the harness, see \ref sim_can_pending, \ref sim_can_receive
+ * and \ref sim_can_error,
+ * <li> the SPI as master, a byte takes 8 SPI clocks and nothing answers, the
+ * byte received is 0xFF, see \ref spi_access for when SPDR is written. </ul>
+ *
+ * The firmware runs on its own stack and returns to the harness when the time
+ * given to \ref sim_run_until has passed, in the middle of any access. The
+ * harness changes inputs and delivers frames between runs.
+ *
+ * A main loop that only polls, each pass as the last, is not run pass by pass
+ * to the next event, the passes in between are skipped, see \ref idle_pass.
+ * The harness is told by \ref sim_idle, and may then leave the node to run
+ * up to its next event in one go.
+ *
+ * Even so every access costs a call and a run of the peripherals: a node
+ * alone runs about 100 to 500 times faster than real time on a desktop PC,
+ * the four nodes of test_host/car.txt together 15 to 20 times. That is short
+ * of the thousands of times asked of the host port, which would take a HAL
+ * of functions in place of the registers, and is not done.
+ *
+ * The register accesses made by each interrupt are counted, and by each
+ * function of the firmware built with -finstrument-functions, see
+ * \ref sim_isr_profile and \ref sim_functions. They are not the cycles the
+ * MCU takes, the code in between accesses is not counted, but they follow the
+ * I/O and the waiting of the firmware.
+ *
+ * \see \ref sim.h
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#undef _FORTIFY_SOURCE // its _longjmp refuses to switch to the stack of the firmware
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include <avr/io.h>
+#include "sim.h"
+
+//! Stack of the firmware.
+#define SIM_STACK		(256 * 1024)
+//! Reserved bit read as set in the interrupt flag registers, see \ref sim.
+#define FLAG_MARKER		0x80
+//! No event.
+#define NEVER			UINT64_MAX
+
+//! Data addresses of the registers.
+enum {
+	A_PINB = 0x23, A_PORTE = 0x2E,
+	A_TIFR0 = 0x35, A_TIFR1 = 0x36, A_PCIFR = 0x3B, A_EIFR = 0x3C, A_EIMSK = 0x3D,
+	A_TCCR0A = 0x44, A_TCCR0B = 0x45, A_TCNT0 = 0x46, A_OCR0A = 0x47, A_OCR0B = 0x48,
+	A_SPCR = 0x4C, A_SPSR = 0x4D, A_SPDR = 0x4E,
+	A_ACSR = 0x50, A_SREG = 0x5F,
+	A_PCICR = 0x68, A_EICRA = 0x69, A_PCMSK0 = 0x6A, A_PCMSK3 = 0x6D, A_TIMSK0 = 0x6E, A_TIMSK1 = 0x6F,
+	A_ADCL = 0x78, A_ADCH = 0x79, A_ADCSRA = 0x7A, A_ADMUX = 0x7C, A_DIDR0 = 0x7E,
+	A_TCCR1A = 0x80, A_TCCR1B = 0x81, A_TCCR1C = 0x82, A_TCNT1 = 0x84, A_ICR1 = 0x86,
+	A_OCR1A = 0x88, A_OCR1B = 0x8A,
+	A_AC0CON = 0x94,
+	A_CANGCON = 0xD8, A_CANGSTA = 0xD9, A_CANGIT = 0xDA, A_CANGIE = 0xDB, A_CANEN2 = 0xDC,
+	A_CANEN1 = 0xDD, A_CANIE2 = 0xDE, A_CANSIT2 = 0xE0, A_CANSIT1 = 0xE1,
+	A_CANBT1 = 0xE2, A_CANBT2 = 0xE3, A_CANBT3 = 0xE4, A_CANTEC = 0xEA, A_CANREC = 0xEB,
+	A_CANHPMOB = 0xEC, A_CANPAGE = 0xED, A_CANSTMOB = 0xEE, A_CANCDMOB = 0xEF,
+	A_CANIDT4 = 0xF0, A_CANIDM4 = 0xF4, A_CANSTM = 0xF8, A_CANMSG = 0xFA,
+};
+
+//! A timer, counting in ticks of the prescaled clock.
+typedef struct {
+	uint8_t tccra;	//!< Address of TCCRnA, the other registers follow from it.
+	uint8_t tifr;	//!< Address of TIFRn.
+	uint8_t wide;	//!< Whether the timer is 16 bit.
+	uint8_t dual;	//!< Whether the mode counts up and down.
+	uint8_t top_a;	//!< Whether OCRnA is TOP.
+	uint8_t top_icr;	//!< Whether ICR1 is TOP.
+	uint8_t tov_top;	//!< Whether TOV is set at TOP (fast PWM), otherwise at MAX.
+	uint32_t presc;	//!< Clocks per tick, 0 when stopped.
+	uint32_t top;	//!< TOP.
+	uint32_t len;	//!< Ticks in a full cycle of the counter.
+	uint64_t base;	//!< Clock at which \ref pos0 was counted.
+	uint64_t pos0;	//!< Tick at \ref base, counted from position 0.
+	uint64_t done;	//!< Last tick of which the flags have been set.
+	uint64_t next;	//!< Clock of the next flag, \ref NEVER if none.
+} sim_timer_t;
+
+//! A Message Object of the CAN controller.
+typedef struct {
+	uint8_t stmob;	//!< CANSTMOB.
+	uint8_t cdmob;	//!< CANCDMOB.
+	uint8_t idt[4];	//!< CANIDT4 - CANIDT1.
+	uint8_t idm[4];	//!< CANIDM4 - CANIDM1.
+	uint16_t stm;	//!< CANSTM.
+	uint8_t msg[8];	//!< Data, CANMSG.
+	uint8_t cd_old;	//!< CANCDMOB before the last access.
+	uint8_t enabled;	//!< Whether the MOb is enabled, CANEN.
+	uint8_t tx;		//!< Whether the MOb is enabled for transmission.
+} mob_t;
+
+//! Interrupt vectors, defined by the firmware with ISR().
+#define VECTOR(n) void __vector_ ## n(void) __attribute__((weak));
+VECTOR(1) VECTOR(2) VECTOR(3) VECTOR(4) VECTOR(5) VECTOR(6) VECTOR(7) VECTOR(8) VECTOR(9) VECTOR(10)
+VECTOR(11) VECTOR(12) VECTOR(13) VECTOR(14) VECTOR(15) VECTOR(16) VECTOR(17) VECTOR(18) VECTOR(19)
+VECTOR(20) VECTOR(21) VECTOR(22) VECTOR(23) VECTOR(24) VECTOR(25) VECTOR(26) VECTOR(27) VECTOR(28)
+VECTOR(29) VECTOR(30)
+#undef VECTOR
+
+static void (* const vectors[_VECTORS_SIZE])(void) = {
+	NULL, __vector_1, __vector_2, __vector_3, __vector_4, __vector_5, __vector_6, __vector_7,
+	__vector_8, __vector_9, __vector_10, __vector_11, __vector_12, __vector_13, __vector_14,
+	__vector_15, __vector_16, __vector_17, __vector_18, __vector_19, __vector_20, __vector_21,
+	__vector_22, __vector_23, __vector_24, __vector_25, __vector_26, __vector_27, __vector_28,
+	__vector_29, __vector_30,
+};
+
+//! The registers, as read by the firmware.
+static uint8_t io[256] __attribute__((aligned(2)));
+//! The registers as they were before the last access.
+static uint8_t old[256] __attribute__((aligned(2)));
+//! Address of the last access, compared at the next one.
+static uint8_t last = 0;
+
+//! Simulated time, clocks of \ref SIM_F_CPU.
+static uint64_t now = 0;
+//! Time to return to the harness, clocks.
+static uint64_t until = 0;
+//! Clock of the next peripheral event.
+static uint64_t next_event = NEVER;
+//! Number of register accesses.
+static uint64_t accesses = 0;
+//! Whether interrupts may have become pending since they were last looked for.
+static uint8_t irq_dirty = 1;
+
+//! Levels of the pins driven from outside, or pulled up.
+static uint8_t ext[4];
+//! Levels of the pins.
+static uint8_t levels[4];
+//! Half period of a square wave on each pin, clocks, 0 if none.
+static uint64_t square_half[32];
+//! Next edge of the square wave on each pin.
+static uint64_t square_next[32];
+//! Pins with a square wave, a bit each.
+static uint32_t squares = 0;
+
+static sim_timer_t timer0 = {.tccra = A_TCCR0A, .tifr = A_TIFR0, .wide = 0};
+static sim_timer_t timer1 = {.tccra = A_TCCR1A, .tifr = A_TIFR1, .wide = 1};
+//! Last PWM reported, duty and top.
+static uint32_t pwm_reported = UINT32_MAX;
+
+//! Values of the analog inputs, by channel of ADMUX.
+static uint16_t analog[32];
+//! End of the conversion running.
+static uint64_t adc_end = NEVER;
+//! End of the byte being sent on the SPI.
+static uint64_t spi_end = NEVER;
+//! Whether SPIF was set when SPDR was accessed last.
+static uint8_t spi_flagged = 0;
+//! Time of an access to SPDR that may have written the byte received, NEVER if none.
+static uint64_t spi_unsure = NEVER;
+
+static mob_t mob[6];
+//! Where accesses to the MOb registers go when CANPAGE selects no MOb.
+static mob_t no_mob;
+//! Transmit error counter, above 255 the controller is bus off.
+static uint16_t tec;
+//! Receive error counter.
+static uint8_t rec;
+//! When the controller recovers from bus off, NEVER if it is not bus off.
+static uint64_t boff_end = NEVER;
+
+static sim_callbacks_t cb;
+static int (*firmware)(void);
+//! Start of the firmware, only used to enter it the first time.
+static ucontext_t firmware_ctx;
+//! Where the harness runs the firmware, see \ref yield.
+static jmp_buf host_jmp;
+//! Where the firmware returned to the harness.
+static jmp_buf firmware_jmp;
+//! Whether the firmware is running, otherwise the harness.
+static uint8_t running = 0;
+//! Whether the firmware has been started.
+static uint8_t started = 0;
+
+static void advance(uint64_t);
+static void schedule(void);
+static void events(void);
+static inline void idle_reset(void);
+
+//! Helper macro, calls the harness back, to which the firmware is stopped meanwhile.
+#define CALLBACK(f, ...) do { \
+	uint8_t was_running = running; \
+	running = 0; \
+	cb.f(__VA_ARGS__); \
+	running = was_running; \
+} while (0)
+
+//! Helper function, converts time to clocks.
+static inline uint64_t clocks(uint64_t ns) {
+	return ns * (SIM_F_CPU / 1000000) / 1000;
+}
+
+//! Helper function, converts clocks to time.
+static inline uint64_t nanoseconds(uint64_t c) {
+	return c * 1000 / (SIM_F_CPU / 1000000);
+}
+
+//! Helper function, the hardware sets a register.
+static inline void hw_set(uint8_t a, uint8_t v) {
+	io[a] = v;
+	old[a] = v;
+}
+
+//! Helper function, the hardware sets a 16 bit register.
+static inline void hw_set16(uint8_t a, uint16_t v) {
+	hw_set(a, v & 0xFF);
+	hw_set(a + 1, v >> 8);
+}
+
+//! Helper function, the hardware sets interrupt flags.
+static inline void hw_flag(uint8_t a, uint8_t flags) {
+	hw_set(a, io[a] | flags);
+	irq_dirty = 1;
+}
+
+/*******************************************************************************
+ * ports
+ ******************************************************************************/
+
+//! Helper function, the pin of external interrupt \p n.
+static inline uint8_t int_pin(uint8_t n) {
+	static const uint8_t pins[4] = {0x16, 0x02, 0x05, 0x08}; // PD6, PB2, PB5, PC0
+	return pins[n];
+}
+
+//! Helper function, whether OC1B drives PC1.
+static inline uint8_t pwm_connected(void) {
+	return (io[A_TCCR1A] & (1 << COM1B1)) && (io[A_PINB + 3 + 1] & (1 << 1));
+}
+
+//! Works out the levels of all pins and what follows when they change.
+static void pins_update(void) {
+	for (uint8_t k = 0; k < 4; k++) {
+		uint8_t a = A_PINB + 3 * k;
+		uint8_t ddr = io[a + 1];
+		uint8_t level = (ddr & io[a + 2]) | (~ddr & ext[k]);
+		uint8_t change = level ^ levels[k];
+		levels[k] = level;
+		hw_set(a, level);
+		if (!change) {
+			continue;
+		}
+		idle_reset();
+		if (io[A_PCMSK0 + k] & change) {
+			hw_flag(A_PCIFR, 1 << k);
+		}
+		for (uint8_t n = 0; n < 4; n++) {
+			uint8_t pin = int_pin(n);
+			if ((pin >> 3) != k || !(change & (1 << (pin & 7)))) {
+				continue;
+			}
+			uint8_t isc = (io[A_EICRA] >> (2 * n)) & 3;
+			uint8_t high = (level >> (pin & 7)) & 1;
+			if (isc == 1 || (isc == 2 && !high) || (isc == 3 && high)) {
+				hw_flag(A_EIFR, 1 << n);
+			}
+		}
+		change &= ddr;
+		if (k == 1 && pwm_connected()) {
+			change &= ~(1 << 1);
+		}
+		for (uint8_t bit = 0; cb.pin && change; bit++, change >>= 1) {
+			if (change & 1) {
+				CALLBACK(pin, (k << 3) | bit, (level >> bit) & 1);
+			}
+		}
+		irq_dirty = 1;
+	}
+}
+
+//! Sets an input from outside.
+/*!
+ * \param code pin code, as IO_PIN_CODE.
+ * \param level 0 low, 1 high, -1 released, pulled up.
+ */
+void sim_set_input(uint8_t code, int8_t level) {
+	uint8_t k = code >> 3;
+	idle_reset();
+	square_half[code & 31] = 0;
+	squares &= ~(1UL << (code & 31));
+	if (level) {
+		ext[k] |= 1 << (code & 7);
+	} else {
+		ext[k] &= ~(1 << (code & 7));
+	}
+	pins_update();
+	schedule();
+}
+
+//! Drives an input with a square wave.
+/*!
+ * \param code pin code, as IO_PIN_CODE.
+ * \param half_period_ns time between edges, 0 stops the wave leaving the
+ * input where it is.
+ */
+void sim_set_square(uint8_t code, uint64_t half_period_ns) {
+	idle_reset();
+	square_half[code & 31] = clocks(half_period_ns);
+	square_next[code & 31] = now + square_half[code & 31];
+	if (square_half[code & 31]) {
+		squares |= 1UL << (code & 31);
+	} else {
+		squares &= ~(1UL << (code & 31));
+	}
+	schedule();
+}
+
+//! Gets the level of a pin.
+/*!
+ * \param code pin code, as IO_PIN_CODE.
+ * \return 1 high, 0 low.
+ */
+uint8_t sim_get_pin(uint8_t code) {
+	return (levels[code >> 3] >> (code & 7)) & 1;
+}
+
+//! Helper function, toggles the square waves due.
+static void square_edges(void) {
+	for (uint32_t m = squares; m; m &= m - 1) {
+		uint8_t i = __builtin_ctzl(m);
+		if (square_next[i] <= now) {
+			ext[i >> 3] ^= 1 << (i & 7);
+			square_next[i] += square_half[i];
+		}
+	}
+	pins_update();
+}
+
+/*******************************************************************************
+ * timers
+ ******************************************************************************/
+
+//! Helper function, the current tick of a timer.
+static uint64_t timer_tick(const sim_timer_t * t) {
+	if (!t->presc) {
+		return t->pos0;
+	}
+	return t->pos0 + (now - t->base) / t->presc;
+}
+
+//! Helper function, the value of TCNTn at a position.
+static uint32_t timer_count(const sim_timer_t * t, uint32_t pos) {
+	if (t->dual && pos > t->top) {
+		return t->len - pos;
+	}
+	return pos;
+}
+
+//! Helper function, the flags set when a timer reaches \p pos.
+static uint8_t timer_flags_at(const sim_timer_t * t, uint32_t pos) {
+	uint8_t a = t->tccra;
+	uint32_t ocra = t->wide ? (io[a + 8] | (io[a + 9] << 8)) : io[a + 3];
+	uint32_t ocrb = t->wide ? (io[a + 10] | (io[a + 11] << 8)) : io[a + 4];
+	uint32_t count = timer_count(t, pos);
+	uint8_t flags = 0;
+	if (t->dual) {
+		if (count == 0) {
+			flags |= 1 << TOV1;
+		}
+		if (pos == t->top && t->top_icr) {
+			flags |= 1 << ICF1;
+		}
+	} else {
+		if (t->tov_top ? count == t->top : (count == 0 && t->top == (t->wide ? 0xFFFFu : 0xFFu))) {
+			flags |= 1 << TOV1;
+		}
+		if (count == t->top && t->top_icr) {
+			flags |= 1 << ICF1;
+		}
+	}
+	if (t->top_a ? count == t->top : count == ocra) {
+		flags |= 1 << OCF1A;
+	}
+	if (count == ocrb) {
+		flags |= 1 << OCF1B;
+	}
+	return flags;
+}
+
+//! Helper function, finds the next flag of a timer.
+/*!
+ * Only the positions where a flag may be set are looked at: BOTTOM, TOP and
+ * the compare values, on the way up and down.
+ */
+static void timer_next(sim_timer_t * t) {
+	t->next = NEVER;
+	if (!t->presc) {
+		return;
+	}
+	uint8_t a = t->tccra;
+	uint32_t ocra = t->wide ? (io[a + 8] | (io[a + 9] << 8)) : io[a + 3];
+	uint32_t ocrb = t->wide ? (io[a + 10] | (io[a + 11] << 8)) : io[a + 4];
+	uint32_t candidates[6] = {0, t->top, ocra, ocrb, t->len - ocra, t->len - ocrb};
+	uint32_t at = t->done % t->len;
+	uint64_t best = UINT64_MAX;
+	for (uint8_t i = 0; i < 6; i++) {
+		uint32_t pos = candidates[i];
+		if (pos >= t->len || !timer_flags_at(t, pos)) {
+			continue;
+		}
+		uint64_t delta = (pos + t->len - at) % t->len;
+		if (!delta) {
+			delta = t->len;
+		}
+		if (delta < best) {
+			best = delta;
+		}
+	}
+	if (best != UINT64_MAX) {
+		t->next = t->base + (t->done + best - t->pos0) * t->presc;
+	}
+}
+
+//! Helper function, the timer is set up again after a register was written.
+/*!
+ * \param t the timer.
+ * \param count the value written to TCNTn, -1 if it was not written.
+ */
+static void timer_config(sim_timer_t * t, int32_t count) {
+	uint32_t pos = timer_tick(t) % (t->len ? t->len : 1);
+	uint8_t a = t->tccra;
+	uint8_t wgm;
+	uint8_t cs = io[a + 1] & 7;
+	static const uint16_t prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+	t->dual = t->top_a = t->top_icr = t->tov_top = 0;
+	if (t->wide) {
+		static const uint16_t tops[16] = {0xFFFF, 0xFF, 0x1FF, 0x3FF, 0, 0xFF, 0x1FF, 0x3FF,
+			0, 0, 0, 0, 0, 0xFFFF, 0, 0};
+		wgm = (io[a] & 3) | ((io[a + 1] >> 1) & 0x0C);
+		t->top = tops[wgm];
+		t->dual = (wgm >= 1 && wgm <= 3) || (wgm >= 8 && wgm <= 11);
+		t->top_a = (wgm == 4 || wgm == 9 || wgm == 11 || wgm == 15);
+		t->top_icr = (wgm == 8 || wgm == 10 || wgm == 12 || wgm == 14);
+		t->tov_top = (wgm >= 5 && wgm <= 7) || wgm == 14 || wgm == 15;
+		if (t->top_a) {
+			t->top = io[A_OCR1A] | (io[A_OCR1A + 1] << 8);
+		} else if (t->top_icr) {
+			t->top = io[A_ICR1] | (io[A_ICR1 + 1] << 8);
+		}
+	} else {
+		wgm = (io[a] & 3) | ((io[a + 1] >> 1) & 0x04);
+		t->top = 0xFF;
+		t->dual = (wgm == 1 || wgm == 5);
+		t->top_a = (wgm == 2 || wgm == 5 || wgm == 7);
+		t->tov_top = (wgm == 3 || wgm == 7);
+		if (t->top_a) {
+			t->top = io[A_OCR0A];
+		}
+	}
+	t->len = t->dual ? 2 * t->top : t->top + 1;
+	if (!t->len) {
+		t->len = 1;
+	}
+	if (count >= 0) {
+		pos = count;
+	}
+	if (pos >= t->len) {
+		pos = 0; // beyond a new TOP, the counter wraps
+	}
+	t->presc = prescalers[cs];
+	t->base = now;
+	t->pos0 = pos;
+	t->done = pos;
+	timer_next(t);
+	schedule();
+}
+
+//! Helper function, sets the flags of a timer that are due.
+static void timer_event(sim_timer_t * t) {
+	uint8_t flags = io[t->tifr];
+	while (t->next <= now) {
+		uint64_t tick = t->pos0 + (t->next - t->base) / t->presc;
+		hw_flag(t->tifr, timer_flags_at(t, tick % t->len));
+		t->done = tick;
+		timer_next(t);
+	}
+	if (io[t->tifr] != flags) { // the main loop may see them
+		idle_reset();
+	}
+}
+
+//! Helper function, reports the PWM on OC1B when it changes.
+static void pwm_update(void) {
+	uint32_t top = pwm_connected() ? timer1.top : 0;
+	uint32_t duty = io[A_OCR1B] | (io[A_OCR1B + 1] << 8);
+	if (duty > top) {
+		duty = top;
+	}
+	if (((top << 16) | duty) != pwm_reported) {
+		pwm_reported = (top << 16) | duty;
+		if (cb.pwm) {
+			CALLBACK(pwm, duty, top);
+		}
+	}
+}
+
+/*******************************************************************************
+ * ADC and analog comparators
+ ******************************************************************************/
+
+//! Sets the value of an analog input.
+/*!
+ * \param channel the channel, as selected by ADMUX.
+ * \param value 0 - 1023.
+ */
+void sim_set_analog(uint8_t channel, uint16_t value) {
+	idle_reset();
+	analog[channel & 31] = value & 0x3FF;
+}
+
+//! Helper function, a conversion has ended.
+static void adc_done(void) {
+	uint16_t value = analog[io[A_ADMUX] & 0x1F];
+	if (io[A_ADMUX] & (1 << ADLAR)) {
+		value <<= 6;
+	}
+	hw_set16(A_ADCL, value);
+	hw_set(A_ADCSRA, io[A_ADCSRA] & ~(1 << ADSC));
+	hw_flag(A_ADCSRA, 1 << ADIF);
+	adc_end = NEVER;
+}
+
+//! Helper function, ADCSRA was written.
+static void adc_write(void) {
+	uint8_t v = io[A_ADCSRA];
+	uint8_t flag = old[A_ADCSRA] & (1 << ADIF) & ~v; // cleared by writing one
+	if (!(v & (1 << ADEN))) {
+		adc_end = NEVER;
+		v &= ~(1 << ADSC);
+	} else if ((v & (1 << ADSC)) && adc_end == NEVER) {
+		uint8_t ps = v & 7;
+		adc_end = now + 13 * (ps ? 1u << ps : 2);
+	} else if (adc_end != NEVER) {
+		v |= 1 << ADSC;
+	}
+	hw_set(A_ADCSRA, (v & ~(1 << ADIF)) | flag);
+	schedule();
+}
+
+//! Sets the output of an analog comparator.
+/*!
+ * \param n the comparator, 0 - 3.
+ * \param out the output, 1 when the positive input is higher.
+ */
+void sim_set_comparator(uint8_t n, uint8_t out) {
+	uint8_t acsr = io[A_ACSR];
+	if (((acsr >> n) & 1) == !!out) {
+		return;
+	}
+	acsr ^= 1 << n;
+	idle_reset();
+	uint8_t con = io[A_AC0CON + n];
+	uint8_t is = (con >> 4) & 3;
+	if ((con & (1 << AC2EN)) && (is == 0 || (is == 2 && !out) || (is == 3 && out))) {
+		acsr |= 1 << (4 + n);
+	}
+	hw_set(A_ACSR, acsr);
+	irq_dirty = 1;
+}
+
+/*******************************************************************************
+ * SPI
+ ******************************************************************************/
+
+//! Helper function, the byte on the SPI has been sent.
+static void spi_done(void) {
+	hw_set(A_SPDR, 0xFF); // nothing on MISO
+	hw_flag(A_SPSR, 1 << SPIF);
+	spi_end = NEVER;
+}
+
+//! Helper function, SPDR was written.
+/*!
+ * \param t when, the byte is sent from then on.
+ */
+static void spi_write(uint64_t t) {
+	static const uint8_t div[4] = {4, 16, 64, 128};
+	uint8_t spcr = io[A_SPCR];
+	if (!(spcr & (1 << SPE)) || !(spcr & (1 << MSTR))) {
+		return;
+	}
+	if (spi_end != NEVER) {
+		hw_set(A_SPSR, io[A_SPSR] | (1 << WCOL)); // the byte being sent goes on
+		return;
+	}
+	spi_end = t + ((8 * div[spcr & 3]) >> (io[A_SPSR] & (1 << SPI2X)));
+	schedule();
+}
+
+//! Helper function, SPDR was accessed.
+/*!
+ * A write is told from a read by the value changing, which it does not when
+ * the byte received, 0xFF, is sent, eg. by SPI_receive. Such an access is a
+ * write if the SPI is idle and SPIF was clear, or the interrupt is enabled, as
+ * the byte read would be stale. Right after a byte it is a read, unless SPSR
+ * is polled next with nothing to wait for, see \ref spi_poll.
+ */
+static void spi_access(void) {
+	if (io[A_SPDR] != old[A_SPDR]) {
+		old[A_SPDR] = io[A_SPDR];
+		spi_write(now);
+	} else if (spi_end == NEVER) {
+		if (!spi_flagged || (io[A_SPCR] & (1 << SPIE))) {
+			spi_write(now);
+		} else {
+			spi_unsure = now;
+		}
+	}
+}
+
+//! Helper function, a register is accessed after an access to SPDR that may have been a write.
+/*!
+ * SPSR polled for SPIF with the SPI idle, the access was a write.
+ *
+ * \param a the address.
+ */
+static void spi_poll(uint8_t a) {
+	if (a == A_SPSR && spi_end == NEVER && !(io[A_SPSR] & (1 << SPIF))) {
+		spi_write(spi_unsure);
+		if (spi_end <= now) {
+			events();
+		}
+	}
+	spi_unsure = NEVER;
+}
+
+/*******************************************************************************
+ * CAN
+ ******************************************************************************/
+
+//! Helper function, the MOb selected by CANPAGE.
+static inline mob_t * page(void) {
+	uint8_t n = io[A_CANPAGE] >> 4;
+	return n < 6 ? &mob[n] : &no_mob;
+}
+
+//! Helper function, the identifier of a MOb, in CANIDT or CANIDM layout.
+static inline uint32_t mob_id(const uint8_t * r) {
+	return ((uint32_t) r[0] >> 3) | ((uint32_t) r[1] << 5) | ((uint32_t) r[2] << 13) | ((uint32_t) r[3] << 21);
+}
+
+//! Helper function, whether a MOb has an interrupt.
+static inline uint8_t mob_interrupt(const mob_t * m) {
+	uint8_t gie = io[A_CANGIE];
+	uint8_t s = m->stmob;
+	return ((s & (1 << RXOK)) && (gie & (1 << ENRX))) || ((s & (1 << TXOK)) && (gie & (1 << ENTX)))
+		|| ((s & 0x1F) && (gie & (1 << ENERR)));
+}
+
+//! Helper function, whether the controller takes part in the bus.
+/*!
+ * Bus off ends after 128 times 11 recessive bits, taken as that time here.
+ */
+static uint8_t can_on(void) {
+	if (boff_end != NEVER && now >= boff_end) {
+		boff_end = NEVER;
+		tec = 0;
+		rec = 0;
+	}
+	return (io[A_CANGCON] & (1 << ENASTB)) && boff_end == NEVER;
+}
+
+//! Helper function, updates the CAN status registers.
+static void can_status(void) {
+	uint8_t en = 0;
+	uint8_t sit = 0;
+	for (uint8_t i = 0; i < 6; i++) {
+		if (mob[i].enabled) {
+			en |= 1 << i;
+		}
+		if ((mob[i].stmob & 0x7F) && (io[A_CANIE2] & (1 << i))) {
+			sit |= 1 << i;
+		}
+	}
+	uint8_t hp = 0xF0;
+	for (uint8_t i = 0; i < 6; i++) {
+		if (sit & (1 << i)) {
+			hp = i << 4;
+			break;
+		}
+	}
+	hw_set(A_CANEN2, en);
+	hw_set(A_CANEN1, 0);
+	hw_set(A_CANSIT2, sit);
+	hw_set(A_CANSIT1, 0);
+	hw_set(A_CANHPMOB, hp);
+	hw_set(A_CANGIT, (io[A_CANGIT] & 0x7F) | (sit || (io[A_CANGIT] & 0x7F) ? 1 << CANIT : 0));
+	hw_set(A_CANGSTA, (can_on() ? 1 << ENFG : 0) | (boff_end != NEVER ? 1 << BOFF : 0)
+			| (tec >= 128 || rec >= 128 ? 1 << ERRP : 0));
+	hw_set(A_CANTEC, tec > 255 ? 255 : tec);
+	hw_set(A_CANREC, rec);
+}
+
+//! Helper function, whether the CAN interrupt is pending, it is a level.
+static uint8_t can_irq(void) {
+	uint8_t gie = io[A_CANGIE];
+	uint8_t git = io[A_CANGIT];
+	if (!(gie & (1 << ENIT))) {
+		return 0;
+	}
+	if (((git & (1 << BOFFIT)) && (gie & (1 << ENBOFF))) || ((git & 0x0F) && (gie & (1 << ENERG)))) {
+		return 1;
+	}
+	for (uint8_t i = 0; i < 6; i++) {
+		if ((io[A_CANIE2] & (1 << i)) && mob_interrupt(&mob[i])) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//! Helper function, CANGCON was written.
+static void can_write_gcon(void) {
+	if (io[A_CANGCON] & (1 << SWRES)) { // reset, the MObs keep their contents but are disabled
+		for (uint8_t i = 0; i < 6; i++) {
+			mob[i].enabled = 0;
+		}
+		for (uint8_t a = A_CANGCON; a <= A_CANBT3; a++) {
+			hw_set(a, 0);
+		}
+		tec = 0;
+		rec = 0;
+		boff_end = NEVER;
+	}
+	can_status();
+}
+
+//! Helper function, CANCDMOB was written, a change of CONMOB enables or disables the MOb.
+static void can_write_cdmob(mob_t * m) {
+	uint8_t conmob = m->cdmob >> CONMOB0;
+	if (conmob != (m->cd_old >> CONMOB0)) {
+		m->enabled = (conmob != 0);
+		m->tx = (conmob == 1);
+		if (m->tx && cb.can_request) {
+			CALLBACK(can_request);
+		}
+	}
+	m->cd_old = m->cdmob;
+	irq_dirty = 1;
+}
+
+//! Helper function, the MOb that transmits next, if any.
+static mob_t * can_tx_mob(void) {
+	if (!can_on()) {
+		return NULL;
+	}
+	for (uint8_t i = 0; i < 6; i++) { // lowest MOb first
+		if (mob[i].enabled && mob[i].tx) {
+			return &mob[i];
+		}
+	}
+	return NULL;
+}
+
+//! Gets the frame the node wants to transmit.
+/*!
+ * \param frame where the frame is put.
+ * \return 1 if there is a frame, 0 if not.
+ */
+uint8_t sim_can_pending(sim_frame_t * frame) {
+	mob_t * m = can_tx_mob();
+	if (!m) {
+		return 0;
+	}
+	frame->id = mob_id(m->idt);
+	frame->dlc = (m->cdmob & 0x0F) > 8 ? 8 : (m->cdmob & 0x0F);
+	memcpy(frame->data, m->msg, 8);
+	return 1;
+}
+
+//! The frame of \ref sim_can_pending has been sent.
+void sim_can_transmitted(void) {
+	mob_t * m = can_tx_mob();
+	idle_reset();
+	if (m) {
+		m->stmob |= 1 << TXOK;
+		m->enabled = 0;
+		irq_dirty = 1;
+	}
+	if (tec) {
+		tec--;
+	}
+}
+
+//! A frame has been sent on the bus by another node.
+/*!
+ * It is taken by the lowest enabled receiving MOb that matches it.
+ *
+ * \param frame the frame.
+ * \return 1 if a MOb took the frame, 0 if it was not received.
+ */
+uint8_t sim_can_receive(const sim_frame_t * frame) {
+	if (!can_on()) {
+		return 0;
+	}
+	if (rec) {
+		rec--;
+		idle_reset();
+	}
+	for (uint8_t i = 0; i < 6; i++) {
+		mob_t * m = &mob[i];
+		if (!m->enabled || m->tx) {
+			continue;
+		}
+		if ((frame->id ^ mob_id(m->idt)) & mob_id(m->idm)) {
+			continue;
+		}
+		if ((m->idm[0] & (1 << IDEMSK)) && !(m->cdmob & (1 << IDE))) {
+			continue; // standard frames only
+		}
+		if ((m->idm[0] & (1 << RTRMSK)) && (m->idt[0] & (1 << RTRTAG))) {
+			continue; // remote frames only
+		}
+		uint32_t id = frame->id << 3;
+		memcpy(m->idt, &id, 4); // little endian, CANIDT4 first
+		memcpy(m->msg, frame->data, 8);
+		if ((m->cdmob & 0x0F) != frame->dlc) {
+			m->stmob |= 1 << DLCW;
+		}
+		m->cdmob = (m->cdmob & 0xF0) | frame->dlc;
+		m->cd_old = m->cdmob;
+		m->stmob |= 1 << RXOK;
+		m->enabled = 0;
+		irq_dirty = 1;
+		idle_reset();
+		return 1;
+	}
+	return 0;
+}
+
+//! The frame on the bus was destroyed by an error frame.
+/*!
+ * The transmitter flags a bit error in its MOb, which is sent again, and adds
+ * 8 to its transmit error counter, a receiver flags a CRC error in CANGIT and
+ * adds 1 to its receive error counter. Above 127 the controller is error
+ * passive, a transmit error counter above 255 turns it bus off.
+ *
+ * \param transmitter whether this node sent the frame.
+ */
+void sim_can_error(uint8_t transmitter) {
+	if (!can_on()) {
+		return;
+	}
+	idle_reset();
+	if (transmitter) {
+		mob_t * m = can_tx_mob();
+		if (m) {
+			m->stmob |= 1 << BERR;
+		}
+		tec += 8;
+		if (tec > 255) {
+			boff_end = now + clocks(128 * 11 * sim_can_bit_ns());
+			hw_set(A_CANGIT, io[A_CANGIT] | (1 << BOFFIT));
+		}
+	} else {
+		if (rec < 255) {
+			rec++;
+		}
+		hw_set(A_CANGIT, io[A_CANGIT] | (1 << CERG));
+	}
+	can_status();
+	irq_dirty = 1;
+}
+
+//! Whether the controller is enabled and not bus off.
+uint8_t sim_can_active(void) {
+	return can_on();
+}
+
+//! Length of a bit on the bus, as set in CANBT1 - CANBT3.
+/*!
+ * \return time of a bit, ns.
+ */
+uint64_t sim_can_bit_ns(void) {
+	uint32_t brp = (io[A_CANBT1] >> 1) & 0x3F;
+	uint32_t prs = (io[A_CANBT2] >> 1) & 7;
+	uint32_t phs1 = (io[A_CANBT3] >> 1) & 7;
+	uint32_t phs2 = (io[A_CANBT3] >> 4) & 7;
+	return nanoseconds((brp + 1) * (prs + phs1 + phs2 + 4));
+}
+
+//! Length of a frame on the bus.
+/*!
+ * The bits from SOF to the CRC are stuffed, a bit of opposite level after five
+ * of the same, followed by 13 bits of delimiters, ACK, EOF and interframe space.
+ *
+ * \param frame the frame.
+ * \return the number of bits.
+ */
+uint16_t sim_can_bits(const sim_frame_t * frame) {
+	uint8_t bits[160];
+	uint16_t n = 0;
+	uint8_t dlc = frame->dlc > 8 ? 8 : frame->dlc;
+	bits[n++] = 0; // SOF
+	for (int8_t i = 28; i >= 18; i--) {
+		bits[n++] = (frame->id >> i) & 1;
+	}
+	bits[n++] = 1; // SRR
+	bits[n++] = 1; // IDE
+	for (int8_t i = 17; i >= 0; i--) {
+		bits[n++] = (frame->id >> i) & 1;
+	}
+	bits[n++] = 0; // RTR
+	bits[n++] = 0; // r1
+	bits[n++] = 0; // r0
+	for (int8_t i = 3; i >= 0; i--) {
+		bits[n++] = (frame->dlc >> i) & 1;
+	}
+	for (uint8_t b = 0; b < dlc; b++) {
+		for (int8_t i = 7; i >= 0; i--) {
+			bits[n++] = (frame->data[b] >> i) & 1;
+		}
+	}
+	uint16_t crc = 0;
+	for (uint16_t i = 0; i < n; i++) {
+		uint8_t next = bits[i] ^ ((crc >> 14) & 1);
+		crc = (crc << 1) & 0x7FFF;
+		if (next) {
+			crc ^= 0x4599;
+		}
+	}
+	for (int8_t i = 14; i >= 0; i--) {
+		bits[n++] = (crc >> i) & 1;
+	}
+	uint16_t stuffed = 0;
+	uint8_t run = 0;
+	uint8_t level = 2;
+	for (uint16_t i = 0; i < n; i++) {
+		if (bits[i] == level) {
+			run++;
+		} else {
+			level = bits[i];
+			run = 1;
+		}
+		if (run == 5) {
+			stuffed++;
+			level = !level; // the stuff bit starts a new run
+			run = 1;
+		}
+	}
+	return n + stuffed + 13;
+}
+
+/*******************************************************************************
+ * profile
+ ******************************************************************************/
+
+//! Functions of the firmware profiled, a hash table by address.
+#define PROFILE_FUNCTIONS	1024
+//! Calls from main profiled.
+#define PROFILE_SITES		64
+//! Calls deep enough to profile.
+#define PROFILE_DEPTH		64
+
+//! Interrupts taken, by vector.
+static sim_profile_t isr_profile[_VECTORS_SIZE];
+//! Clocks spent in each interrupt, see \ref sim_isr_ns.
+static uint64_t isr_clocks[_VECTORS_SIZE];
+//! Interrupts running, nested.
+static uint8_t isr_depth;
+//! Register accesses in interrupts taken at each depth.
+static uint64_t isr_accesses[8];
+static sim_function_t functions[PROFILE_FUNCTIONS];
+//! Calls not returned from.
+static struct {
+	sim_function_t * f;
+	uint64_t start;		//!< \ref accesses at the call.
+	uint64_t isr_start;	//!< \ref isr_accesses at the depth of the call, then.
+	uint8_t isr_depth;
+} calls[PROFILE_DEPTH];
+//! Depth of \ref calls, may be beyond PROFILE_DEPTH.
+static uint16_t depth;
+//! Calls made by main outside interrupts, by where they are made.
+static struct {
+	void * site;
+	void * fn;
+	sim_profile_t period;	//!< Between calls.
+	uint64_t last;		//!< \ref accesses at the last call.
+} sites[PROFILE_SITES];
+static uint8_t n_sites;
+
+//! Helper function, counts the register accesses of an interrupt or a call.
+static void count_accesses(sim_profile_t * c, uint64_t n) {
+	c->count++;
+	c->accesses += n;
+	if (n > c->max) {
+		c->max = n;
+	}
+}
+
+//! Helper function, the entry of a function, added if missing.
+static sim_function_t * function(void * fn) {
+	uint16_t i = ((uintptr_t) fn >> 2) % PROFILE_FUNCTIONS;
+	for (uint16_t n = 0; n < PROFILE_FUNCTIONS; n++, i = (i + 1) % PROFILE_FUNCTIONS) {
+		if (functions[i].fn == fn || !functions[i].fn) {
+			functions[i].fn = fn;
+			return &functions[i];
+		}
+	}
+	return NULL;
+}
+
+//! Called on entry to each function of the firmware built with -finstrument-functions.
+void __cyg_profile_func_enter(void * fn, void * site) __attribute__((no_instrument_function));
+void __cyg_profile_func_enter(void * fn, void * site) {
+	if (depth < PROFILE_DEPTH) {
+		sim_function_t * f = function(fn);
+		calls[depth].f = f;
+		calls[depth].start = accesses;
+		calls[depth].isr_start = isr_accesses[isr_depth];
+		calls[depth].isr_depth = isr_depth;
+		if (depth && !isr_depth && calls[depth - 1].f && calls[depth - 1].f->fn == *(void **) &firmware) {
+			uint8_t i;
+			for (i = 0; i < n_sites && sites[i].site != site; i++);
+			if (i == n_sites && n_sites < PROFILE_SITES) {
+				sites[n_sites].site = site;
+				sites[n_sites++].fn = fn;
+			} else if (i < n_sites) {
+				count_accesses(&sites[i].period, accesses - sites[i].last);
+			}
+			sites[i].last = accesses;
+		}
+	}
+	depth++;
+}
+
+//! Called on return from each function of the firmware built with -finstrument-functions.
+void __cyg_profile_func_exit(void * fn, void * site) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void * fn, void * site) {
+	(void) fn;
+	(void) site;
+	if (depth && --depth < PROFILE_DEPTH && calls[depth].f) {
+		uint64_t interrupted = isr_accesses[calls[depth].isr_depth] - calls[depth].isr_start;
+		count_accesses(&calls[depth].f->run, accesses - calls[depth].start - interrupted);
+	}
+}
+
+//! Register accesses made by an interrupt.
+/*!
+ * From the interrupt being taken to its return, and by any interrupt nested
+ * in it. The code between the accesses is not counted, the cost of an
+ * interrupt on the MCU cannot be told from them, only how much I/O it does
+ * and how long it polls.
+ *
+ * \param vector as _VECTOR(n).
+ * \return the accesses, NULL if there is no such vector.
+ */
+const sim_profile_t * sim_isr_profile(uint8_t vector) {
+	return vector < _VECTORS_SIZE ? &isr_profile[vector] : NULL;
+}
+
+//! Simulated time spent in an interrupt.
+/*!
+ * From the interrupt being taken to its return, nested interrupts included.
+ * It is the time of \ref SIM_ACCESS_CLOCKS per access and of the waits for
+ * the hardware, eg. for SPIF, so it tells the cost of an interrupt that
+ * mostly waits, not of one that computes.
+ *
+ * \param vector as _VECTOR(n).
+ * \return ns, 0 if there is no such vector.
+ */
+uint64_t sim_isr_ns(uint8_t vector) {
+	return vector < _VECTORS_SIZE ? nanoseconds(isr_clocks[vector]) : 0;
+}
+
+//! Register accesses made by the functions of the firmware.
+/*!
+ * Only the functions built with -finstrument-functions are counted, from
+ * call to return, interrupts taken meanwhile excluded.
+ *
+ * \param n where the size of the table is put.
+ * \return the table, entries with no function are empty.
+ */
+const sim_function_t * sim_functions(uint16_t * n) {
+	*n = PROFILE_FUNCTIONS;
+	return functions;
+}
+
+//! Register accesses made by a pass of the main loop.
+/*!
+ * The accesses between calls made by main outside interrupts, main built with
+ * -finstrument-functions, at the place where most calls are made. A call made
+ * in every pass of the loop is made there, so they are those of a pass,
+ * interrupts included. Passes skipped, see \ref idle_skip, are not counted.
+ *
+ * \param fn where the function called there is put.
+ * \return the accesses, NULL if main made no calls.
+ */
+const sim_profile_t * sim_main_loop(void ** fn) {
+	int16_t best = -1;
+	for (uint8_t i = 0; i < n_sites; i++) {
+		if (best < 0 || sites[i].period.count > sites[best].period.count) {
+			best = i;
+		}
+	}
+	if (best < 0) {
+		return NULL;
+	}
+	*fn = sites[best].fn;
+	return &sites[best].period;
+}
+
+/*******************************************************************************
+ * idle
+ ******************************************************************************/
+
+//! Accesses after which a part of a pass that has not ended is given up, see \ref idle_pass.
+#define IDLE_GIVE_UP		4096
+//! Parts of passes remembered, a pass of the main loop is at most half as many.
+#define IDLE_PARTS		16
+//! Start of the hash of a part, FNV-1a.
+#define IDLE_HASH		14695981039346656037ULL
+
+//! The main loop, to skip the time it only polls.
+/*!
+ * A pass of the loop is cut into parts where the first access after
+ * \ref idle_reset was made, the same place may be passed several times in a
+ * pass, by a function called more than once.
+ */
+static struct {
+	void * site;		//!< Where a part begins, NULL when it is to be found.
+	uint8_t reg;		//!< Register accessed there.
+	uint64_t start;		//!< Clock at which the part began.
+	uint64_t hash;		//!< Of the accesses of the part so far, addresses and values.
+	uint16_t accesses;	//!< In the part so far.
+	uint64_t hashes[IDLE_PARTS];	//!< Of the last parts, \ref parts the next.
+	uint64_t lens[IDLE_PARTS];	//!< Clocks of the last parts.
+	uint16_t parts;		//!< Parts since \ref idle_reset.
+	uint8_t cut;		//!< Whether the part running was cut by \ref idle_reset, it is not kept.
+	uint8_t period;		//!< Parts in a pass once passes repeat, 0 if they do not.
+	uint64_t len;		//!< Clocks of a pass once passes repeat.
+	uint64_t resume;	//!< Clock from which passes are skipped again at any access, see \ref idle_skip.
+	uint64_t pass_hashes[IDLE_PARTS / 2];	//!< Of the parts of the last pass that repeated.
+	uint64_t pass_lens[IDLE_PARTS / 2];	//!< Clocks of its parts.
+	uint8_t pass_parts;	//!< Parts of the pass, 0 if none has repeated.
+} idle;
+
+//! Clocks skipped, see \ref sim_skipped.
+static uint64_t skipped = 0;
+
+//! Helper function, something happened that the main loop may see, passes are compared anew.
+static inline void idle_reset(void) {
+	idle.parts = 0;
+	idle.cut = 1;
+	idle.period = 0;
+}
+
+//! Helper function, the first event the main loop does not bring about itself.
+/*!
+ * The timers, the SPI, square waves and the end of bus off. A conversion of
+ * the ADC is started by the loop, it is moved along with it.
+ */
+static uint64_t idle_limit(void) {
+	uint64_t t = timer0.next < timer1.next ? timer0.next : timer1.next;
+	if (spi_end < t) {
+		t = spi_end; // a byte sent by an interrupt
+	}
+	for (uint32_t m = squares; m; m &= m - 1) {
+		uint8_t i = __builtin_ctzl(m);
+		if (square_next[i] < t) {
+			t = square_next[i];
+		}
+	}
+	return boff_end < t ? boff_end : t;
+}
+
+//! Helper function, skips passes of the main loop alike the last one.
+/*!
+ * As many whole passes as end before the next event or the time of
+ * \ref sim_run_until are taken to have been run, as they would have done the
+ * same. Their register accesses are not counted, see \ref sim_accesses and
+ * \ref sim_functions.
+ *
+ * An event the main loop cannot see, a timer flag already set, does not
+ * change the passes, they are skipped again from the next access on, wherever
+ * in the pass it is, and so after a return to the harness. The end of bus off
+ * is only seen at the end of a pass.
+ *
+ * \param len clocks of a pass.
+ */
+static void idle_skip(uint64_t len) {
+	uint64_t limit = idle_limit();
+	if (until < limit) {
+		limit = until;
+	}
+	idle.len = len;
+	idle.resume = limit == boff_end ? NEVER : limit;
+	if (limit <= now) {
+		return;
+	}
+	uint64_t c = (limit - now) / len * len;
+	if (!c) {
+		return;
+	}
+	now += c;
+	skipped += c;
+	idle.start += c;
+	if (adc_end != NEVER) {
+		adc_end += c;
+	}
+	schedule();
+}
+
+//! Helper function, whether the last \p m parts are the same as the \p m before them.
+/*!
+ * \return the clocks of the \p m parts, 0 if they are not the same.
+ */
+static uint64_t idle_repeated(uint8_t m) {
+	uint64_t len = 0;
+	for (uint8_t i = 0; i < m; i++) {
+		uint8_t x = (idle.parts - 1 - i) % IDLE_PARTS;
+		uint8_t y = (idle.parts - 1 - m - i) % IDLE_PARTS;
+		if (idle.hashes[x] != idle.hashes[y] || idle.lens[x] != idle.lens[y]) {
+			return 0;
+		}
+		len += idle.lens[x];
+	}
+	return len;
+}
+
+//! Helper function, whether the last parts are the pass that last repeated, from any of its parts on.
+/*!
+ * \return the clocks of the pass, 0 if they are not the same.
+ */
+static uint64_t idle_as_before(void) {
+	uint8_t m = idle.pass_parts;
+	if (!m || idle.parts < m) {
+		return 0;
+	}
+	for (uint8_t j = 0; j < m; j++) {
+		uint64_t len = 0;
+		uint8_t i;
+		for (i = 0; i < m; i++) {
+			uint8_t x = (idle.parts - 1 - i) % IDLE_PARTS;
+			uint8_t y = (j + m - i) % m;
+			if (idle.hashes[x] != idle.pass_hashes[y] || idle.lens[x] != idle.pass_lens[y]) {
+				break;
+			}
+			len += idle.lens[x];
+		}
+		if (i == m) {
+			return len;
+		}
+	}
+	return 0;
+}
+
+//! Helper function, the firmware accesses a register outside interrupts.
+/*!
+ * A part of a pass ends where it began, see \ref idle. Once the last parts
+ * make a pass as the one before it, the same registers accessed with the same
+ * values at the same places, taking as long, the firmware is taken to only
+ * poll, and the passes up to the next event are skipped. After an event one
+ * pass as the one that repeated before it is enough. The values the loop
+ * keeps in memory are not compared, a loop counting its passes would be cut
+ * short, the LUR7 firmware does not.
+ *
+ * \param site return address of the access.
+ * \param a the register.
+ */
+static void idle_pass(void * site, uint8_t a) {
+	if (site == idle.site && a == idle.reg) {
+		if (!idle.cut) {
+			uint8_t k = idle.parts % IDLE_PARTS;
+			idle.hashes[k] = idle.hash;
+			idle.lens[k] = now - idle.start;
+			idle.parts++;
+		}
+		idle.cut = 0;
+		idle.period = 0;
+		uint64_t len = idle_as_before();
+		if (len) {
+			idle.period = idle.pass_parts;
+		}
+		for (uint8_t m = 1; m <= IDLE_PARTS / 2 && 2 * m <= idle.parts && !idle.period; m++) {
+			len = idle_repeated(m);
+			if (len) {
+				idle.period = m;
+				idle.pass_parts = m;
+				for (uint8_t i = 0; i < m; i++) {
+					idle.pass_hashes[i] = idle.hashes[(idle.parts - m + i) % IDLE_PARTS];
+					idle.pass_lens[i] = idle.lens[(idle.parts - m + i) % IDLE_PARTS];
+				}
+			}
+		}
+		if (idle.period) {
+			idle_skip(len);
+		}
+	} else if (idle.site && ++idle.accesses < IDLE_GIVE_UP) {
+		if (idle.period && now >= idle.resume) {
+			idle_skip(idle.len);
+		}
+		return;
+	} else { // begin at this access, or again elsewhere if the part did not end there
+		idle_reset();
+		idle.cut = 0;
+		idle.pass_parts = 0;
+		idle.site = site;
+		idle.reg = a;
+	}
+	idle.start = now;
+	idle.hash = IDLE_HASH;
+	idle.accesses = 0;
+}
+
+//! Helper function, adds an access to the hash of the part.
+/*!
+ * The ports are accessed through PINB and the pin change masks through PCMSK0,
+ * see \ref commit, all of them are added then. A 16 bit register is accessed
+ * at its low address, both bytes are added.
+ *
+ * \param site return address of the access.
+ * \param a the register.
+ * \param v its value.
+ */
+static inline void idle_note(void * site, uint8_t a, uint8_t v) {
+	uint8_t from = a;
+	uint8_t to = a < A_CANSTMOB ? a + 1 : a;
+	if (!idle.site) {
+		return;
+	}
+	if (a >= A_PINB && a <= A_PORTE) {
+		from = A_PINB;
+		to = A_PORTE;
+	} else if (a >= A_PCMSK0 && a <= A_PCMSK3) {
+		from = A_PCMSK0;
+		to = A_PCMSK3;
+	}
+	idle.hash = (idle.hash ^ ((uintptr_t) site + ((uint32_t) a << 8) + v)) * 1099511628211ULL;
+	for (uint16_t i = from; i <= to; i++) {
+		idle.hash = (idle.hash ^ io[i]) * 1099511628211ULL;
+	}
+}
+
+//! Until when the firmware only polls.
+/*!
+ * Once a node only polls it does nothing the harness sees until the next event
+ * of its peripherals, or until the harness gives it a frame or changes an
+ * input. The harness may then run it to that time in one go.
+ *
+ * \return time of the next event, ns, 0 if the firmware does more than poll.
+ */
+uint64_t sim_idle(void) {
+	if (!idle.period) {
+		return 0;
+	}
+	uint64_t limit = idle_limit();
+	return limit == NEVER ? UINT64_MAX : nanoseconds(limit);
+}
+
+//! Time skipped while the main loop only polled.
+/*!
+ * \return ns.
+ */
+uint64_t sim_skipped(void) {
+	return nanoseconds(skipped);
+}
+
+/*******************************************************************************
+ * interrupts
+ ******************************************************************************/
+
+//! Helper function, the highest priority interrupt pending, 0 if none.
+static uint8_t pending(void) {
+	uint8_t flags = io[A_ACSR] >> 4;
+	for (uint8_t n = 0; n < 4; n++) {
+		if ((flags & (1 << n)) && (io[A_AC0CON + n] & (1 << AC2IE))) {
+			return 1 + n;
+		}
+	}
+	for (uint8_t n = 0; n < 4; n++) {
+		if (!(io[A_EIMSK] & (1 << n))) {
+			continue;
+		}
+		uint8_t pin = int_pin(n);
+		uint8_t low = !((levels[pin >> 3] >> (pin & 7)) & 1);
+		if ((io[A_EIFR] & (1 << n)) || (((io[A_EICRA] >> (2 * n)) & 3) == 0 && low)) {
+			return 7 + n;
+		}
+	}
+	flags = io[A_TIFR1] & io[A_TIMSK1];
+	if (flags & (1 << ICF1)) {
+		return 11;
+	}
+	if (flags & (1 << OCF1A)) {
+		return 12;
+	}
+	if (flags & (1 << OCF1B)) {
+		return 13;
+	}
+	if (flags & (1 << TOV1)) {
+		return 14;
+	}
+	flags = io[A_TIFR0] & io[A_TIMSK0];
+	if (flags & (1 << OCF0A)) {
+		return 15;
+	}
+	if (flags & (1 << OCF0B)) {
+		return 16;
+	}
+	if (flags & (1 << TOV0)) {
+		return 17;
+	}
+	if (can_irq()) {
+		return 18;
+	}
+	flags = io[A_PCIFR] & io[A_PCICR] & 0x0F;
+	for (uint8_t n = 0; n < 4; n++) {
+		if (flags & (1 << n)) {
+			return 22 + n;
+		}
+	}
+	if ((io[A_SPSR] & (1 << SPIF)) && (io[A_SPCR] & (1 << SPIE))) {
+		return 26;
+	}
+	if ((io[A_ADCSRA] & (1 << ADIF)) && (io[A_ADCSRA] & (1 << ADIE))) {
+		return 27;
+	}
+	return 0;
+}
+
+//! Helper function, clears the flag of an interrupt as it is taken.
+static void acknowledge(uint8_t v) {
+	static const uint8_t timer1_flags[4] = {1 << ICF1, 1 << OCF1A, 1 << OCF1B, 1 << TOV1};
+	if (v <= 4) {
+		hw_set(A_ACSR, io[A_ACSR] & ~(1 << (3 + v)));
+	} else if (v >= 7 && v <= 10) {
+		hw_set(A_EIFR, io[A_EIFR] & ~(1 << (v - 7)));
+	} else if (v >= 11 && v <= 14) {
+		hw_set(A_TIFR1, io[A_TIFR1] & ~timer1_flags[v - 11]);
+	} else if (v >= 15 && v <= 17) {
+		hw_set(A_TIFR0, io[A_TIFR0] & ~(1 << (v == 17 ? TOV0 : v - 14)));
+	} else if (v >= 22 && v <= 25) {
+		hw_set(A_PCIFR, io[A_PCIFR] & ~(1 << (v - 22)));
+	} else if (v == 26) {
+		hw_set(A_SPSR, io[A_SPSR] & ~(1 << SPIF));
+	} else if (v == 27) {
+		hw_set(A_ADCSRA, io[A_ADCSRA] & ~(1 << ADIF));
+	}
+}
+
+static void commit(void);
+
+//! Helper function, takes an interrupt.
+static void interrupt(uint8_t v) {
+	uint64_t start = accesses;
+	uint64_t entry = now;
+	uint8_t d = isr_depth++;
+	idle_reset();
+	acknowledge(v);
+	hw_set(A_SREG, io[A_SREG] & ~(1 << SREG_I));
+	advance(SIM_ISR_CLOCKS / 2);
+	if (!vectors[v]) {
+		fprintf(stderr, "sim: interrupt %u has no handler\n", v);
+		exit(1);
+	}
+	vectors[v]();
+	commit();
+	spi_unsure = NEVER; // a read, the interrupt did not wait for it
+	advance(SIM_ISR_CLOCKS / 2);
+	hw_set(A_SREG, io[A_SREG] | (1 << SREG_I)); // reti
+	irq_dirty = 1;
+	isr_depth = d;
+	if (d < sizeof(isr_accesses) / sizeof(isr_accesses[0])) {
+		isr_accesses[d] += accesses - start;
+	}
+	count_accesses(&isr_profile[v], accesses - start);
+	isr_clocks[v] += now - entry;
+}
+
+/*******************************************************************************
+ * time
+ ******************************************************************************/
+
+//! Helper function, finds the next peripheral event.
+static void schedule(void) {
+	uint64_t t = timer0.next < timer1.next ? timer0.next : timer1.next;
+	if (adc_end < t) {
+		t = adc_end;
+	}
+	if (spi_end < t) {
+		t = spi_end;
+	}
+	for (uint32_t m = squares; m; m &= m - 1) {
+		uint8_t i = __builtin_ctzl(m);
+		if (square_next[i] < t) {
+			t = square_next[i];
+		}
+	}
+	next_event = t;
+}
+
+//! Helper function, handles the peripheral events that are due.
+static void events(void) {
+	if (timer0.next <= now) {
+		timer_event(&timer0);
+	}
+	if (timer1.next <= now) {
+		timer_event(&timer1);
+	}
+	if (adc_end <= now) {
+		adc_done();
+	}
+	if (spi_end <= now) {
+		spi_done();
+	}
+	square_edges();
+	schedule();
+}
+
+//! Helper function, returns to the harness until it runs the firmware again.
+/*!
+ * _setjmp and _longjmp switch between the stacks without the system calls of
+ * swapcontext, which would take longer than most runs.
+ */
+static void yield(void) {
+	running = 0;
+	if (!_setjmp(firmware_jmp)) {
+		_longjmp(host_jmp, 1);
+	}
+	running = 1;
+}
+
+//! Helper function, lets time pass.
+/*!
+ * Events are handled as they happen and interrupts taken when enabled, the
+ * firmware returns to the harness when the time of \ref sim_run_until is up.
+ *
+ * \param c clocks.
+ */
+static void advance(uint64_t c) {
+	uint64_t end = now + c;
+	while (1) {
+		while (now >= until) {
+			yield();
+		}
+		if (irq_dirty && (io[A_SREG] & (1 << SREG_I))) {
+			uint8_t v = pending();
+			if (v) {
+				interrupt(v);
+				continue;
+			}
+			irq_dirty = 0;
+		}
+		if (now >= end) {
+			return;
+		}
+		uint64_t t = end;
+		if (next_event < t) {
+			t = next_event;
+		}
+		if (until < t) {
+			t = until;
+		}
+		now = t;
+		if (now >= next_event) {
+			events();
+		}
+	}
+}
+
+/*******************************************************************************
+ * registers
+ ******************************************************************************/
+
+//! Helper function, a register was written by the firmware.
+static void write(uint8_t a) {
+	uint8_t v = io[a];
+	switch (a) {
+		case A_TIFR0:
+		case A_TIFR1:
+		case A_PCIFR:
+		case A_EIFR: // write one to clear
+			hw_set(a, (old[a] & ~v) | FLAG_MARKER);
+			break;
+		case A_ACSR: // flags written one are cleared, outputs read only
+			hw_set(a, (old[a] & 0xF0 & ~v) | (old[a] & 0x0F));
+			break;
+		case A_PINB:
+		case A_PINB + 3:
+		case A_PINB + 6:
+		case A_PINB + 9: // toggle
+			hw_set(a + 2, io[a + 2] ^ v);
+			hw_set(a, old[a]);
+			pins_update();
+			break;
+		case A_PINB + 1:
+		case A_PINB + 2:
+		case A_PINB + 4:
+		case A_PINB + 5:
+		case A_PINB + 7:
+		case A_PINB + 8:
+		case A_PINB + 10:
+		case A_PINB + 11:
+			old[a] = v;
+			pins_update();
+			pwm_update();
+			break;
+		case A_TCCR0A:
+		case A_TCCR0B:
+		case A_OCR0A:
+		case A_OCR0B:
+			old[a] = v;
+			timer_config(&timer0, -1);
+			break;
+		case A_TCNT0:
+			old[a] = v;
+			timer_config(&timer0, v);
+			break;
+		case A_TCCR1A:
+		case A_TCCR1B:
+		case A_TCCR1C:
+		case A_ICR1:
+		case A_ICR1 + 1:
+		case A_OCR1A:
+		case A_OCR1A + 1:
+		case A_OCR1B:
+		case A_OCR1B + 1:
+			old[a] = v;
+			timer_config(&timer1, -1);
+			pins_update();
+			pwm_update();
+			break;
+		case A_TCNT1:
+		case A_TCNT1 + 1:
+			old[a] = v;
+			timer_config(&timer1, io[A_TCNT1] | (io[A_TCNT1 + 1] << 8));
+			break;
+		case A_ADCSRA:
+			adc_write();
+			break;
+		case A_ADMUX:
+		case A_DIDR0: // written for each conversion, no interrupt depends on them
+			old[a] = v;
+			return;
+		case A_ADCL:
+		case A_ADCH:
+			hw_set(a, old[a]); // read only
+			break;
+		case A_SPSR: // SPI2X, the flags read only
+			hw_set(a, (old[a] & ~(1 << SPI2X)) | (v & (1 << SPI2X)));
+			break;
+		case A_CANGCON:
+			old[a] = v;
+			can_write_gcon();
+			break;
+		case A_CANGSTA:
+		case A_CANEN2:
+		case A_CANEN1:
+		case A_CANSIT2:
+		case A_CANSIT1:
+		case A_CANHPMOB:
+		case A_CANTEC:
+		case A_CANREC:
+			hw_set(a, old[a]); // read only
+			break;
+		case A_CANGIT: // write one to clear, CANIT read only
+			hw_set(a, old[a] & ~(v & 0x7F));
+			break;
+		default:
+			old[a] = v;
+			break;
+	}
+	irq_dirty = 1;
+}
+
+//! Helper function, looks for a write in the last access.
+/*!
+ * The ports are accessed through pointers from PINB, see IO_PIN_REG, and the
+ * pin change masks from PCMSK0, so all of them are compared then. A 16 bit
+ * register is accessed at its low address.
+ */
+static void commit(void) {
+	uint8_t a = last;
+	last = 0;
+	if (a >= A_PINB && a <= A_PORTE) {
+		for (uint8_t i = A_PINB; i <= A_PORTE; i++) {
+			if (io[i] != old[i]) {
+				write(i);
+			}
+		}
+	} else if (a >= A_PCMSK0 && a <= A_PCMSK3) {
+		for (uint8_t i = A_PCMSK0; i <= A_PCMSK3; i++) {
+			if (io[i] != old[i]) {
+				write(i);
+			}
+		}
+	} else if (a == A_CANCDMOB) {
+		mob_t * m = page();
+		if (m->cdmob != m->cd_old) {
+			can_write_cdmob(m);
+		}
+	} else if (a >= A_CANSTMOB) {
+		irq_dirty = 1; // the MOb registers are kept in mob_t
+	} else if (a == A_SPDR) {
+		spi_access();
+	} else if (a) {
+		if (io[a] != old[a]) {
+			write(a);
+		}
+		if (io[a + 1] != old[a + 1]) {
+			write(a + 1);
+		}
+	}
+}
+
+//! Helper function, updates a register before it is accessed.
+/*!
+ * \param a the address.
+ * \return where the access goes.
+ */
+static volatile uint8_t * prepare(uint8_t a) {
+	if (a == A_ADCSRA && adc_end != NEVER && running) {
+		advance(adc_end - now); // nothing else happens while polling ADSC
+	}
+	if (spi_unsure != NEVER) {
+		spi_poll(a);
+	}
+	last = a;
+	if (a >= A_CANSTMOB) {
+		mob_t * m = page();
+		if (a == A_CANSTMOB) {
+			return &m->stmob;
+		} else if (a == A_CANCDMOB) {
+			m->cd_old = m->cdmob;
+			return &m->cdmob;
+		} else if (a < A_CANIDM4) {
+			return &m->idt[a - A_CANIDT4];
+		} else if (a < A_CANSTM) {
+			return &m->idm[a - A_CANIDM4];
+		} else if (a < A_CANMSG) {
+			return (uint8_t *) &m->stm + (a - A_CANSTM);
+		} else if (a == A_CANMSG) {
+			uint8_t p = io[A_CANPAGE];
+			volatile uint8_t * r = &m->msg[p & 7];
+			if (!(p & (1 << AINC))) { // auto increment
+				hw_set(A_CANPAGE, (p & 0xF8) | ((p + 1) & 7));
+			}
+			return r;
+		}
+		return &io[a];
+	}
+	switch (a) {
+		case A_TCNT0:
+			hw_set(a, timer_count(&timer0, timer_tick(&timer0) % timer0.len));
+			break;
+		case A_TCNT1:
+		case A_TCNT1 + 1:
+			hw_set16(A_TCNT1, timer_count(&timer1, timer_tick(&timer1) % timer1.len));
+			break;
+		case A_CANGSTA:
+		case A_CANGIT:
+		case A_CANTEC:
+		case A_CANREC:
+		case A_CANEN2:
+		case A_CANEN1:
+		case A_CANSIT2:
+		case A_CANSIT1:
+		case A_CANHPMOB:
+			can_status();
+			break;
+		case A_SPDR: // SPIF is cleared by reading SPSR, then SPDR
+			spi_flagged = io[A_SPSR] & (1 << SPIF);
+			hw_set(A_SPSR, io[A_SPSR] & ~((1 << SPIF) | (1 << WCOL)));
+			break;
+	}
+	return &io[a];
+}
+
+//! Accesses a register, see \ref sim.
+/*!
+ * \param a data address of the register.
+ * \return where the access goes.
+ */
+volatile uint8_t * sim_reg(uint8_t a) {
+	commit();
+	if (!running) {
+		return prepare(a);
+	}
+	void * site = __builtin_return_address(0);
+	if (!isr_depth) {
+		idle_pass(site, a);
+	}
+	accesses++;
+	advance(SIM_ACCESS_CLOCKS);
+	volatile uint8_t * r = prepare(a);
+	if (!isr_depth) {
+		idle_note(site, a, *r);
+	}
+	return r;
+}
+
+//! Helper function, an instruction of one clock, seen by \ref idle_pass as an access.
+/*!
+ * \param site return address of the instruction.
+ * \param a the register it changes, 0 if none.
+ */
+static void instruction(void * site, uint8_t a) {
+	if (!isr_depth) {
+		idle_pass(site, a);
+		idle_note(site, a, io[a]);
+	}
+	advance(1);
+}
+
+//! Sets the I bit of SREG, see sei().
+void sim_sei(void) {
+	commit();
+	hw_set(A_SREG, io[A_SREG] | (1 << SREG_I));
+	irq_dirty = 1;
+	if (running) {
+		instruction(__builtin_return_address(0), A_SREG);
+	}
+}
+
+//! Clears the I bit of SREG, see cli().
+void sim_cli(void) {
+	commit();
+	hw_set(A_SREG, io[A_SREG] & ~(1 << SREG_I));
+	if (running) {
+		instruction(__builtin_return_address(0), A_SREG);
+	}
+}
+
+//! One clock, see _NOP().
+void sim_nop(void) {
+	commit();
+	if (running) {
+		instruction(__builtin_return_address(0), 0);
+	}
+}
+
+/*******************************************************************************
+ * running
+ ******************************************************************************/
+
+//! Simulated time.
+/*!
+ * When called by the firmware, reading the time takes as long as a register
+ * access, so that code polling the time moves on.
+ *
+ * \return time since start, ns.
+ */
+uint64_t sim_now(void) {
+	if (running) {
+		idle_reset(); // the time read is never the same
+		commit();
+		advance(SIM_ACCESS_CLOCKS);
+	}
+	return nanoseconds(now);
+}
+
+//! Lets time pass for the firmware, interrupts are taken meanwhile.
+/*!
+ * \param ns time, ns.
+ */
+void sim_wait(uint64_t ns) {
+	if (running) {
+		idle_reset();
+		commit();
+		advance(clocks(ns));
+	}
+}
+
+//! Number of register accesses so far.
+uint64_t sim_accesses(void) {
+	return accesses;
+}
+
+//! Asks the firmware to return to the harness, from a callback.
+void sim_stop(void) {
+	until = now;
+}
+
+//! Helper function, start of the firmware stack.
+static void start(void) {
+	firmware();
+	fprintf(stderr, "sim: main returned\n");
+	sim_cli();
+	while (1) {
+		sim_wait(1000000);
+	}
+}
+
+//! Initialisation function.
+/*!
+ * Sets the MCU up as after reset, the firmware starts at the first
+ * \ref sim_run_until.
+ *
+ * \param entry the main function of the firmware.
+ * \param callbacks what the harness is told, copied.
+ */
+void sim_init(int (*entry)(void), const sim_callbacks_t * callbacks) {
+	static uint8_t * stack = NULL;
+	memset(io, 0, sizeof(io));
+	memset(mob, 0, sizeof(mob));
+	memset(analog, 0, sizeof(analog));
+	memset(square_half, 0, sizeof(square_half));
+	squares = 0;
+	hw_set(A_TIFR0, FLAG_MARKER);
+	hw_set(A_TIFR1, FLAG_MARKER);
+	hw_set(A_PCIFR, FLAG_MARKER);
+	hw_set(A_EIFR, FLAG_MARKER);
+	hw_set(A_CANHPMOB, 0xF0);
+	memcpy(old, io, sizeof(io));
+	memset(ext, 0xFF, sizeof(ext)); // pulled up on the PCB
+	memset(levels, 0xFF, sizeof(levels));
+	memset(&cb, 0, sizeof(cb));
+	now = 0;
+	until = 0;
+	accesses = 0;
+	skipped = 0;
+	memset(&idle, 0, sizeof(idle));
+	last = 0;
+	adc_end = NEVER;
+	spi_end = NEVER;
+	spi_flagged = 0;
+	spi_unsure = NEVER;
+	tec = 0;
+	rec = 0;
+	boff_end = NEVER;
+	memset(isr_profile, 0, sizeof(isr_profile));
+	memset(isr_clocks, 0, sizeof(isr_clocks));
+	memset(isr_accesses, 0, sizeof(isr_accesses));
+	memset(functions, 0, sizeof(functions));
+	n_sites = 0;
+	isr_depth = 0;
+	depth = 0;
+	timer_config(&timer0, 0);
+	timer_config(&timer1, 0);
+	pwm_reported = 0;
+	pins_update();
+	if (callbacks) {
+		cb = *callbacks;
+	}
+	firmware = entry;
+	started = 0;
+	if (!stack) {
+		stack = malloc(SIM_STACK);
+	}
+	getcontext(&firmware_ctx);
+	firmware_ctx.uc_stack.ss_sp = stack;
+	firmware_ctx.uc_stack.ss_size = SIM_STACK;
+	firmware_ctx.uc_link = NULL;
+	makecontext(&firmware_ctx, start, 0);
+}
+
+//! Runs the firmware.
+/*!
+ * \param ns time to run until, ns since start. The firmware may return
+ * earlier after \ref sim_stop.
+ */
+void sim_run_until(uint64_t ns) {
+	until = (ns * (SIM_F_CPU / 1000000) + 999) / 1000; // rounded up, sim_now() is then at least ns
+	if (now >= until && started) {
+		return;
+	}
+	uint8_t first = !started;
+	started = 1;
+	running = 1;
+	if (!_setjmp(host_jmp)) {
+		if (first) {
+			setcontext(&firmware_ctx);
+		}
+		_longjmp(firmware_jmp, 1);
+	}
+	running = 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * sim.h - ATmega32M1 peripherals simulated on the host, for the LUR7 HAL.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file sim.h
+ * Host simulation of the ATmega32M1, see \ref sim.c.
+ *
+ * All code is released under the GPLv3 license.
+ *
+ * \see \ref sim.c
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ *
+ * \addtogroup sim
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdint.h>
+
+//! Clock of the simulated MCU, as F_CPU in LUR7.h.
+#define SIM_F_CPU		16000000ULL
+//! Clocks of simulated time let pass by each register access, the code in between takes none.
+#define SIM_ACCESS_CLOCKS	4
+//! Clocks of simulated time let pass to enter and leave an interrupt, besides its register accesses.
+#define SIM_ISR_CLOCKS	8
+
+//! A CAN frame, extended identifier.
+typedef struct {
+	uint32_t id;		//!< 29 bit identifier.
+	uint8_t dlc;		//!< Number of data bytes.
+	uint8_t data[8];	//!< Data in the order it is sent on the bus.
+} sim_frame_t;
+
+//! Register accesses made by an interrupt or a function, see \ref sim_isr_profile.
+typedef struct {
+	uint64_t count;		//!< Times taken.
+	uint64_t accesses;	//!< In total.
+	uint64_t max;		//!< The most at once.
+} sim_profile_t;
+
+//! A function of the firmware, see \ref sim_functions.
+typedef struct {
+	void * fn;		//!< Address, NULL for an empty entry.
+	sim_profile_t run;	//!< From call to return, interrupts excluded.
+} sim_function_t;
+
+//! What the harness is told, all may be NULL. Called with the firmware stopped where it is.
+typedef struct {
+	//! A pin driven by the MCU changed, \p code as IO_PIN_CODE, \p level 0 low.
+	void (*pin)(uint8_t code, uint8_t level);
+	//! The PWM on OC1B changed, \p duty of \p top, \p top 0 when not connected.
+	void (*pwm)(uint16_t duty, uint16_t top);
+	//! A MOb was enabled for transmission, see \ref sim_can_pending.
+	void (*can_request)(void);
+} sim_callbacks_t;
+
+void sim_init(int (*entry)(void), const sim_callbacks_t * callbacks);
+void sim_run_until(uint64_t ns);
+void sim_stop(void);
+uint64_t sim_now(void);
+void sim_wait(uint64_t ns);
+uint64_t sim_accesses(void);
+uint64_t sim_idle(void);
+uint64_t sim_skipped(void);
+const sim_profile_t * sim_isr_profile(uint8_t vector);
+uint64_t sim_isr_ns(uint8_t vector);
+const sim_function_t * sim_functions(uint16_t * n);
+const sim_profile_t * sim_main_loop(void ** fn);
+
+void sim_set_input(uint8_t code, int8_t level);
+void sim_set_square(uint8_t code, uint64_t half_period_ns);
+uint8_t sim_get_pin(uint8_t code);
+void sim_set_analog(uint8_t channel, uint16_t value);
+void sim_set_comparator(uint8_t n, uint8_t out);
+
+uint8_t sim_can_pending(sim_frame_t * frame);
+void sim_can_transmitted(void);
+uint8_t sim_can_receive(const sim_frame_t * frame);
+void sim_can_error(uint8_t transmitter);
+uint8_t sim_can_active(void);
+uint64_t sim_can_bit_ns(void);
+uint16_t sim_can_bits(const sim_frame_t * frame);
+
+#endif // _SIM_H_
@@ -0,0 +1,65 @@
+/*
+ * atomic.h - Host replacement of avr-libc <util/atomic.h>
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The same construction as avr-libc, the I bit of SREG is cleared for the
+// block and restored when it is left, also by return or break.
+
+#ifndef _HOST_ATOMIC_H_
+#define _HOST_ATOMIC_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static inline uint8_t __iSeiRetVal(void) {
+	sei();
+	return 1;
+}
+
+static inline uint8_t __iCliRetVal(void) {
+	cli();
+	return 1;
+}
+
+static inline void __iSeiParam(const uint8_t * __s) {
+	(void) __s;
+	sei();
+}
+
+static inline void __iCliParam(const uint8_t * __s) {
+	(void) __s;
+	cli();
+}
+
+static inline void __iRestore(const uint8_t * __s) {
+	if (*__s & (1 << SREG_I)) {
+		sei();
+	} else {
+		cli();
+	}
+}
+
+#define ATOMIC_BLOCK(type)		for (type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+#define NONATOMIC_BLOCK(type)	for (type, __ToDo = __iSeiRetVal(); __ToDo; __ToDo = 0)
+
+#define ATOMIC_RESTORESTATE		uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON			uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+#define NONATOMIC_RESTORESTATE	uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define NONATOMIC_FORCEOFF		uint8_t sreg_save __attribute__((__cleanup__(__iCliParam))) = 0
+
+#endif // _HOST_ATOMIC_H_
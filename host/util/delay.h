@@ -0,0 +1,37 @@
+/*
+ * delay.h - Host replacement of avr-libc <util/delay.h>
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Delays advance the simulated time, interrupts are taken meanwhile as on
+// the target.
+
+#ifndef _HOST_DELAY_H_
+#define _HOST_DELAY_H_
+
+#include <stdint.h>
+
+void sim_wait(uint64_t ns);
+
+static inline void _delay_ms(double ms) {
+	sim_wait((uint64_t) (ms * 1000000.0));
+}
+
+static inline void _delay_us(double us) {
+	sim_wait((uint64_t) (us * 1000.0));
+}
+
+#endif // _HOST_DELAY_H_
@@ -0,0 +1,411 @@
+/*
+ * main.c - Worst case stack and RAM of a firmware of the LUR7.
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file main.c
+ * stackcheck computes the worst case stack of a firmware from the call graphs
+ * written by GCC with -fcallgraph-info=su, which holds the stack of each
+ * function as -fstack-usage does, and checks that it fits in the RAM left by
+ * .data and .bss:
+ *
+ *     stackcheck -t MCU-rear/main -r 2048 -u 412 -m 256 -c stack.txt obj/main/stack/ *.ci
+ *
+ * The stack of a function is its own and that of the deepest function it
+ * calls. On the AVR the return address and the registers pushed are counted
+ * in its own. The worst case is the deepest path from main, and on top of it
+ * the deepest interrupt, the functions named __vector_n or ending in _vect.
+ * An interrupt given with -i runs with interrupts enabled, ISR_NOBLOCK, and
+ * any other may come on top of it, so all of those are added.
+ *
+ * A call through a pointer is resolved from the file given with -c, lines of
+ * the function making the call, or the source file it is in, and the
+ * functions it may call:
+ *
+ *     # end_fun_ptr
+ *     timer0_isr_stop: mid_gear_up end_gear_change
+ *     # the handlers of PC_HANDLERS, called from ISRs once inlined
+ *     LUR7_interrupt.c: wheel_r_change wheel_l_change
+ *
+ * Functions named there but not built are left out, so one file serves the
+ * variants of a target, and a line without functions lists a call made to
+ * none, a table left empty. A call through a pointer not listed, recursion or a
+ * variable length array or alloca without a bound are errors. Functions
+ * called but not built, from avr-libc, are counted with -x bytes, and calls
+ * to libgcc made for arithmetic are not seen at all, they take a few bytes.
+ *
+ * Prints the stack and the RAM used, and the deepest paths. Exits with 1 if
+ * .data and .bss (-u), the stack and the margin (-m) are more than the RAM
+ * (-r), or on an error.
+ *
+ * \see header_and_config/LUR7.mk, make stack
+ * \see <http://www.gnu.org/copyleft/gpl.html>
+ * \author Simon Wrafter
+ * \copyright GNU Public License v3.0
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_LINE	4096	//!< Longest line of a call graph.
+#define INDIRECT	"__indirect_call"	//!< Callee of a call through a pointer.
+
+//! A function of the call graph.
+typedef struct {
+	char * title;	//!< Node title, file:name for a static function.
+	char * name;	//!< Name.
+	long bytes;	//!< Stack of its own, -1 when not built.
+	int dynamic;	//!< Stack not bounded.
+	char ** sites;	//!< Calls through a pointer, file:line:col.
+	int n_sites;	//!< Number of \ref sites.
+	int * callees;	//!< Functions called, indices.
+	int n_callees;	//!< Number of \ref callees.
+	int state;	//!< 0 not visited, 1 on the path searched, 2 done.
+	long depth;	//!< Its stack and the deepest callee, once done.
+	int next;	//!< Deepest callee, -1 if none.
+} func_t;
+
+//! A line of the file given with -c.
+typedef struct {
+	char * caller;	//!< Function calling through a pointer.
+	char * callee;	//!< A function it may call.
+} call_t;
+
+static func_t * funcs;
+static int n_funcs;
+static call_t * calls;
+static int n_calls;
+static long unknown_bytes = 16;	//!< Stack of a function not built, -x.
+static char ** nested;	//!< Interrupts run with interrupts enabled, -i.
+static int n_nested;
+static int errors;
+
+static void usage(const char * name) {
+	fprintf(stderr, "usage: %s [-t title] [-r ram] [-u used] [-m margin] [-x bytes] [-c calls] "
+		"[-e entry] [-i isr]... [-v] file.ci...\n", name);
+	exit(2);
+}
+
+static void * grow(void * p, int n, size_t size) {
+	if ((n & (n - 1)) == 0) { // doubles at powers of two
+		p = realloc(p, (n ? 2 * n : 1) * size);
+		if (!p) {
+			perror("stackcheck");
+			exit(2);
+		}
+	}
+	return p;
+}
+
+//! Index of the function with \p title, added if new.
+static int func_by_title(const char * title) {
+	for (int i = 0; i < n_funcs; i++) {
+		if (!strcmp(funcs[i].title, title)) {
+			return i;
+		}
+	}
+	funcs = grow(funcs, n_funcs, sizeof(func_t));
+	func_t * f = &funcs[n_funcs];
+	memset(f, 0, sizeof(*f));
+	f->title = strdup(title);
+	const char * colon = strrchr(title, ':');
+	f->name = strdup(colon ? colon + 1 : title);
+	f->bytes = -1;
+	f->next = -1;
+	return n_funcs++;
+}
+
+static void add_callee(func_t * f, int callee) {
+	for (int i = 0; i < f->n_callees; i++) {
+		if (f->callees[i] == callee) {
+			return;
+		}
+	}
+	f->callees = grow(f->callees, f->n_callees, sizeof(int));
+	f->callees[f->n_callees++] = callee;
+}
+
+//! Copies the quoted value following \p key in \p line to \p value, 0 if not found.
+static int field(const char * line, const char * key, char * value) {
+	const char * p = strstr(line, key);
+	if (!p || p[strlen(key)] != '"') {
+		return 0;
+	}
+	p += strlen(key) + 1;
+	while (*p && *p != '"') {
+		if (*p == '\\' && p[1]) {
+			*value++ = *p++;
+		}
+		*value++ = *p++;
+	}
+	*value = '\0';
+	return 1;
+}
+
+//! Reads a call graph of -fcallgraph-info.
+static void read_graph(const char * path) {
+	FILE * f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		exit(2);
+	}
+	char line[MAX_LINE], a[MAX_LINE], b[MAX_LINE];
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, "node:", 5) && field(line, "title: ", a) && strcmp(a, INDIRECT)) {
+			int i = func_by_title(a); // may move funcs
+			func_t * fn = &funcs[i];
+			// the label is name\nfile:line:col\nN bytes (static|dynamic|dynamic,bounded)...
+			const char * bytes = field(line, "label: ", b) ? strstr(b, " bytes (") : NULL;
+			if (bytes) {
+				while (bytes > b && isdigit((unsigned char) bytes[-1])) {
+					bytes--;
+				}
+				fn->bytes = atol(bytes);
+				fn->dynamic = !strncmp(strchr(bytes, '('), "(dynamic)", 9);
+			}
+		} else if (!strncmp(line, "edge:", 5) && field(line, "sourcename: ", a) && field(line, "targetname: ", b)) {
+			int caller = func_by_title(a);
+			int callee = strcmp(b, INDIRECT) ? func_by_title(b) : -1; // may move funcs
+			func_t * fn = &funcs[caller];
+			if (callee >= 0) {
+				add_callee(fn, callee);
+			} else {
+				field(line, "label: ", b);
+				fn->sites = grow(fn->sites, fn->n_sites, sizeof(char *));
+				fn->sites[fn->n_sites++] = strdup(b);
+			}
+		}
+	}
+	fclose(f);
+}
+
+//! Reads the calls through pointers, see \ref main.c.
+static void read_calls(const char * path) {
+	FILE * f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		exit(2);
+	}
+	char line[MAX_LINE];
+	while (fgets(line, sizeof(line), f)) {
+		char * hash = strchr(line, '#');
+		if (hash) {
+			*hash = '\0';
+		}
+		char * colon = strchr(line, ':');
+		if (!colon) {
+			continue;
+		}
+		*colon = '\0';
+		char * caller = strtok(line, " \t");
+		if (!caller) {
+			continue;
+		}
+		char * callee = strtok(colon + 1, " \t\r\n");
+		do { // a line without callees lists the call, to nothing
+			calls = grow(calls, n_calls, sizeof(call_t));
+			calls[n_calls].caller = strdup(caller);
+			calls[n_calls].callee = strdup(callee ? callee : "");
+			n_calls++;
+		} while (callee && (callee = strtok(NULL, " \t\r\n")));
+	}
+	fclose(f);
+}
+
+static int is_named(const func_t * f, const char * name) {
+	return !strcmp(f->name, name) || !strcmp(f->title, name);
+}
+
+//! Whether \p site, file:line:col, is in source file \p name.
+static int is_in(const char * site, const char * name) {
+	const char * colon = strchr(site, ':');
+	const char * slash = strrchr(site, '/');
+	const char * file = slash && slash < colon ? slash + 1 : site;
+	return colon && (size_t) (colon - file) == strlen(name) && !strncmp(file, name, colon - file);
+}
+
+//! Adds the callees of the calls through pointers.
+static void resolve_calls(void) {
+	for (int i = 0; i < n_funcs; i++) {
+		func_t * f = &funcs[i];
+		for (int s = 0; s < f->n_sites; s++) {
+			int listed = 0;
+			for (int c = 0; c < n_calls; c++) {
+				if (!is_named(f, calls[c].caller) && !is_in(f->sites[s], calls[c].caller)) {
+					continue;
+				}
+				listed = 1;
+				for (int j = 0; j < n_funcs; j++) {
+					if (funcs[j].bytes >= 0 && is_named(&funcs[j], calls[c].callee)) {
+						add_callee(f, j);
+					}
+				}
+			}
+			if (!listed) {
+				fprintf(stderr, "stackcheck: %s calls through a pointer at %s, list the functions it may call with -c\n",
+					f->title, f->sites[s]);
+				errors++;
+			}
+		}
+	}
+}
+
+//! Stack of function \p i and the deepest path below it.
+static long depth(int i) {
+	func_t * f = &funcs[i];
+	if (f->state == 2) {
+		return f->depth;
+	}
+	if (f->state == 1) {
+		fprintf(stderr, "stackcheck: %s is called recursively\n", f->title);
+		errors++;
+		return 0;
+	}
+	f->state = 1;
+	if (f->dynamic) {
+		fprintf(stderr, "stackcheck: %s has a variable length array or alloca without a bound\n", f->title);
+		errors++;
+	}
+	long deepest = 0;
+	for (int c = 0; c < f->n_callees; c++) {
+		long d = depth(f->callees[c]);
+		if (d > deepest) {
+			deepest = d;
+			f->next = f->callees[c];
+		}
+	}
+	f->depth = (f->bytes >= 0 ? f->bytes : unknown_bytes) + deepest;
+	f->state = 2;
+	return f->depth;
+}
+
+//! Prints the deepest path from function \p i.
+static void print_path(int i) {
+	printf("  %s %ld:", funcs[i].name, funcs[i].depth);
+	for (; i >= 0; i = funcs[i].next) {
+		long bytes = funcs[i].bytes >= 0 ? funcs[i].bytes : unknown_bytes;
+		printf(" %s%s %ld", funcs[i].name, funcs[i].bytes >= 0 ? "" : "?", bytes);
+		if (funcs[i].next >= 0) {
+			printf(" >");
+		}
+	}
+	printf("\n");
+}
+
+static int is_isr(const func_t * f) {
+	size_t len = strlen(f->name);
+	return f->bytes >= 0 && (!strncmp(f->name, "__vector_", 9) || (len > 5 && !strcmp(f->name + len - 5, "_vect")));
+}
+
+static int is_nested(const func_t * f) {
+	for (int n = 0; n < n_nested; n++) {
+		if (is_named(f, nested[n])) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char ** argv) {
+	const char * title = "firmware";
+	const char * entry = "main";
+	long ram = 2048, used = 0, margin = 0;
+	int verbose = 0, opt;
+	while ((opt = getopt(argc, argv, "t:r:u:m:x:c:e:i:v")) != -1) {
+		switch (opt) {
+			case 't': title = optarg; break;
+			case 'r': ram = atol(optarg); break;
+			case 'u': used = atol(optarg); break;
+			case 'm': margin = atol(optarg); break;
+			case 'x': unknown_bytes = atol(optarg); break;
+			case 'c': read_calls(optarg); break;
+			case 'e': entry = optarg; break;
+			case 'i':
+				nested = grow(nested, n_nested, sizeof(char *));
+				nested[n_nested++] = optarg;
+				break;
+			case 'v': verbose = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+	if (optind == argc) {
+		usage(argv[0]);
+	}
+	for (int i = optind; i < argc; i++) {
+		read_graph(argv[i]);
+	}
+	resolve_calls();
+
+	int root = -1;
+	for (int i = 0; i < n_funcs; i++) {
+		if (funcs[i].bytes >= 0 && is_named(&funcs[i], entry)) {
+			root = i;
+		}
+	}
+	if (root < 0) {
+		fprintf(stderr, "stackcheck: %s not found\n", entry);
+		return 1;
+	}
+	long stack_main = depth(root);
+
+	// the deepest interrupt, with those that allow others on top of it
+	long stack_isr = 0, stack_nested = 0;
+	int deepest_isr = -1;
+	for (int i = 0; i < n_funcs; i++) {
+		if (!is_isr(&funcs[i])) {
+			continue;
+		}
+		long d = depth(i);
+		if (is_nested(&funcs[i])) {
+			stack_nested += d;
+		} else if (d > stack_isr) {
+			stack_isr = d;
+			deepest_isr = i;
+		}
+	}
+	long stack = stack_main + stack_nested + stack_isr;
+
+	printf("%s: stack %ld bytes, main %ld, interrupts %ld, RAM %ld + %ld = %ld of %ld bytes, %.1f%%, margin %ld\n",
+		title, stack, stack_main, stack_nested + stack_isr, used, stack, used + stack, ram,
+		100.0 * (used + stack) / ram, margin);
+	print_path(root);
+	for (int i = 0; i < n_funcs; i++) {
+		if (is_isr(&funcs[i]) && (verbose || i == deepest_isr || is_nested(&funcs[i]))) {
+			print_path(i);
+		}
+	}
+	if (verbose) {
+		printf("  not built, %ld bytes each:", unknown_bytes);
+		for (int i = 0; i < n_funcs; i++) {
+			if (funcs[i].bytes < 0 && funcs[i].state == 2) {
+				printf(" %s", funcs[i].name);
+			}
+		}
+		printf("\n");
+	}
+
+	if (errors) {
+		return 1;
+	}
+	if (used + stack + margin > ram) {
+		fprintf(stderr, "%s: RAM %ld bytes over, with a margin of %ld\n", title, used + stack + margin - ram, margin);
+		return 1;
+	}
+	return 0;
+}
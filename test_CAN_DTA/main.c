@@ -22,17 +22,6 @@ int main(void) {
 	return(0);
 }
 
-
-void pcISR_in1(void) {}
-void pcISR_in2(void) {}
-void pcISR_in3(void) {}
-void pcISR_in4(void) {}
-void pcISR_in5(void) {}
-void pcISR_in6(void) {}
-void pcISR_in7(void) {}
-void pcISR_in8(void) {}
-void pcISR_in9(void) {}
-
 void CAN_ISR_RXOK(uint32_t id, uint8_t dlc, uint8_t * data) {
 	toggle_output(OUT2);
 	tps = (uint16_t) (data[7] << 8) | data[8];
@@ -41,7 +30,6 @@ void CAN_ISR_RXOK(uint32_t id, uint8_t dlc, uint8_t * data) {
 void CAN_ISR_TXOK(uint32_t id, uint8_t dlc, uint8_t * data) {}
 void CAN_ISR_OTHER() {}
 
-
 void timer1_isr_100Hz(uint8_t interrupt_nbr) {}
 void timer0_isr_stop(void) {}
 
@@ -0,0 +1,270 @@
+/*
+ * / main.c - Host stress test of the CAN log buffer of the LUR7 logger
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_canlog/main.c
+ * Stress test of \ref canlog.c, runs on the host, see the makefile.
+ *
+ * A 1 Mbit/s bus is simulated at 100% load, frames back to back, while the
+ * main loop writes sectors to a simulated card. Every written sector is
+ * decoded by \ref canlog_decode.c and checked: sequence numbers, timestamps,
+ * IDs and payloads of all frames, and that the drop counter in the header
+ * accounts for exactly the frames that are missing.
+ *
+ * IDs are a mix of a few frequent ones and more rare ones than fit in the
+ * dictionary of a block. Once per load case a copy of a sector is torn, the
+ * second half left as it was on the card, and must be rejected without
+ * disturbing the decoding of the following blocks. The log is ended with
+ * canlog_finish, as at power loss, the end sector must account for all
+ * blocks and drops.
+ *
+ * With two sector buffers the time to write a sector must stay below the time
+ * to fill one. At 100% load no frames may be lost, only with a card that
+ * occasionally stalls for 10 ms.
+ *
+ * Frame times are for extended frames without stuff bits, the shortest
+ * possible, 67 bits + 8 bits per data byte including interframe space.
+ *
+ * The card model, sectors streamed to the pre-allocated file by
+ * \ref logfile.c:
+ * - sending a sector over SPI at 8 MHz takes the CPU about 650 µs, stretched
+ *   by the time spent in the CAN interrupt,
+ * - the card is then busy programming for 350 µs,
+ * - the FAT is not touched while logging.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "canlog.h"
+#include "canlog_decode.h"
+
+//! Simulated time, seconds.
+#define SIM_TIME	60.0
+//! CPU time for sending one sector to the card, µs.
+#define SD_SPI_US	650.0
+//! Card busy time after a sector, µs.
+#define SD_BUSY_US	350.0
+//! Log id used in the test.
+#define SESSION		7
+//! Most frames in a load case.
+#define MAX_FRAMES	(1UL << 21)
+//! Sector that is torn in every load case.
+#define TORN_SECTOR	100
+
+//! A load case.
+typedef struct {
+	const char * name;
+	uint8_t dlc;		//!< DLC of the frames, 9 cycles 0 to 8.
+	double isr_us;		//!< CPU time of the CAN interrupt per frame.
+	double spike_us;	//!< Extra card busy time every \p spike_every sectors.
+	uint32_t spike_every;
+	uint8_t allow_drops;	//!< Whether frames may be lost, they must still be counted.
+} profile_t;
+
+static const profile_t profiles[] = {
+	{"100% load, 8 byte frames",         8, 25.0,     0.0,    0, 0},
+	{"100% load, mixed 0-8 byte frames", 9, 25.0,     0.0,    0, 0},
+	{"100% load, empty frames",          0, 25.0,     0.0,    0, 0},
+	{"100% load, 8 byte, slow card",     8, 25.0, 10000.0, 1000, 1},
+};
+
+//! Timestamps of all sent frames.
+static uint32_t stamps[MAX_FRAMES];
+//! Second sector buffer of canlog, the window of FatFs on the logger.
+static canlog_sector_t lent;
+
+//! Verification state.
+static const profile_t * profile;
+static canlog_decoder_t dec;
+static uint32_t logged;
+static uint32_t block_frame;
+static uint32_t expected;
+static uint32_t errors;
+static uint32_t last_drops;
+static uint32_t drop_events;
+
+static uint8_t frame_dlc(const profile_t * p, uint32_t k) {
+	return p->dlc == 9 ? k % 9 : p->dlc;
+}
+
+//! ID of frame \p k, 8 frequent IDs and 23 rare.
+static uint32_t frame_id(uint32_t k) {
+	return k % 4 == 3 ? 0x18FF0000UL + k % 23 : 0x100 + k % 8;
+}
+
+static void fail(const char * what, uint32_t seq) {
+	if (errors++ < 10) {
+		printf("    sector %u: %s\n", seq, what);
+	}
+}
+
+//! Checks a decoded frame.
+static void verify_frame(const canlog_frame_t * f, void * ctx) {
+	(void) ctx;
+	uint32_t seq = dec.header.sequence;
+	if (block_frame++ == 0) {
+		expected = logged + dec.header.drops; // wrong if the drops are miscounted
+		if (dec.header.drops != last_drops) {
+			drop_events++;
+			last_drops = dec.header.drops;
+		}
+	}
+	uint32_t k = expected++;
+	if (k >= MAX_FRAMES) {
+		fail("more frames than sent", seq);
+		return;
+	}
+	if (f->id != frame_id(k)) {
+		fail("bad id", seq);
+	}
+	if (f->time != stamps[k] >> CANLOG_TIME_SHIFT) {
+		fail("bad time", seq);
+	}
+	if (f->dlc != frame_dlc(profile, k)) {
+		fail("bad dlc", seq);
+	}
+	for (uint8_t j = 0; j < 8; j++) {
+		if (f->data[j] != (j < f->dlc ? (uint8_t) (k + j) : 0)) {
+			fail("bad data", seq);
+			break;
+		}
+	}
+	logged++;
+}
+
+//! Checks a written sector.
+static void verify(const canlog_sector_t * s, uint32_t written) {
+	const uint8_t * raw = (const uint8_t *) s;
+	if (written == TORN_SECTOR) {
+		uint8_t torn[CANLOG_SECTOR_SIZE];
+		memcpy(torn, raw, CANLOG_SECTOR_SIZE / 2);
+		memset(torn + CANLOG_SECTOR_SIZE / 2, 0xFF, CANLOG_SECTOR_SIZE / 2);
+		uint32_t blocks = dec.blocks;
+		if (canlog_decode_sector(&dec, torn, verify_frame, NULL) != CANLOG_BAD_CRC || dec.blocks != blocks) {
+			fail("torn sector not rejected", s->header.sequence);
+		}
+	}
+	block_frame = 0;
+	int res = canlog_decode_sector(&dec, raw, verify_frame, NULL);
+	if (res == CANLOG_END) {
+		if (dec.end.blocks != dec.blocks || dec.end.drops != canlog_drops() || dec.end.reason != CANLOG_END_POWER) {
+			fail("bad end sector", written);
+		}
+		if (canlog_blocks() != dec.blocks || canlog_frames() != dec.frames) { // as stored in the index
+			fail("bad frame or block count", written);
+		}
+	} else if (dec.ended) {
+		fail("sector after the end", written);
+	} else if (written == 1 ? res != CANLOG_SESSION : res != CANLOG_OK) {
+		fail("sector rejected", s->header.sequence);
+	}
+}
+
+//! Time to write a sector, µs.
+static double write_time(const profile_t * p, uint32_t written) {
+	double frame_us = 67.0 + 8.0 * (p->dlc == 9 ? 4 : p->dlc);
+	double sector_us = SD_SPI_US / (1.0 - p->isr_us / frame_us) + SD_BUSY_US;
+	double us = sector_us;
+	if (p->spike_every && written % p->spike_every == 0) {
+		us += p->spike_us;
+	}
+	return us;
+}
+
+//! Runs one load case.
+static int run(const profile_t * p) {
+	const double end = SIM_TIME * 1e6;
+	double t = 0;			// arrival time of the next frame
+	double second = 1e6;	// next canlog_close from the 100 Hz interrupt
+	double write_end = 0;	// end of the sector write in progress
+	double now = 0;			// time of the last event
+	canlog_sector_t * writing = NULL;
+	uint32_t written = 0;
+	uint32_t k = 0;
+
+	canlog_init(SESSION, 0, 0, (uint8_t *) &lent);
+	canlog_decoder_init(&dec);
+	profile = p;
+	logged = 0;
+	errors = 0;
+	last_drops = 0;
+	drop_events = 0;
+
+	while (1) {
+		if (!writing && (writing = canlog_next()) != NULL) {
+			write_end = now + write_time(p, ++written);
+		}
+		if (writing && (t >= end || write_end <= t)) { // sector written
+			now = write_end;
+			verify(writing, written);
+			canlog_release();
+			writing = NULL;
+		} else if (t < end && k < MAX_FRAMES) { // frame received
+			now = t;
+			if (t >= second) {
+				canlog_close();
+				second += 1e6;
+			}
+			uint8_t dlc = frame_dlc(p, k);
+			uint8_t data[8];
+			for (uint8_t j = 0; j < dlc; j++) {
+				data[j] = k + j;
+			}
+			stamps[k] = (uint32_t) (t * 16);
+			canlog_frame(stamps[k], frame_id(k), dlc, data);
+			t += 67.0 + 8.0 * dlc;
+			k++;
+		} else if (canlog_finish(CANLOG_END_POWER)) { // end of session, end the log
+			break;
+		}
+	}
+
+	// the rest of the pre-allocated file, never written or zeroed
+	uint8_t unwritten[CANLOG_SECTOR_SIZE];
+	memset(unwritten, 0xFF, sizeof(unwritten));
+	if (canlog_decode_sector(&dec, unwritten, verify_frame, NULL) != CANLOG_BAD_MAGIC) {
+		fail("unwritten sector not rejected", written);
+	}
+	memset(unwritten, 0, sizeof(unwritten));
+	if (canlog_decode_sector(&dec, unwritten, verify_frame, NULL) != CANLOG_BAD_MAGIC) {
+		fail("zeroed sector not rejected", written);
+	}
+
+	uint32_t drops = canlog_drops();
+	if (!dec.ended) {
+		fail("no end sector", written);
+	}
+	if (logged + drops != k || dec.lost_blocks) {
+		fail("frames lost without being counted", written);
+	}
+	if (!p->allow_drops && drops) {
+		fail("frames dropped", written);
+	}
+	printf("%-36s %8u frames %5u sectors %5.2f bytes/frame %5u dropped in %3u places  %s\n", p->name, k, written,
+			(double) written * CANLOG_SECTOR_SIZE / logged, drops, drop_events, errors ? "FAIL" : "OK");
+	return errors != 0;
+}
+
+int main(void) {
+	int failed = 0;
+	for (uint8_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+		failed |= run(&profiles[i]);
+	}
+	printf(failed ? "FAIL\n" : "OK\n");
+	return failed;
+}
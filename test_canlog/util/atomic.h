@@ -0,0 +1,29 @@
+/*
+ * atomic.h - Host replacement of avr-libc <util/atomic.h> for test_canlog
+ * Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The simulation is single threaded, interrupts are events between calls, so
+// a block is atomic as it is.
+
+#ifndef _HOST_ATOMIC_H_
+#define _HOST_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type)	for (int _atomic_done = 0; !_atomic_done; _atomic_done = 1)
+
+#endif // _HOST_ATOMIC_H_
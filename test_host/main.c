@@ -0,0 +1,1475 @@
+/*
+ * / main.c - Runs the firmware of the LUR7 nodes on the host, on a virtual CAN bus
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_host/main.c
+ * Harness of the nodes built for the host, see the makefile and \ref sim.
+ *
+ * The firmware of each node, its main.c and the LUR7 HAL, is built unchanged
+ * with the headers in host/ into a shared object, node_front.so and so on,
+ * with its own simulated ATmega32M1 of host/sim.c. Its main is renamed
+ * avr_main. The harness loads the nodes named by a script, runs them side by
+ * side in simulated time, connects them on one virtual CAN bus and writes a
+ * trace of their outputs, PWMs and the frames on the bus.
+ *
+ * The bus runs at the bit rate set by the nodes, 1 Mbit. Frames wait for the
+ * bus to be free, the lowest identifier of those waiting when it is wins
+ * arbitration, and a frame takes as long as its bits, stuffing included. All
+ * other nodes receive it at its end. A destroyed frame ends in an error frame
+ * after the CRC, the sender and receivers count the error as the controller
+ * does, and it is sent again. Besides the nodes the script and a stand-in for
+ * the DTA S60, sending 0x2000 - 0x2005 periodically, are on the bus.
+ *
+ * The nodes run in steps shorter than the shortest frame. A frame starts at
+ * the time it was requested, or the bus was free, even if a step has passed
+ * since, so arbitration and delivery are exact.
+ *
+ * Script lines are <tt>ms command arguments</tt>, ms the time since reset,
+ * in order, # starts a comment. \p node is the name given to a node:
+ * <ul>
+ * <li> <tt>node name file.so [card.img]</tt> load a node, at 0 only, with
+ * the card of the logger, created and formatted if missing.
+ * <li> <tt>in node IN1 0|1|-</tt> drive an input low or high, - releases it
+ * to the pull-up.
+ * <li> <tt>pulse node IN1 hz</tt> drive an input with a square wave, 0 stops
+ * it.
+ * <li> <tt>adc node ADC_IN4 value</tt> the conversion result of an analog
+ * input, also TEMP or a channel number.
+ * <li> <tt>power node 0|1</tt> early brown-out warning on or off, analog
+ * comparator 2.
+ * <li> <tt>can id data</tt> send a frame, \p id a number or a name of
+ * \ref names, \p data a message of \ref messages or bytes in hex in the
+ * order of the array given to can_setup_tx.
+ * <li> <tt>dta on|off</tt> start or stop the DTA, <tt>dta period ms</tt>
+ * its period, default 10 ms, <tt>dta field value</tt> a value it sends, see
+ * \ref dta_fields.
+ * <li> <tt>replay file</tt> send the frames of a log, the text written by
+ * canlog2csv or the old logger, at the times they were logged, the first
+ * now. The run lasts until 100 ms after the last frame, if longer than the
+ * script.
+ * <li> <tt>error node|id n</tt> destroy the next \p n frames of a node, also
+ * script or dta, or with an identifier.
+ * <li> <tt>detach node</tt> and <tt>attach node</tt> disconnect a node from
+ * the bus and connect it again.
+ * <li> <tt>latency label node OUT1 0|1 ms</tt> measure the time until
+ * get_output(OUT1) of the node would return the value, fail unless within
+ * \p ms. <tt>latency label tx id ms</tt> the same until a frame with \p id
+ * has been sent.
+ * <li> <tt>expect node OUT1 0|1</tt> fail unless get_output(OUT1) would
+ * return the value.
+ * <li> <tt>expect-pwm node duty</tt> fail unless the PWM of the clutch,
+ * OCR1B, is \p duty.
+ * <li> <tt>expect-can id</tt> fail unless a frame with \p id was sent since
+ * the last expect-can of \p id.
+ * <li> <tt>expect-bus node 0|1</tt> fail unless the CAN controller of the
+ * node is on the bus, enabled and not bus off, or not.
+ * <li> <tt>end</tt> stop.
+ * </ul>
+ *
+ * The bus load, in total and the highest of any 100 ms, the frames and error
+ * frames of each node, the longest time a frame of a node waited for the bus
+ * and the latencies are reported when done.
+ *
+ * With -b the register accesses made by the interrupts of each node, by its
+ * functions and by a pass of its main loop are written to a file, one line of
+ * <tt>node kind name count average max</tt> each, kind isr, function or loop,
+ * the loop line naming a function called in each pass. Functions and passes
+ * are only counted when the nodes are built with -finstrument-functions, see
+ * \ref sim_functions and \ref sim_main_loop. The code between the accesses
+ * is not counted, so they do not tell how long an interrupt takes on the MCU,
+ * only how much I/O it does and how long it polls. With -B the file is
+ * compared with one written before, a maximum grown by more than a tenth
+ * fails.
+ *
+ * A log replayed into a node gives a trace of how its firmware answers what
+ * was recorded on the car, the traces of two revisions are compared by
+ * <tt>make diff</tt>. The nodes run as fast as they can, with -r no faster
+ * than the given times real time. As fast as they can is some 100 - 500 times
+ * real time for one node and 15 - 20 times for the car, not thousands, see
+ * \ref sim. A log replayed into rear and mid runs at some 50 - 80 times
+ * real time, short of the hundreds of times asked of the replay.
+ *
+ * Usage: <tt>host_bus [-t ms] [-r rate] [-o trace] [-v] [-d dir] [-b file [-B file]] script</tt>.
+ */
+
+#define _GNU_SOURCE // dladdr
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../header_and_config/LUR7.h"
+#include "sim.h"
+#include "sdcard.h"
+
+//! A pin of the PCB.
+typedef struct {
+	const char * name;
+	uint8_t port;	//!< \ref IN1 - \ref LED0.
+} pin_name_t;
+
+static const pin_name_t pins[] = {
+	{"IN1", IN1}, {"IN2", IN2}, {"IN3", IN3}, {"IN4", IN4}, {"IN5", IN5},
+	{"IN6", IN6}, {"IN7", IN7}, {"IN8", IN8}, {"IN9", IN9},
+	{"OUT1", OUT1}, {"OUT2", OUT2}, {"OUT3", OUT3}, {"OUT4", OUT4},
+	{"OUT5", OUT5}, {"OUT6", OUT6}, {"OUT7", OUT7}, {"OUT8", OUT8},
+	{"LED0", LED0}
+};
+
+//! Analog inputs.
+static const struct {
+	const char * name;
+	uint8_t channel;
+} analogs[] = {
+	{"ADC_IN4", ADC_IN4}, {"ADC_IN6", ADC_IN6}, {"ADC_IN8", ADC_IN8},
+	{"ADC_IN9", ADC_IN9}, {"TEMP", ADC_TEMP}
+};
+
+//! Identifiers by name, as in LUR7_can.c, taken from the first node.
+static const struct {
+	const char * name;
+	const char * symbol;
+} names[] = {
+	{"DTA", "CAN_DTA_ID"},
+	{"FRONT_SPEED", "CAN_FRONT_LOG_SPEED_ID"},
+	{"FRONT_SUSPENSION", "CAN_FRONT_LOG_SUSPENSION_ID"},
+	{"STEER_BRAKE", "CAN_FRONT_LOG_STEER_BRAKE_ID"},
+	{"GEAR", "CAN_GEAR_ID"},
+	{"CLUTCH", "CAN_CLUTCH_ID"},
+	{"LAUNCH", "CAN_LAUNCH_ID"},
+	{"LOG", "CAN_LOG_ID"},
+	{"REAR_SPEED", "CAN_REAR_LOG_SPEED_ID"},
+	{"REAR_SUSPENSION", "CAN_REAR_LOG_SUSPENSION_ID"},
+	{"REAR_NEUTRAL", "CAN_REAR_LOG_NEUTRAL_ID"},
+	{"REAR_FILTER", "CAN_REAR_LOG_FILTER_ID"},
+	{"REAR_DUTYCYCLE", "CAN_REAR_LOG_DUTYCYCLE_ID"},
+	{"REAR_GEAR", "CAN_REAR_GEAR_ID"}
+};
+
+//! Messages by name, as in LUR7_can.c, taken from the first node.
+static const struct {
+	const char * name;
+	const char * symbol;
+	uint8_t dlc;
+} messages[] = {
+	{"BRAKE_ON", "CAN_MSG_BRAKE_ON", sizeof(CAN_MSG_BRAKE_ON)},
+	{"BRAKE_OFF", "CAN_MSG_BRAKE_OFF", sizeof(CAN_MSG_BRAKE_OFF)},
+	{"GEAR_UP", "CAN_MSG_GEAR_UP", sizeof(CAN_MSG_GEAR_UP)},
+	{"GEAR_DOWN", "CAN_MSG_GEAR_DOWN", sizeof(CAN_MSG_GEAR_DOWN)},
+	{"NEUTRAL_SINGLE", "CAN_MSG_GEAR_NEUTRAL_SINGLE", sizeof(CAN_MSG_GEAR_NEUTRAL_SINGLE)},
+	{"NEUTRAL_REPEAT", "CAN_MSG_GEAR_NEUTRAL_REPEAT", sizeof(CAN_MSG_GEAR_NEUTRAL_REPEAT)},
+	{"POT_GOOD", "CAN_MSG_POT_GOOD", sizeof(CAN_MSG_POT_GOOD)},
+	{"POT_DISS", "CAN_MSG_POT_DISS", sizeof(CAN_MSG_POT_DISS)},
+	{"LAUNCH", "CAN_MSG_LAUNCH", sizeof(CAN_MSG_LAUNCH)},
+	{"LOG_START", "CAN_MSG_LOG_START", sizeof(CAN_MSG_LOG_START)},
+	{"LOG_STOP", "CAN_MSG_LOG_STOP", sizeof(CAN_MSG_LOG_STOP)}
+};
+
+//! Values sent by the DTA, four 16 bit values, little endian, in each of 0x2000 - 0x2005.
+static const char * const dta_fields[24] = {
+	"rpm", "tps", "water", "air",
+	"map", "lambda", "kph", "oilp",
+	"fuelp", "oiltemp", "volts", "fuelcon",
+	"gear", "advance", "injection", "fuelcon100",
+	"ana1", "ana2", "ana3", "camadv",
+	"camtarg", "campwm", "crankerr", "camerr"
+};
+
+#define MAX_NODES	8	//!< Nodes and other senders on the bus.
+#define MAX_QUEUE	64	//!< Frames waiting for the bus, of the script or the DTA.
+#define MAX_SEEN	64	//!< Identifiers remembered for expect-can.
+#define MAX_ERRORS	16	//!< Identifiers with frames to destroy.
+#define MAX_WATCHES	16	//!< Latencies being measured.
+#define MAX_LATENCIES	32	//!< Latencies reported.
+#define MAX_IDS		64	//!< Identifiers counted.
+#define DTA_ID		0x2000	//!< First identifier sent by the DTA, as CAN_DTA_ID.
+#define STEP_BITS	50	//!< Length of a step of the nodes, shorter than any frame.
+#define LOAD_WINDOW	100000000ULL	//!< Window of the peak bus load, ns.
+#define REPLAY_TAIL	100000000ULL	//!< Time run after the last frame of a log, ns.
+
+//! A sender on the bus, a node or the script or the DTA.
+typedef struct {
+	char name[16];
+	char path[256];		//!< Of the shared object.
+	void * so;		//!< The node, NULL for the script and the DTA.
+	//! \name Functions of the node, see \ref sim.h.
+	//! @{
+	void (*init)(int (*)(void), const sim_callbacks_t *);
+	void (*run_until)(uint64_t);
+	uint64_t (*now)(void);
+	uint64_t (*accesses)(void);
+	uint64_t (*idle)(void);
+	uint64_t (*skipped)(void);
+	void (*set_input)(uint8_t, int8_t);
+	void (*set_square)(uint8_t, uint64_t);
+	uint8_t (*get_pin)(uint8_t);
+	void (*set_analog)(uint8_t, uint16_t);
+	void (*set_comparator)(uint8_t, uint8_t);
+	uint8_t (*can_pending)(sim_frame_t *);
+	void (*can_transmitted)(void);
+	uint8_t (*can_receive)(const sim_frame_t *);
+	void (*can_error)(uint8_t);
+	uint8_t (*can_active)(void);
+	uint64_t (*can_bit_ns)(void);
+	const sim_profile_t * (*isr_profile)(uint8_t);
+	const sim_function_t * (*functions)(uint16_t *);
+	const sim_profile_t * (*main_loop)(void **);
+	int (*firmware)(void);
+	void (*card_close)(void);
+	//! @}
+	uint8_t attached;	//!< Connected to the bus.
+	uint8_t active;		//!< CAN controller on the bus, as last traced.
+	uint16_t pwm_duty;	//!< Duty cycle of the PWM last reported.
+	uint64_t requests[MAX_QUEUE];	//!< When the frames waiting were requested, oldest first.
+	uint8_t waiting;
+	sim_frame_t queue[MAX_QUEUE];	//!< Frames of the script or the DTA.
+	uint8_t queued;
+	uint32_t destroy;	//!< Frames to destroy.
+	uint64_t sent;
+	uint64_t errors;
+	uint64_t max_wait;	//!< Longest time from request to the start of a frame sent, ns.
+} node_t;
+
+//! A latency being measured.
+typedef struct {
+	char label[32];
+	int line;
+	node_t * node;		//!< Output of the node, NULL for a frame.
+	uint8_t code;		//!< As IO_PIN_CODE.
+	uint8_t value;		//!< As get_output.
+	uint32_t id;
+	uint64_t from;
+	uint64_t deadline;
+} watch_t;
+
+//! A line of the trace.
+typedef struct {
+	uint64_t at;
+	uint32_t seq;
+	char * text;
+} trace_line_t;
+
+static FILE * trace;
+static trace_line_t * lines;	//!< Lines of the trace not yet written.
+static uint32_t n_lines;
+static uint32_t max_lines;
+static int verbose;
+static const char * node_dir;	//!< Where the nodes are loaded from, NULL for as given.
+static uint64_t t;		//!< Time of the harness, ns.
+static int failures;
+static node_t nodes[MAX_NODES];
+static uint8_t n_nodes;
+static node_t * script_node;	//!< The script, sending frames.
+static node_t * current;	//!< The node running.
+static uint16_t (*can_bits)(const sim_frame_t *);	//!< sim_can_bits of the first node.
+
+//! The bus.
+static struct {
+	uint8_t busy;
+	uint8_t error;		//!< The frame on the bus is destroyed.
+	node_t * sender;
+	uint64_t start;
+	uint64_t end;		//!< When the frame on the bus has been sent.
+	uint64_t idle;		//!< Since when the bus is free.
+	sim_frame_t frame;
+	uint32_t seen[MAX_SEEN];	//!< Identifiers sent, for expect-can.
+	uint8_t n_seen;
+	struct {
+		uint32_t id;
+		uint32_t n;
+	} destroy[MAX_ERRORS];	//!< Frames to destroy by identifier.
+	uint8_t n_destroy;
+	struct {
+		uint32_t id;
+		uint64_t n;
+	} ids[MAX_IDS];		//!< Frames sent by identifier.
+	uint8_t n_ids;
+	uint64_t frames;
+	uint64_t errors;
+	uint64_t busy_ns;
+	uint64_t window;	//!< Start of the window of the peak load.
+	uint64_t window_ns;	//!< Time busy in the window.
+	uint64_t peak_ns;	//!< Time busy in the busiest window.
+} bus;
+
+//! The DTA stand-in.
+static struct {
+	node_t * node;
+	uint8_t on;
+	uint64_t period;	//!< ns.
+	uint64_t next;		//!< When it sends next.
+	uint16_t values[24];	//!< As \ref dta_fields.
+} dta;
+
+//! The log replayed.
+static struct {
+	node_t * node;
+	FILE * file;		//!< NULL when all has been sent.
+	char name[256];
+	int line;
+	uint8_t started;	//!< The first frame has been read.
+	uint64_t first;		//!< Time of the first frame in the log, µs.
+	uint64_t start;		//!< When the first frame is sent.
+	uint64_t next;		//!< When \ref frame is sent.
+	uint64_t done;		//!< When the run may end, 0 if nothing is replayed.
+	sim_frame_t frame;	//!< The next frame.
+	uint64_t frames;
+	uint64_t bad;		//!< Lines not understood.
+	uint64_t dropped;	//!< Frames not sent, the queue was full.
+	struct timespec host_start;	//!< Host time at \ref start.
+} replay;
+
+static watch_t watches[MAX_WATCHES];
+static uint8_t n_watches;
+
+//! Latencies measured, by label.
+static struct {
+	char label[32];
+	uint32_t n;
+	uint64_t min;
+	uint64_t max;
+} latencies[MAX_LATENCIES];
+static uint8_t n_latencies;
+
+//! Prints the usage.
+static void usage(const char * name) {
+	fprintf(stderr,
+		"usage: %s [options] script\n"
+		"  -t ms      run this long, default until the end of the script\n"
+		"  -r rate    run at most rate times real time\n"
+		"  -o file    write the trace to file, default stdout\n"
+		"  -v         report the frames of each identifier\n"
+		"  -d dir     load the nodes from dir\n"
+		"  -b file    write the register accesses of the interrupts and functions to file\n"
+		"  -B file    fail if any took a tenth longer than in file, written by -b\n", name);
+	exit(2);
+}
+
+//! Helper function, adds a line to the trace.
+/*!
+ * The nodes run one after the other, the lines of a step are written in order
+ * of time by \ref trace_flush.
+ */
+static void trace_line(uint64_t at, const char * format, ...) __attribute__((format(printf, 2, 3)));
+static void trace_line(uint64_t at, const char * format, ...) {
+	char text[160];
+	va_list ap;
+	va_start(ap, format);
+	vsnprintf(text, sizeof(text), format, ap);
+	va_end(ap);
+	if (n_lines == max_lines) {
+		max_lines = max_lines ? 2 * max_lines : 256;
+		lines = realloc(lines, max_lines * sizeof(lines[0]));
+		if (!lines) {
+			perror("trace");
+			exit(2);
+		}
+	}
+	lines[n_lines].at = at;
+	lines[n_lines].seq = n_lines;
+	lines[n_lines++].text = strdup(text);
+}
+
+//! Helper function, orders lines of the trace by time, then as added.
+static int trace_order(const void * a, const void * b) {
+	const trace_line_t * x = a;
+	const trace_line_t * y = b;
+	if (x->at != y->at) {
+		return x->at < y->at ? -1 : 1;
+	}
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+//! Helper function, writes the lines of the trace added.
+static void trace_flush(void) {
+	qsort(lines, n_lines, sizeof(lines[0]), trace_order);
+	for (uint32_t i = 0; i < n_lines; i++) {
+		fprintf(trace, "%12.3f %s\n", lines[i].at / 1e6, lines[i].text);
+		free(lines[i].text);
+	}
+	n_lines = 0;
+}
+
+//! Helper function, a failed expectation.
+static void fail(int line, const char * format, ...) __attribute__((format(printf, 2, 3)));
+static void fail(int line, const char * format, ...) {
+	char what[128];
+	va_list ap;
+	va_start(ap, format);
+	vsnprintf(what, sizeof(what), format, ap);
+	va_end(ap);
+	trace_line(t, "FAIL line %d: %s", line, what);
+	fprintf(stderr, "line %d at %.3f ms: %s\n", line, t / 1e6, what);
+	failures++;
+}
+
+//! Helper function, records a latency.
+static void latency_done(const watch_t * w, uint64_t at) {
+	uint64_t ns = at - w->from;
+	trace_line(at, "latency %s %.3f ms", w->label, ns / 1e6);
+	if (at > w->deadline) {
+		fail(w->line, "latency %s %.3f ms, expected at most %.3f ms", w->label, ns / 1e6,
+				(w->deadline - w->from) / 1e6);
+	}
+	uint8_t i;
+	for (i = 0; i < n_latencies && strcmp(latencies[i].label, w->label); i++);
+	if (i == MAX_LATENCIES) {
+		return;
+	}
+	if (i == n_latencies) {
+		n_latencies++;
+		strcpy(latencies[i].label, w->label);
+		latencies[i].min = ns;
+	}
+	latencies[i].n++;
+	latencies[i].min = ns < latencies[i].min ? ns : latencies[i].min;
+	latencies[i].max = ns > latencies[i].max ? ns : latencies[i].max;
+}
+
+//! Helper function, ends the latencies measured by an event, \p node NULL for a frame.
+static void watch_event(node_t * node, uint8_t code, uint8_t value, uint32_t id, uint64_t at) {
+	for (uint8_t i = 0; i < n_watches; i++) {
+		watch_t * w = &watches[i];
+		if (w->node == node && (node ? w->code == code && w->value == value : w->id == id)) {
+			latency_done(w, at);
+			watches[i--] = watches[--n_watches];
+		}
+	}
+}
+
+//! Helper function, fails the latencies not measured in time.
+static void watch_expire(void) {
+	for (uint8_t i = 0; i < n_watches; i++) {
+		watch_t * w = &watches[i];
+		if (t > w->deadline) {
+			fail(w->line, "latency %s, nothing within %.3f ms", w->label, (w->deadline - w->from) / 1e6);
+			watches[i--] = watches[--n_watches];
+		}
+	}
+}
+
+//! Callback, a pin driven by the node running changed.
+static void pin_changed(uint8_t code, uint8_t level) {
+	for (uint8_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+		if (pins[i].port >= FIRST_OUT && IO_PIN_CODE(pins[i].port) == code) {
+			uint64_t at = current->now();
+			trace_line(at, "%s out %s %u", current->name, pins[i].name, !level); // as get_output
+			watch_event(current, code, !level, 0, at);
+			return;
+		}
+	}
+}
+
+//! Callback, the PWM of the clutch of the node running changed.
+static void pwm_changed(uint16_t duty, uint16_t top) {
+	current->pwm_duty = duty;
+	trace_line(current->now(), "%s pwm OUT1 %u/%u", current->name, duty, top);
+}
+
+//! Callback, the node running has a frame for the bus.
+static void can_request(void) {
+	if (current->waiting < MAX_QUEUE) {
+		current->requests[current->waiting++] = current->now();
+	}
+}
+
+//! Helper function, removes trailing blanks from \p text, which may be NULL.
+static char * trim(char * text) {
+	size_t n = text ? strlen(text) : 0;
+	while (n && (text[n - 1] == ' ' || text[n - 1] == '\t')) {
+		text[--n] = '\0';
+	}
+	return text;
+}
+
+//! Helper function, a pin by name.
+static int pin_by_name(const char * name, uint8_t * port) {
+	for (uint8_t i = 0; name && i < sizeof(pins) / sizeof(pins[0]); i++) {
+		if (!strcmp(pins[i].name, name)) {
+			*port = pins[i].port;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//! Helper function, a variable of the firmware of the first node, NULL if none.
+static const void * node_symbol(const char * symbol) {
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		if (nodes[i].so) {
+			return dlsym(nodes[i].so, symbol);
+		}
+	}
+	return NULL;
+}
+
+//! Helper function, an identifier by name or number.
+static int id_by_name(const char * name, uint32_t * id) {
+	char * end;
+	if (!name) {
+		return 0;
+	}
+	for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (!strcmp(names[i].name, name)) {
+			const uint32_t * p = node_symbol(names[i].symbol);
+			*id = p ? *p : 0;
+			return p != NULL;
+		}
+	}
+	*id = strtoul(name, &end, 0);
+	return *end == '\0' && end != name && *id < (1UL << 29);
+}
+
+//! Helper function, a sender on the bus by name.
+static node_t * node_by_name(const char * name) {
+	for (uint8_t i = 0; name && i < n_nodes; i++) {
+		if (!strcmp(nodes[i].name, name)) {
+			return &nodes[i];
+		}
+	}
+	return NULL;
+}
+
+//! Helper function, a node with firmware by name.
+static node_t * mcu_by_name(const char * name) {
+	node_t * n = node_by_name(name);
+	return n && n->so ? n : NULL;
+}
+
+//! Helper function, parses the data of a frame, bytes in firmware order.
+static int parse_data(char * text, sim_frame_t * f) {
+	uint8_t data[8];
+	uint8_t dlc = 0;
+	char * tok = strtok(text, " \t");
+	for (uint8_t i = 0; tok && i < sizeof(messages) / sizeof(messages[0]); i++) {
+		if (!strcmp(messages[i].name, tok)) {
+			const uint8_t * p = node_symbol(messages[i].symbol);
+			if (!p) {
+				return 0;
+			}
+			memcpy(data, p, messages[i].dlc);
+			dlc = messages[i].dlc;
+			if (strtok(NULL, " \t")) {
+				return 0;
+			}
+			tok = NULL;
+		}
+	}
+	for (; tok; tok = strtok(NULL, " \t")) {
+		char * end;
+		unsigned long b = strtoul(tok, &end, 16);
+		if (*end || b > 0xFF || dlc == 8) {
+			return 0;
+		}
+		data[dlc++] = b;
+	}
+	f->dlc = dlc;
+	for (uint8_t i = 0; i < dlc; i++) { // sent reversed, see can_setup_tx
+		f->data[i] = data[dlc - 1 - i];
+	}
+	return 1;
+}
+
+//! Helper function, adds a sender without firmware.
+static node_t * node_add(const char * name) {
+	node_t * n = &nodes[n_nodes++];
+	memset(n, 0, sizeof(*n));
+	snprintf(n->name, sizeof(n->name), "%s", name);
+	n->attached = 1;
+	return n;
+}
+
+//! Helper function, loads a node.
+/*!
+ * \return 0 on failure, reported.
+ */
+static int node_load(const char * name, const char * file, const char * image) {
+	char path[256];
+	if (n_nodes == MAX_NODES || node_by_name(name)) {
+		fprintf(stderr, "%s: too many nodes or the name is taken\n", name);
+		return 0;
+	}
+	if (node_dir) {
+		snprintf(path, sizeof(path), "%s/%s", node_dir, file);
+	} else {
+		snprintf(path, sizeof(path), "%s%s", strchr(file, '/') ? "" : "./", file);
+	}
+	void * so = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!so) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 0;
+	}
+	node_t * n = node_add(name);
+	n->so = so;
+	snprintf(n->path, sizeof(n->path), "%s", path);
+#define SYM(field, symbol) \
+	if (!(*(void **) &n->field = dlsym(so, symbol))) { \
+		fprintf(stderr, "%s: %s\n", file, dlerror()); \
+		return 0; \
+	}
+	SYM(init, "sim_init");
+	SYM(run_until, "sim_run_until");
+	SYM(now, "sim_now");
+	SYM(accesses, "sim_accesses");
+	SYM(idle, "sim_idle");
+	SYM(skipped, "sim_skipped");
+	SYM(set_input, "sim_set_input");
+	SYM(set_square, "sim_set_square");
+	SYM(get_pin, "sim_get_pin");
+	SYM(set_analog, "sim_set_analog");
+	SYM(set_comparator, "sim_set_comparator");
+	SYM(can_pending, "sim_can_pending");
+	SYM(can_transmitted, "sim_can_transmitted");
+	SYM(can_receive, "sim_can_receive");
+	SYM(can_error, "sim_can_error");
+	SYM(can_active, "sim_can_active");
+	SYM(can_bit_ns, "sim_can_bit_ns");
+	SYM(isr_profile, "sim_isr_profile");
+	SYM(functions, "sim_functions");
+	SYM(main_loop, "sim_main_loop");
+	SYM(firmware, "avr_main");
+	if (!can_bits) {
+		*(void **) &can_bits = dlsym(so, "sim_can_bits");
+	}
+	if (image) {
+		int (*card_open)(const char *, uint32_t, const sdcard_model_t *);
+		sdcard_model_t model = {.cmd_us = 20, .spi_us = 130, .read_us = 150, .busy_us = 350};
+		SYM(card_close, "sdcard_close");
+		*(void **) &card_open = dlsym(so, "sdcard_open");
+		if (!card_open || card_open(image, 1024UL * 2048, &model)) {
+			perror(image);
+			return 0;
+		}
+	}
+#undef SYM
+	sim_callbacks_t callbacks = {.pin = pin_changed, .pwm = pwm_changed, .can_request = can_request};
+	n->init(n->firmware, &callbacks);
+	return 1;
+}
+
+//! Helper function, the time of a bit, as set by the first node on the bus.
+static uint64_t bit_ns(void) {
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		if (nodes[i].so && nodes[i].active) {
+			return nodes[i].can_bit_ns();
+		}
+	}
+	return 1000;
+}
+
+//! Helper function, until when all nodes only poll, see \ref sim_idle.
+/*!
+ * \return time, ns, 0 if a node does more than poll or a frame is on the bus.
+ */
+static uint64_t nodes_idle(void) {
+	uint64_t wake = UINT64_MAX;
+	if (bus.busy) {
+		return 0;
+	}
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		if (nodes[i].so) {
+			uint64_t w = nodes[i].idle();
+			if (w < wake) {
+				wake = w;
+			}
+		}
+	}
+	return wake;
+}
+
+//! Helper function, traces nodes turning their CAN controller on or off.
+static void nodes_active(void) {
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		node_t * n = &nodes[i];
+		uint8_t active = n->so ? n->can_active() : 1;
+		if (active != n->active) {
+			n->active = active;
+			if (n->so) {
+				trace_line(t, "%s can %s", n->name, active ? "on" : "off");
+			}
+		}
+	}
+}
+
+//! Helper function, the frame a sender has for the bus.
+static uint8_t node_frame(node_t * n, sim_frame_t * f) {
+	if (!n->attached) {
+		if (n->so) { // its frames wait from when it is attached
+			n->waiting = 0;
+		}
+		return 0;
+	}
+	if (!n->so) {
+		if (n->queued) {
+			*f = n->queue[0];
+		}
+		return n->queued;
+	}
+	if (!n->active || !n->can_pending(f)) {
+		n->waiting = 0;
+		return 0;
+	}
+	if (!n->waiting) { // pending since before it was attached
+		n->requests[n->waiting++] = t;
+	}
+	return 1;
+}
+
+//! Helper function, queues a frame of the script or the DTA.
+static int node_queue(node_t * n, const sim_frame_t * f) {
+	if (n->queued == MAX_QUEUE) {
+		return 0;
+	}
+	n->queue[n->queued++] = *f;
+	n->requests[n->waiting++] = t;
+	return 1;
+}
+
+//! Helper function, takes the first frame of a sender off its queue.
+static void node_dequeue(node_t * n) {
+	if (n->waiting) {
+		memmove(n->requests, n->requests + 1, --n->waiting * sizeof(n->requests[0]));
+	}
+	if (!n->so && n->queued) {
+		memmove(n->queue, n->queue + 1, --n->queued * sizeof(n->queue[0]));
+	}
+}
+
+//! Helper function, whether the frame about to be sent is destroyed.
+static uint8_t bus_destroy(node_t * n, uint32_t id) {
+	if (n->destroy) {
+		n->destroy--;
+		return 1;
+	}
+	for (uint8_t i = 0; i < bus.n_destroy; i++) {
+		if (bus.destroy[i].id == id) {
+			if (!--bus.destroy[i].n) {
+				bus.destroy[i] = bus.destroy[--bus.n_destroy];
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//! Helper function, starts the next frame if the bus is free.
+/*!
+ * The frame starts when the bus became free or when the first frame waiting
+ * was requested, whichever is later, and of the frames requested by then the
+ * lowest identifier wins, the first sender on a tie.
+ */
+static void bus_arbitrate(void) {
+	sim_frame_t f[MAX_NODES];
+	uint8_t has[MAX_NODES];
+	uint64_t first = UINT64_MAX;
+	if (bus.busy) {
+		return;
+	}
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		has[i] = node_frame(&nodes[i], &f[i]);
+		if (has[i] && nodes[i].requests[0] < first) {
+			first = nodes[i].requests[0];
+		}
+	}
+	if (first == UINT64_MAX || !can_bits) {
+		return;
+	}
+	uint64_t start = first > bus.idle ? first : bus.idle;
+	int win = -1;
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		if (has[i] && nodes[i].requests[0] <= start && (win < 0 || f[i].id < f[win].id)) {
+			win = i;
+		}
+	}
+	uint64_t bit = bit_ns();
+	uint16_t bits = can_bits(&f[win]);
+	bus.busy = 1;
+	bus.sender = &nodes[win];
+	bus.frame = f[win];
+	bus.start = start;
+	bus.error = bus_destroy(bus.sender, bus.frame.id);
+	if (bus.error) { // up to the ACK delimiter, error flag, delimiter and interframe space
+		bits = bits - 10 + 6 + 8 + 3;
+	}
+	bus.end = start + bits * bit;
+}
+
+//! Helper function, counts the time the bus was busy.
+static void bus_load(uint64_t start, uint64_t end) {
+	if (start >= bus.window + LOAD_WINDOW) {
+		if (bus.window_ns > bus.peak_ns) {
+			bus.peak_ns = bus.window_ns;
+		}
+		bus.window = start - start % LOAD_WINDOW;
+		bus.window_ns = 0;
+	}
+	bus.window_ns += end - start;
+	bus.busy_ns += end - start;
+}
+
+//! Helper function, the frame on the bus has been sent, or destroyed.
+static void bus_done(void) {
+	node_t * s = bus.sender;
+	const sim_frame_t * f = &bus.frame;
+	char text[32];
+	char * p = text;
+	for (uint8_t i = f->dlc; i > 0; i--) { // in firmware order
+		p += sprintf(p, " %02x", f->data[i - 1]);
+	}
+	*p = '\0';
+	bus.busy = 0;
+	bus.idle = bus.end;
+	bus_load(bus.start, bus.end);
+	if (bus.error) {
+		trace_line(t, "bus error %s %08" PRIx32 " %u%s", s->name, f->id, f->dlc, text);
+		bus.errors++;
+		s->errors++;
+		for (uint8_t i = 0; i < n_nodes; i++) {
+			node_t * n = &nodes[i];
+			if (n->so && n->attached && n->active) {
+				n->can_error(n == s);
+			}
+		}
+		return;
+	}
+	trace_line(t, "bus tx %s %08" PRIx32 " %u%s", s->name, f->id, f->dlc, text);
+	bus.frames++;
+	s->sent++;
+	if (bus.start - s->requests[0] > s->max_wait) {
+		s->max_wait = bus.start - s->requests[0];
+	}
+	if (s->so) {
+		s->can_transmitted();
+	}
+	node_dequeue(s);
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		node_t * n = &nodes[i];
+		if (n != s && n->so && n->attached) {
+			n->can_receive(f);
+		}
+	}
+	watch_event(NULL, 0, 0, f->id, t);
+	uint8_t i;
+	for (i = 0; i < bus.n_ids && bus.ids[i].id != f->id; i++);
+	if (i < MAX_IDS) {
+		bus.ids[i].id = f->id;
+		bus.ids[i].n++;
+		bus.n_ids += (i == bus.n_ids);
+	}
+	for (i = 0; i < bus.n_seen && bus.seen[i] != f->id; i++);
+	if (i == bus.n_seen && bus.n_seen < MAX_SEEN) {
+		bus.seen[bus.n_seen++] = f->id;
+	}
+}
+
+//! Helper function, the DTA sends its frames when due.
+static void dta_send(void) {
+	if (!dta.on || t < dta.next) {
+		return;
+	}
+	for (uint8_t k = 0; k < 6; k++) {
+		sim_frame_t f = {.id = DTA_ID + k, .dlc = 8};
+		for (uint8_t v = 0; v < 4; v++) {
+			f.data[2 * v] = dta.values[4 * k + v] & 0xFF;
+			f.data[2 * v + 1] = dta.values[4 * k + v] >> 8;
+		}
+		node_queue(dta.node, &f);
+	}
+	dta.next += dta.period;
+}
+
+//! Helper function, reads the next frame of the log replayed.
+/*!
+ * A line is <tt>ID, time in ms, data bytes</tt>, the identifier in hex, the
+ * time with at most three decimals and up to eight bytes in decimal in the
+ * order of the array given to can_setup_tx, as read by the decoder. The
+ * number of bytes is the DLC. The file is closed at its end.
+ */
+static void replay_read(void) {
+	char text[256];
+	while (fgets(text, sizeof(text), replay.file)) {
+		replay.line++;
+		char * end;
+		char * tok = strtok(text, ", \t\r\n");
+		if (!tok) {
+			continue;
+		}
+		sim_frame_t f = {.id = strtoul(tok, &end, 16)};
+		uint8_t ok = *end == '\0' && f.id < (1UL << 29);
+		tok = strtok(NULL, ", \t\r\n");
+		double ms = tok ? strtod(tok, &end) : -1;
+		ok &= ms >= 0 && *end == '\0';
+		uint8_t data[8];
+		for (tok = strtok(NULL, ", \t\r\n"); ok && tok; tok = strtok(NULL, ", \t\r\n")) {
+			unsigned long b = strtoul(tok, &end, 10);
+			ok &= *end == '\0' && b <= 0xFF && f.dlc < 8;
+			data[f.dlc++] = b;
+		}
+		if (!ok) {
+			replay.bad++;
+			continue;
+		}
+		for (uint8_t i = 0; i < f.dlc; i++) { // sent reversed, see can_setup_tx
+			f.data[i] = data[f.dlc - 1 - i];
+		}
+		uint64_t us = ms * 1000 + 0.5;
+		if (!replay.started) {
+			replay.started = 1;
+			replay.first = us;
+		}
+		replay.frame = f;
+		replay.next = replay.start + (us > replay.first ? (us - replay.first) * 1000 : 0);
+		if (replay.next < t) { // the log went back in time
+			replay.next = t;
+		}
+		return;
+	}
+	fclose(replay.file);
+	replay.file = NULL;
+	replay.done = (replay.started ? replay.next : t) + REPLAY_TAIL;
+}
+
+//! Helper function, the log replayed sends its frames when due.
+static void replay_send(void) {
+	while (replay.file && t >= replay.next) {
+		if (node_queue(replay.node, &replay.frame)) {
+			replay.frames++;
+		} else {
+			replay.dropped++;
+		}
+		replay_read();
+	}
+}
+
+//! Helper function, runs a line of the script.
+/*!
+ * \return 0 on a syntax error.
+ */
+static int command(int line, char * cmd, char * args) {
+	if (!strcmp(cmd, "can")) {
+		sim_frame_t f;
+		char * a = strtok(args, " \t");
+		char * b = a ? strtok(NULL, "") : NULL;
+		return id_by_name(a, &f.id) && b && parse_data(b, &f) && node_queue(script_node, &f);
+	}
+	if (!strcmp(cmd, "replay")) { // the file name may hold blanks
+		args += strspn(args, " \t");
+		if (replay.node || !*args || !(replay.file = fopen(args, "r"))) {
+			if (*args && !replay.node) {
+				perror(args);
+			}
+			return 0;
+		}
+		if (n_nodes == MAX_NODES) {
+			return 0;
+		}
+		replay.node = node_add("replay");
+		snprintf(replay.name, sizeof(replay.name), "%s", args);
+		replay.start = t;
+		clock_gettime(CLOCK_MONOTONIC, &replay.host_start);
+		trace_line(t, "replay %s", args);
+		replay_read();
+		return 1;
+	}
+	char * a = strtok(args, " \t");
+	char * b = a ? strtok(NULL, " \t") : NULL;
+	char * c = b ? strtok(NULL, "") : NULL;
+	node_t * n = mcu_by_name(a);
+	uint8_t port;
+	if (!strcmp(cmd, "node") && a && b) {
+		if (t) {
+			return 0;
+		}
+		if (!node_load(a, b, c)) {
+			exit(2);
+		}
+	} else if (!strcmp(cmd, "in") && n && c && pin_by_name(b, &port)) {
+		n->set_input(IO_PIN_CODE(port), *c == '-' ? -1 : atoi(c));
+		trace_line(t, "%s in %s %s", a, b, c);
+	} else if (!strcmp(cmd, "pulse") && n && c && pin_by_name(b, &port)) {
+		double hz = atof(c);
+		n->set_square(IO_PIN_CODE(port), hz > 0 ? 5e8 / hz : 0);
+		trace_line(t, "%s pulse %s %s", a, b, c);
+	} else if (!strcmp(cmd, "adc") && n && c) {
+		int channel = -1;
+		for (uint8_t i = 0; i < sizeof(analogs) / sizeof(analogs[0]); i++) {
+			if (!strcmp(analogs[i].name, b)) {
+				channel = analogs[i].channel;
+			}
+		}
+		if (channel < 0) {
+			channel = atoi(b);
+		}
+		n->set_analog(channel, atoi(c));
+	} else if (!strcmp(cmd, "power") && n && b) {
+		n->set_comparator(2, !atoi(b)); // output high warns
+		trace_line(t, "%s power %s", a, b);
+	} else if (!strcmp(cmd, "dta") && a) {
+		if (!strcmp(a, "on") || !strcmp(a, "off")) {
+			dta.on = !strcmp(a, "on");
+			dta.next = t;
+		} else if (!strcmp(a, "period") && b && atof(b) > 0) {
+			dta.period = atof(b) * 1e6;
+		} else {
+			uint8_t i;
+			for (i = 0; i < 24 && strcmp(dta_fields[i], a); i++);
+			if (i == 24 || !b) {
+				return 0;
+			}
+			dta.values[i] = atoi(b);
+		}
+		trace_line(t, "dta %s%s%s", a, b ? " " : "", b ? b : "");
+	} else if (!strcmp(cmd, "error") && a && b) {
+		node_t * s = node_by_name(a);
+		uint32_t id;
+		if (s) {
+			s->destroy += atoi(b);
+		} else if (id_by_name(a, &id) && bus.n_destroy < MAX_ERRORS) {
+			bus.destroy[bus.n_destroy].id = id;
+			bus.destroy[bus.n_destroy++].n = atoi(b);
+		} else {
+			return 0;
+		}
+		trace_line(t, "error %s %s", a, b);
+	} else if ((!strcmp(cmd, "detach") || !strcmp(cmd, "attach")) && node_by_name(a)) {
+		node_by_name(a)->attached = (cmd[0] == 'a');
+		trace_line(t, "%s %s", a, cmd);
+	} else if (!strcmp(cmd, "latency") && a && c && n_watches < MAX_WATCHES) {
+		watch_t * w = &watches[n_watches];
+		char * d = strtok(c, " \t");
+		char * e = d ? strtok(NULL, " \t") : NULL;
+		char * f = e ? strtok(NULL, " \t") : NULL;
+		memset(w, 0, sizeof(*w));
+		snprintf(w->label, sizeof(w->label), "%s", a);
+		w->line = line;
+		w->from = t;
+		if (!strcmp(b, "tx") && id_by_name(d, &w->id) && e) {
+			w->deadline = t + atof(e) * 1e6;
+		} else if ((w->node = mcu_by_name(b)) && pin_by_name(d, &port) && port >= FIRST_OUT && f) {
+			w->code = IO_PIN_CODE(port);
+			w->value = atoi(e);
+			w->deadline = t + atof(f) * 1e6;
+		} else {
+			return 0;
+		}
+		n_watches++;
+	} else if (!strcmp(cmd, "expect") && n && c && pin_by_name(b, &port) && port >= FIRST_OUT) {
+		uint8_t value = !n->get_pin(IO_PIN_CODE(port)); // as get_output
+		if (value != atoi(c)) {
+			fail(line, "%s %s is %u, expected %s", a, b, value, c);
+		}
+	} else if (!strcmp(cmd, "expect-pwm") && n && b) {
+		if (n->pwm_duty != atoi(b)) {
+			fail(line, "%s PWM duty is %u, expected %s", a, n->pwm_duty, b);
+		}
+	} else if (!strcmp(cmd, "expect-can") && a) {
+		uint32_t id;
+		uint8_t found = 0;
+		if (!id_by_name(a, &id)) {
+			return 0;
+		}
+		for (uint8_t i = 0; i < bus.n_seen; i++) {
+			if (bus.seen[i] == id) {
+				bus.seen[i] = bus.seen[--bus.n_seen];
+				found = 1;
+			}
+		}
+		if (!found) {
+			fail(line, "no frame %08" PRIx32 " sent", id);
+		}
+	} else if (!strcmp(cmd, "expect-bus") && n && b) {
+		if (n->can_active() != atoi(b)) {
+			fail(line, "%s is %s the bus", a, atoi(b) ? "off" : "on");
+		}
+	} else {
+		return 0;
+	}
+	return 1;
+}
+
+//! Helper function, the report when done.
+static void report(const char * script, double host_s) {
+	uint64_t accesses = 0;
+	uint64_t skipped = 0;
+	uint8_t mcus = 0;
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		if (nodes[i].so) {
+			accesses += nodes[i].accesses();
+			skipped += nodes[i].skipped();
+			mcus++;
+		}
+	}
+	if (bus.window_ns > bus.peak_ns && t >= bus.window + LOAD_WINDOW) {
+		bus.peak_ns = bus.window_ns;
+	}
+	double load = t ? 100.0 * bus.busy_ns / t : 0.0;
+	double peak = t < LOAD_WINDOW ? load : 100.0 * bus.peak_ns / LOAD_WINDOW;
+	fprintf(stderr, "%s: %.3f s simulated in %.3f s, %.1f times real time, %u nodes, %" PRIu64
+			" register accesses, %.1f%% of the time skipped polling, %d failed\n", script, t / 1e9, host_s,
+			t / 1e9 / host_s, mcus, accesses, t && mcus ? 100.0 * skipped / t / mcus : 0.0, failures);
+	fprintf(stderr, "  bus: %" PRIu64 " frames, %" PRIu64 " error frames, load %.1f%%, peak %.1f%% in %u ms\n",
+			bus.frames, bus.errors, load, peak, (unsigned) (LOAD_WINDOW / 1000000));
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		node_t * n = &nodes[i];
+		if (n->sent || n->errors) {
+			fprintf(stderr, "  %s: %" PRIu64 " frames, %" PRIu64 " error frames, longest wait %.3f ms\n",
+					n->name, n->sent, n->errors, n->max_wait / 1e6);
+		}
+	}
+	for (uint8_t i = 0; i < n_latencies; i++) {
+		fprintf(stderr, "  latency %s: %u, %.3f - %.3f ms\n", latencies[i].label, latencies[i].n,
+				latencies[i].min / 1e6, latencies[i].max / 1e6);
+	}
+	if (replay.node) { // the nodes started before
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		double replay_s = (now.tv_sec - replay.host_start.tv_sec) + (now.tv_nsec - replay.host_start.tv_nsec) / 1e9;
+		fprintf(stderr, "  replay %s: %" PRIu64 " frames, %" PRIu64 " bad lines, %" PRIu64 " dropped, %.3f s in %.3f s, "
+				"%.1f times real time\n", replay.name, replay.frames, replay.bad, replay.dropped,
+				(t - replay.start) / 1e9, replay_s, (t - replay.start) / 1e9 / replay_s);
+	}
+	for (uint8_t i = 0; verbose && i < bus.n_ids; i++) {
+		fprintf(stderr, "  %08" PRIx32 ": %" PRIu64 " frames\n", bus.ids[i].id, bus.ids[i].n);
+	}
+}
+
+//! Interrupts by vector, as in avr/io.h.
+static const char * const vector_names[_VECTORS_SIZE] = {
+	NULL, "ANACOMP0_vect", "ANACOMP1_vect", "ANACOMP2_vect", "ANACOMP3_vect", "PSC_FAULT_vect",
+	"PSC_EC_vect", "INT0_vect", "INT1_vect", "INT2_vect", "INT3_vect", "TIMER1_CAPT_vect",
+	"TIMER1_COMPA_vect", "TIMER1_COMPB_vect", "TIMER1_OVF_vect", "TIMER0_COMPA_vect",
+	"TIMER0_COMPB_vect", "TIMER0_OVF_vect", "CAN_INT_vect", "CAN_TOVF_vect", "LIN_TC_vect",
+	"LIN_ERR_vect", "PCINT0_vect", "PCINT1_vect", "PCINT2_vect", "PCINT3_vect", "SPI_STC_vect",
+	"ADC_vect", "WDT_vect", "EE_READY_vect", "SPM_READY_vect"
+};
+
+#define BENCH_LINES	1024	//!< Lines of a report of register accesses.
+
+//! A line of the report of register accesses.
+typedef struct {
+	char node[16];
+	char kind[16];
+	char name[64];
+	uint64_t count;
+	double avg;
+	uint64_t max;
+} bench_line_t;
+
+static bench_line_t bench_lines[BENCH_LINES];
+static uint16_t n_bench;
+
+//! Helper function, adds a line to the report of register accesses.
+static void bench_add(const node_t * n, const char * kind, const char * name, const sim_profile_t * c) {
+	if (n_bench == BENCH_LINES || !c->count) {
+		return;
+	}
+	bench_line_t * b = &bench_lines[n_bench++];
+	snprintf(b->node, sizeof(b->node), "%s", n->name);
+	snprintf(b->kind, sizeof(b->kind), "%s", kind);
+	snprintf(b->name, sizeof(b->name), "%s", name);
+	b->count = c->count;
+	b->avg = (double) c->accesses / c->count;
+	b->max = c->max;
+}
+
+//! Helper function, orders the functions of a node by name.
+static int bench_order(const void * a, const void * b) {
+	return strcmp(((const bench_line_t *) a)->name, ((const bench_line_t *) b)->name);
+}
+
+//! Functions of a node, from the symbols of its shared object.
+static struct {
+	void * fn;
+	char name[64];
+} * symbols;
+static uint32_t n_symbols;
+
+//! Helper function, reads the functions of a node with nm.
+static void node_symbols(const node_t * n) {
+	Dl_info info;
+	char cmd[300];
+	char line[256];
+	uint32_t max = 0;
+	n_symbols = 0;
+	snprintf(cmd, sizeof(cmd), "nm --defined-only '%s'", n->path);
+	FILE * nm = dladdr(*(void **) &n->firmware, &info) ? popen(cmd, "r") : NULL;
+	while (nm && fgets(line, sizeof(line), nm)) {
+		unsigned long long address;
+		char type;
+		char name[sizeof(symbols[0].name)];
+		if (sscanf(line, "%llx %c %63s", &address, &type, name) != 3 || (type != 't' && type != 'T')) {
+			continue;
+		}
+		if (n_symbols == max) {
+			max = max ? 2 * max : 256;
+			symbols = realloc(symbols, max * sizeof(symbols[0]));
+			if (!symbols) {
+				perror("nm");
+				exit(2);
+			}
+		}
+		symbols[n_symbols].fn = (char *) info.dli_fbase + address;
+		strcpy(symbols[n_symbols++].name, name);
+	}
+	if (nm) {
+		pclose(nm);
+	}
+}
+
+//! Helper function, the name of a function read by \ref node_symbols, or its address.
+static void function_name(void * fn, char * name, size_t size) {
+	snprintf(name, size, "%p", fn);
+	for (uint32_t i = 0; i < n_symbols; i++) {
+		if (symbols[i].fn == fn) {
+			snprintf(name, size, "%s", symbols[i].name);
+			return;
+		}
+	}
+}
+
+//! Helper function, writes the report of register accesses, see -b.
+/*!
+ * \return 0 if it could not be written or the baseline read.
+ */
+static int bench_report(const char * file, const char * baseline) {
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		node_t * n = &nodes[i];
+		if (!n->so) {
+			continue;
+		}
+		for (uint8_t v = 1; v < _VECTORS_SIZE; v++) {
+			bench_add(n, "isr", vector_names[v], n->isr_profile(v));
+		}
+		uint16_t size;
+		const sim_function_t * f = n->functions(&size);
+		node_symbols(n);
+		uint16_t first = n_bench;
+		for (uint16_t k = 0; k < size; k++) {
+			char name[64];
+			if (!f[k].fn) {
+				continue;
+			}
+			function_name(f[k].fn, name, sizeof(name));
+			bench_add(n, "function", name, &f[k].run);
+		}
+		qsort(bench_lines + first, n_bench - first, sizeof(bench_lines[0]), bench_order);
+		void * fn;
+		const sim_profile_t * loop = n->main_loop(&fn);
+		if (loop) {
+			char name[64];
+			function_name(fn, name, sizeof(name));
+			bench_add(n, "loop", name, loop);
+		}
+	}
+	FILE * out = fopen(file, "w");
+	if (!out) {
+		perror(file);
+		return 0;
+	}
+	fprintf(out, "# node\tkind\tname\tcount\taverage\tmax, register accesses\n");
+	for (uint16_t i = 0; i < n_bench; i++) {
+		bench_line_t * b = &bench_lines[i];
+		fprintf(out, "%s\t%s\t%s\t%" PRIu64 "\t%.1f\t%" PRIu64 "\n", b->node, b->kind, b->name, b->count,
+				b->avg, b->max);
+	}
+	fclose(out);
+	if (!baseline) {
+		return 1;
+	}
+	FILE * in = fopen(baseline, "r");
+	if (!in) {
+		perror(baseline);
+		return 0;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), in)) {
+		bench_line_t old;
+		if (line[0] == '#' || sscanf(line, "%15s %15s %63s %" SCNu64 " %lf %" SCNu64, old.node, old.kind,
+				old.name, &old.count, &old.avg, &old.max) != 6) {
+			continue;
+		}
+		for (uint16_t i = 0; i < n_bench; i++) {
+			bench_line_t * b = &bench_lines[i];
+			if (!strcmp(b->node, old.node) && !strcmp(b->kind, old.kind) && !strcmp(b->name, old.name)
+					&& b->max > old.max + old.max / 10) {
+				fprintf(stderr, "%s: %s %s %s made %" PRIu64 " accesses, %" PRIu64 " in %s\n", file, b->node,
+						b->kind, b->name, b->max, old.max, baseline);
+				failures++;
+			}
+		}
+	}
+	fclose(in);
+	return 1;
+}
+
+int main(int argc, char ** argv) {
+	double run_ms = -1;
+	double rate = 0;
+	const char * out = NULL;
+	int opt;
+	const char * bench = NULL;
+	const char * baseline = NULL;
+	while ((opt = getopt(argc, argv, "t:r:o:vd:b:B:")) != -1) {
+		switch (opt) {
+			case 't': run_ms = atof(optarg); break;
+			case 'r': rate = atof(optarg); break;
+			case 'o': out = optarg; break;
+			case 'v': verbose = 1; break;
+			case 'd': node_dir = optarg; break;
+			case 'b': bench = optarg; break;
+			case 'B': baseline = optarg; break;
+			default: usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || (baseline && !bench)) {
+		usage(argv[0]);
+	}
+	FILE * script = fopen(argv[optind], "r");
+	if (!script) {
+		perror(argv[optind]);
+		return 2;
+	}
+	trace = out ? fopen(out, "w") : stdout;
+	if (!trace) {
+		perror(out);
+		return 2;
+	}
+	script_node = node_add("script");
+	dta.node = node_add("dta");
+	dta.period = 10000000;
+	struct timespec host_start, host_end;
+	clock_gettime(CLOCK_MONOTONIC, &host_start);
+
+	char text[256];
+	int line = 0;
+	uint64_t end = run_ms < 0 ? UINT64_MAX : run_ms * 1e6;
+	uint64_t next = 0;	// time of the pending line of the script
+	char * cmd = NULL;
+	char * args = NULL;
+	char empty[] = "";
+	int at_end = 0;
+	while (t < end) {
+		if (!cmd && !at_end) { // read ahead to the next command
+			while (!cmd && fgets(text, sizeof(text), script)) {
+				line++;
+				char * hash = strchr(text, '#');
+				if (hash) {
+					*hash = '\0';
+				}
+				char * time_text = strtok(text, " \t\r\n");
+				if (!time_text) {
+					continue;
+				}
+				cmd = strtok(NULL, " \t\r\n");
+				args = trim(strtok(NULL, "\r\n"));
+				uint64_t at = atof(time_text) * 1e6;
+				if (!cmd || at < next) {
+					fprintf(stderr, "%s:%d: bad line\n", argv[optind], line);
+					return 2;
+				}
+				next = at;
+			}
+			at_end = !cmd;
+		}
+		if (at_end && run_ms < 0 && !replay.file) { // and the log replayed
+			end = replay.done > t ? replay.done : t;
+		}
+		uint64_t stop = t + STEP_BITS * bit_ns();
+		uint64_t wake = nodes_idle();
+		if (wake > stop) { // no frame can be requested before then
+			stop = wake;
+		}
+		if (end < stop) {
+			stop = end;
+		}
+		if (cmd && next < stop) {
+			stop = next;
+		}
+		if (bus.busy && bus.end < stop) {
+			stop = bus.end;
+		}
+		if (dta.on && dta.next < stop) {
+			stop = dta.next;
+		}
+		if (replay.file && replay.next < stop) {
+			stop = replay.next;
+		}
+		for (uint8_t i = 0; i < n_watches; i++) {
+			if (watches[i].deadline + 1 < stop) {
+				stop = watches[i].deadline + 1;
+			}
+		}
+		if (stop > t) {
+			for (uint8_t i = 0; i < n_nodes; i++) {
+				if (nodes[i].so) {
+					current = &nodes[i];
+					current->run_until(stop);
+				}
+			}
+			current = NULL;
+			t = stop;
+		}
+		if (bus.busy && t >= bus.end) {
+			bus_done();
+		}
+		nodes_active();
+		watch_expire();
+		dta_send();
+		replay_send();
+		if (cmd && t >= next) {
+			if (!strcmp(cmd, "end")) {
+				break;
+			}
+			if (!command(line, cmd, args ? args : empty)) {
+				fprintf(stderr, "%s:%d: bad command\n", argv[optind], line);
+				return 2;
+			}
+			cmd = NULL;
+		}
+		bus_arbitrate();
+		trace_flush();
+		if (rate > 0) { // hold back to the rate
+			clock_gettime(CLOCK_MONOTONIC, &host_end);
+			double ahead = t / 1e9 / rate - (host_end.tv_sec - host_start.tv_sec)
+					- (host_end.tv_nsec - host_start.tv_nsec) / 1e9;
+			if (ahead > 0) {
+				struct timespec pause = {.tv_sec = ahead, .tv_nsec = (ahead - (time_t) ahead) * 1e9};
+				nanosleep(&pause, NULL);
+			}
+		}
+	}
+	trace_flush();
+
+	clock_gettime(CLOCK_MONOTONIC, &host_end);
+	double host_s = (host_end.tv_sec - host_start.tv_sec) + (host_end.tv_nsec - host_start.tv_nsec) / 1e9;
+	if (bench && !bench_report(bench, baseline)) {
+		return 2;
+	}
+	report(argv[optind], host_s);
+	if (out) {
+		fclose(trace);
+	}
+	for (uint8_t i = 0; i < n_nodes; i++) {
+		if (nodes[i].card_close) {
+			nodes[i].card_close();
+		}
+	}
+	return failures ? 1 : 0;
+}
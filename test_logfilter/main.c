@@ -0,0 +1,115 @@
+/*
+ * / main.c - Host test of the log filter of the LUR7 logger
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_logfilter/main.c
+ * Test of \ref logfilter.c, runs on the host, see the makefile.
+ *
+ * Lines of a rule file are parsed, good and bad ones, then one second of the
+ * traffic on the bus is sent through the rules and the number of frames kept
+ * per ID is checked: first matching rule decides, excluded IDs, every Nth,
+ * on change, and on change with a least rate.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "logfilter.h"
+
+//! Number of failed checks.
+static int failures = 0;
+
+//! Reports a failed check.
+static void check(int ok, const char * what) {
+	if (!ok) {
+		printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+//! Parses a line, a copy as the parser modifies it.
+static uint8_t parse(const char * line) {
+	char buff[LOGFILTER_LINE];
+	strncpy(buff, line, sizeof(buff) - 1);
+	buff[sizeof(buff) - 1] = '\0';
+	return logfilter_parse(buff);
+}
+
+//! Sends \p n frames of \p id, the payload changing every \p change frames, returns the number kept.
+static unsigned send(uint32_t id, unsigned n, unsigned change) {
+	unsigned kept = 0;
+	uint8_t data[8] = {0};
+	for (unsigned i = 0; i < n; i++) {
+		data[0] = change ? i / change : 0;
+		kept += logfilter_keep(id, 4, data);
+	}
+	return kept;
+}
+
+int main(void) {
+	static const char * bad[] = {
+		"include 1501",			// unknown action
+		"keep",				// no ID
+		"keep 15g1",			// not hex
+		"keep 1501 every",		// no count
+		"keep 1501 every 0",		// out of range
+		"keep 1501 every 256",
+		"keep 1501 sometimes",		// unknown option
+		"exclude 1501 every 2",		// options only for keep
+		"exclude 1501 change",
+		"keep 1ffffffff",		// too large
+	};
+	for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+		check(!parse(bad[i]), bad[i]);
+	}
+	check(logfilter_rules() == 0, "bad lines added rules");
+	check(parse("") && parse("   # only a comment\r\n") && logfilter_rules() == 0, "empty lines");
+
+	// no rules, everything kept
+	check(send(0x2000, 100, 0) == 100, "no rules");
+
+	check(parse("keep 4502\n"), "keep single");
+	check(parse("keep 0x6000 1fffff00 # debug"), "keep masked");
+	check(parse("exclude 6000 1ffff000"), "exclude masked");
+	check(parse("keep 1501 change every 100\r\n"), "change every");
+	check(parse("keep 1500\tchange"), "change");
+	check(parse("keep 2000 1ffffffc every 5"), "every");
+	check(parse("keep 4000 every 10"), "every single");
+	check(parse("exclude 4500 1ffffff0"), "exclude");
+	check(logfilter_rules() == LOGFILTER_RULES, "rules added");
+	check(!parse("keep 3000"), "table full");
+
+	// one second of traffic
+	check(send(0x4502, 3, 0) == 3, "4502 rare, all kept"); // before the exclude rule of 4500
+	check(send(0x6031, 50, 0) == 50, "6031 debug, all kept");
+	check(send(0x6123, 50, 0) == 0, "6123 excluded");
+	check(send(0x1501, 100, 0) == 1, "1501 constant, first kept");
+	check(send(0x1501, 100, 0) == 1, "1501 constant, once per 100");
+	check(send(0x1501, 100, 10) == 10, "1501 changing every 10th");
+	check(send(0x1500, 100, 0) == 1, "1500 constant, first only");
+	check(send(0x1500, 100, 25) == 3, "1500 changing every 25th"); // starts at the value last kept
+	check(send(0x2000, 100, 0) == 20 && send(0x2003, 100, 0) == 20, "2000-2003 every 5th");
+	check(send(0x4000, 100, 0) == 10, "4000 every 10th");
+	check(send(0x4501, 100, 0) == 0, "4501 excluded");
+	check(send(0x4001, 100, 0) == 100, "4001 no rule, kept");
+
+	logfilter_clear();
+	check(logfilter_rules() == 0 && send(0x4501, 10, 0) == 10, "cleared");
+
+	printf("%s\n", failures ? "FAILED" : "OK");
+	return failures ? 1 : 0;
+}
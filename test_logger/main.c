@@ -0,0 +1,686 @@
+/*
+ * / main.c - Host benchmark of the LUR7 logger on an emulated SD card
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_logger/main.c
+ * Benchmark of the logger, runs on the host, see the makefile.
+ *
+ * The code of the logger, \ref logger, \ref logfilter, \ref canlog,
+ * \ref logfile, FatFs and diskio.c, runs unchanged on a card emulated on a
+ * disk image, see \ref test_logger/sdcard.c. Time is simulated: the main loop
+ * calls logger_poll(void) over and over, each pass taking loop_us, while CAN
+ * frames and the 100 Hz timer interrupt it at their times, each taking
+ * isr_us of CPU time. Waiting for the card takes the time of the card model,
+ * with the interrupts running meanwhile.
+ *
+ * The frames are replayed from a CAN trace, the text format of canlog2csv
+ * or a binary LOGnnnn.BIN, optionally sped up, or generated at a given bus
+ * load. START messages can be sent at given times, and power can be cut, with
+ * or without the early warning. At the end of the run, or after power is back
+ * and the logger has recovered the torn log, every log in the session index is
+ * read back from the image through FatFs, decoded, and compared frame by
+ * frame with the frames the logger took, see \ref check_frame.
+ *
+ * Reported are the throughput, the high-water mark of the sector buffers,
+ * dropped frames, frames arriving while a log is being changed, the longest
+ * pass of the main loop and what the card did. The run fails if the logs do
+ * not match, if the drops in the index do not account for every frame lost,
+ * also while the log was changed, if a sudden power cut lost frames older
+ * than \ref LOST_MS, or with -z if any frame was lost.
+ *
+ * With -e the EEPROM of the logger is kept between runs on the same image,
+ * and -Q formats the card first, so that new logs are written over the stale
+ * sectors of the old ones.
+ *
+ * Usage: test_logger [options], see \ref usage.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "canlog.h"
+#include "canlog_decode.h"
+#include "ff.h"
+#include "logfile.h"
+#include "logfilter.h"
+#include "logger.h"
+#include "sdcard.h"
+
+//! \ref CAN_LOG_ID, as in LUR7_can.c.
+#define LOG_ID		0x00003000UL
+//! \ref CAN_MSG_LOG_START, as in LUR7_can.c.
+#define LOG_START	"TRTS"
+//! \ref CAN_MSG_LOG_STOP, as in LUR7_can.c.
+#define LOG_STOP	"POTS"
+//! Bit rate of the bus, bits per µs.
+#define CAN_MBPS	1
+//! Most START messages.
+#define MAX_STARTS	16
+//! How far ahead a missing frame is looked for.
+#define SEARCH		100000
+//! Frames lost at a sudden power cut must have arrived this close to it, ms.
+#define LOST_MS		100
+
+//! A frame on the bus.
+typedef struct {
+	uint64_t t;		//!< End of the frame, ns.
+	uint32_t id;
+	uint8_t dlc;
+	uint8_t data[8];
+} frame_t;
+
+//! A frame the logger took.
+typedef struct {
+	uint32_t stamp;		//!< Timer 1 timestamp.
+	uint32_t id;
+	uint8_t dlc;
+	uint8_t data[8];
+} logged_t;
+
+//! Helper macro, grows an array of \p n elements when it is full.
+#define GROW(a, n, cap) do { \
+	if ((n) == (cap)) { \
+		(cap) = (cap) ? 2 * (cap) : 4096; \
+		(a) = realloc((a), (cap) * sizeof(*(a))); \
+		if (!(a)) { \
+			perror("realloc"); \
+			exit(2); \
+		} \
+	} \
+} while (0)
+
+//! Options.
+static struct {
+	const char * trace;
+	double speed;
+	double load;
+	double seconds;
+	const char * rules;
+	double start[MAX_STARTS];
+	uint8_t starts;
+	double cut;		//!< ms, < 0 no cut.
+	double warning;		//!< ms before the cut, < 0 none.
+	const char * image;
+	uint32_t mib;
+	double isr_us;
+	double loop_us;
+	const char * out;
+	uint8_t no_drops;
+	const char * eeprom;
+	uint8_t format;
+	sdcard_model_t card;
+} opt = {
+	.speed = 1, .load = 100, .seconds = 20, .cut = -1, .warning = -1,
+	.image = "card.img", .mib = 1024, .isr_us = 25, .loop_us = 2,
+	.card = {.cmd_us = 50, .spi_us = 650, .read_us = 700, .busy_us = 350, .gc_us = 50000, .seed = 1},
+};
+
+//! Time of the simulation, ns.
+static uint64_t now = 0;
+
+//! The frames on the bus, in time order.
+static frame_t * input = NULL;
+static size_t inputs = 0, input_cap = 0;
+//! Next frame of \ref input.
+static size_t next_input = 0;
+//! START and STOP messages, sent as frames between those of \ref input.
+static frame_t commands[MAX_STARTS + 1];
+static uint8_t n_commands = 0, next_command = 0;
+//! Whether frames are received, see \ref logger_main.
+static uint8_t can_enabled = 0;
+//! Number of the next timer tick.
+static uint64_t tick = 0;
+//! When the early warning is given, ns, UINT64_MAX never.
+static uint64_t warning_at = UINT64_MAX;
+//! When the power is cut, ns, UINT64_MAX never.
+static uint64_t cut = UINT64_MAX;
+
+//! The frames the logger took, in order.
+static logged_t * logged = NULL;
+static size_t n_logged = 0, logged_cap = 0;
+
+//! Counters of the run.
+static struct {
+	uint64_t frames;	//!< Frames on the bus.
+	uint64_t drops;		//!< Dropped, both buffers full.
+	uint64_t filtered;	//!< Not kept by the log filter.
+	uint64_t missed;	//!< Kept by the filter while no log was open, eg. while the file was changed.
+	uint16_t high_water;	//!< Most bytes in the sector buffers.
+	uint64_t longest;	//!< Longest pass of the main loop, ns.
+	uint64_t polls;		//!< Passes of the main loop.
+	uint64_t errors;	//!< Passes where logger_poll failed.
+	uint64_t logs;		//!< Logs started.
+} run;
+
+//! Verification state.
+static struct {
+	size_t next;		//!< Next frame of \ref logged expected.
+	uint64_t matched;
+	uint64_t missing;	//!< Frames skipped in the logs.
+	uint64_t bad;		//!< Frames in the logs that were never logged.
+	uint64_t frames;	//!< Frames decoded of the current log.
+	uint64_t drops;		//!< Frames dropped in all logs, as told by the index.
+	FILE * out;
+	int errors;
+} check;
+
+//! Prints the usage.
+static void usage(const char * name) {
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -t trace   replay a trace, text as written by canlog2csv or a binary log\n"
+		"  -x speed   replay the trace this many times faster\n"
+		"  -l load    generate frames at this bus load in %%, default 100\n"
+		"  -d s       seconds of generated frames, default 20\n"
+		"  -r file    rules of the log filter, copied to the card\n"
+		"  -s ms      send START at this time, may be repeated\n"
+		"  -c ms      cut the power at this time\n"
+		"  -w ms      early warning this long before the cut\n"
+		"  -i image   the card, created and formatted if missing, default card.img\n"
+		"  -m MiB     size of a new card, default 1024\n"
+		"  -b us      card busy time per sector, default 350\n"
+		"  -g n:us    garbage collection stall of us every n sectors\n"
+		"  -G chance  garbage collection stall at random after any sector\n"
+		"  -f chance  streamed sector rejected at random\n"
+		"  -F n[:k]   streamed sector n rejected, k times in a row\n"
+		"  -S seed    seed of the random stalls and faults\n"
+		"  -I us      CPU time of the CAN interrupt, default 25\n"
+		"  -o file    write the logs read back as text\n"
+		"  -e file    EEPROM of the logger, kept in this file between runs\n"
+		"  -Q         quick format the card before the run, old sectors are left as they were\n"
+		"  -z         fail if any frame is lost, dropped or missed while the log is changed\n", name);
+	exit(2);
+}
+
+//! Helper function, loads a binary log as the trace.
+static void add_decoded(const canlog_frame_t * f, void * ctx) {
+	(void) ctx;
+	GROW(input, inputs, input_cap);
+	frame_t * in = &input[inputs++];
+	in->t = f->time * 1000;
+	in->id = f->id;
+	in->dlc = f->dlc;
+	memcpy(in->data, f->data, 8);
+}
+
+//! Loads the trace, returns 0 if it can not be read.
+static int load_trace(const char * path) {
+	FILE * f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	uint8_t sector[CANLOG_SECTOR_SIZE];
+	size_t n = fread(sector, 1, sizeof(sector), f);
+	uint32_t magic = sector[0] | sector[1] << 8 | sector[2] << 16 | (uint32_t) sector[3] << 24;
+	if (n == sizeof(sector) && (magic == CANLOG_SESSION_MAGIC || magic == CANLOG_MAGIC)) {
+		canlog_decoder_t dec;
+		canlog_decoder_init(&dec);
+		do {
+			if (canlog_decode_sector(&dec, sector, add_decoded, NULL) == CANLOG_END) {
+				break;
+			}
+		} while (fread(sector, 1, sizeof(sector), f) == sizeof(sector));
+	} else {
+		char line[256];
+		rewind(f);
+		while (fgets(line, sizeof(line), f)) {
+			char * p = line;
+			frame_t in = {.dlc = 8};
+			in.id = strtoul(p, &p, 16);
+			if (*p++ != ',') {
+				continue; // not a frame
+			}
+			in.t = strtod(p, &p) * 1e6;
+			for (uint8_t i = 0; i < 8 && *p == ','; i++) {
+				in.data[i] = strtoul(p + 1, &p, 10);
+			}
+			GROW(input, inputs, input_cap);
+			input[inputs++] = in;
+		}
+	}
+	fclose(f);
+	if (inputs == 0) {
+		fprintf(stderr, "%s: no frames\n", path);
+		return 0;
+	}
+	uint64_t t0 = input[0].t;
+	for (size_t i = 0; i < inputs; i++) {
+		input[i].t = (input[i].t - t0) / opt.speed;
+	}
+	return 1;
+}
+
+//! Generates the frames, a mix of frequent IDs and more rare ones than fit in the dictionary of a block.
+static void generate(void) {
+	uint64_t t = 0;
+	for (uint32_t k = 0; t < opt.seconds * 1e9; k++) {
+		GROW(input, inputs, input_cap);
+		frame_t * in = &input[inputs++];
+		uint8_t rare = k % 4 == 3;
+		in->id = rare ? 0x18FF0000UL + k % 23 : 0x100 + k % 8;
+		in->dlc = rare ? k % 9 : 8;
+		for (uint8_t j = 0; j < in->dlc; j++) {
+			in->data[j] = in->id & 4 ? k / 800 + j : k + j; // 0x104-0x107 change slowly
+		}
+		t += (67 + 8 * in->dlc) * 1000 / CAN_MBPS * 100 / opt.load;
+		in->t = t;
+	}
+}
+
+//! Helper function, adds a START or STOP message at \p t, ns.
+static void add_command(uint64_t t, const char * msg) {
+	frame_t * c = &commands[n_commands++];
+	c->t = t;
+	c->id = LOG_ID;
+	c->dlc = 4;
+	memcpy(c->data, msg, 4);
+}
+
+//! A frame is received, \ref CAN_ISR_RXOK of \ref logger_main.
+static void receive(const frame_t * in) {
+	uint32_t frames = canlog_frames();
+	uint32_t drops = canlog_drops();
+	uint32_t stamp = now * 16 / 1000; // timer 1 at 16 MHz
+
+	uint32_t missed = canlog_missed();
+
+	run.frames++;
+	logger_frame(stamp, in->id, in->dlc, (uint8_t *) in->data);
+	if (in->id == LOG_ID && in->dlc == 4) {
+		if (!memcmp(in->data, LOG_START, 4)) {
+			logger_command(LOG_CMD_START);
+		} else if (!memcmp(in->data, LOG_STOP, 4)) {
+			logger_command(LOG_CMD_STOP);
+		}
+	}
+
+	if (canlog_frames() != frames) {
+		GROW(logged, n_logged, logged_cap);
+		logged_t * l = &logged[n_logged++];
+		l->stamp = stamp;
+		l->id = in->id;
+		l->dlc = in->dlc;
+		memcpy(l->data, in->data, 8);
+	} else if (canlog_drops() != drops) {
+		run.drops++;
+	} else if (canlog_missed() != missed) {
+		run.missed++;
+	} else {
+		run.filtered++;
+	}
+	uint16_t b = canlog_buffered();
+	if (b > run.high_water) {
+		run.high_water = b;
+	}
+}
+
+//! Runs the interrupts due until \p until, ns.
+static void interrupts(uint64_t until) {
+	while (1) {
+		uint64_t t_tick = (tick + 1) * 10000000;
+		uint64_t t_frame = can_enabled && next_input < inputs ? input[next_input].t : UINT64_MAX;
+		uint64_t t_command = can_enabled && next_command < n_commands ? commands[next_command].t : UINT64_MAX;
+		uint64_t t = t_tick;
+		if (t_frame < t) {
+			t = t_frame;
+		}
+		if (t_command < t) {
+			t = t_command;
+		}
+		if (warning_at < t) {
+			t = warning_at;
+		}
+		if (t > until) {
+			return;
+		}
+		if (now < t) {
+			now = t;
+		}
+		if (t == warning_at) {
+			logger_power(1);
+			warning_at = UINT64_MAX;
+			now += 2000;
+		} else if (t == t_command) {
+			receive(&commands[next_command++]);
+			now += opt.isr_us * 1000;
+		} else if (t == t_frame) {
+			receive(&input[next_input++]);
+			now += opt.isr_us * 1000;
+		} else {
+			logger_tick(tick++ % 100);
+			now += 2000;
+		}
+	}
+}
+
+uint64_t sim_now(void) {
+	return now;
+}
+
+void sim_wait(uint64_t ns) {
+	uint64_t until = now + ns;
+	interrupts(until);
+	if (now < until) {
+		now = until;
+	}
+}
+
+//! One pass of the main loop.
+static void poll(void) {
+	uint8_t logging = logger_logging();
+	uint64_t t = now;
+	interrupts(now);
+	if (logger_poll()) {
+		run.errors++;
+	}
+	now += opt.loop_us * 1000;
+	if (now - t > run.longest) {
+		run.longest = now - t;
+	}
+	run.polls++;
+	if (!logging && logger_logging()) {
+		run.logs++;
+	}
+}
+
+//! Checks a frame read back from the card against \ref logged.
+/*!
+ * Frames must be found in the order they were logged. Frames missing in
+ * between are counted, from lost blocks, a frame that was never logged is an
+ * error.
+ */
+static void check_frame(const canlog_frame_t * f, void * ctx) {
+	(void) ctx;
+	check.frames++;
+	if (check.out) {
+		fprintf(check.out, "%08" PRIX32 ", %" PRIu64 ".%03u", f->id, f->time / 1000, (unsigned) (f->time % 1000));
+		for (uint8_t i = 0; i < 8; i++) {
+			fprintf(check.out, ",  %02u", f->data[i]);
+		}
+		fputc('\n', check.out);
+	}
+	for (size_t k = check.next; k < n_logged && k < check.next + SEARCH; k++) {
+		const logged_t * l = &logged[k];
+		if (l->id == f->id && l->dlc == f->dlc && !memcmp(l->data, f->data, f->dlc)
+				&& ((l->stamp >> CANLOG_TIME_SHIFT) & CANLOG_TIME_MASK) == (f->time & CANLOG_TIME_MASK)) {
+			check.missing += k - check.next;
+			check.next = k + 1;
+			check.matched++;
+			return;
+		}
+	}
+	check.bad++;
+}
+
+//! Helper function, reports a failed check.
+static void fail(const char * what, unsigned session) {
+	printf("FAIL: log %u: %s\n", session, what);
+	check.errors++;
+}
+
+//! Reads every log in the session index back from the card and checks it.
+static void verify(void) {
+	static FATFS fs;
+	FIL file;
+	FIL index;
+	UINT br;
+	uint8_t bytes[CANLOG_INDEX_SIZE];
+	uint8_t sector[CANLOG_SECTOR_SIZE];
+	uint64_t lost = 0;
+	uint32_t entries = 0;
+
+	if (f_mount(&fs, "", 1) || f_open(&index, LOGFILE_INDEX, FA_READ)) {
+		fail("no session index", 0);
+		return;
+	}
+	while (f_read(&index, bytes, sizeof(bytes), &br) == FR_OK && br == sizeof(bytes)) {
+		canlog_index_t e;
+		canlog_decoder_t dec;
+		char name[] = "LOG0000.BIN";
+		if (!canlog_parse_index(&e, bytes)) {
+			fail("bad index entry", entries);
+			break;
+		}
+		entries++;
+		check.drops += e.drops;
+		snprintf(name, sizeof(name), "LOG%04u.BIN", e.session % 10000);
+		if (f_open(&file, name, FA_READ)) {
+			fail("no file", e.session);
+			continue;
+		}
+		canlog_decoder_init(&dec);
+		check.frames = 0;
+		int res = CANLOG_OK;
+		while (f_read(&file, sector, sizeof(sector), &br) == FR_OK && br == sizeof(sector)) {
+			res = canlog_decode_sector(&dec, sector, check_frame, NULL);
+			if (res == CANLOG_END) {
+				break;
+			}
+		}
+		f_close(&file);
+		lost += dec.lost_blocks;
+
+		printf("  log %u: %s, %" PRIu32 " blocks, %" PRIu64 " frames, %" PRIu32 " drops, %" PRIu32 " lost blocks\n",
+				e.session, canlog_end_reason(e.reason), dec.blocks, dec.frames, dec.ended ? dec.end.drops : 0,
+				dec.lost_blocks);
+		if (res != CANLOG_END) {
+			fail("no end sector", e.session);
+		} else if (dec.end.reason != e.reason || dec.end.blocks != e.blocks || dec.end.drops != e.drops) {
+			fail("end sector and index differ", e.session);
+		}
+		if (dec.blocks + dec.lost_blocks != e.blocks) {
+			fail("blocks missing", e.session);
+		}
+		if (e.reason != CANLOG_END_RECOVERED && dec.lost_blocks == 0 && e.frames != check.frames) {
+			fail("frames in the index and the log differ", e.session);
+		}
+	}
+	f_close(&index);
+
+	if (entries != run.logs) {
+		fail("logs missing in the index", entries);
+	}
+	if (check.bad) {
+		fail("frames that were never logged", check.bad);
+	}
+	if (check.missing && !lost) {
+		fail("frames missing", check.missing);
+	}
+	if (opt.cut < 0 && check.drops != run.drops + run.missed) { // the last log is stopped after the last frame
+		fail("frames lost but not counted as dropped", run.drops + run.missed - check.drops);
+	}
+	size_t tail = n_logged - check.next;
+	if (tail && (opt.cut < 0 || opt.warning >= 0)) {
+		fail("last frames missing", tail);
+	} else if (tail && (uint64_t) logged[check.next].stamp * 1000 / 16 + LOST_MS * 1000000ULL < cut) {
+		fail("frames lost long before the power cut", tail);
+	}
+	printf("  read back %" PRIu64 " of %zu frames logged, %" PRIu64 " in lost blocks, %zu lost at the power cut\n",
+			check.matched, n_logged, check.missing, tail);
+}
+
+//! Helper function, copies the rules of the log filter to the card.
+static int copy_rules(const char * path) {
+	static FATFS fs;
+	FIL file;
+	UINT bw;
+	char buff[512];
+	FILE * in = fopen(path, "rb");
+	if (!in) {
+		perror(path);
+		return 0;
+	}
+	int ok = f_mount(&fs, "", 1) == FR_OK && f_open(&file, LOGFILTER_FILE, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK;
+	size_t n;
+	while (ok && (n = fread(buff, 1, sizeof(buff), in)) > 0) {
+		ok = f_write(&file, buff, n, &bw) == FR_OK && bw == n;
+	}
+	ok = ok && f_close(&file) == FR_OK;
+	fclose(in);
+	f_mount(NULL, "", 0);
+	return ok;
+}
+
+int main(int argc, char ** argv) {
+	int c;
+	while ((c = getopt(argc, argv, "t:x:l:d:r:s:c:w:i:m:b:g:G:f:F:S:I:o:e:Qz")) != -1) {
+		switch (c) {
+			case 't': opt.trace = optarg; break;
+			case 'x': opt.speed = atof(optarg); break;
+			case 'l': opt.load = atof(optarg); break;
+			case 'd': opt.seconds = atof(optarg); break;
+			case 'r': opt.rules = optarg; break;
+			case 's':
+				if (opt.starts == MAX_STARTS) {
+					usage(argv[0]);
+				}
+				opt.start[opt.starts++] = atof(optarg);
+				break;
+			case 'c': opt.cut = atof(optarg); break;
+			case 'w': opt.warning = atof(optarg); break;
+			case 'i': opt.image = optarg; break;
+			case 'm': opt.mib = atoi(optarg); break;
+			case 'b': opt.card.busy_us = atoi(optarg); break;
+			case 'g':
+				if (sscanf(optarg, "%" SCNu32 ":%" SCNu32, &opt.card.gc_every, &opt.card.gc_us) != 2) {
+					usage(argv[0]);
+				}
+				break;
+			case 'G': opt.card.gc_chance = atof(optarg); break;
+			case 'f': opt.card.fail_chance = atof(optarg); break;
+			case 'F':
+				if (sscanf(optarg, "%" SCNu32 ":%" SCNu32, &opt.card.fail_at, &opt.card.fail_times) < 1) {
+					usage(argv[0]);
+				}
+				break;
+			case 'S': opt.card.seed = atoi(optarg); break;
+			case 'I': opt.isr_us = atof(optarg); break;
+			case 'o': opt.out = optarg; break;
+			case 'e': opt.eeprom = optarg; break;
+			case 'Q': opt.format = 1; break;
+			case 'z': opt.no_drops = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+	if (optind != argc || opt.speed <= 0 || opt.load <= 0 || opt.load > 100 || opt.mib < 64) {
+		usage(argv[0]);
+	}
+	if (opt.trace ? !load_trace(opt.trace) : (generate(), 0)) {
+		return 2;
+	}
+	if (sdcard_open(opt.image, opt.mib * 2048, &opt.card)) {
+		perror(opt.image);
+		return 2;
+	}
+	if (opt.eeprom && sdcard_eeprom(opt.eeprom)) {
+		perror(opt.eeprom);
+		return 2;
+	}
+	if (opt.format && sdcard_format()) {
+		fprintf(stderr, "%s: not formatted\n", opt.image);
+		return 2;
+	}
+	if (opt.rules && !copy_rules(opt.rules)) {
+		fprintf(stderr, "%s: not copied to the card\n", opt.rules);
+		return 2;
+	}
+	if (opt.trace) {
+		printf("%s: %zu frames in %.1f s\n", opt.trace, inputs, input[inputs - 1].t / 1e9);
+	} else {
+		printf("generated: %zu frames in %.1f s, %.0f%% load\n", inputs, input[inputs - 1].t / 1e9, opt.load);
+	}
+
+	// power up as main of the logger, CAN is enabled once the first log is open
+	now = 1000000000ULL;
+	tick = now / 10000000;
+	if (logger_init()) {
+		run.errors++;
+	}
+	if (logger_logging()) {
+		run.logs++;
+	}
+	uint64_t start = now; // times of the options from here
+	for (size_t i = 0; i < inputs; i++) {
+		input[i].t += start;
+	}
+	for (uint8_t i = 0; i < opt.starts; i++) {
+		add_command(start + opt.start[i] * 1e6, LOG_START);
+	}
+	cut = opt.cut < 0 ? UINT64_MAX : start + opt.cut * 1e6;
+	if (opt.cut >= 0 && opt.warning >= 0) {
+		warning_at = cut - opt.warning * 1e6;
+	}
+	if (cut == UINT64_MAX) {
+		add_command(input[inputs - 1].t + 1000, LOG_STOP); // end the last log properly
+	}
+	for (uint8_t i = 1; i < n_commands; i++) { // insertion sort by time
+		for (uint8_t j = i; j > 0 && commands[j].t < commands[j - 1].t; j--) {
+			frame_t tmp = commands[j];
+			commands[j] = commands[j - 1];
+			commands[j - 1] = tmp;
+		}
+	}
+	can_enabled = 1;
+	while (now < cut && (next_input < inputs || next_command < n_commands || logger_logging())) {
+		poll();
+	}
+	uint64_t duration = now;
+	if (now >= cut) { // power back, the torn log is recovered when the next one is opened
+		static canlog_sector_t work; // the buffers of canlog are still full of the torn log
+		uint16_t n, id;
+		can_enabled = 0;
+		sdcard_power_cut();
+		if (logfile_open(&n, &id, (uint8_t *) &work) == FR_OK) {
+			logfile_close();
+		}
+	}
+
+	const sdcard_stats_t * s = sdcard_stats();
+	double seconds = (duration - start) / 1e9;
+	printf("  %.1f s, %" PRIu64 " frames, %zu logged, %" PRIu64 " dropped, %" PRIu64 " missed between logs,"
+			" %" PRIu64 " filtered\n", seconds, run.frames, n_logged, run.drops, run.missed, run.filtered);
+	printf("  %.1f kB/s streamed, buffers %u of %u bytes at most, longest main loop pass %.2f ms, %" PRIu64 " poll errors\n",
+			s->streamed * 512 / seconds / 1000, run.high_water, (unsigned) (2 * CANLOG_SECTOR_SIZE), run.longest / 1e6,
+			run.errors);
+	printf("  card: %" PRIu64 " sectors streamed in %" PRIu64 " writes, %" PRIu64 " through FatFs, %" PRIu64 " read,"
+			" %" PRIu64 " rejected, %" PRIu64 " stalls, %" PRIu64 " timeouts, busy %.0f%%, %" PRIu64 " protocol errors\n",
+			s->streamed, s->streams, s->writes, s->reads, s->rejects, s->stalls, s->timeouts,
+			s->busy_us / (seconds * 1e4), s->protocol);
+	if (s->protocol) {
+		fail("card protocol errors", 0);
+	}
+
+	if (opt.out) {
+		check.out = fopen(opt.out, "w");
+		if (!check.out) {
+			perror(opt.out);
+		}
+	}
+	verify();
+	if (check.out) {
+		fclose(check.out);
+	}
+	sdcard_close();
+	if (opt.no_drops && (run.drops || run.missed)) {
+		fail("frames dropped", run.drops + run.missed);
+	}
+	printf("%s\n", check.errors ? "FAILED" : "OK");
+	return check.errors ? 1 : 0;
+}
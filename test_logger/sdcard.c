@@ -0,0 +1,563 @@
+/*
+ * / sdcard.c - SD card emulated on a disk image, for host tests of the logger
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_logger/sdcard.c
+ * The functions of SD_routines.h on a disk image file instead of a card, so
+ * that \ref diskio.c, FatFs and \ref logfile run unchanged on the host.
+ *
+ * Every sector read or written is read or written in the image. Time is
+ * taken from the simulation of the test, sim_now(void) and sim_wait(uint64_t)
+ * with interrupts running while the card is waited for:
+ *
+ * - Commands wait for the card to be ready, then take cmd_us. Sectors read
+ *   take read_us more, sectors written through FatFs spi_us to send, then
+ *   the card is busy for busy_us while the caller goes on.
+ * - A streamed sector, SD_stream_begin, is sent by the SPI interrupt in
+ *   spi_us, SD_stream_result tells when. It is written to the image then, so
+ *   a buffer modified while it is sent is caught. The card is then busy for
+ *   busy_us, SD_poll and SD_stream_ready tell when it is done.
+ * - After any sector written the card may stall, garbage collection, for
+ *   gc_us: every gc_every sectors and at random with gc_chance.
+ * - Busy for longer than \ref SD_TIMEOUT_WRITE the card times out as in
+ *   SD_routines.c: SD_poll gives up the multiple block write, and a command
+ *   fails if the card does not get ready in time.
+ * - A streamed sector may be rejected, at random with fail_chance or sector
+ *   fail_at of the run, fail_times in a row. The multiple block write is then
+ *   ended by the card and must be started again. Writes through FatFs never
+ *   fail.
+ *
+ * Commands the card would not accept, eg. a single block write in the middle
+ * of a multiple block write, are counted as protocol errors.
+ *
+ * A new image is formatted FAT32 with 4 KiB clusters, as the cards used in
+ * the car, and grows as it is written.
+ *
+ * sdcard_format(void) formats the card again as a PC would, leaving the
+ * sectors of the deleted files as they were.
+ *
+ * The EEPROM of the logger, the variables of the EEMEM section, is kept in a
+ * file of its own by sdcard_eeprom(const char *), so that it outlasts the
+ * logs on the card as it does in the car.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "integer.h"
+#include "SD_routines.h"
+#include "sdcard.h"
+
+//! Sectors of the reserved area, FAT32.
+#define RESERVED	32
+//! Sectors per cluster.
+#define CLUSTER		8
+
+//! The image.
+static int image = -1;
+//! Size of the card, sectors.
+static uint32_t size;
+//! The model.
+static sdcard_model_t model;
+//! What the card has done.
+static sdcard_stats_t stats;
+//! State of the random stalls and faults.
+static uint32_t random_state;
+
+//! When the card started programming, ns.
+static uint64_t busy_from;
+//! When the card has finished programming, ns.
+static uint64_t busy_until;
+//! Whether the card was ready when last polled, it stays so until the next sector.
+static uint8_t ready;
+//! Whether the card timed out, until the next command.
+static uint8_t timed_out;
+//! Whether a multiple block write is in progress.
+static uint8_t streaming;
+//! Next sector of the multiple block write.
+static uint32_t stream_sector;
+//! Whether the SPI interrupt is sending a sector.
+static uint8_t sending;
+//! Sector being sent.
+static const uint8_t * sending_buff;
+//! When the sector has been sent, ns.
+static uint64_t sending_done;
+//! Result of the last sector sent, 0 accepted, 1 rejected.
+static uint8_t sending_result;
+
+//! File of the EEPROM, -1 if it is only kept in memory.
+static int eeprom = -1;
+//! The EEMEM section, see avr/eeprom.h.
+extern uint8_t __start_host_eeprom[], __stop_host_eeprom[];
+
+//! Helper function, a random number in [0, 1).
+static double random_unit(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state / 4294967296.0;
+}
+
+//! Helper function, writes a sector of the image.
+static uint8_t put(uint32_t sector, const void * buff) {
+	return sector < size && pwrite(image, buff, 512, (off_t) sector * 512) == 512;
+}
+
+//! Helper function, reads a sector of the image, never written sectors are zero.
+static uint8_t get(uint32_t sector, void * buff) {
+	if (sector >= size) {
+		return 0;
+	}
+	ssize_t n = pread(image, buff, 512, (off_t) sector * 512);
+	if (n < 0) {
+		return 0;
+	}
+	memset((uint8_t *) buff + n, 0, 512 - n);
+	return 1;
+}
+
+//! Helper function, waits until the card has finished programming.
+/*!
+ * \return 1, or 0 if it did not within \ref SD_TIMEOUT_WRITE.
+ */
+static uint8_t wait_ready(void) {
+	uint64_t end = sim_now() + SD_TIMEOUT_WRITE * 1000000ULL;
+	if (busy_until > end) {
+		sim_wait(end - sim_now());
+		stats.timeouts++;
+		timed_out = 1;
+		return 0;
+	}
+	if (sim_now() < busy_until) {
+		sim_wait(busy_until - sim_now());
+	}
+	timed_out = 0;
+	return 1;
+}
+
+//! Helper function, a command other than a streamed sector.
+/*!
+ * \return 1, or 0 if the card was not ready.
+ */
+static uint8_t command(void) {
+	if (streaming || sending) {
+		stats.protocol++; // the card takes it for data, the stream is lost
+		streaming = 0;
+		sending = 0;
+	}
+	if (!wait_ready()) {
+		return 0;
+	}
+	sim_wait(model.cmd_us * 1000ULL);
+	return 1;
+}
+
+//! Helper function, the card programs a sector written at \p t, ns.
+static void program(uint64_t t) {
+	uint64_t busy = model.busy_us;
+	uint64_t n = stats.writes + stats.streamed;
+	if ((model.gc_every && n % model.gc_every == 0) || random_unit() < model.gc_chance) {
+		busy += model.gc_us;
+		stats.stalls++;
+	}
+	stats.busy_us += busy;
+	busy_from = t;
+	busy_until = t + busy * 1000;
+	ready = 0;
+}
+
+//! Helper function, stores a little endian value.
+static void store(uint8_t * p, uint32_t value, uint8_t bytes) {
+	for (uint8_t i = 0; i < bytes; i++) {
+		p[i] = value >> (8 * i);
+	}
+}
+
+//! Helper function, formats the image FAT32.
+static uint8_t format(void) {
+	uint8_t s[512];
+	uint32_t fat = (size - RESERVED + (128 * CLUSTER + 1) - 1) / (128 * CLUSTER + 1); // sectors per FAT, two FATs
+	memset(s, 0, sizeof(s));
+	memcpy(s, "\xEB\x58\x90" "MSDOS5.0", 11);
+	store(s + 11, 512, 2);		// bytes per sector
+	s[13] = CLUSTER;
+	store(s + 14, RESERVED, 2);
+	s[16] = 2;			// FATs
+	s[21] = 0xF8;			// fixed disk
+	store(s + 24, 63, 2);		// sectors per track
+	store(s + 26, 255, 2);		// heads
+	store(s + 32, size, 4);
+	store(s + 36, fat, 4);
+	store(s + 44, 2, 4);		// root directory cluster
+	store(s + 48, 1, 2);		// FSInfo sector
+	store(s + 50, 6, 2);		// backup boot sector
+	s[64] = 0x80;			// drive
+	s[66] = 0x29;			// extended boot signature
+	store(s + 67, 0x4C555237, 4);	// volume ID
+	memcpy(s + 71, "LUR7 LOG   FAT32   ", 19);
+	s[510] = 0x55;
+	s[511] = 0xAA;
+	if (!put(0, s) || !put(6, s)) {
+		return 0;
+	}
+
+	memset(s, 0, sizeof(s));
+	store(s, 0x41615252, 4);
+	store(s + 484, 0x61417272, 4);
+	store(s + 488, 0xFFFFFFFF, 4);	// free clusters not known
+	store(s + 492, 0xFFFFFFFF, 4);
+	s[510] = 0x55;
+	s[511] = 0xAA;
+	if (!put(1, s) || !put(7, s)) {
+		return 0;
+	}
+
+	memset(s, 0, sizeof(s));
+	store(s, 0x0FFFFFF8, 4);	// media
+	store(s + 4, 0x0FFFFFFF, 4);
+	store(s + 8, 0x0FFFFFFF, 4);	// root directory, one cluster
+	for (uint8_t i = 0; i < 2; i++) {
+		if (!put(RESERVED + i * fat, s)) {
+			return 0;
+		}
+	}
+	return ftruncate(image, (off_t) size * 512) == 0;
+}
+
+//! Formats the card again, as a quick format on a PC.
+/*!
+ * Only the file system is written anew, the FATs and the root directory are
+ * cleared, and the data sectors keep what the old files left there.
+ *
+ * \return 0, or -1 if the image could not be written.
+ */
+int sdcard_format(void) {
+	uint8_t s[512];
+	uint32_t fat = (size - RESERVED + (128 * CLUSTER + 1) - 1) / (128 * CLUSTER + 1);
+	memset(s, 0, sizeof(s));
+	for (uint32_t i = 0; i < 2 * fat + CLUSTER; i++) { // both FATs and the root directory
+		if (!put(RESERVED + i, s)) {
+			return -1;
+		}
+	}
+	return format() ? 0 : -1;
+}
+
+//! Opens the card.
+/*!
+ * \param path the image, formatted if it is created.
+ * \param sectors size of a new card.
+ * \param m the model.
+ * \return 0, or -1 if the image can not be opened.
+ */
+int sdcard_open(const char * path, uint32_t sectors, const sdcard_model_t * m) {
+	image = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (image >= 0) {
+		size = sectors;
+		if (!format()) {
+			close(image);
+			return -1;
+		}
+	} else {
+		image = open(path, O_RDWR);
+		if (image < 0) {
+			return -1;
+		}
+		off_t end = lseek(image, 0, SEEK_END);
+		size = end / 512;
+	}
+	model = *m;
+	random_state = model.seed ? model.seed : 1;
+	memset(&stats, 0, sizeof(stats));
+	ready = 0;
+	sdcard_power_cut();
+	return 0;
+}
+
+//! Closes the card.
+void sdcard_close(void) {
+	if (image >= 0) {
+		close(image);
+	}
+	image = -1;
+	if (eeprom >= 0) {
+		close(eeprom);
+	}
+	eeprom = -1;
+}
+
+//! Removes power, a sector being sent is lost.
+void sdcard_power_cut(void) {
+	busy_until = 0;
+	timed_out = 0;
+	streaming = 0;
+	sending = 0;
+}
+
+//! Keeps the EEPROM of the logger in a file.
+/*!
+ * The EEPROM is read from \p path now, a new file is erased, and saved to it
+ * whenever it is written.
+ *
+ * \param path the file.
+ * \return 0, or -1 if the file can not be opened.
+ */
+int sdcard_eeprom(const char * path) {
+	size_t n = __stop_host_eeprom - __start_host_eeprom;
+	eeprom = open(path, O_RDWR | O_CREAT, 0644);
+	if (eeprom < 0) {
+		return -1;
+	}
+	if (pread(eeprom, __start_host_eeprom, n, 0) != (ssize_t) n) {
+		memset(__start_host_eeprom, 0xFF, n);
+	}
+	return 0;
+}
+
+void eeprom_update_word(uint16_t * addr, uint16_t value) {
+	*addr = value;
+	if (eeprom >= 0 && pwrite(eeprom, __start_host_eeprom, __stop_host_eeprom - __start_host_eeprom, 0) < 0) {
+		perror("eeprom");
+	}
+}
+
+//! Gets what the card has done.
+const sdcard_stats_t * sdcard_stats(void) {
+	return &stats;
+}
+
+/*
+ * The functions of SD_routines.h.
+ */
+
+uint8_t SD_init(void) {
+	sdcard_power_cut();
+	sim_wait(model.cmd_us * 1000ULL * 4);
+	return image < 0;
+}
+
+void SD_deselect(void) {
+}
+
+uint16_t SD_select(void) {
+	return wait_ready();
+}
+
+uint8_t SD_sendCommand(uint8_t cmd, uint32_t arg) {
+	(void) cmd;
+	(void) arg;
+	return command() ? 0 : 0xff;
+}
+
+uint8_t SD_readSingleBlock(uint8_t * buff, uint32_t sector) {
+	if (!command()) {
+		return 1;
+	}
+	sim_wait(model.read_us * 1000ULL);
+	stats.reads++;
+	return !get(sector, buff);
+}
+
+uint16_t SD_readMultipleBlock(uint8_t * buff, uint32_t sector, uint16_t count) {
+	if (!command()) {
+		return count;
+	}
+	for (; count; count--) {
+		sim_wait(model.read_us * 1000ULL);
+		if (!get(sector++, buff)) {
+			break;
+		}
+		stats.reads++;
+		buff += 512;
+	}
+	return count;
+}
+
+uint8_t SD_writeSingleBlock(uint8_t * buff, uint32_t sector) {
+	return SD_writeMultipleBlock(buff, sector, 1);
+}
+
+uint8_t SD_writeMultipleBlock(uint8_t * buff, uint32_t sector, uint16_t count) {
+	if (!command()) {
+		return 1;
+	}
+	for (; count; count--) {
+		if (!wait_ready()) {
+			return 1;
+		}
+		sim_wait(model.spi_us * 1000ULL);
+		if (!put(sector++, buff)) {
+			return 1;
+		}
+		stats.writes++;
+		program(sim_now());
+		buff += 512;
+	}
+	return 0; // the card programs the last sector meanwhile
+}
+
+uint8_t SD_stream_start(uint32_t sector, uint32_t count) {
+	(void) count; // pre-erase hint
+	if (!command()) {
+		return 1;
+	}
+	streaming = 1;
+	stream_sector = sector;
+	stats.streams++;
+	return 0;
+}
+
+uint8_t SD_stream_write(const uint8_t * buff) {
+	uint8_t res;
+	while (!SD_stream_ready()) {
+		if (timed_out) {
+			return 1;
+		}
+	}
+	SD_stream_begin(buff);
+	while ((res = SD_stream_result()) == 0xff) {
+		sim_wait(1000);
+	}
+	return res;
+}
+
+uint8_t SD_stream_ready(void) {
+	return SD_poll() == SD_READY;
+}
+
+void SD_stream_begin(const uint8_t * buff) {
+	if (sending || sim_now() < busy_until) {
+		stats.protocol++; // previous sector not done
+	}
+	sending = 1;
+	sending_buff = buff;
+	sending_done = sim_now() + model.spi_us * 1000ULL;
+}
+
+//! Helper function, the card takes or rejects the sector that has been sent.
+static void received(void) {
+	sending = 0;
+	uint64_t n = stats.streamed + stats.rejects + 1;
+	if (!streaming || (model.fail_at && n >= model.fail_at && n < model.fail_at + (model.fail_times ? model.fail_times : 1))
+			|| random_unit() < model.fail_chance
+			|| !put(stream_sector, sending_buff)) {
+		stats.rejects++;
+		streaming = 0; // ended by the card
+		sending_result = 1;
+		return;
+	}
+	stream_sector++;
+	stats.streamed++;
+	program(sending_done);
+	sending_result = 0;
+}
+
+uint8_t SD_stream_result(void) {
+	if (SD_poll() == SD_SENDING) {
+		return 0xff;
+	}
+	return sending_result;
+}
+
+uint8_t SD_stream_stop(void) {
+	if (sending) {
+		stats.protocol++;
+		sending = 0;
+	}
+	streaming = 0;
+	if (!wait_ready()) {
+		return 1;
+	}
+	sim_wait(model.cmd_us * 1000ULL);
+	return 0;
+}
+
+uint8_t SD_poll(void) {
+	if (sending) {
+		if (sim_now() < sending_done) {
+			return SD_SENDING;
+		}
+		received();
+	}
+	if (timed_out) {
+		return SD_TIMEOUT;
+	}
+	if (ready) { // the time is not read, so a main loop polling the card idle is seen to only poll
+		return SD_READY;
+	}
+	if (sim_now() >= busy_until) {
+		ready = 1;
+		return SD_READY;
+	}
+	sim_wait(1000); // one byte clocked
+	if (sim_now() >= busy_until) {
+		ready = 1;
+		return SD_READY;
+	}
+	if (sim_now() >= busy_from + SD_TIMEOUT_WRITE * 1000000ULL) {
+		stats.timeouts++;
+		timed_out = 1;
+		streaming = 0; // given up, the card is deselected
+		return SD_TIMEOUT;
+	}
+	return SD_BUSY;
+}
+
+uint8_t SD_busy(void) {
+	uint8_t s = SD_poll();
+	return s == SD_SENDING || s == SD_BUSY;
+}
+
+uint8_t SD_sync(void) {
+	return SD_select();
+}
+
+uint8_t SD_get_sector_count(void * buff) {
+	*(DWORD *) buff = size;
+	return 1;
+}
+
+uint8_t SD_get_block_size(void * buff) {
+	*(DWORD *) buff = 8192; // erase block, sectors
+	return 1;
+}
+
+uint8_t SD_get_cardType(void) {
+	return CT_SD2 | CT_BLOCK;
+}
+
+uint8_t SD_read_csd(uint8_t * ptr) {
+	(void) ptr;
+	return 0;
+}
+
+uint8_t SD_read_cid(uint8_t * ptr) {
+	(void) ptr;
+	return 0;
+}
+
+uint8_t SD_read_ocr(uint8_t * ptr) {
+	(void) ptr;
+	return 0;
+}
+
+uint8_t SD_get_status(uint8_t * ptr) {
+	(void) ptr;
+	return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * / sdcard.h - SD card emulated on a disk image, for host tests of the logger
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_logger/sdcard.h
+ * SD card emulated on a disk image, see \ref test_logger/sdcard.c.
+ */
+
+#ifndef _SDCARD_H_
+#define _SDCARD_H_
+
+#include <stdint.h>
+
+//! Timing and faults of the emulated card.
+typedef struct {
+	uint32_t cmd_us;	//!< Command and response.
+	uint32_t spi_us;	//!< Sending a sector, 514 bytes over SPI.
+	uint32_t read_us;	//!< Reading a sector.
+	uint32_t busy_us;	//!< Programming a sector.
+	uint32_t gc_every;	//!< A stall every nth sector written, 0 never.
+	double gc_chance;	//!< Chance of a stall after any sector written.
+	uint32_t gc_us;		//!< Length of a stall.
+	double fail_chance;	//!< Chance that a streamed sector is rejected.
+	uint32_t fail_at;	//!< Streamed sector n, counting from 1, is rejected, 0 never.
+	uint32_t fail_times;	//!< Number of times in a row sector fail_at is rejected, 0 once.
+	uint32_t seed;		//!< Seed of the random stalls and faults.
+} sdcard_model_t;
+
+//! What the card has done.
+typedef struct {
+	uint64_t reads;		//!< Sectors read.
+	uint64_t writes;	//!< Sectors written through FatFs.
+	uint64_t streamed;	//!< Sectors written in a stream.
+	uint64_t rejects;	//!< Streamed sectors rejected.
+	uint64_t streams;	//!< Multiple block writes started.
+	uint64_t stalls;	//!< Garbage collection stalls.
+	uint64_t busy_us;	//!< Total time programming, including stalls.
+	uint64_t protocol;	//!< Commands the card would not have accepted.
+	uint64_t timeouts;	//!< Times the card was busy too long.
+} sdcard_stats_t;
+
+int sdcard_open(const char * path, uint32_t sectors, const sdcard_model_t * model);
+void sdcard_close(void);
+void sdcard_power_cut(void);
+int sdcard_format(void);
+int sdcard_eeprom(const char * path);
+const sdcard_stats_t * sdcard_stats(void);
+
+//! Time of the simulation, ns, implemented by the test.
+uint64_t sim_now(void);
+//! Waits \p ns while interrupts run, implemented by the test.
+void sim_wait(uint64_t ns);
+
+#endif // _SDCARD_H_
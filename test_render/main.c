@@ -0,0 +1,156 @@
+/*
+ * / main.c - Host unit test of the display rendering of the LUR7
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_render/main.c
+ * Checks \ref render.c against the loop, float and if-chain implementations it
+ * replaced, for every possible input. Runs on the host, see the makefile.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "display.h"
+#include "render.h"
+
+//! Previous rev bar implementation, float arithmetic.
+static uint8_t ref_rev_bar(uint16_t revs) {
+	const float rev_min = REV_MIN, rev_max = REV_MAX;
+	const float bar_min = REV_BAR_MIN, bar_max = REV_BAR_MAX;
+	float return_val = (revs - rev_min) / (rev_max - rev_min) * bar_max + bar_min;
+	if (return_val < bar_min) {
+		return 0;
+	} else if (return_val > bar_max) {
+		return bar_max;
+	}
+	return return_val;
+}
+
+//! Previous temperature bar implementation, if-chain.
+static uint8_t ref_temp_bar(uint16_t temperature) {
+	if (temperature < TEMP_LVL_1) {
+		return 0;
+	} else if (temperature < TEMP_LVL_2) {
+		return 1;
+	} else if (temperature < TEMP_LVL_3) {
+		return 2;
+	} else if (temperature < TEMP_LVL_4) {
+		return 3;
+	} else if (temperature < TEMP_LVL_5) {
+		return 4;
+	} else if (temperature < TEMP_LVL_6) {
+		return 5;
+	} else if (temperature < TEMP_LVL_7) {
+		return 6;
+	} else if (temperature < TEMP_LVL_8) {
+		return 7;
+	} else if (temperature < TEMP_LVL_9) {
+		return 8;
+	} else if (temperature < TEMP_LVL_10) {
+		return 9;
+	}
+	return 10;
+}
+
+//! Previous BCD implementation, repeated subtraction.
+static void ref_bcd(uint16_t value, uint8_t * bcd_vect) {
+	if (value >= 100) {
+		bcd_vect[0] = 0;
+		while (value >= 100) {
+			value -= 100;
+			bcd_vect[0]++;
+		}
+	} else {
+		bcd_vect[0] = 10;
+	}
+
+	if (value >= 10) {
+		bcd_vect[1] = 0;
+		while (value >= 10) {
+			value -= 10;
+			bcd_vect[1]++;
+		}
+	} else {
+		if (bcd_vect[0] == 10) {
+			bcd_vect[1] = 10;
+		} else {
+			bcd_vect[1] = 0;
+		}
+	}
+
+	bcd_vect[2] = 0;
+	while (value >= 1) {
+		value -= 1;
+		bcd_vect[2]++;
+	}
+}
+
+//! Previous seven segment implementation.
+static uint8_t ref_7seg(uint8_t binary, uint8_t dp) {
+	static const uint8_t sev_seg[12] = {
+		0b11111100, 0b01100000, 0b11011010, 0b11110010, 0b01100110, 0b10110110,
+		0b10111110, 0b11100000, 0b11111110, 0b11110110, 0b00000000
+	};
+	if (binary <= 10) {
+		if (!dp) {
+			return sev_seg[binary];
+		} else {
+			return sev_seg[binary] + 1;
+		}
+	}
+	return sev_seg[10];
+}
+
+int main(void) {
+	uint32_t errors = 0;
+
+	for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+		uint8_t bcd[3], ref[3];
+		render_bcd(i, bcd);
+		ref_bcd(i, ref);
+		if (bcd[0] != ref[0] || bcd[1] != ref[1] || bcd[2] != ref[2]) {
+			if (errors++ < 10) {
+				printf("bcd(%u): %u %u %u, expected %u %u %u\n", i, bcd[0], bcd[1], bcd[2], ref[0], ref[1], ref[2]);
+			}
+		}
+		if (render_rev_bar(i) != ref_rev_bar(i)) {
+			if (errors++ < 10) {
+				printf("rev_bar(%u): %u, expected %u\n", i, render_rev_bar(i), ref_rev_bar(i));
+			}
+		}
+		if (render_temp_bar(i) != ref_temp_bar(i)) {
+			if (errors++ < 10) {
+				printf("temp_bar(%u): %u, expected %u\n", i, render_temp_bar(i), ref_temp_bar(i));
+			}
+		}
+	}
+	for (uint16_t i = 0; i <= UINT8_MAX; i++) {
+		for (uint8_t dp = 0; dp < 2; dp++) {
+			if (render_7seg(i, dp) != ref_7seg(i, dp)) {
+				if (errors++ < 10) {
+					printf("7seg(%u, %u): 0x%02x, expected 0x%02x\n", i, dp, render_7seg(i, dp), ref_7seg(i, dp));
+				}
+			}
+		}
+	}
+
+	if (errors) {
+		printf("FAIL: %u errors\n", errors);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * / main.c - Host measurement of the SPI block transfer of the LUR7 logger
+ * / Copyright (C) 2015  Simon Wrafter <simon.wrafter@gmail.com>
+ * /
+ * / This program is free software: you can redistribute it and/or modify
+ * / it under the terms of the GNU General Public License as published by
+ * / the Free Software Foundation, either version 3 of the License, or
+ * / (at your option) any later version.
+ * /
+ * / This program is distributed in the hope that it will be useful,
+ * / but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * / MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * / GNU General Public License for more details.
+ * /
+ * / You should have received a copy of the GNU General Public License
+ * / along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file test_spi/main.c
+ * Checks the sending of log sectors by Logger/SPI_routines.c, runs on the
+ * host, see the makefile.
+ *
+ * The file is built unchanged on the ATmega32M1 simulated by \ref sim, where
+ * a byte takes 16 clocks on the SPI at 8 MHz. Sectors are requested by a
+ * timer interrupt at a given rate for one second and sent as a data block,
+ * token, 512 bytes, CRC and data response, either from the SPI interrupt by
+ * SPI_block_write or by polling each byte with SPI_transmit in the main loop,
+ * as before. Every sector must be sent, and from the interrupt the main loop
+ * must be held up far less than when polling.
+ *
+ * The times printed are those of the model, not of the MCU: \ref sim_isr_ns
+ * is the 16 clocks of each byte on the SPI and \ref SIM_ACCESS_CLOCKS per
+ * register access, the instructions in between are not counted. That the
+ * interrupt costs about as much as polling follows from the model, it is not
+ * a measurement, see SPI_routines.c for the cycles counted by hand. The
+ * card is not simulated either, the time it is busy programming is left out.
+ *
+ * 211 sectors/s is a 1 Mbit/s bus at 100% load with 8 byte frames, 7634
+ * frames/s at 13.5 bytes each as logged by \ref canlog, see test_canlog.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../header_and_config/LUR7.h"
+#include "SPI_routines.h"
+#include "sim.h"
+
+//! Length of a run, s.
+#define RUN_S		1
+//! Timer1 clocks per second, prescaler 1024.
+#define TIMER1_HZ	(SIM_F_CPU / 1024)
+//! Vector of the SPI interrupt, SPI_STC_vect.
+#define SPI_VECTOR	26
+//! Longest time an interrupt of the block transfer may take in the model, ns.
+#define BURST_MAX_NS	45000
+
+//! Send by polling instead of from the interrupt.
+static uint8_t polled = 0;
+//! Timer1 clocks between requests.
+static uint16_t period = 0;
+//! Sectors to request in the run.
+static uint16_t limit = 0;
+//! Sectors requested by the timer.
+static volatile uint16_t requested = 0;
+//! Sectors requested, not yet started.
+static volatile uint16_t due = 0;
+//! Sectors sent.
+static volatile uint16_t sent = 0;
+//! Time spent sending in the main loop, ns.
+static uint64_t main_ns = 0;
+//! The sector sent.
+static uint8_t sector[512];
+
+//! Requests the next sector.
+ISR(TIMER1_COMPA_vect) {
+	if (requested < limit) {
+		requested++;
+		due++;
+	}
+}
+
+//! Called from the SPI interrupt when a block is sent.
+static void block_done(uint8_t response) {
+	(void) response; // nothing answers on the simulated SPI
+	sent++;
+}
+
+//! Main of the firmware, sends the sectors as they are requested.
+static int firmware(void) {
+	SPI_init();
+	SPI_high_speed(); // 8 MHz
+	OCR1A = period - 1;
+	TCCR1B = (1 << WGM12) | (1 << CS12) | (1 << CS10); // CTC, prescaler 1024
+	TIMSK1 = (1 << OCIE1A);
+	sei();
+	while (1) {
+		if (due && !SPI_block_busy()) {
+			uint64_t start = sim_now();
+			due--;
+			if (polled) {
+				SPI_transmit(0xFC); // token of a multiple block write
+				for (uint16_t i = 0; i < 512; i++) {
+					SPI_transmit(sector[i]);
+				}
+				SPI_transmit(0xff); // dummy CRC
+				SPI_transmit(0xff);
+				SPI_receive(); // data response
+				sent++;
+			} else {
+				SPI_block_write(sector, 0xFC, block_done);
+			}
+			main_ns += sim_now() - start;
+		} else {
+			(void) SPSR; // the rest of the main loop, time passes on a register access
+		}
+	}
+	return 0;
+}
+
+//! Sends \p rate sectors in a second, returns the CPU time taken in the model, ns.
+static uint64_t run(uint16_t rate, uint8_t by_polling) {
+	polled = by_polling;
+	period = TIMER1_HZ / rate;
+	limit = rate * RUN_S;
+	requested = 0;
+	due = 0;
+	sent = 0;
+	main_ns = 0;
+	sim_init(firmware, NULL);
+	sim_run_until(RUN_S * 1000000000ULL + 10000000); // the last sector is sent
+	uint64_t isr_ns = sim_isr_ns(SPI_VECTOR);
+	const sim_profile_t * isr = sim_isr_profile(SPI_VECTOR);
+	uint64_t cpu = isr_ns + main_ns;
+	if (!sent) {
+		printf("FAIL: no sector sent at %u sectors/s\n", rate);
+		return 0;
+	}
+	printf("  %3u sectors/s, %s, model: %4.1f%% CPU, %3.0f us per sector, %5.1f us in the main loop", rate,
+			by_polling ? "polled   " : "interrupt", cpu / (RUN_S * 1e7), cpu / 1e3 / sent, main_ns / 1e3 / sent);
+	if (!by_polling) {
+		printf(", %2.0f interrupts of %4.1f us", (double) isr->count / sent, isr_ns / 1e3 / isr->count);
+	}
+	printf("\n");
+	if (sent != limit) {
+		printf("FAIL: %u of %u sectors sent\n", sent, limit);
+		return 0;
+	}
+	if (!by_polling && isr_ns / isr->count > BURST_MAX_NS) {
+		printf("FAIL: an interrupt takes %.1f us, CAN waits for it\n", isr_ns / 1e3 / isr->count);
+		return 0;
+	}
+	return cpu;
+}
+
+//! Runs the block transfer at log rates up to 100% load.
+/*!
+ * Fails if a sector is not sent, an interrupt takes too long, or the main
+ * loop is not held up far less than when polling.
+ */
+int main(void) {
+	static const uint16_t rates[] = {50, 100, 211};
+	uint8_t failed = 0;
+	for (uint8_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+		uint64_t irq = run(rates[i], 0);
+		uint64_t held = main_ns;
+		uint64_t poll = run(rates[i], 1);
+		if (!irq || !poll || held * 10 > main_ns) {
+			failed = 1;
+		}
+	}
+	printf(failed ? "FAIL\n" : "OK\n");
+	return failed;
+}
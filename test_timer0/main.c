@@ -31,7 +31,6 @@ int main(void) {
 	return 0;
 }
 
-
 void timer1_isr_100Hz(uint8_t interrupt_nbr) {
 	set_output(OUT1, HIGH);
 	timer0_start(10);
@@ -41,16 +40,6 @@ void timer0_isr_stop(void) {
 	set_output(OUT1, LOW);
 }
 
-void pcISR_in1(void) {}
-void pcISR_in2(void) {}
-void pcISR_in3(void) {}
-void pcISR_in4(void) {}
-void pcISR_in5(void) {}
-void pcISR_in6(void) {}
-void pcISR_in7(void) {}
-void pcISR_in8(void) {}
-void pcISR_in9(void) {}
-
 void CAN_ISR_RXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {}
 void CAN_ISR_TXOK(uint8_t mob, uint32_t id, uint8_t dlc, uint8_t * data) {}
 void CAN_ISR_OTHER(void) {}
@@ -28,16 +28,6 @@ int main(void) {
 	return 0;
 }
 
-void pcISR_in1(void) {}
-void pcISR_in2(void) {}
-void pcISR_in3(void) {}
-void pcISR_in4(void) {}
-void pcISR_in5(void) {}
-void pcISR_in6(void) {}
-void pcISR_in7(void) {}
-void pcISR_in8(void) {}
-void pcISR_in9(void) {}
-
 void timer1_isr_100Hz(uint8_t interrupt_nbr) {
 	toggle_output(OUT1);
 }
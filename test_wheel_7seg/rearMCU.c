@@ -20,7 +20,6 @@
 #include "rearMCU.h"
 //#include "../header_and_config/LUR7_io.h"
 
-
 static volatile uint16_t speed_l = 0;
 static volatile uint16_t speed_r = 0;
 static volatile uint16_t susp_l = 0;
@@ -114,13 +113,3 @@ uint8_t bin_to_7seg(uint8_t binary, uint8_t dp) {
 	return sev_seg[10];
 }
 
-void pcISR_in1(){}
-void pcISR_in2(){}
-void pcISR_in3(){}
-void pcISR_in4(){}
-void pcISR_in5(){}
-void pcISR_in6(){}
-void pcISR_in7(){}
-void pcISR_in8(){}
-void pcISR_in9(){}
-